@@ -123,7 +123,7 @@ int toy_work_handler(
         else
         {
             /* Calculate the amount of memory needed */
-            size_t size_needed = work->object_ids_count * 2 * sizeof(gpi_model_state_component_t);
+            size_t size_needed = sizeof(gpi_model_bin_header_t) + work->object_ids_count * sizeof(gpi_model_edge_key_t);
             uint16_t pages_needed = DIV_ROUND_UP(size_needed, SIZE_BITS_TO_BYTES(MO_PAGE_BITS));
 
             /* Initialize the model state */
@@ -147,20 +147,15 @@ int toy_work_handler(
                 }
 
                 /* Add the toy -> toy_maps map edge*/
-                char toy_id_str[CSV_MAX_STRING_SIZE];
-                char toy_map_id_str[CSV_MAX_STRING_SIZE];
+                gpi_model_node_key_t toy_key = get_resource_key(make_res_id(get_toy_server()->gen.resource_type,
+                                                                            get_toy_server()->gen.default_space.id,
+                                                                            toy_id));
 
-                get_resource_id(make_res_id(get_toy_server()->gen.resource_type,
-                                            get_toy_server()->gen.default_space.id,
-                                            toy_id),
-                                toy_id_str);
+                gpi_model_node_key_t toy_map_key = get_resource_key(make_res_id(get_toy_server()->maps_type,
+                                                                                get_toy_server()->toy_maps[toy_id].space_id,
+                                                                                get_toy_server()->toy_maps[toy_id].id));
 
-                get_resource_id(make_res_id(get_toy_server()->maps_type,
-                                            get_toy_server()->toy_maps[toy_id].space_id,
-                                            get_toy_server()->toy_maps[toy_id].id),
-                                toy_map_id_str);
-
-                add_edge_by_id(model_state, GPI_EDGE_TYPE_MAP, toy_id_str, toy_map_id_str);
+                add_edge_by_id(model_state, GPI_EDGE_TYPE_MAP, toy_key, toy_map_key);
             }
 
             /* Send the result */
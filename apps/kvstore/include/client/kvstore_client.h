@@ -5,9 +5,11 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <sel4/sel4.h>
 #include <sel4/types.h>
+#include <sel4gpi/mo_client_context.h>
 
 #include <kvstore_shared.h>
 
@@ -71,5 +73,101 @@ int kvstore_client_set(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, seL4_Word ke
  */
 int kvstore_client_get(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, seL4_Word key, seL4_Word *value);
 
+/**
+ * @brief Put a batch of key-value pairs in the kv store, with one request
+ * The pairs are applied in a single transaction, overwriting any previous values
+ *
+ * @param kvstore_ep endpoint of a particular kvstore resource, if using a remote kvstore
+ * @param store_id ID of a particular kvstore, if using a local kvstore
+ * @param mo memory object holding the pairs, shared with a remote kvstore
+ * @param pairs the pairs to store, where mo is attached in the caller's ADS
+ * @param n_pairs number of pairs, at most KVSTORE_MAX_BATCH_PAIRS
+ * @return 0 on success, seL4 error otherwise
+ */
+int kvstore_client_mset(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, mo_client_context_t *mo,
+                        kvstore_pair_t *pairs, uint32_t n_pairs);
+
+/**
+ * @brief Get a batch of values from the kv store, with one request
+ * Each pair's val is set if its key is found, and its error is set to KvstoreError_KEY otherwise
+ *
+ * @param kvstore_ep endpoint of a particular kvstore resource, if using a remote kvstore
+ * @param store_id ID of a particular kvstore, if using a local kvstore
+ * @param mo memory object holding the pairs, shared with a remote kvstore
+ * @param pairs the keys to search for, where mo is attached in the caller's ADS
+ * @param n_pairs number of pairs, at most KVSTORE_MAX_BATCH_PAIRS
+ * @param n_found returns the number of keys that were found
+ * @return 0 on success, even if some keys were not found, seL4 error otherwise
+ */
+int kvstore_client_mget(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, mo_client_context_t *mo,
+                        kvstore_pair_t *pairs, uint32_t n_pairs, uint32_t *n_found);
+
+/**
+ * @brief Put a variable-length key-value pair in the kv store
+ * The pair travels in a shared MO: the key is at the start, and the value directly follows it
+ * Not supported in SEPARATE_ADS mode, since the MO is not mapped in the kvstore's ADS
+ *
+ * @param kvstore_ep endpoint of a particular kvstore resource, if using a remote kvstore
+ * @param store_id ID of a particular kvstore, if using a local kvstore
+ * @param mo memory object holding the pair
+ * @param mo_vaddr where mo is attached in the caller's ADS
+ * @param key_len length of the key
+ * @param val_len length of the value
+ * @return 0 on success, seL4 error otherwise
+ */
+int kvstore_client_bset(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, mo_client_context_t *mo, void *mo_vaddr,
+                        uint32_t key_len, uint32_t val_len);
+
+/**
+ * @brief Get a variable-length value from the kv store
+ * The key is read from the start of the shared MO, and the value is written over it by the kvstore
+ * Not supported in SEPARATE_ADS mode, since the MO is not mapped in the kvstore's ADS
+ *
+ * @param kvstore_ep endpoint of a particular kvstore resource, if using a remote kvstore
+ * @param store_id ID of a particular kvstore, if using a local kvstore
+ * @param mo memory object holding the key
+ * @param mo_vaddr where mo is attached in the caller's ADS
+ * @param key_len length of the key
+ * @param val_len returns the length of the value, also if it does not fit in the MO
+ * @return 0 on success,
+ *         KvstoreError_KEY if the key does not exist,
+ *         KvstoreError_SIZE if the value is larger than the MO,
+ *         seL4 error otherwise
+ */
+int kvstore_client_bget(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, mo_client_context_t *mo, void *mo_vaddr,
+                        uint32_t key_len, uint32_t *val_len);
+
+/**
+ * @brief Get one page of the pairs with keys in [start, end), in key order
+ * The kvstore keeps no state between pages: to continue, call again with next_key as the start, until done is set
+ * A page may hold fewer than max_pairs pairs before the scan is done
+ *
+ * @param kvstore_ep endpoint of a particular kvstore resource, if using a remote kvstore
+ * @param store_id ID of a particular kvstore, if using a local kvstore
+ * @param mo memory object to receive the pairs, shared with a remote kvstore
+ * @param pairs returns the pairs found, where mo is attached in the caller's ADS
+ * @param max_pairs maximum pairs to return, at most KVSTORE_MAX_BATCH_PAIRS
+ * @param start first key of the range
+ * @param end first key after the range
+ * @param n_pairs returns the number of pairs found
+ * @param next_key returns the start key of the next page
+ * @param done returns true if there are no more pairs in the range
+ * @return 0 on success, seL4 error otherwise
+ */
+int kvstore_client_scan(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, mo_client_context_t *mo,
+                        kvstore_pair_t *pairs, uint32_t max_pairs, seL4_Word start, seL4_Word end,
+                        uint32_t *n_pairs, seL4_Word *next_key, bool *done);
+
+/**
+ * @brief Get the hit and miss counters of the kvstore server's cache for a store
+ *
+ * @param kvstore_ep endpoint of a particular kvstore resource, if using a remote kvstore
+ * @param store_id ID of a particular kvstore, if using a local kvstore
+ * @param hits returns the number of gets served from the cache
+ * @param misses returns the number of gets that went to the database
+ * @return 0 on success, seL4 error otherwise
+ */
+int kvstore_client_get_cache_stats(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, uint64_t *hits, uint64_t *misses);
+
 int kvstore_client_swap_ads_lib(void);
 int kvstore_client_swap_ads_app(void);
\ No newline at end of file
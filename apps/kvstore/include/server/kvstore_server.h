@@ -5,10 +5,13 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <sel4/sel4.h>
 #include <sel4/types.h>
 #include <sel4gpi/resource_server_utils.h>
+#include <sqlite3/sqlite3.h>
+#include <utils/uthash.h>
 #include <kvstore_shared.h>
 
 /**
@@ -29,6 +32,37 @@
 #define KVSTORE_PRINTF(...)
 #endif
 
+#define KVSTORE_CACHE_DEFAULT_ENTRIES 256 // Default number of pairs cached per store
+
+/**
+ * A cached key-value pair
+ * The cache is write-through, so cached pairs always match the table
+ */
+typedef struct _kvstore_cache_entry
+{
+    seL4_Word key;
+    seL4_Word val;
+    UT_hash_handle hh;
+} kvstore_cache_entry_t;
+
+/**
+ * Registry entry for one kvstore (table)
+ */
+typedef struct _kvstore_registry_entry
+{
+    resource_registry_node_t gen;
+    sqlite3_stmt *insert_stmt; ///< Prepared insert-or-replace into the store's table
+    sqlite3_stmt *select_stmt; ///< Prepared select of one key from the store's table
+    sqlite3_stmt *blob_insert_stmt; ///< Prepared insert-or-replace into the store's blob table
+    sqlite3_stmt *blob_select_stmt; ///< Prepared select of one blob key's row and value length
+    sqlite3_stmt *scan_stmt;        ///< Prepared select of a page of pairs in a key range, in key order
+
+    kvstore_cache_entry_t *cache; ///< Hash table of cached pairs, kept in least to most recently used order
+    uint32_t cache_count;         ///< Number of pairs in the cache
+    uint64_t cache_hits;          ///< Gets served from the cache
+    uint64_t cache_misses;        ///< Gets that went to the table
+} kvstore_registry_entry_t;
+
 /*
 Context of the server
 */
@@ -38,6 +72,7 @@ typedef struct _kvstore_server_context
     resource_server_context_t gen;
 
     resource_registry_t kvstore_registry; ///< Registry of kvstores (tables)
+    uint32_t cache_capacity;              ///< Maximum pairs cached per store, 0 disables the cache
     char db_filename[128]; ///< Name of the file storing the database
 } kvstore_server_context_t;
 
@@ -85,4 +120,94 @@ int kvstore_server_set(gpi_obj_id_t store_id, seL4_Word key, seL4_Word value);
  *         KvstoreError_KEY if the key does not exist,
  *         seL4 error otherwise
  */
-int kvstore_server_get(gpi_obj_id_t store_id, seL4_Word key, seL4_Word *value);
\ No newline at end of file
+int kvstore_server_get(gpi_obj_id_t store_id, seL4_Word key, seL4_Word *value);
+
+/**
+ * @brief Put a batch of key-value pairs in the kv store, in a single transaction
+ * Overwrites any previous values stored for the keys
+ *
+ * @param store_id the kvstore to set, use the ID from kvstore_create_store
+ * @param pairs array of pairs to store
+ * @param n_pairs number of pairs, at most KVSTORE_MAX_BATCH_PAIRS
+ * @return 0 on success, seL4 error otherwise, in which case no pairs are stored
+ */
+int kvstore_server_mset(gpi_obj_id_t store_id, kvstore_pair_t *pairs, uint32_t n_pairs);
+
+/**
+ * @brief Get a batch of values from the kv store, in a single transaction
+ *
+ * @param store_id the kvstore to search, use the ID from kvstore_create_store
+ * @param pairs array of keys to search for, each pair's val and error are set
+ * @param n_pairs number of pairs, at most KVSTORE_MAX_BATCH_PAIRS
+ * @param n_found returns the number of keys that were found
+ * @return 0 on success, even if some keys were not found, seL4 error otherwise
+ */
+int kvstore_server_mget(gpi_obj_id_t store_id, kvstore_pair_t *pairs, uint32_t n_pairs, uint32_t *n_found);
+
+/**
+ * @brief Set the number of pairs cached per store
+ * Stores with more cached pairs shrink as new pairs are cached
+ *
+ * @param capacity maximum pairs per store, 0 disables the cache
+ */
+void kvstore_server_set_cache_capacity(uint32_t capacity);
+
+/**
+ * @brief Get the cache counters of a kvstore
+ *
+ * @param store_id the kvstore, use the ID from kvstore_create_store
+ * @param hits returns the number of gets served from the cache
+ * @param misses returns the number of gets that went to the database
+ * @return 0 on success, seL4 error otherwise
+ */
+int kvstore_server_get_cache_stats(gpi_obj_id_t store_id, uint64_t *hits, uint64_t *misses);
+
+/**
+ * @brief Put a variable-length key-value pair in the kv store
+ * Blob pairs are separate from the seL4_Word pairs of kvstore_server_set
+ * Overwrites any previous value stored for the key
+ *
+ * @param store_id the kvstore to set, use the ID from kvstore_create_store
+ * @param key bytes of the key
+ * @param key_len length of the key, must not be 0
+ * @param val bytes of the value
+ * @param val_len length of the value
+ * @return 0 on success, seL4 error otherwise
+ */
+int kvstore_server_bset(gpi_obj_id_t store_id, const void *key, uint32_t key_len, const void *val, uint32_t val_len);
+
+/**
+ * @brief Get a variable-length value from the kv store
+ * The key is only read before the value is written, so they may share a buffer
+ *
+ * @param store_id the kvstore to search, use the ID from kvstore_create_store
+ * @param key bytes of the key
+ * @param key_len length of the key
+ * @param buf buffer to write the value to
+ * @param buf_len size of the buffer
+ * @param val_len returns the length of the value, also if it does not fit in the buffer
+ * @return 0 on success,
+ *         KvstoreError_KEY if the key does not exist,
+ *         KvstoreError_SIZE if the value is larger than the buffer,
+ *         seL4 error otherwise
+ */
+int kvstore_server_bget(gpi_obj_id_t store_id, const void *key, uint32_t key_len,
+                        void *buf, size_t buf_len, uint32_t *val_len);
+
+/**
+ * @brief Get one page of the pairs with keys in [start, end), in key order
+ * To continue the scan, call again with next_key as the start, until done is set
+ *
+ * @param store_id the kvstore to scan, use the ID from kvstore_create_store
+ * @param start first key of the range
+ * @param end first key after the range
+ * @param pairs returns the pairs found
+ * @param max_pairs maximum pairs to return
+ * @param n_pairs returns the number of pairs found
+ * @param next_key returns the start key of the next page
+ * @param done returns true if there are no more pairs in the range
+ * @return 0 on success, seL4 error otherwise
+ */
+int kvstore_server_scan(gpi_obj_id_t store_id, seL4_Word start, seL4_Word end,
+                        kvstore_pair_t *pairs, uint32_t max_pairs,
+                        uint32_t *n_pairs, seL4_Word *next_key, bool *done);
@@ -5,4 +5,16 @@
 
 #define KVSTORE_DEBUG 0
 #define KVSTORE_RPC_MAGIC 0x4b56
-#define KVSTORE_RESOURCE_NAME "KVSTORE"
\ No newline at end of file
+#define KVSTORE_RESOURCE_NAME "KVSTORE"
+
+/**
+ * One entry of a batched MSET/MGET, an array of these is passed in a shared MO
+ */
+typedef struct _kvstore_pair
+{
+    seL4_Word key;
+    seL4_Word val; ///< Value to set, or value returned by MGET
+    int error;     ///< Set by MGET: 0 if the key was found, KvstoreError_KEY if not
+} kvstore_pair_t;
+
+#define KVSTORE_MAX_BATCH_PAIRS ((1u << seL4_PageBits) / sizeof(kvstore_pair_t)) // Pairs that fit in one page
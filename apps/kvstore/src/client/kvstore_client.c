@@ -4,6 +4,7 @@
 #include <assert.h>
 
 #include <sel4/sel4.h>
+#include <utils/util.h>
 #include <sel4gpi/pd_utils.h>
 #include <sel4utils/process.h>
 #include <sel4gpi/ads_clientapi.h>
@@ -228,7 +229,7 @@ int kvstore_client_set(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, seL4_Word ke
 
         KvstoreReturnMessage reply = {0};
 
-        error = sel4gpi_rpc_call(&rpc_client, kvstore_ep, &request, 0, NULL, &reply);
+        error = sel4gpi_rpc_call_raw(&rpc_client, kvstore_ep, &request, 0, NULL, &reply);
 
         error |= reply.errorCode;
     }
@@ -271,7 +272,7 @@ int kvstore_client_get(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, seL4_Word ke
 
         KvstoreReturnMessage reply = {0};
 
-        error = sel4gpi_rpc_call(&rpc_client, kvstore_ep, &request, 0, NULL, &reply);
+        error = sel4gpi_rpc_call_raw(&rpc_client, kvstore_ep, &request, 0, NULL, &reply);
 
         error |= reply.errorCode;
 
@@ -301,3 +302,335 @@ int kvstore_client_get(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, seL4_Word ke
 
     return error;
 }
+
+/**
+ * Number of pairs copied through the stack at a time in SEPARATE_ADS mode,
+ * since the caller's shared memory is not mapped in the kvstore's ADS
+ * Each chunk is applied in its own transaction
+ */
+#define KVSTORE_ADS_BATCH_CHUNK 16
+
+/**
+ * Send an MSET or MGET request with the pairs in a shared MO
+ */
+static int kvstore_client_multi_rpc(seL4_CPtr kvstore_ep, pb_size_t which_msg, mo_client_context_t *mo,
+                                    uint32_t n_pairs, uint32_t *n_found)
+{
+    seL4_Error error;
+    seL4_CPtr caps[1] = {mo->ep};
+
+    KvstoreMessage request = {
+        .magic = KVSTORE_RPC_MAGIC,
+        .which_msg = which_msg};
+
+    // mset and mget share a message type
+    request.msg.mset.n_pairs = n_pairs;
+    request.msg.mset.mo_id = mo->id;
+
+    KvstoreReturnMessage reply = {0};
+
+    error = sel4gpi_rpc_call(&rpc_client, kvstore_ep, &request, 1, caps, &reply);
+
+    error |= reply.errorCode;
+
+    if (error == seL4_NoError && n_found != NULL)
+    {
+        *n_found = reply.msg.mget.n_found;
+    }
+
+    return error;
+}
+
+int kvstore_client_mset(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, mo_client_context_t *mo,
+                        kvstore_pair_t *pairs, uint32_t n_pairs)
+{
+    seL4_Error error = seL4_NoError;
+
+    if (n_pairs > KVSTORE_MAX_BATCH_PAIRS)
+    {
+        ZF_LOGE("Too many pairs for one batch");
+        return seL4_RangeError;
+    }
+
+    if (mode == SEPARATE_PROC || mode == SEPARATE_THREAD)
+    {
+        error = kvstore_client_multi_rpc(kvstore_ep, KvstoreMessage_mset_tag, mo, n_pairs, NULL);
+    }
+    else if (mode == SEPARATE_ADS)
+    {
+        kvstore_pair_t chunk[KVSTORE_ADS_BATCH_CHUNK];
+
+        for (uint32_t i = 0; i < n_pairs && error == seL4_NoError; i += KVSTORE_ADS_BATCH_CHUNK)
+        {
+            uint32_t n = MIN(n_pairs - i, KVSTORE_ADS_BATCH_CHUNK);
+            memcpy(chunk, &pairs[i], n * sizeof(kvstore_pair_t));
+
+            error = cpu_client_change_vspace(&self_cpu_conn, &kvserv_ads);
+            if (error)
+            {
+                ZF_LOGE("failed to swap ADS to kvstore server");
+                return error;
+            }
+
+            error = kvstore_server_mset(store_id, chunk, n);
+            ZF_LOGE_IF(error, "kvstore_server_mset failed");
+
+            // don't overwrite the error value from the actual server command
+            int swap_err = cpu_client_change_vspace(&self_cpu_conn, &client_ads_conn);
+            ZF_LOGF_IF(swap_err, "Failed to swap back to client ADS"); // fatal because we can't continue in the wrong ADS
+        }
+    }
+    else
+    {
+        error = kvstore_server_mset(store_id, pairs, n_pairs);
+    }
+
+    return error;
+}
+
+int kvstore_client_mget(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, mo_client_context_t *mo,
+                        kvstore_pair_t *pairs, uint32_t n_pairs, uint32_t *n_found)
+{
+    seL4_Error error = seL4_NoError;
+
+    if (n_pairs > KVSTORE_MAX_BATCH_PAIRS)
+    {
+        ZF_LOGE("Too many pairs for one batch");
+        return seL4_RangeError;
+    }
+
+    if (mode == SEPARATE_PROC || mode == SEPARATE_THREAD)
+    {
+        error = kvstore_client_multi_rpc(kvstore_ep, KvstoreMessage_mget_tag, mo, n_pairs, n_found);
+    }
+    else if (mode == SEPARATE_ADS)
+    {
+        kvstore_pair_t chunk[KVSTORE_ADS_BATCH_CHUNK];
+        *n_found = 0;
+
+        for (uint32_t i = 0; i < n_pairs && error == seL4_NoError; i += KVSTORE_ADS_BATCH_CHUNK)
+        {
+            uint32_t n = MIN(n_pairs - i, KVSTORE_ADS_BATCH_CHUNK);
+            uint32_t chunk_found = 0;
+            memcpy(chunk, &pairs[i], n * sizeof(kvstore_pair_t));
+
+            error = cpu_client_change_vspace(&self_cpu_conn, &kvserv_ads);
+            if (error)
+            {
+                ZF_LOGE("failed to swap ADS to kvstore server");
+                return error;
+            }
+
+            error = kvstore_server_mget(store_id, chunk, n, &chunk_found);
+            ZF_LOGE_IF(error, "kvstore_server_mget failed");
+
+            // don't overwrite the error value from the actual server command
+            int swap_err = cpu_client_change_vspace(&self_cpu_conn, &client_ads_conn);
+            ZF_LOGF_IF(swap_err, "Failed to swap back to client ADS"); // fatal because we can't continue in the wrong ADS
+
+            memcpy(&pairs[i], chunk, n * sizeof(kvstore_pair_t));
+            *n_found += chunk_found;
+        }
+    }
+    else
+    {
+        error = kvstore_server_mget(store_id, pairs, n_pairs, n_found);
+    }
+
+    return error;
+}
+
+int kvstore_client_bset(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, mo_client_context_t *mo, void *mo_vaddr,
+                        uint32_t key_len, uint32_t val_len)
+{
+    seL4_Error error;
+
+    if (mode == SEPARATE_PROC || mode == SEPARATE_THREAD)
+    {
+        seL4_CPtr caps[1] = {mo->ep};
+
+        KvstoreMessage request = {
+            .magic = KVSTORE_RPC_MAGIC,
+            .which_msg = KvstoreMessage_bset_tag,
+            .msg.bset = {
+                .key_len = key_len,
+                .val_len = val_len,
+                .mo_id = mo->id,
+            }};
+
+        KvstoreReturnMessage reply = {0};
+
+        error = sel4gpi_rpc_call(&rpc_client, kvstore_ep, &request, 1, caps, &reply);
+
+        error |= reply.errorCode;
+    }
+    else if (mode == SEPARATE_ADS)
+    {
+        ZF_LOGE("Blob operations are not supported with a separate kvstore ADS");
+        error = seL4_IllegalOperation;
+    }
+    else
+    {
+        error = kvstore_server_bset(store_id, mo_vaddr, key_len, mo_vaddr + key_len, val_len);
+    }
+
+    return error;
+}
+
+int kvstore_client_bget(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, mo_client_context_t *mo, void *mo_vaddr,
+                        uint32_t key_len, uint32_t *val_len)
+{
+    seL4_Error error;
+
+    if (mode == SEPARATE_PROC || mode == SEPARATE_THREAD)
+    {
+        seL4_CPtr caps[1] = {mo->ep};
+
+        KvstoreMessage request = {
+            .magic = KVSTORE_RPC_MAGIC,
+            .which_msg = KvstoreMessage_bget_tag,
+            .msg.bget = {
+                .key_len = key_len,
+                .mo_id = mo->id,
+            }};
+
+        KvstoreReturnMessage reply = {0};
+
+        error = sel4gpi_rpc_call(&rpc_client, kvstore_ep, &request, 1, caps, &reply);
+
+        // The length is also returned if the value did not fit
+        if (error == seL4_NoError && reply.which_msg == KvstoreReturnMessage_bget_tag)
+        {
+            *val_len = reply.msg.bget.val_len;
+        }
+
+        error |= reply.errorCode;
+    }
+    else if (mode == SEPARATE_ADS)
+    {
+        ZF_LOGE("Blob operations are not supported with a separate kvstore ADS");
+        error = seL4_IllegalOperation;
+    }
+    else
+    {
+        error = kvstore_server_bget(store_id, mo_vaddr, key_len, mo_vaddr, mo->size, val_len);
+    }
+
+    return error;
+}
+
+int kvstore_client_scan(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, mo_client_context_t *mo,
+                        kvstore_pair_t *pairs, uint32_t max_pairs, seL4_Word start, seL4_Word end,
+                        uint32_t *n_pairs, seL4_Word *next_key, bool *done)
+{
+    seL4_Error error;
+
+    if (max_pairs > KVSTORE_MAX_BATCH_PAIRS)
+    {
+        ZF_LOGE("Too many pairs for one page");
+        return seL4_RangeError;
+    }
+
+    if (mode == SEPARATE_PROC || mode == SEPARATE_THREAD)
+    {
+        seL4_CPtr caps[1] = {mo->ep};
+
+        KvstoreMessage request = {
+            .magic = KVSTORE_RPC_MAGIC,
+            .which_msg = KvstoreMessage_scan_tag,
+            .msg.scan = {
+                .start = start,
+                .end = end,
+                .max_pairs = max_pairs,
+                .mo_id = mo->id,
+            }};
+
+        KvstoreReturnMessage reply = {0};
+
+        error = sel4gpi_rpc_call(&rpc_client, kvstore_ep, &request, 1, caps, &reply);
+
+        error |= reply.errorCode;
+        *n_pairs = reply.msg.scan.n_pairs;
+        *next_key = reply.msg.scan.next_key;
+        *done = reply.msg.scan.done;
+    }
+    else if (mode == SEPARATE_ADS)
+    {
+        // The pairs go through the stack, so return a shorter page and let the caller resume from next_key
+        kvstore_pair_t chunk[KVSTORE_ADS_BATCH_CHUNK];
+        uint32_t n = MIN(max_pairs, KVSTORE_ADS_BATCH_CHUNK);
+
+        error = cpu_client_change_vspace(&self_cpu_conn, &kvserv_ads);
+        if (error)
+        {
+            ZF_LOGE("failed to swap ADS to kvstore server");
+            return error;
+        }
+
+        error = kvstore_server_scan(store_id, start, end, chunk, n, n_pairs, next_key, done);
+        ZF_LOGE_IF(error, "kvstore_server_scan failed");
+
+        // don't overwrite the error value from the actual server command
+        int swap_err = cpu_client_change_vspace(&self_cpu_conn, &client_ads_conn);
+        ZF_LOGF_IF(swap_err, "Failed to swap back to client ADS"); // fatal because we can't continue in the wrong ADS
+
+        memcpy(pairs, chunk, *n_pairs * sizeof(kvstore_pair_t));
+    }
+    else
+    {
+        error = kvstore_server_scan(store_id, start, end, pairs, max_pairs, n_pairs, next_key, done);
+    }
+
+    return error;
+}
+
+int kvstore_client_get_cache_stats(seL4_CPtr kvstore_ep, gpi_obj_id_t store_id, uint64_t *hits, uint64_t *misses)
+{
+    seL4_Error error;
+
+    if (mode == SEPARATE_PROC || mode == SEPARATE_THREAD)
+    {
+        KvstoreMessage request = {
+            .magic = KVSTORE_RPC_MAGIC,
+            .which_msg = KvstoreMessage_cache_stats_tag};
+
+        KvstoreReturnMessage reply = {0};
+
+        error = sel4gpi_rpc_call(&rpc_client, kvstore_ep, &request, 0, NULL, &reply);
+
+        error |= reply.errorCode;
+
+        if (error == seL4_NoError)
+        {
+            *hits = reply.msg.cache_stats.hits;
+            *misses = reply.msg.cache_stats.misses;
+        }
+    }
+    else if (mode == SEPARATE_ADS)
+    {
+        error = cpu_client_change_vspace(&self_cpu_conn, &kvserv_ads);
+        if (error)
+        {
+            ZF_LOGE("failed to swap ADS to kvstore server");
+            return error;
+        }
+
+        // The counters are on the shared stack, so they are visible from both ADSes
+        uint64_t server_hits, server_misses;
+        error = kvstore_server_get_cache_stats(store_id, &server_hits, &server_misses);
+        ZF_LOGE_IF(error, "kvstore_server_get_cache_stats failed");
+
+        // don't overwrite the error value from the actual server command
+        int swap_err = cpu_client_change_vspace(&self_cpu_conn, &client_ads_conn);
+        ZF_LOGF_IF(swap_err, "Failed to swap back to client ADS"); // fatal because we can't continue in the wrong ADS
+
+        *hits = server_hits;
+        *misses = server_misses;
+    }
+    else
+    {
+        error = kvstore_server_get_cache_stats(store_id, hits, misses);
+    }
+
+    return error;
+}
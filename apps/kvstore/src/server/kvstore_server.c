@@ -3,6 +3,8 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <utils/util.h>
 #include <utils/uthash.h>
 
 #include <sqlite3/sqlite3.h>
@@ -21,8 +23,17 @@
 static const char *kvstore_db_file = "/kvstore.db";
 static const char *create_table_cmd = "create table kvstore_%u (key bigint unsigned not null primary key, val bigint unsigned);";
 static const char *delete_table_cmd = "drop table kvstore_%u;";
-static const char *insert_format = "insert or replace into kvstore_%u(key, val) values (%ld, %ld);";
-static const char *select_format = "select val from kvstore_%u where key == %ld;";
+static const char *create_blob_table_cmd = "create table kvstore_blob_%u (key blob not null primary key, val blob);";
+static const char *delete_blob_table_cmd = "drop table kvstore_blob_%u;";
+static const char *blob_table_format = "kvstore_blob_%u";
+static const char *insert_format = "insert or replace into kvstore_%u(key, val) values (?1, ?2);";
+static const char *select_format = "select val from kvstore_%u where key == ?1;";
+static const char *scan_format = "select key, val from kvstore_%u where key >= ?1 and key < ?2 order by key limit ?3;";
+static const char *blob_insert_format = "insert or replace into kvstore_blob_%u(key, val) values (?1, ?2);";
+static const char *blob_select_format = "select rowid, length(val) from kvstore_blob_%u where key == ?1;";
+static const char *begin_cmd = "begin transaction;";
+static const char *commit_cmd = "commit transaction;";
+static const char *rollback_cmd = "rollback transaction;";
 
 static sqlite3 *kvstore_db;
 static int cmdlen = 128;
@@ -104,18 +115,125 @@ static int sqlite_callback(void *listp, int argc, char **argv, char **azColName)
     return 0;
 }
 
+/**
+ * Finalize a kvstore's prepared statements
+ * Statements must be finalized before the table is dropped or the database is closed
+ */
+static void kvstore_finalize_stmts(kvstore_registry_entry_t *entry)
+{
+    sqlite3_finalize(entry->insert_stmt);
+    sqlite3_finalize(entry->select_stmt);
+    sqlite3_finalize(entry->blob_insert_stmt);
+    sqlite3_finalize(entry->blob_select_stmt);
+    sqlite3_finalize(entry->scan_stmt);
+    entry->insert_stmt = NULL;
+    entry->select_stmt = NULL;
+    entry->blob_insert_stmt = NULL;
+    entry->blob_select_stmt = NULL;
+    entry->scan_stmt = NULL;
+}
+
+/**
+ * Move a cached pair to the most recently used end of the cache
+ */
+static void kvstore_cache_touch(kvstore_registry_entry_t *entry, kvstore_cache_entry_t *cached)
+{
+    HASH_DELETE(hh, entry->cache, cached);
+    HASH_ADD(hh, entry->cache, key, sizeof(seL4_Word), cached);
+}
+
+/**
+ * Find a pair in a kvstore's cache, and mark it as recently used
+ *
+ * @return the cached pair, or NULL if the key is not cached
+ */
+static kvstore_cache_entry_t *kvstore_cache_find(kvstore_registry_entry_t *entry, seL4_Word key)
+{
+    kvstore_cache_entry_t *cached = NULL;
+    HASH_FIND(hh, entry->cache, &key, sizeof(seL4_Word), cached);
+
+    if (cached != NULL)
+    {
+        kvstore_cache_touch(entry, cached);
+    }
+
+    return cached;
+}
+
+/**
+ * Cache a pair that is stored in the table, evicting the least recently used pairs if the cache is full
+ */
+static void kvstore_cache_put(kvstore_registry_entry_t *entry, seL4_Word key, seL4_Word val)
+{
+    uint32_t capacity = get_kvstore_server()->cache_capacity;
+    kvstore_cache_entry_t *cached = kvstore_cache_find(entry, key);
+
+    if (cached != NULL)
+    {
+        cached->val = val;
+        return;
+    }
+
+    if (capacity == 0)
+    {
+        return;
+    }
+
+    // The head of the hash table is the least recently used pair
+    while (entry->cache_count >= capacity)
+    {
+        kvstore_cache_entry_t *lru = entry->cache;
+        HASH_DELETE(hh, entry->cache, lru);
+        free(lru);
+        entry->cache_count--;
+    }
+
+    cached = malloc(sizeof(kvstore_cache_entry_t));
+    if (cached == NULL)
+    {
+        // The cache is only an optimization
+        return;
+    }
+
+    cached->key = key;
+    cached->val = val;
+    HASH_ADD(hh, entry->cache, key, sizeof(seL4_Word), cached);
+    entry->cache_count++;
+}
+
+/**
+ * Remove all pairs from a kvstore's cache
+ */
+static void kvstore_cache_clear(kvstore_registry_entry_t *entry)
+{
+    kvstore_cache_entry_t *curr, *tmp;
+    HASH_ITER(hh, entry->cache, curr, tmp)
+    {
+        HASH_DELETE(hh, entry->cache, curr);
+        free(curr);
+    }
+
+    entry->cache_count = 0;
+}
+
 static void on_kvstore_registry_delete(resource_registry_node_t *node, void *arg0)
 {
     int error = 0;
 
+    kvstore_finalize_stmts((kvstore_registry_entry_t *)node);
+    kvstore_cache_clear((kvstore_registry_entry_t *)node);
+
     if (!sel4gpi_can_request_type(FILE_RESOURCE_TYPE_NAME))
     {
         // Can't delete table because we no longer have access to the FS
         return;
     }
 
-    // Delete table
+    // Delete tables
     SQL_EXEC(kvstore_db, delete_table_cmd, node->object_id);
+    int blob_error = error;
+    SQL_EXEC(kvstore_db, delete_blob_table_cmd, node->object_id);
+    error |= blob_error;
 
     if (error)
     {
@@ -166,6 +284,8 @@ int kvstore_server_init()
     resource_registry_initialize(&get_kvstore_server()->kvstore_registry, on_kvstore_registry_delete,
                                  NULL, BADGE_MAX_OBJ_ID - 1);
 
+    get_kvstore_server()->cache_capacity = KVSTORE_CACHE_DEFAULT_ENTRIES;
+
 err_goto:
     return error;
 }
@@ -269,6 +389,87 @@ static void kvstore_request_handler(void *msg_p,
             reply_msg->which_msg = KvstoreReturnMessage_get_tag;
             reply_msg->msg.get.val = val;
             break;
+        case KvstoreMessage_mset_tag:
+            *need_new_recv_cap = true;
+
+            /* Get the client's memory object in the server ADS, it stays attached for later requests */
+            error = resource_server_attach_client_mo(&get_kvstore_server()->gen, client_id, msg->msg.mset.mo_id,
+                                                     cap, &mo_vaddr, NULL);
+            CHECK_ERR_GOTO(error, "Failed to attach MO", KvstoreError_UNKNOWN);
+
+            error = kvstore_server_mset(store_id, (kvstore_pair_t *)mo_vaddr, msg->msg.mset.n_pairs);
+            break;
+        case KvstoreMessage_mget_tag:
+            *need_new_recv_cap = true;
+
+            error = resource_server_attach_client_mo(&get_kvstore_server()->gen, client_id, msg->msg.mget.mo_id,
+                                                     cap, &mo_vaddr, NULL);
+            CHECK_ERR_GOTO(error, "Failed to attach MO", KvstoreError_UNKNOWN);
+
+            uint32_t n_found;
+            error = kvstore_server_mget(store_id, (kvstore_pair_t *)mo_vaddr, msg->msg.mget.n_pairs, &n_found);
+
+            reply_msg->which_msg = KvstoreReturnMessage_mget_tag;
+            reply_msg->msg.mget.n_found = n_found;
+            break;
+        case KvstoreMessage_bset_tag:
+            *need_new_recv_cap = true;
+
+            size_t mo_size;
+            error = resource_server_attach_client_mo(&get_kvstore_server()->gen, client_id, msg->msg.bset.mo_id,
+                                                     cap, &mo_vaddr, &mo_size);
+            CHECK_ERR_GOTO(error, "Failed to attach MO", KvstoreError_UNKNOWN);
+            CHECK_ERR_GOTO((size_t)msg->msg.bset.key_len + msg->msg.bset.val_len > mo_size,
+                           "Blob pair is larger than the shared MO", KvstoreError_SIZE);
+
+            // The value follows the key in the MO
+            error = kvstore_server_bset(store_id, mo_vaddr, msg->msg.bset.key_len,
+                                        mo_vaddr + msg->msg.bset.key_len, msg->msg.bset.val_len);
+            break;
+        case KvstoreMessage_bget_tag:
+            *need_new_recv_cap = true;
+
+            error = resource_server_attach_client_mo(&get_kvstore_server()->gen, client_id, msg->msg.bget.mo_id,
+                                                     cap, &mo_vaddr, &mo_size);
+            CHECK_ERR_GOTO(error, "Failed to attach MO", KvstoreError_UNKNOWN);
+            CHECK_ERR_GOTO(msg->msg.bget.key_len > mo_size, "Blob key is larger than the shared MO", KvstoreError_SIZE);
+
+            // The value replaces the key at the start of the MO
+            uint32_t val_len;
+            error = kvstore_server_bget(store_id, mo_vaddr, msg->msg.bget.key_len, mo_vaddr, mo_size, &val_len);
+
+            reply_msg->which_msg = KvstoreReturnMessage_bget_tag;
+            reply_msg->msg.bget.val_len = val_len;
+            break;
+        case KvstoreMessage_scan_tag:
+            *need_new_recv_cap = true;
+
+            error = resource_server_attach_client_mo(&get_kvstore_server()->gen, client_id, msg->msg.scan.mo_id,
+                                                     cap, &mo_vaddr, &mo_size);
+            CHECK_ERR_GOTO(error, "Failed to attach MO", KvstoreError_UNKNOWN);
+
+            // Never return more pairs than fit in the MO
+            uint32_t max_pairs = MIN(msg->msg.scan.max_pairs, mo_size / sizeof(kvstore_pair_t));
+
+            uint32_t n_pairs;
+            seL4_Word next_key;
+            bool done;
+            error = kvstore_server_scan(store_id, msg->msg.scan.start, msg->msg.scan.end,
+                                        (kvstore_pair_t *)mo_vaddr, max_pairs, &n_pairs, &next_key, &done);
+
+            reply_msg->which_msg = KvstoreReturnMessage_scan_tag;
+            reply_msg->msg.scan.n_pairs = n_pairs;
+            reply_msg->msg.scan.next_key = next_key;
+            reply_msg->msg.scan.done = done;
+            break;
+        case KvstoreMessage_cache_stats_tag:
+            uint64_t hits, misses;
+            error = kvstore_server_get_cache_stats(store_id, &hits, &misses);
+
+            reply_msg->which_msg = KvstoreReturnMessage_cache_stats_tag;
+            reply_msg->msg.cache_stats.hits = hits;
+            reply_msg->msg.cache_stats.misses = misses;
+            break;
         default:
             CHECK_ERR_GOTO(1, "got invalid op on badged ep with obj id", KvstoreError_UNKNOWN);
         }
@@ -352,6 +553,13 @@ static int kvstore_work_handler(PdWorkReturnMessage *work)
             else
             {
                 // Destroy the entire db
+                for (kvstore_registry_entry_t *curr = (kvstore_registry_entry_t *)get_kvstore_server()->kvstore_registry.head;
+                     curr != NULL;
+                     curr = (kvstore_registry_entry_t *)curr->gen.hh.next)
+                {
+                    kvstore_finalize_stmts(curr);
+                }
+
                 error = sqlite3_close(kvstore_db);
                 CHECK_ERR_GOTO(error, "Failed to close database\n", KvstoreError_UNKNOWN);
 
@@ -477,14 +685,40 @@ int kvstore_create_store(gpi_obj_id_t *store_id)
     int error = 0;
 
     // Insert to metadata
-    resource_registry_node_t *node = calloc(1, sizeof(resource_registry_node_t));
-    gpi_obj_id_t id = resource_registry_insert_new_id(&get_kvstore_server()->kvstore_registry, node);
+    kvstore_registry_entry_t *entry = calloc(1, sizeof(kvstore_registry_entry_t));
+    gpi_obj_id_t id = resource_registry_insert_new_id(&get_kvstore_server()->kvstore_registry,
+                                                      (resource_registry_node_t *)entry);
 
     // Create table
     SQL_EXEC(kvstore_db, create_table_cmd, id);
     CHECK_ERR_GOTO(error, "failed to create kvstore table", KvstoreError_UNKNOWN);
     KVSTORE_PRINTF("Created table\n");
 
+    // Prepare the statements once, so set/get only bind values
+    SQL_MAKE_CMD(insert_format, id);
+    error = sqlite3_prepare_v2(kvstore_db, sql_cmd, -1, &entry->insert_stmt, 0);
+    CHECK_ERR_GOTO(error, "failed to prepare insert statement", KvstoreError_UNKNOWN);
+
+    SQL_MAKE_CMD(select_format, id);
+    error = sqlite3_prepare_v2(kvstore_db, sql_cmd, -1, &entry->select_stmt, 0);
+    CHECK_ERR_GOTO(error, "failed to prepare select statement", KvstoreError_UNKNOWN);
+
+    SQL_MAKE_CMD(scan_format, id);
+    error = sqlite3_prepare_v2(kvstore_db, sql_cmd, -1, &entry->scan_stmt, 0);
+    CHECK_ERR_GOTO(error, "failed to prepare scan statement", KvstoreError_UNKNOWN);
+
+    // Blob pairs are kept in a separate table
+    SQL_EXEC(kvstore_db, create_blob_table_cmd, id);
+    CHECK_ERR_GOTO(error, "failed to create kvstore blob table", KvstoreError_UNKNOWN);
+
+    SQL_MAKE_CMD(blob_insert_format, id);
+    error = sqlite3_prepare_v2(kvstore_db, sql_cmd, -1, &entry->blob_insert_stmt, 0);
+    CHECK_ERR_GOTO(error, "failed to prepare blob insert statement", KvstoreError_UNKNOWN);
+
+    SQL_MAKE_CMD(blob_select_format, id);
+    error = sqlite3_prepare_v2(kvstore_db, sql_cmd, -1, &entry->blob_select_stmt, 0);
+    CHECK_ERR_GOTO(error, "failed to prepare blob select statement", KvstoreError_UNKNOWN);
+
     // Return the ID
     *store_id = id;
 
@@ -492,13 +726,116 @@ err_goto:
     return error;
 }
 
+/**
+ * Find a kvstore's registry entry, if its statements are ready
+ */
+static kvstore_registry_entry_t *kvstore_get_entry(gpi_obj_id_t store_id)
+{
+    kvstore_registry_entry_t *entry = (kvstore_registry_entry_t *)
+        resource_registry_get_by_id(&get_kvstore_server()->kvstore_registry, store_id);
+
+    if (entry == NULL || entry->insert_stmt == NULL || entry->select_stmt == NULL)
+    {
+        return NULL;
+    }
+
+    return entry;
+}
+
+/**
+ * Run a statement that returns no rows, for transaction control
+ */
+static int kvstore_exec(const char *cmd)
+{
+    int error = sqlite3_exec(kvstore_db, cmd, sqlite_callback, NULL, &errmsg);
+    print_error(error, errmsg, kvstore_db);
+    return error;
+}
+
+/**
+ * SQLite integers are signed, so flip the top bit of keys to keep them in unsigned order in the table
+ */
+static inline sqlite3_int64 kvstore_key_to_sql(seL4_Word key)
+{
+    return (sqlite3_int64)(key ^ (1ull << 63));
+}
+
+static inline seL4_Word kvstore_key_from_sql(sqlite3_int64 key)
+{
+    return (seL4_Word)key ^ (1ull << 63);
+}
+
+/**
+ * Insert one pair with the store's prepared statement
+ */
+static int kvstore_insert(kvstore_registry_entry_t *entry, seL4_Word key, seL4_Word value)
+{
+    int error = seL4_NoError;
+    sqlite3_stmt *stmt = entry->insert_stmt;
+
+    error = sqlite3_bind_int64(stmt, 1, kvstore_key_to_sql(key));
+    error |= sqlite3_bind_int64(stmt, 2, (sqlite3_int64)value);
+    CHECK_ERR_GOTO(error, "failed to bind insert statement", KvstoreError_UNKNOWN);
+
+    int res = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    CHECK_ERR_GOTO(res != SQLITE_DONE, "failed to insert pair to kvstore table", KvstoreError_UNKNOWN);
+
+err_goto:
+    return error;
+}
+
+/**
+ * Look up one key with the store's prepared statement
+ *
+ * @return 0 on success, KvstoreError_KEY if the key does not exist, KvstoreError_UNKNOWN otherwise
+ */
+static int kvstore_select(kvstore_registry_entry_t *entry, seL4_Word key, seL4_Word *value)
+{
+    int error = seL4_NoError;
+    sqlite3_stmt *stmt = entry->select_stmt;
+
+    error = sqlite3_bind_int64(stmt, 1, kvstore_key_to_sql(key));
+    CHECK_ERR_GOTO(error, "failed to bind select statement", KvstoreError_UNKNOWN);
+
+    // Execute the statement (gets one row if it exists)
+    int res = sqlite3_step(stmt);
+    if (res == SQLITE_ROW)
+    {
+        *value = (seL4_Word)sqlite3_column_int64(stmt, 0);
+    }
+    else if (res == SQLITE_DONE)
+    {
+        // This means there was no data found for the key
+        error = KvstoreError_KEY;
+    }
+    else
+    {
+        ZF_LOGE("failed to step select statement, %d", res);
+        error = KvstoreError_UNKNOWN;
+    }
+
+    sqlite3_reset(stmt);
+
+err_goto:
+    return error;
+}
+
 int kvstore_server_set(gpi_obj_id_t store_id, seL4_Word key, seL4_Word value)
 {
     KVSTORE_PRINTF("kvstore_server_set: key (%ld), value (%ld), %s\n", key, value, get_kvstore_server()->db_filename);
 
     int error = seL4_NoError;
-    SQL_EXEC(kvstore_db, insert_format, store_id, key, value);
-    CHECK_ERR_GOTO(error, "failed to insert pair to kvstore table", KvstoreError_UNKNOWN);
+
+    kvstore_registry_entry_t *entry = kvstore_get_entry(store_id);
+    CHECK_ERR_GOTO(entry == NULL, "kvstore does not exist", KvstoreError_UNKNOWN);
+
+    error = kvstore_insert(entry, key, value);
+
+    if (error == seL4_NoError)
+    {
+        kvstore_cache_put(entry, key, value);
+    }
 
 err_goto:
     return error;
@@ -509,30 +846,295 @@ int kvstore_server_get(gpi_obj_id_t store_id, seL4_Word key, seL4_Word *value)
     KVSTORE_PRINTF("kvstore_server_get: key (%ld)\n", key);
 
     int error = seL4_NoError;
-    sqlite3_stmt *stmt;
 
-    SQL_MAKE_CMD(select_format, store_id, key);
-    error = sqlite3_prepare_v2(kvstore_db, sql_cmd, -1, &stmt, 0);
-    CHECK_ERR_GOTO(error, "failed to prepare sql cmd", KvstoreError_UNKNOWN);
+    kvstore_registry_entry_t *entry = kvstore_get_entry(store_id);
+    CHECK_ERR_GOTO(entry == NULL, "kvstore does not exist", KvstoreError_UNKNOWN);
 
-    // Execute the statement (gets one row if it exists)
+    kvstore_cache_entry_t *cached = kvstore_cache_find(entry, key);
+    if (cached != NULL)
+    {
+        entry->cache_hits++;
+        *value = cached->val;
+        goto err_goto;
+    }
+
+    entry->cache_misses++;
+    error = kvstore_select(entry, key, value);
+
+    if (error == seL4_NoError)
+    {
+        kvstore_cache_put(entry, key, *value);
+    }
+
+err_goto:
+    return error;
+}
+
+/* Server copy of an mset batch, so the client cannot change pairs between binding and caching them */
+static kvstore_pair_t mset_pairs[KVSTORE_MAX_BATCH_PAIRS];
+
+int kvstore_server_mset(gpi_obj_id_t store_id, kvstore_pair_t *client_pairs, uint32_t n_pairs)
+{
+    KVSTORE_PRINTF("kvstore_server_mset: %u pairs\n", n_pairs);
+
+    int error = seL4_NoError;
+
+    CHECK_ERR_GOTO(n_pairs > KVSTORE_MAX_BATCH_PAIRS, "too many pairs in batch", KvstoreError_UNKNOWN);
+
+    kvstore_registry_entry_t *entry = kvstore_get_entry(store_id);
+    CHECK_ERR_GOTO(entry == NULL, "kvstore does not exist", KvstoreError_UNKNOWN);
+
+    // The pairs may be in the client's shared MO, work from a copy so the stored and cached values match
+    kvstore_pair_t *pairs = mset_pairs;
+    memcpy(pairs, client_pairs, n_pairs * sizeof(kvstore_pair_t));
+
+    // Apply all pairs in one transaction, so there is one commit for the batch
+    error = kvstore_exec(begin_cmd);
+    CHECK_ERR_GOTO(error, "failed to begin transaction", KvstoreError_UNKNOWN);
+
+    for (uint32_t i = 0; i < n_pairs; i++)
+    {
+        error = kvstore_insert(entry, pairs[i].key, pairs[i].val);
+
+        if (error)
+        {
+            kvstore_exec(rollback_cmd);
+            goto err_goto;
+        }
+    }
+
+    error = kvstore_exec(commit_cmd);
+    CHECK_ERR_GOTO(error, "failed to commit transaction", KvstoreError_UNKNOWN);
+
+    // Only cache the pairs once they are committed
+    for (uint32_t i = 0; i < n_pairs; i++)
+    {
+        kvstore_cache_put(entry, pairs[i].key, pairs[i].val);
+    }
+
+err_goto:
+    return error;
+}
+
+int kvstore_server_mget(gpi_obj_id_t store_id, kvstore_pair_t *pairs, uint32_t n_pairs, uint32_t *n_found)
+{
+    KVSTORE_PRINTF("kvstore_server_mget: %u keys\n", n_pairs);
+
+    int error = seL4_NoError;
+    *n_found = 0;
+
+    CHECK_ERR_GOTO(n_pairs > KVSTORE_MAX_BATCH_PAIRS, "too many pairs in batch", KvstoreError_UNKNOWN);
+
+    kvstore_registry_entry_t *entry = kvstore_get_entry(store_id);
+    CHECK_ERR_GOTO(entry == NULL, "kvstore does not exist", KvstoreError_UNKNOWN);
+
+    // Read all uncached keys in one transaction, so the batch takes the database lock once
+    bool in_transaction = false;
+
+    for (uint32_t i = 0; i < n_pairs; i++)
+    {
+        kvstore_cache_entry_t *cached = kvstore_cache_find(entry, pairs[i].key);
+        if (cached != NULL)
+        {
+            entry->cache_hits++;
+            pairs[i].val = cached->val;
+            pairs[i].error = seL4_NoError;
+            (*n_found)++;
+            continue;
+        }
+
+        entry->cache_misses++;
+
+        if (!in_transaction)
+        {
+            error = kvstore_exec(begin_cmd);
+            CHECK_ERR_GOTO(error, "failed to begin transaction", KvstoreError_UNKNOWN);
+            in_transaction = true;
+        }
+
+        pairs[i].error = kvstore_select(entry, pairs[i].key, &pairs[i].val);
+
+        if (pairs[i].error == seL4_NoError)
+        {
+            kvstore_cache_put(entry, pairs[i].key, pairs[i].val);
+            (*n_found)++;
+        }
+        else if (pairs[i].error != KvstoreError_KEY)
+        {
+            error = pairs[i].error;
+            kvstore_exec(rollback_cmd);
+            goto err_goto;
+        }
+    }
+
+    if (in_transaction)
+    {
+        error = kvstore_exec(commit_cmd);
+        CHECK_ERR_GOTO(error, "failed to end transaction", KvstoreError_UNKNOWN);
+    }
+
+err_goto:
+    return error;
+}
+
+void kvstore_server_set_cache_capacity(uint32_t capacity)
+{
+    get_kvstore_server()->cache_capacity = capacity;
+
+    if (capacity == 0)
+    {
+        for (kvstore_registry_entry_t *curr = (kvstore_registry_entry_t *)get_kvstore_server()->kvstore_registry.head;
+             curr != NULL;
+             curr = (kvstore_registry_entry_t *)curr->gen.hh.next)
+        {
+            kvstore_cache_clear(curr);
+        }
+    }
+}
+
+int kvstore_server_get_cache_stats(gpi_obj_id_t store_id, uint64_t *hits, uint64_t *misses)
+{
+    int error = seL4_NoError;
+
+    kvstore_registry_entry_t *entry = (kvstore_registry_entry_t *)
+        resource_registry_get_by_id(&get_kvstore_server()->kvstore_registry, store_id);
+    CHECK_ERR_GOTO(entry == NULL, "kvstore does not exist", KvstoreError_UNKNOWN);
+
+    *hits = entry->cache_hits;
+    *misses = entry->cache_misses;
+
+err_goto:
+    return error;
+}
+
+int kvstore_server_bset(gpi_obj_id_t store_id, const void *key, uint32_t key_len, const void *val, uint32_t val_len)
+{
+    KVSTORE_PRINTF("kvstore_server_bset: key (%u bytes), value (%u bytes)\n", key_len, val_len);
+
+    int error = seL4_NoError;
+
+    CHECK_ERR_GOTO(key_len == 0, "blob key is empty", KvstoreError_KEY);
+
+    kvstore_registry_entry_t *entry = kvstore_get_entry(store_id);
+    CHECK_ERR_GOTO(entry == NULL || entry->blob_insert_stmt == NULL, "kvstore does not exist", KvstoreError_UNKNOWN);
+
+    // The buffers outlive the statement's execution, so SQLite does not need its own copy to bind them
+    sqlite3_stmt *stmt = entry->blob_insert_stmt;
+    error = sqlite3_bind_blob(stmt, 1, key, key_len, SQLITE_STATIC);
+    error |= sqlite3_bind_blob(stmt, 2, val, val_len, SQLITE_STATIC);
+    CHECK_ERR_GOTO(error, "failed to bind blob insert statement", KvstoreError_UNKNOWN);
+
+    int res = sqlite3_step(stmt);
+    sqlite3_clear_bindings(stmt);
+    sqlite3_reset(stmt);
+    CHECK_ERR_GOTO(res != SQLITE_DONE, "failed to insert blob pair to kvstore table", KvstoreError_UNKNOWN);
+
+err_goto:
+    return error;
+}
+
+int kvstore_server_bget(gpi_obj_id_t store_id, const void *key, uint32_t key_len,
+                        void *buf, size_t buf_len, uint32_t *val_len)
+{
+    KVSTORE_PRINTF("kvstore_server_bget: key (%u bytes)\n", key_len);
+
+    int error = seL4_NoError;
+    *val_len = 0;
+
+    kvstore_registry_entry_t *entry = kvstore_get_entry(store_id);
+    CHECK_ERR_GOTO(entry == NULL || entry->blob_select_stmt == NULL, "kvstore does not exist", KvstoreError_UNKNOWN);
+
+    /* Find the row and the value's length, the key is not used after this */
+    sqlite3_stmt *stmt = entry->blob_select_stmt;
+    error = sqlite3_bind_blob(stmt, 1, key, key_len, SQLITE_STATIC);
+    CHECK_ERR_GOTO(error, "failed to bind blob select statement", KvstoreError_UNKNOWN);
+
+    sqlite3_int64 rowid = 0;
     int res = sqlite3_step(stmt);
-    if (res != SQLITE_ROW)
+    if (res == SQLITE_ROW)
     {
-        // This means there was no data found for the key
-        error = sqlite3_finalize(stmt);
-        CHECK_ERR_GOTO(error, "failed to finalize sql cmd", KvstoreError_UNKNOWN);
-        return KvstoreError_KEY;
+        rowid = sqlite3_column_int64(stmt, 0);
+        *val_len = sqlite3_column_int(stmt, 1);
+    }
+    sqlite3_clear_bindings(stmt);
+    sqlite3_reset(stmt);
+
+    CHECK_ERR_GOTO(res == SQLITE_DONE, "blob key does not exist", KvstoreError_KEY);
+    CHECK_ERR_GOTO(res != SQLITE_ROW, "failed to step blob select statement", KvstoreError_UNKNOWN);
+    CHECK_ERR_GOTO(*val_len > buf_len, "blob value is larger than the buffer", KvstoreError_SIZE);
+
+    if (*val_len == 0)
+    {
+        goto err_goto;
     }
 
-    // Retrieve value
-    const char *val_s = (const char *)sqlite3_column_text(stmt, 0);
-    CHECK_ERR_GOTO(val_s == NULL, "failed to get value from row", KvstoreError_KEY);
+    /* Read the value straight into the buffer, without materializing it in a result row */
+    char table[32];
+    error = snprintf(table, sizeof(table), blob_table_format, store_id);
+    assert(error != -1);
 
-    *value = atoi(val_s);
-    error = sqlite3_finalize(stmt);
-    CHECK_ERR_GOTO(error, "failed to finalize sql cmd", KvstoreError_UNKNOWN);
+    sqlite3_blob *blob;
+    error = sqlite3_blob_open(kvstore_db, "main", table, "val", rowid, 0, &blob);
+    CHECK_ERR_GOTO(error, "failed to open blob value", KvstoreError_UNKNOWN);
+
+    error = sqlite3_blob_read(blob, buf, *val_len, 0);
+    sqlite3_blob_close(blob);
+    CHECK_ERR_GOTO(error, "failed to read blob value", KvstoreError_UNKNOWN);
 
 err_goto:
     return error;
-}
\ No newline at end of file
+}
+
+int kvstore_server_scan(gpi_obj_id_t store_id, seL4_Word start, seL4_Word end,
+                        kvstore_pair_t *pairs, uint32_t max_pairs,
+                        uint32_t *n_pairs, seL4_Word *next_key, bool *done)
+{
+    KVSTORE_PRINTF("kvstore_server_scan: keys [%lu, %lu), up to %u pairs\n", start, end, max_pairs);
+
+    int error = seL4_NoError;
+    *n_pairs = 0;
+    *next_key = start;
+    *done = start >= end;
+
+    kvstore_registry_entry_t *entry = kvstore_get_entry(store_id);
+    CHECK_ERR_GOTO(entry == NULL || entry->scan_stmt == NULL, "kvstore does not exist", KvstoreError_UNKNOWN);
+
+    if (*done || max_pairs == 0)
+    {
+        goto err_goto;
+    }
+
+    // The primary key index returns the pairs in key order
+    sqlite3_stmt *stmt = entry->scan_stmt;
+    error = sqlite3_bind_int64(stmt, 1, kvstore_key_to_sql(start));
+    error |= sqlite3_bind_int64(stmt, 2, kvstore_key_to_sql(end));
+    error |= sqlite3_bind_int64(stmt, 3, max_pairs);
+    CHECK_ERR_GOTO(error, "failed to bind scan statement", KvstoreError_UNKNOWN);
+
+    int res;
+    while ((res = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        pairs[*n_pairs].key = kvstore_key_from_sql(sqlite3_column_int64(stmt, 0));
+        pairs[*n_pairs].val = (seL4_Word)sqlite3_column_int64(stmt, 1);
+        pairs[*n_pairs].error = seL4_NoError;
+        (*n_pairs)++;
+    }
+    sqlite3_reset(stmt);
+    CHECK_ERR_GOTO(res != SQLITE_DONE, "failed to step scan statement", KvstoreError_UNKNOWN);
+
+    // The cursor is the key after the last one returned, so the server keeps no state between pages
+    if (*n_pairs < max_pairs)
+    {
+        *next_key = end;
+        *done = true;
+    }
+    else
+    {
+        seL4_Word last_key = pairs[*n_pairs - 1].key;
+        *next_key = last_key + 1;
+        *done = last_key + 1 >= end || last_key + 1 == 0;
+    }
+
+err_goto:
+    return error;
+}
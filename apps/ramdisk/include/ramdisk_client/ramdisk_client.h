@@ -20,10 +20,11 @@ Context of the client
 typedef struct _ramdisk_client_context
 {
     seL4_CPtr ep;
+    uint32_t n_blocks; ///< Number of contiguous blocks in the extent
 
     // Needed only for RR dump
     gpi_space_id_t space_id;
-    gpi_obj_id_t res_id;
+    gpi_obj_id_t res_id; ///< ID of the extent, which is also the ID of its first block
 } ramdisk_client_context_t;
 
 /**
@@ -42,11 +43,13 @@ int start_ramdisk_pd(pd_client_context_t *ramdisk_pd,
  * Shared memory will be used for future read/write calls
  *
  * @param server_ep_cap raw ramdisk ep
- * @param mo memory to share, should be size >= RAMDISK_BLOCK_SIZE
+ * @param mo memory to share, should be size >= n_blocks * RAMDISK_BLOCK_SIZE
+ * @param n_blocks number of blocks the shared memory holds, limits the size of vectored reads/writes
  * @return int 0 on success, error code otherwise
  */
 int ramdisk_client_bind(seL4_CPtr server_ep_cap,
-                        mo_client_context_t *mo);
+                        mo_client_context_t *mo,
+                        uint32_t n_blocks);
 
 /**
  * @brief
@@ -71,7 +74,22 @@ int ramdisk_client_alloc_block(seL4_CPtr server_ep_cap,
                                ramdisk_client_context_t *ret_conn);
 
 /**
- * @brief Return a block to the ramdisk
+ * @brief Allocate a range of contiguous blocks from ramdisk as a single resource
+ *
+ * Block i of the extent has block ID ret_conn->res_id + i, for use with
+ * ramdisk_client_readv and ramdisk_client_writev
+ *
+ * @param server_ep_cap Well known server endpoint cap.
+ * @param n_blocks number of blocks to allocate
+ * @param ret_conn client's connection object for the extent
+ * @return int 0 on success, error code otherwise
+ */
+int ramdisk_client_alloc_extent(seL4_CPtr server_ep_cap,
+                                uint32_t n_blocks,
+                                ramdisk_client_context_t *ret_conn);
+
+/**
+ * @brief Return a block or extent to the ramdisk
  *
  * @param conn connection for the block to free
  * @return int 0 on success, error code otherwise
@@ -96,6 +114,67 @@ int ramdisk_client_read(ramdisk_client_context_t *conn);
  */
 int ramdisk_client_write(ramdisk_client_context_t *conn);
 
+/**
+ * @brief Read one block of an allocated extent from ramdisk
+ * Uses the shared memory as set in ramdisk_client_bind
+ *
+ * @param conn client connection object for the extent
+ * @param block_offset index of the block within the extent
+ * @return int 0 on success, error code otherwise
+ */
+int ramdisk_client_read_block(ramdisk_client_context_t *conn, uint32_t block_offset);
+
+/**
+ * @brief Write one block of an allocated extent to ramdisk
+ * Uses the shared memory as set in ramdisk_client_bind
+ *
+ * @param conn client connection object for the extent
+ * @param block_offset index of the block within the extent
+ * @return int 0 on success, error code otherwise
+ */
+int ramdisk_client_write_block(ramdisk_client_context_t *conn, uint32_t block_offset);
+
+/**
+ * @brief Read a list of allocated blocks from ramdisk with a single request
+ * Block i is placed at offset i * RAMDISK_BLOCK_SIZE of the shared memory set in ramdisk_client_bind
+ *
+ * @param server_ep_cap raw ramdisk ep
+ * @param block_ids IDs of the blocks to read, the client must hold all of them
+ * @param n_blocks number of blocks, at most RAMDISK_MAX_VECTOR_BLOCKS and the size of the shared memory
+ * @return int 0 on success, error code otherwise
+ */
+int ramdisk_client_readv(seL4_CPtr server_ep_cap,
+                         gpi_obj_id_t *block_ids,
+                         uint32_t n_blocks);
+
+/**
+ * @brief Write a list of allocated blocks to ramdisk with a single request
+ * Block i is taken from offset i * RAMDISK_BLOCK_SIZE of the shared memory set in ramdisk_client_bind
+ *
+ * @param server_ep_cap raw ramdisk ep
+ * @param block_ids IDs of the blocks to write, the client must hold all of them
+ * @param n_blocks number of blocks, at most RAMDISK_MAX_VECTOR_BLOCKS and the size of the shared memory
+ * @return int 0 on success, error code otherwise
+ */
+int ramdisk_client_writev(seL4_CPtr server_ep_cap,
+                          gpi_obj_id_t *block_ids,
+                          uint32_t n_blocks);
+
+/**
+ * @brief Get an MO backed by the ramdisk memory of a list of allocated blocks
+ * Block i is page i of the MO, and accesses through the MO go straight to the ramdisk
+ *
+ * @param server_ep_cap raw ramdisk ep
+ * @param block_ids IDs of the blocks to map, the client must hold all of them
+ * @param n_blocks number of blocks, at most RAMDISK_MAX_VECTOR_BLOCKS
+ * @param ret_mo returns the MO, held by the caller, which can slice it again for its own clients
+ * @return int 0 on success, error code otherwise
+ */
+int ramdisk_client_map(seL4_CPtr server_ep_cap,
+                       gpi_obj_id_t *block_ids,
+                       uint32_t n_blocks,
+                       mo_client_context_t *ret_mo);
+
 /**
  * Get the block size of the ramdisk
  */
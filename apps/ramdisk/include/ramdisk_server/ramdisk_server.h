@@ -19,15 +19,9 @@
 #define RAMDISK_SERVER_DEFAULT_PRIORITY (seL4_MaxPrio - 100)
 #define MAX_CLIENT_ID 32
 
-/* Context of the server */
+#define RAMDISK_MAP_WORDS (RAMDISK_N_BLOCKS / 64)
 
-// Linked list node represents a block or block range
-typedef struct _ramdisk_block_node
-{
-    gpi_obj_id_t blockno;
-    uint32_t n_blocks;
-    struct _ramdisk_block_node *next;
-} ramdisk_block_node_t;
+/* Context of the server */
 
 typedef struct _ramdisk_server_context
 {
@@ -38,11 +32,21 @@ typedef struct _ramdisk_server_context
     void *ramdisk_buf;
     mo_client_context_t *ramdisk_mo;
 
-    // Data structure of ramdisk blocks
-    ramdisk_block_node_t *free_blocks;
+    // Bitmap of ramdisk blocks, a set bit means the block is free
+    uint64_t free_map[RAMDISK_MAP_WORDS];
+
+    // Bitmap of block IDs that have been created as a resource, extents are created on first allocation
+    uint64_t created_map[RAMDISK_MAP_WORDS];
+
+    // Number of blocks in the extent starting at each block, or 0 if no extent starts there
+    uint32_t extent_len[RAMDISK_N_BLOCKS];
+
+    // Client holding each block, or BADGE_OBJ_ID_NULL if the block is free
+    gpi_obj_id_t block_owner[RAMDISK_N_BLOCKS];
 
     // Store per-client page for shared mem
     void *shared_mem[MAX_CLIENT_ID];
+    uint32_t shared_mem_blocks[MAX_CLIENT_ID]; ///< Number of blocks each client's shared mem holds
 } ramdisk_server_context_t;
 
 /**
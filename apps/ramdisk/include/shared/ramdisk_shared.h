@@ -10,5 +10,7 @@
 #define RD_RPC_MAGIC 0x5244
 #define BLOCK_RESOURCE_TYPE_NAME "BLOCK"
 #define RAMDISK_BLOCK_SIZE (1u << seL4_PageBits) // Block size for the ramdisk
-#define RAMDISK_SIZE_BITS 22                     // Size of total ramdisk
-#define RAMDISK_SIZE_BYTES (1u << RAMDISK_SIZE_BITS)
\ No newline at end of file
+#define RAMDISK_SIZE_BITS 24                     // Size of total ramdisk, lets each xv6fs hold a double-indirect file
+#define RAMDISK_SIZE_BYTES (1u << RAMDISK_SIZE_BITS)
+#define RAMDISK_N_BLOCKS (RAMDISK_SIZE_BYTES / RAMDISK_BLOCK_SIZE)
+#define RAMDISK_MAX_VECTOR_BLOCKS 32 // Max blocks moved by one READV/WRITEV request, or mapped by one MAP request
\ No newline at end of file
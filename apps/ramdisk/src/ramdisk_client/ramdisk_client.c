@@ -63,13 +63,15 @@ int start_ramdisk_pd(pd_client_context_t *ramdisk_pd,
 }
 
 int ramdisk_client_bind(seL4_CPtr server_ep_cap,
-                        mo_client_context_t *mo)
+                        mo_client_context_t *mo,
+                        uint32_t n_blocks)
 {
     int error;
 
     RamdiskMessage request = {
         .magic = RD_RPC_MAGIC,
-        .op = RamdiskAction_BIND};
+        .op = RamdiskAction_BIND,
+        .n_blocks = n_blocks};
 
     RamdiskReturnMessage reply = {0};
 
@@ -93,14 +95,20 @@ int ramdisk_client_unbind(seL4_CPtr server_ep_cap)
     return error || reply.errorCode;
 }
 
-int ramdisk_client_alloc_block(seL4_CPtr server_ep_cap,
-                               ramdisk_client_context_t *ret_conn)
+/**
+ * Send an ALLOC or ALLOC_EXTENT request
+ */
+static int ramdisk_client_alloc(seL4_CPtr server_ep_cap,
+                                RamdiskAction op,
+                                uint32_t n_blocks,
+                                ramdisk_client_context_t *ret_conn)
 {
     int error;
 
     RamdiskMessage request = {
         .magic = RD_RPC_MAGIC,
-        .op = RamdiskAction_ALLOC};
+        .op = op,
+        .n_blocks = n_blocks};
 
     RamdiskReturnMessage reply = {0};
 
@@ -114,10 +122,24 @@ int ramdisk_client_alloc_block(seL4_CPtr server_ep_cap,
     ret_conn->ep = reply.msg.alloc.slot;
     ret_conn->space_id = reply.msg.alloc.space_id;
     ret_conn->res_id = reply.msg.alloc.block_id;
+    ret_conn->n_blocks = reply.msg.alloc.n_blocks;
 
     return error || reply.errorCode;
 }
 
+int ramdisk_client_alloc_block(seL4_CPtr server_ep_cap,
+                               ramdisk_client_context_t *ret_conn)
+{
+    return ramdisk_client_alloc(server_ep_cap, RamdiskAction_ALLOC, 1, ret_conn);
+}
+
+int ramdisk_client_alloc_extent(seL4_CPtr server_ep_cap,
+                                uint32_t n_blocks,
+                                ramdisk_client_context_t *ret_conn)
+{
+    return ramdisk_client_alloc(server_ep_cap, RamdiskAction_ALLOC_EXTENT, n_blocks, ret_conn);
+}
+
 int ramdisk_client_free_block(ramdisk_client_context_t *conn)
 {
     int error;
@@ -134,35 +156,125 @@ int ramdisk_client_free_block(ramdisk_client_context_t *conn)
 }
 
 int ramdisk_client_read(ramdisk_client_context_t *conn)
+{
+    return ramdisk_client_read_block(conn, 0);
+}
+
+int ramdisk_client_read_block(ramdisk_client_context_t *conn, uint32_t block_offset)
 {
     int error;
 
     RamdiskMessage request = {
         .magic = RD_RPC_MAGIC,
-        .op = RamdiskAction_READ};
+        .op = RamdiskAction_READ,
+        .block_offset = block_offset};
 
     RamdiskReturnMessage reply = {0};
 
-    error = sel4gpi_rpc_call(&rpc_client, conn->ep, &request, 0, NULL, &reply);
+    error = sel4gpi_rpc_call_raw(&rpc_client, conn->ep, &request, 0, NULL, &reply);
 
     return error || reply.errorCode;
 }
 
 int ramdisk_client_write(ramdisk_client_context_t *conn)
+{
+    return ramdisk_client_write_block(conn, 0);
+}
+
+int ramdisk_client_write_block(ramdisk_client_context_t *conn, uint32_t block_offset)
 {
     int error;
 
     RamdiskMessage request = {
         .magic = RD_RPC_MAGIC,
-        .op = RamdiskAction_WRITE};
+        .op = RamdiskAction_WRITE,
+        .block_offset = block_offset};
 
     RamdiskReturnMessage reply = {0};
 
-    error = sel4gpi_rpc_call(&rpc_client, conn->ep, &request, 0, NULL, &reply);
+    error = sel4gpi_rpc_call_raw(&rpc_client, conn->ep, &request, 0, NULL, &reply);
 
     return error || reply.errorCode;
 }
 
+/**
+ * Send a READV or WRITEV request for a list of blocks
+ */
+static int ramdisk_client_rw_vector(seL4_CPtr server_ep_cap,
+                                    RamdiskAction op,
+                                    gpi_obj_id_t *block_ids,
+                                    uint32_t n_blocks)
+{
+    int error = 0;
+
+    CHECK_ERROR(n_blocks == 0 || n_blocks > RAMDISK_MAX_VECTOR_BLOCKS, "invalid number of blocks");
+
+    RamdiskMessage request = {
+        .magic = RD_RPC_MAGIC,
+        .op = op,
+        .block_ids_count = n_blocks};
+
+    for (int i = 0; i < n_blocks; i++)
+    {
+        request.block_ids[i] = block_ids[i];
+    }
+
+    RamdiskReturnMessage reply = {0};
+
+    error = sel4gpi_rpc_call(&rpc_client, server_ep_cap, &request, 0, NULL, &reply);
+
+    return error || reply.errorCode;
+}
+
+int ramdisk_client_readv(seL4_CPtr server_ep_cap,
+                         gpi_obj_id_t *block_ids,
+                         uint32_t n_blocks)
+{
+    return ramdisk_client_rw_vector(server_ep_cap, RamdiskAction_READV, block_ids, n_blocks);
+}
+
+int ramdisk_client_writev(seL4_CPtr server_ep_cap,
+                          gpi_obj_id_t *block_ids,
+                          uint32_t n_blocks)
+{
+    return ramdisk_client_rw_vector(server_ep_cap, RamdiskAction_WRITEV, block_ids, n_blocks);
+}
+
+int ramdisk_client_map(seL4_CPtr server_ep_cap,
+                       gpi_obj_id_t *block_ids,
+                       uint32_t n_blocks,
+                       mo_client_context_t *ret_mo)
+{
+    int error = 0;
+
+    CHECK_ERROR(n_blocks == 0 || n_blocks > RAMDISK_MAX_VECTOR_BLOCKS, "invalid number of blocks");
+
+    RamdiskMessage request = {
+        .magic = RD_RPC_MAGIC,
+        .op = RamdiskAction_MAP,
+        .block_ids_count = n_blocks};
+
+    for (int i = 0; i < n_blocks; i++)
+    {
+        request.block_ids[i] = block_ids[i];
+    }
+
+    RamdiskReturnMessage reply = {0};
+
+    error = sel4gpi_rpc_call(&rpc_client, server_ep_cap, &request, 0, NULL, &reply);
+
+    if (error || reply.errorCode || reply.which_msg != RamdiskReturnMessage_map_tag)
+    {
+        return 1;
+    }
+
+    ret_mo->ep = reply.msg.map.slot;
+    ret_mo->id = reply.msg.map.mo_id;
+    ret_mo->size = (size_t)n_blocks * RAMDISK_BLOCK_SIZE;
+
+    return 0;
+}
+
 uint64_t get_ramdisk_block_size()
 {
     return RAMDISK_BLOCK_SIZE;
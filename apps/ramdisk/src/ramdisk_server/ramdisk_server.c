@@ -74,118 +74,101 @@ ramdisk_server_context_t *get_ramdisk_server(void)
  */
 static void *ramdisk_ptr(unsigned int sector)
 {
-    assert(sector < (RAMDISK_SIZE_BYTES / RAMDISK_BLOCK_SIZE));
+    assert(sector < RAMDISK_N_BLOCKS);
     return get_ramdisk_server()->ramdisk_buf + sector * RAMDISK_BLOCK_SIZE;
 }
 
-/**
- * Allocate the next available block
- *
- * @param blockno returns the allocated block number
- * @param return 0 on success, 1 if there are no blocks available
- */
-static int alloc_block(gpi_obj_id_t *blockno)
+static inline bool map_test(uint64_t *map, uint32_t blockno)
 {
-    if (get_ramdisk_server()->free_blocks == NULL)
-    {
-        return 1;
-    }
-
-    *blockno = get_ramdisk_server()->free_blocks->blockno;
-
-    RAMDISK_PRINTF("Allocating blockno %u\n", *blockno);
-
-    // Update free block list
-    get_ramdisk_server()->free_blocks->blockno++;
-    get_ramdisk_server()->free_blocks->n_blocks--;
+    return (map[blockno / 64] >> (blockno % 64)) & 1;
+}
 
-    if (get_ramdisk_server()->free_blocks->n_blocks <= 0)
-    {
-        // This node has no blocks left, move to the next
-        ramdisk_block_node_t *old_node = get_ramdisk_server()->free_blocks;
-        get_ramdisk_server()->free_blocks = old_node->next;
-        free(old_node);
-    }
+static inline void map_set(uint64_t *map, uint32_t blockno)
+{
+    map[blockno / 64] |= 1ull << (blockno % 64);
+}
 
-    return 0;
+static inline void map_clear(uint64_t *map, uint32_t blockno)
+{
+    map[blockno / 64] &= ~(1ull << (blockno % 64));
 }
 
 /**
- * Mark a block as free
+ * Allocate the first run of free blocks that is long enough
+ *
+ * @param n_blocks number of contiguous blocks to allocate
+ * @param blockno returns the first block of the allocated extent
+ * @param return 0 on success, 1 if there is no free run of n_blocks
  */
-static void free_block(unsigned int blockno)
+static int alloc_extent(uint32_t n_blocks, gpi_obj_id_t *blockno)
 {
-    // Find a place in the linked list to record this free block
-    // (XXX) Arya: Not terribly efficient
-    ramdisk_block_node_t *prev = NULL;
-    for (ramdisk_block_node_t *curr = get_ramdisk_server()->free_blocks; curr != NULL; curr = curr->next)
+    ramdisk_server_context_t *server = get_ramdisk_server();
+
+    if (n_blocks == 0 || n_blocks > RAMDISK_N_BLOCKS)
     {
-        if (curr->blockno == blockno + 1)
-        {
-            // Insert this block at the beginning of the current node
-            curr->blockno = blockno;
-            curr->n_blocks++;
+        return 1;
+    }
 
-            // Check if we can coalesce with previous node
-            if (prev && (prev->blockno + prev->n_blocks) == blockno)
-            {
-                prev->n_blocks += curr->n_blocks;
-                prev->next = curr->next;
-                free(curr);
-            }
+    uint32_t run_start = 0;
+    uint32_t run_len = 0;
 
-            return;
+    for (uint32_t i = 0; i < RAMDISK_N_BLOCKS && run_len < n_blocks;)
+    {
+        if (i % 64 == 0 && server->free_map[i / 64] == 0)
+        {
+            // Skip fully allocated words
+            run_len = 0;
+            i += 64;
         }
-        else if (curr->blockno + curr->n_blocks == blockno)
+        else if (map_test(server->free_map, i))
         {
-            // Insert this block at the end of the current node
-            curr->n_blocks++;
-
-            // Check if we can coalesce with the next node
-            if (curr->next && curr->next->blockno == blockno + 1)
+            if (run_len == 0)
             {
-                curr->n_blocks += curr->next->n_blocks;
-                curr->next = curr->next->next;
-                free(curr->next);
+                run_start = i;
             }
-
-            return;
+            run_len++;
+            i++;
         }
-        else if (curr->blockno > blockno)
+        else
         {
-            // Should insert a new node for this blockno
-            ramdisk_block_node_t *new_node = malloc(sizeof(ramdisk_block_node_t));
-            new_node->blockno = blockno;
-            new_node->n_blocks = 1;
-            new_node->next = curr;
-
-            if (prev == NULL)
-            {
-                get_ramdisk_server()->free_blocks = new_node;
-            }
-            else
-            {
-                prev->next = new_node;
-            }
-
-            return;
+            run_len = 0;
+            i++;
         }
     }
 
-    // If we get here, then we need to insert at the end of the list
-    ramdisk_block_node_t *new_node = malloc(sizeof(ramdisk_block_node_t));
-    new_node->blockno = blockno;
-    new_node->n_blocks = 1;
-    new_node->next = NULL;
+    if (run_len < n_blocks)
+    {
+        return 1;
+    }
+
+    RAMDISK_PRINTF("Allocating blocks %u to %u\n", run_start, run_start + n_blocks - 1);
 
-    if (prev == NULL)
+    for (uint32_t i = run_start; i < run_start + n_blocks; i++)
     {
-        get_ramdisk_server()->free_blocks = new_node;
+        map_clear(server->free_map, i);
     }
-    else
+
+    server->extent_len[run_start] = n_blocks;
+    *blockno = run_start;
+
+    return 0;
+}
+
+/**
+ * Mark all blocks of an extent as free
+ */
+static void free_extent(unsigned int blockno)
+{
+    ramdisk_server_context_t *server = get_ramdisk_server();
+    uint32_t n_blocks = server->extent_len[blockno];
+
+    for (uint32_t i = blockno; i < blockno + n_blocks; i++)
     {
-        prev->next = new_node;
+        server->block_owner[i] = BADGE_OBJ_ID_NULL;
+        map_set(server->free_map, i);
     }
+
+    server->extent_len[blockno] = 0;
 }
 
 /**
@@ -217,19 +200,18 @@ int ramdisk_init()
     CHECK_ERROR(error, "failed to map virtual disk");
     RAMDISK_PRINTF("Mapped ramdisk\n");
 
-    /* Setup disk block data structure */
-    server->free_blocks = malloc(sizeof(ramdisk_block_node_t));
-    server->free_blocks->blockno = 0;
-    server->free_blocks->n_blocks = RAMDISK_SIZE_BYTES / RAMDISK_BLOCK_SIZE;
-    server->free_blocks->next = NULL;
+    /* Setup disk block data structure, all blocks start free */
+    memset(server->free_map, 0xff, sizeof(server->free_map));
+    memset(server->created_map, 0, sizeof(server->created_map));
 
-    /* Create the block resources */
-    for (int i = 0; i < server->free_blocks->n_blocks; i++)
+    for (int i = 0; i < RAMDISK_N_BLOCKS; i++)
     {
-        // Local resource ID is the block ID
-        resource_server_create_resource(&server->gen, NULL, i);
+        server->extent_len[i] = 0;
+        server->block_owner[i] = BADGE_OBJ_ID_NULL;
     }
 
+    // Block resources are created when an extent first starts at them
+
     return error;
 }
 
@@ -273,10 +255,20 @@ void ramdisk_request_handler(
             RAMDISK_PRINTF("Binding MO for client %u\n", client_id);
 
             /* Attach memory object to server ADS */
-            error = resource_server_attach_mo(&get_ramdisk_server()->gen, cap, &mo_vaddr);
+            size_t mo_size;
+            error = resource_server_attach_mo(&get_ramdisk_server()->gen, cap, &mo_vaddr, &mo_size);
             CHECK_ERROR_GOTO(error, "Failed to attach MO", error, done);
 
+            /* Vectored requests trust this count, so the MO must really hold that many blocks */
+            uint32_t shared_blocks = msg->n_blocks > 0 ? msg->n_blocks : 1;
+            if ((uint64_t)shared_blocks * RAMDISK_BLOCK_SIZE > mo_size)
+            {
+                resource_server_unattach(&get_ramdisk_server()->gen, mo_vaddr);
+                CHECK_ERROR_GOTO(1, "MO is smaller than the blocks it should hold", RamdiskError_UNKNOWN, done);
+            }
+
             get_ramdisk_server()->shared_mem[client_id] = mo_vaddr;
+            get_ramdisk_server()->shared_mem_blocks[client_id] = shared_blocks;
 
             // No need to clear the cap, it will be cleared by the utils after the call
 
@@ -291,15 +283,31 @@ void ramdisk_request_handler(
             error = resource_server_unattach(&get_ramdisk_server()->gen, mo_vaddr);
             CHECK_ERROR_GOTO(error, "Failed to unattach MO", error, done);
             get_ramdisk_server()->shared_mem[client_id] = NULL;
+            get_ramdisk_server()->shared_mem_blocks[client_id] = 0;
 
             CHECK_ERROR_GOTO(error, "Failed to free cap during unbind", error, done);
             break;
         case RamdiskAction_ALLOC:
-            // Assign a new block to this ep
+        case RamdiskAction_ALLOC_EXTENT:
+            // Assign a new extent to this ep
+            uint32_t n_blocks = msg->op == RamdiskAction_ALLOC ? 1 : msg->n_blocks;
             gpi_obj_id_t blockno;
-            error = alloc_block(&blockno);
+            error = alloc_extent(n_blocks, &blockno);
+
+            CHECK_ERROR_GOTO(error, "no free range of blocks to assign", RamdiskError_NO_BLOCKS, done);
+
+            if (!map_test(get_ramdisk_server()->created_map, blockno))
+            {
+                // Local resource ID is the ID of the extent's first block
+                error = resource_server_create_resource(&get_ramdisk_server()->gen, NULL, blockno);
+                if (error)
+                {
+                    free_extent(blockno);
+                }
+                CHECK_ERROR_GOTO(error, "Failed to create the resource", error, done);
 
-            CHECK_ERROR_GOTO(error, "no more free blocks to assign", RamdiskError_NO_BLOCKS, done);
+                map_set(get_ramdisk_server()->created_map, blockno);
+            }
 
             // Create the resource endpoint
             seL4_CPtr dest;
@@ -308,16 +316,83 @@ void ramdisk_request_handler(
                                                   blockno,
                                                   get_client_id_from_badge(sender_badge),
                                                   &dest);
+            if (error)
+            {
+                free_extent(blockno);
+            }
             CHECK_ERROR_GOTO(error, "Failed to give the resource", error, done);
 
+            for (uint32_t i = blockno; i < blockno + n_blocks; i++)
+            {
+                get_ramdisk_server()->block_owner[i] = client_id;
+            }
+
             // Send the reply
             reply_msg->which_msg = RamdiskReturnMessage_alloc_tag;
             reply_msg->msg.alloc.block_id = blockno;
             reply_msg->msg.alloc.space_id = get_ramdisk_server()->gen.default_space.id;
             reply_msg->msg.alloc.slot = dest;
+            reply_msg->msg.alloc.n_blocks = n_blocks;
 
             RAMDISK_PRINTF("Resource is in dest slot %d\n", (int)dest);
             break;
+        case RamdiskAction_READV:
+        case RamdiskAction_WRITEV:
+            RAMDISK_PRINTF("Op is %s of %u blocks\n", msg->op == RamdiskAction_READV ? "readv" : "writev",
+                           (unsigned int)msg->block_ids_count);
+
+            /* Find the previously attached shared memory */
+            mo_vaddr = get_ramdisk_server()->shared_mem[client_id];
+            CHECK_ERROR_GOTO(mo_vaddr == NULL, "MO for client did not exist", RamdiskError_UNKNOWN, done);
+            CHECK_ERROR_GOTO(msg->block_ids_count > get_ramdisk_server()->shared_mem_blocks[client_id],
+                             "Shared memory is too small for request", RamdiskError_UNKNOWN, done);
+
+            /* Check all blocks before transferring any */
+            for (int i = 0; i < msg->block_ids_count; i++)
+            {
+                gpi_obj_id_t block_id = msg->block_ids[i];
+                CHECK_ERROR_GOTO(block_id >= RAMDISK_N_BLOCKS || get_ramdisk_server()->block_owner[block_id] != client_id,
+                                 "Client does not hold block", RamdiskError_UNKNOWN, done);
+            }
+
+            for (int i = 0; i < msg->block_ids_count; i++)
+            {
+                void *shared_vaddr = mo_vaddr + i * RAMDISK_BLOCK_SIZE;
+
+                if (msg->op == RamdiskAction_READV)
+                {
+                    memcpy(shared_vaddr, ramdisk_ptr(msg->block_ids[i]), RAMDISK_BLOCK_SIZE);
+                }
+                else
+                {
+                    memcpy(ramdisk_ptr(msg->block_ids[i]), shared_vaddr, RAMDISK_BLOCK_SIZE);
+                }
+            }
+            break;
+        case RamdiskAction_MAP:
+            RAMDISK_PRINTF("Op is map of %u blocks for PD %u\n", (unsigned int)msg->block_ids_count, client_id);
+
+            CHECK_ERROR_GOTO(msg->block_ids_count == 0, "No blocks to map", RamdiskError_UNKNOWN, done);
+
+            for (int i = 0; i < msg->block_ids_count; i++)
+            {
+                gpi_obj_id_t block_id = msg->block_ids[i];
+                CHECK_ERROR_GOTO(block_id >= RAMDISK_N_BLOCKS || get_ramdisk_server()->block_owner[block_id] != client_id,
+                                 "Client does not hold block", RamdiskError_UNKNOWN, done);
+            }
+
+            /* Each block is one page of the ramdisk MO, so the new MO shares those pages
+               The client holds the blocks, so the MO component accepts it as a client of the block space */
+            mo_client_context_t block_mo;
+            error = mo_component_client_slice(get_ramdisk_server()->ramdisk_mo, msg->block_ids,
+                                              msg->block_ids_count, client_id,
+                                              get_ramdisk_server()->gen.default_space.id, &block_mo);
+            CHECK_ERROR_GOTO(error, "Failed to make MO for blocks", RamdiskError_UNKNOWN, done);
+
+            reply_msg->which_msg = RamdiskReturnMessage_map_tag;
+            reply_msg->msg.map.slot = block_mo.ep;
+            reply_msg->msg.map.mo_id = block_mo.id;
+            break;
         default:
             RAMDISK_PRINTF("Op is %d\n", msg->op);
             CHECK_ERROR_GOTO(1, "got invalid op on badged ep without obj id", RamdiskError_UNKNOWN, done);
@@ -337,9 +412,12 @@ void ramdisk_request_handler(
             CHECK_ERROR_GOTO(mo_vaddr == NULL, "MO for client did not exist", RamdiskError_UNKNOWN, done);
             *need_new_recv_cap = false;
 
+            CHECK_ERROR_GOTO(msg->block_offset >= get_ramdisk_server()->extent_len[obj_id],
+                             "Block offset is outside of the extent", RamdiskError_UNKNOWN, done);
+
             /* Read ramdisk */
-            void *ramdisk_vaddr = ramdisk_ptr(obj_id);
-            RAMDISK_PRINTF("Reading from blockno %u to %p\n", obj_id, mo_vaddr);
+            void *ramdisk_vaddr = ramdisk_ptr(obj_id + msg->block_offset);
+            RAMDISK_PRINTF("Reading from blockno %u to %p\n", obj_id + msg->block_offset, mo_vaddr);
             memcpy(mo_vaddr, ramdisk_vaddr, RAMDISK_BLOCK_SIZE);
 
             RAMDISK_PRINTF("Read block\n");
@@ -354,9 +432,12 @@ void ramdisk_request_handler(
             CHECK_ERROR_GOTO(mo_vaddr == NULL, "MO for client did not exist", RamdiskError_UNKNOWN, done);
             *need_new_recv_cap = false;
 
+            CHECK_ERROR_GOTO(msg->block_offset >= get_ramdisk_server()->extent_len[obj_id],
+                             "Block offset is outside of the extent", RamdiskError_UNKNOWN, done);
+
             /* Write ramdisk */
-            ramdisk_vaddr = ramdisk_ptr(obj_id);
-            RAMDISK_PRINTF("Writing from %p to blockno %u\n", mo_vaddr, obj_id);
+            ramdisk_vaddr = ramdisk_ptr(obj_id + msg->block_offset);
+            RAMDISK_PRINTF("Writing from %p to blockno %u\n", mo_vaddr, obj_id + msg->block_offset);
             memcpy(ramdisk_vaddr, mo_vaddr, RAMDISK_BLOCK_SIZE);
 
             // ARYA-TODO what if the MO is not of RAMDISK_BLOCK_SIZE?
@@ -364,9 +445,9 @@ void ramdisk_request_handler(
         case RamdiskAction_FREE:
             RAMDISK_PRINTF("Op is free\n");
 
-            RAMDISK_PRINTF("Free blockno %d\n", obj_id);
-            // Free the block in metadata
-            free_block(obj_id);
+            RAMDISK_PRINTF("Free extent at blockno %d\n", obj_id);
+            // Free the extent in metadata
+            free_extent(obj_id);
 
             // Revoke the resource from the client
             error = resspc_client_revoke_resource(&get_ramdisk_server()->gen.default_space, obj_id, client_id);
@@ -407,10 +488,10 @@ int ramdisk_work_handler(PdWorkReturnMessage *work)
             gpi_obj_id_t blockno = work->object_ids[i];
 
             assert(space_id == get_ramdisk_server()->gen.default_space.id);
-            assert(blockno >= 0 && blockno < (RAMDISK_SIZE_BYTES / RAMDISK_BLOCK_SIZE));
+            assert(blockno >= 0 && blockno < RAMDISK_N_BLOCKS);
 
-            RAMDISK_PRINTF("Free blockno %d\n", blockno);
-            free_block(blockno);
+            RAMDISK_PRINTF("Free extent at blockno %d\n", blockno);
+            free_extent(blockno);
         }
 
         error = pd_client_finish_work(&get_ramdisk_server()->gen.pd_conn, work);
@@ -423,14 +504,18 @@ int ramdisk_work_handler(PdWorkReturnMessage *work)
             gpi_obj_id_t blockno = work->object_ids[i];
 
             assert(space_id == get_ramdisk_server()->gen.default_space.id);
-            assert(blockno >= 0 && blockno < (RAMDISK_SIZE_BYTES / RAMDISK_BLOCK_SIZE));
+            assert(blockno >= 0 && blockno < RAMDISK_N_BLOCKS);
 
             if (blockno != BADGE_OBJ_ID_NULL)
             {
-                // Destroy a block, it can no longer be allocated
-                RAMDISK_PRINTF("Destroy blockno %d\n", blockno);
+                // Destroy an extent, its blocks can no longer be allocated
+                RAMDISK_PRINTF("Destroy extent at blockno %d\n", blockno);
+                for (uint32_t j = blockno; j < blockno + get_ramdisk_server()->extent_len[blockno]; j++)
+                {
+                    get_ramdisk_server()->block_owner[j] = BADGE_OBJ_ID_NULL;
+                }
 
-                // Nothing to be done, just don't return the blockno to the free list
+                // Nothing else to be done, just don't return the blocks to the free map
             }
             else
             {
@@ -443,13 +528,8 @@ int ramdisk_work_handler(PdWorkReturnMessage *work)
                 error = mo_component_client_disconnect(get_ramdisk_server()->ramdisk_mo);
                 CHECK_ERROR_GOTO(error, "Failed to free ramdisk memroy", RamdiskError_UNKNOWN, err_goto);
 
-                // Clear the list of free blocks
-                ramdisk_block_node_t *next = NULL;
-                for (ramdisk_block_node_t *curr = get_ramdisk_server()->free_blocks; curr != NULL; curr = next)
-                {
-                    next = curr->next;
-                    free(curr);
-                }
+                // No blocks can be allocated anymore
+                memset(get_ramdisk_server()->free_map, 0, sizeof(get_ramdisk_server()->free_map));
             }
         }
 
@@ -272,19 +272,15 @@ int sample_work_handler(PdWorkReturnMessage *work)
 
                 // For example:
 #if 0
-                // Get the sample server PD ID string
-                char sample_pd_id_str[CSV_MAX_STRING_SIZE];
-                get_pd_id(sel4gpi_get_pd_conn().id, sample_pd_id_str);
+                // Get the sample server PD node key
+                gpi_model_node_key_t sample_pd_key = get_pd_key(sel4gpi_get_pd_conn().id);
 
-                // Get the client PD ID string
-                char client_pd_id_str[CSV_MAX_STRING_SIZE];
-                get_pd_id(client_pd_id, client_pd_id_str);
+                // Get the client PD node key
+                gpi_model_node_key_t client_pd_key = get_pd_key(client_pd_id);
 
-                // Get the sample resource space ID string
-                char sample_space_id[CSV_MAX_STRING_SIZE];
-                get_resource_space_id(get_sample_server()->gen.resource_type,
-                                      get_sample_server()->gen.default_space.id,
-                                      sample_space_id);
+                // Get the sample resource space node key
+                gpi_model_node_key_t sample_space_key = get_resource_space_key(get_sample_server()->gen.resource_type,
+                                                                               get_sample_server()->gen.default_space.id);
 
                 // Find the implicit resource(s)
                 gpi_obj_id_t id = ...;
@@ -297,11 +293,11 @@ int sample_work_handler(PdWorkReturnMessage *work)
                     true);
 
                 // Add the subset edge
-                add_edge_by_id(model_state, GPI_EDGE_TYPE_SUBSET, sample_node->id, sample_space_id);
+                add_edge_by_id(model_state, GPI_EDGE_TYPE_SUBSET, sample_node->id, sample_space_key);
 
                 // Add the hold edges
-                add_edge_by_id(model_state, GPI_EDGE_TYPE_HOLD, sample_pd_id_str, sample_node->id);
-                add_edge_by_id(model_state, GPI_EDGE_TYPE_HOLD, client_pd_id_str, sample_node->id);
+                add_edge_by_id(model_state, GPI_EDGE_TYPE_HOLD, sample_pd_key, sample_node->id);
+                add_edge_by_id(model_state, GPI_EDGE_TYPE_HOLD, client_pd_key, sample_node->id);
 
                 // Add the map edges
                 add_edge(model_state, GPI_EDGE_TYPE_MAP, sample_node, ...);
@@ -313,17 +309,15 @@ int sample_work_handler(PdWorkReturnMessage *work)
 
                 // For example:
 #if 0
-                // Get the sample resource node id
+                // Get the sample resource node key
                 // The node is added to the model state by the root task
-                char sample_node_id[CSV_MAX_STRING_SIZE];
-                get_resource_id(
+                gpi_model_node_key_t sample_node_key = get_resource_key(
                     make_res_id(get_sample_server()->gen.resource_type,
                                 get_sample_server()->gen.default_space.id,
-                                object_id),
-                    sample_node_id);
+                                object_id));
 
                 // Add the map edge(s)
-                add_edge_by_id(model_state, GPI_EDGE_TYPE_MAP, sample_node_id, ...);
+                add_edge_by_id(model_state, GPI_EDGE_TYPE_MAP, sample_node_key, ...);
 #endif
             }
         }
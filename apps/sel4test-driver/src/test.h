@@ -124,6 +124,7 @@ struct driver_env
 
     /* OSmosis PD running the test executable */
     pd_t *test_pd;
+    ads_t *test_ads;
     cpu_t *test_cpu;
 };
 typedef struct driver_env *driver_env_t;
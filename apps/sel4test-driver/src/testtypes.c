@@ -22,6 +22,7 @@
 #include <sel4gpi/pd_component.h>
 #include <sel4gpi/endpoint_component.h>
 #include <sel4gpi/error_handle.h>
+#include <sel4gpi/pd_utils.h>
 #include <sel4testsupport/testreporter.h>
 #include <sel4platsupport/device.h>
 
@@ -242,6 +243,34 @@ static int sel4test_driver_wait(driver_env_t env, struct testcase *test)
             continue;
         }
 
+        if (test->test_type == OSM && seL4_MessageInfo_get_label(info) == seL4_Fault_VMFault &&
+            sel4gpi_is_write_fault())
+        {
+            /* the test PD may write to a VMR it shared copy-on-write with a child PD */
+            seL4_Word fault_mrs[seL4_VMFault_Length];
+            for (int i = 0; i < seL4_VMFault_Length; i++)
+            {
+                fault_mrs[i] = seL4_GetMR(i);
+            }
+
+            sync_mutex_lock(get_gpi_server()->mx);
+            int error = ads_cow_fault(get_ads_component()->server_vspace, get_ads_component()->server_vka,
+                                      env->test_ads, (void *)fault_mrs[seL4_VMFault_Addr]);
+            sync_mutex_unlock(get_gpi_server()->mx);
+
+            if (!error)
+            {
+                api_reply(env->reply.cptr, seL4_MessageInfo_new(0, 0, 0, 0));
+                continue;
+            }
+
+            /* restore the fault message for the report below */
+            for (int i = 0; i < seL4_VMFault_Length; i++)
+            {
+                seL4_SetMR(i, fault_mrs[i]);
+            }
+        }
+
         result = test_output;
         if (seL4_MessageInfo_get_label(info))
         {
@@ -479,6 +508,7 @@ void osm_set_up(uintptr_t e)
     seL4_CPtr ads_slot_in_test;
     error = ads_component_allocate(pd->id, &ads, &ads_slot_in_test);
     assert(error == 0);
+    env->test_ads = ads;
 
     cpu_t *cpu;
     seL4_CPtr cpu_slot_in_test;
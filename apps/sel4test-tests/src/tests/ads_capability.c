@@ -10,6 +10,7 @@
 #include "../test.h"
 #include "../helpers.h"
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <sel4gpi/ads_clientapi.h>
 #include <sel4gpi/vmr_clientapi.h>
@@ -19,6 +20,8 @@
 #include <sel4gpi/mo_component.h>
 #include <sel4gpi/debug.h>
 #include <sel4gpi/pd_utils.h>
+#include <sel4gpi/pd_creation.h>
+#include <sel4gpi/range_tree.h>
 #include "test_shared.h"
 
 int test_ads_attach(env_t env)
@@ -154,6 +157,204 @@ int ads_create_many_osm(env_t env)
 }
 DEFINE_TEST_OSM(GPIADS003, "Test creating and destroying a lot of address spaces", ads_create_many_osm, true)
 
+#define COW_ORIGINAL_DATA 0xA
+#define COW_CHILD_DATA 0xB
+#define COW_PARENT_DATA 0xC
+
+static int cow_child(int argc, char **argv)
+{
+    ep_client_context_t fault_ep_conn = sel4gpi_get_fault_ep_conn();
+    int error = ep_client_get_raw_endpoint(&fault_ep_conn);
+    assert(error == 0);
+
+    volatile uint64_t *buf = (uint64_t *)atol(argv[0]);
+    seL4_Word ok = buf[0] == COW_ORIGINAL_DATA;
+
+    /* first write faults to the parent, which gives us a private copy of the page */
+    buf[0] = COW_CHILD_DATA;
+    ok = ok && buf[0] == COW_CHILD_DATA;
+
+    /* let the parent write to its own mapping, then check that we do not see it */
+    seL4_Call(fault_ep_conn.raw_endpoint, seL4_MessageInfo_new(0, 0, 0, 0));
+    ok = ok && buf[1] == COW_ORIGINAL_DATA;
+
+    seL4_SetMR(0, ok);
+    seL4_Send(fault_ep_conn.raw_endpoint, seL4_MessageInfo_new(0, 0, 0, 1));
+    return 0;
+}
+
+int test_ads_cow(env_t env)
+{
+    int error;
+    seL4_CPtr vmr_rde = sel4gpi_get_bound_vmr_rde();
+
+    // allocate and attach the page to share copy-on-write
+    mo_client_context_t mo_conn;
+    error = mo_component_client_connect(sel4gpi_get_rde(GPICAP_TYPE_MO), 1, MO_PAGE_BITS, &mo_conn);
+    test_error_eq(error, 0);
+
+    volatile uint64_t *buf;
+    error = vmr_client_attach_no_reserve(vmr_rde, NULL, &mo_conn, SEL4UTILS_RES_TYPE_SHARED_FRAMES, (void **)&buf);
+    test_error_eq(error, 0);
+    buf[0] = COW_ORIGINAL_DATA;
+    buf[1] = COW_ORIGINAL_DATA;
+
+    // child PD with its own ADS, sharing our code and data, and the page copy-on-write
+    sel4gpi_runnable_t runnable = {0};
+    pd_config_t *cfg = sel4gpi_new_runnable(true, true, &runnable);
+    test_assert(cfg != NULL);
+
+    sel4gpi_add_vmr_config(&cfg->ads_cfg, GPI_DISJOINT, SEL4UTILS_RES_TYPE_STACK, NULL,
+                           NULL, DEFAULT_STACK_PAGES, MO_PAGE_BITS, NULL);
+    sel4gpi_add_vmr_config(&cfg->ads_cfg, GPI_SHARED, SEL4UTILS_RES_TYPE_CODE, NULL, NULL, 0, 0, NULL);
+    sel4gpi_add_vmr_config(&cfg->ads_cfg, GPI_SHARED, SEL4UTILS_RES_TYPE_DATA, NULL, NULL, 0, 0, NULL);
+    sel4gpi_add_vmr_config(&cfg->ads_cfg, GPI_DISJOINT, SEL4UTILS_RES_TYPE_IPC_BUF,
+                           NULL, NULL, 1, MO_PAGE_BITS, NULL);
+    sel4gpi_add_vmr_config(&cfg->ads_cfg, GPI_COW, SEL4UTILS_RES_TYPE_SHARED_FRAMES, (void *)buf,
+                           NULL, 1, MO_PAGE_BITS, NULL);
+    sel4gpi_config_pd_share_all_rdes(cfg);
+
+    cfg->ads_cfg.entry_point = cow_child;
+    cfg->link_with_current = true;
+
+    seL4_Word arg = (seL4_Word)buf;
+    error = sel4gpi_prepare_pd(cfg, &runnable, 1, &arg);
+    test_error_eq(error, 0);
+
+    error = sel4gpi_start_pd(&runnable);
+    test_error_eq(error, 0);
+
+    // resolve the child's write fault, until it asks us to write
+    seL4_MessageInfo_t info = seL4_Recv(cfg->fault_ep.raw_endpoint, NULL);
+    while (seL4_MessageInfo_get_label(info) == seL4_Fault_VMFault)
+    {
+        error = sel4gpi_handle_cow_fault(&runnable, info);
+        test_error_eq(error, 0);
+        seL4_Reply(seL4_MessageInfo_new(0, 0, 0, 0));
+        info = seL4_Recv(cfg->fault_ep.raw_endpoint, NULL);
+    }
+    test_eq(seL4_MessageInfo_get_label(info), (seL4_Word)0);
+
+    // the child's write is private, and our write is too (resolved by our own fault handler)
+    test_eq(buf[0], (uint64_t)COW_ORIGINAL_DATA);
+    buf[1] = COW_PARENT_DATA;
+    test_eq(buf[1], (uint64_t)COW_PARENT_DATA);
+
+    seL4_Reply(seL4_MessageInfo_new(0, 0, 0, 0));
+    info = seL4_Recv(cfg->fault_ep.raw_endpoint, NULL);
+    test_eq(seL4_MessageInfo_get_label(info), (seL4_Word)0);
+    test_eq(seL4_GetMR(0), (seL4_Word)1);
+
+    sel4gpi_config_destroy(cfg);
+
+    error = sel4gpi_destroy_vmr(vmr_rde, (void *)buf, &mo_conn);
+    test_error_eq(error, 0);
+
+    // Print model state
+    pd_client_context_t pd_conn = sel4gpi_get_pd_conn();
+    extract_model(&pd_conn);
+
+    return sel4test_get_result();
+}
+DEFINE_TEST_OSM(GPIADS004, "Test copy-on-write sharing of a VMR with a child PD", test_ads_cow, true)
+
+#define RANGE_TREE_TEST_N_RANGES 64
+
+int test_ads_range_tree(env_t env)
+{
+    range_tree_t tree = {0};
+    range_tree_node_t a = {.start = 0x1000, .end = 0x3000};
+    range_tree_node_t b = {.start = 0x3000, .end = 0x4000};
+    range_tree_node_t c = {.start = 0x8000, .end = 0x9000};
+
+    // Adjacent ranges do not overlap
+    test_assert(range_tree_insert(&tree, &a) == 0);
+    test_assert(range_tree_insert(&tree, &b) == 0);
+    test_assert(range_tree_insert(&tree, &c) == 0);
+    test_assert(tree.count == 3);
+
+    // Empty and overlapping ranges are rejected
+    range_tree_node_t bad = {.start = 0x5000, .end = 0x5000};
+    test_assert(range_tree_insert(&tree, &bad) != 0);
+    bad = (range_tree_node_t){.start = 0x6000, .end = 0x5000};
+    test_assert(range_tree_insert(&tree, &bad) != 0);
+    bad = (range_tree_node_t){.start = 0x1000, .end = 0x3000};
+    test_assert(range_tree_insert(&tree, &bad) != 0);
+    bad = (range_tree_node_t){.start = 0x2000, .end = 0x2800};
+    test_assert(range_tree_insert(&tree, &bad) != 0);
+    bad = (range_tree_node_t){.start = 0x0, .end = 0x1001};
+    test_assert(range_tree_insert(&tree, &bad) != 0);
+    bad = (range_tree_node_t){.start = 0x8fff, .end = 0xa000};
+    test_assert(range_tree_insert(&tree, &bad) != 0);
+    bad = (range_tree_node_t){.start = 0x0, .end = 0x10000};
+    test_assert(range_tree_insert(&tree, &bad) != 0);
+    test_assert(tree.count == 3);
+
+    // Lookups include the start and exclude the end of a range
+    test_assert(range_tree_find(&tree, 0xfff) == NULL);
+    test_assert(range_tree_find(&tree, 0x1000) == &a);
+    test_assert(range_tree_find(&tree, 0x2fff) == &a);
+    test_assert(range_tree_find(&tree, 0x3000) == &b);
+    test_assert(range_tree_find(&tree, 0x4000) == NULL);
+    test_assert(range_tree_find(&tree, 0x8fff) == &c);
+    test_assert(range_tree_find(&tree, 0x9000) == NULL);
+
+    // The lowest overlapping range is returned
+    test_assert(range_tree_find_overlap(&tree, 0x0, 0x10000) == &a);
+    test_assert(range_tree_find_overlap(&tree, 0x3fff, 0x8001) == &b);
+    test_assert(range_tree_find_overlap(&tree, 0x4000, 0x8000) == NULL);
+    test_assert(range_tree_find_overlap(&tree, 0x0, 0x1000) == NULL);
+
+    // Removed ranges are no longer found, and their space can be reused
+    range_tree_remove(&tree, &b);
+    test_assert(b.height == 0);
+    test_assert(tree.count == 2);
+    test_assert(range_tree_find(&tree, 0x3000) == NULL);
+    test_assert(range_tree_find(&tree, 0x2fff) == &a);
+    bad = (range_tree_node_t){.start = 0x2800, .end = 0x8800};
+    test_assert(range_tree_insert(&tree, &bad) != 0);
+    test_assert(range_tree_insert(&tree, &b) == 0);
+
+    range_tree_remove(&tree, &a);
+    range_tree_remove(&tree, &b);
+    range_tree_remove(&tree, &c);
+    test_assert(tree.count == 0 && tree.root == NULL);
+
+    // Sequential inserts and interleaved removes keep the tree searchable
+    range_tree_node_t *ranges = calloc(RANGE_TREE_TEST_N_RANGES, sizeof(range_tree_node_t));
+    test_assert(ranges != NULL);
+    for (int i = 0; i < RANGE_TREE_TEST_N_RANGES; i++)
+    {
+        ranges[i].start = (i + 1) * 0x2000;
+        ranges[i].end = ranges[i].start + 0x1000;
+        test_assert(range_tree_insert(&tree, &ranges[i]) == 0);
+    }
+
+    for (int i = 0; i < RANGE_TREE_TEST_N_RANGES; i += 2)
+    {
+        range_tree_remove(&tree, &ranges[i]);
+    }
+    test_assert(tree.count == RANGE_TREE_TEST_N_RANGES / 2);
+
+    for (int i = 0; i < RANGE_TREE_TEST_N_RANGES; i++)
+    {
+        range_tree_node_t *expected = i % 2 ? &ranges[i] : NULL;
+        test_assert(range_tree_find(&tree, ranges[i].start) == expected);
+        test_assert(range_tree_find(&tree, ranges[i].end - 1) == expected);
+        test_assert(range_tree_find(&tree, ranges[i].end) == NULL);
+    }
+
+    for (int i = 1; i < RANGE_TREE_TEST_N_RANGES; i += 2)
+    {
+        range_tree_remove(&tree, &ranges[i]);
+    }
+    test_assert(tree.count == 0 && tree.root == NULL);
+    free(ranges);
+
+    return sel4test_get_result();
+}
+DEFINE_TEST_OSM(GPIADS005, "Test the range tree used to index ADS reservations", test_ads_range_tree, true)
+
 // (XXX) Arya: These are very old, we should write some new tests
 #if 0
 int test_ads_shallow_copy(env_t env)
@@ -278,10 +278,11 @@ static int benchmark_pd_spawn_sel4utils(env_t env, sel4utils_process_t *sel4util
 }
 
 // This tests specifically a process PD, to compare with sel4test version
-static int benchmark_pd_spawn_osm(pd_client_context_t *pd, seL4_CPtr *ep)
+// If compound is true, the PD is prepared with a single spawn request instead of step by step
+static int benchmark_pd_spawn_osm(pd_client_context_t *pd, seL4_CPtr *ep, bool compound)
 {
     ccnt_t pd_create_start_time;
-    TEST_LOG("\nPD SPAWN");
+    TEST_LOG(compound ? "\nPD SPAWN (COMPOUND)" : "\nPD SPAWN");
     SEL4BENCH_READ_CCNT(pd_create_start_time);
 
     // Don't include EP creation in timing for consistency with spawn_pd_sel4utils
@@ -310,7 +311,14 @@ static int benchmark_pd_spawn_osm(pd_client_context_t *pd, seL4_CPtr *ep)
     args[0] = slot;
     args[1] = 0;
 
-    error = sel4gpi_prepare_pd(cfg, &runnable, argc, args);
+    if (compound)
+    {
+        error = sel4gpi_spawn_pd(cfg, &runnable, argc, args);
+    }
+    else
+    {
+        error = sel4gpi_prepare_pd(cfg, &runnable, argc, args);
+    }
     test_error_eq(error, 0);
 
     // Start the PD
@@ -1044,7 +1052,7 @@ int benchmark_process_spawn_osm(env_t env)
     // Run benchmarks
     pd_client_context_t pd;
     seL4_CPtr ep;
-    error = benchmark_pd_spawn_osm(&pd, &ep);
+    error = benchmark_pd_spawn_osm(&pd, &ep, false);
     test_error_eq(error, 0);
 
     error = benchmark_send_cap_osm(&pd);
@@ -1331,6 +1339,128 @@ static int internal_benchmark_cleanup(env_t env, cleanup_scenario_server_t serve
     return sel4test_get_result();
 }
 
+/**
+ * Benchmark PD spawn (process style), preparing the PD step by step
+ * vs. with a single spawn request to the PD component
+ */
+int benchmark_process_spawn_compound_osm(env_t env)
+{
+    int error = 0;
+
+    benchmark_init(env);
+
+    pd_client_context_t pd;
+    seL4_CPtr ep;
+
+    // Step by step
+    error = benchmark_pd_spawn_osm(&pd, &ep, false);
+    test_error_eq(error, 0);
+    test_error_eq(maybe_terminate_pd(&pd), 0);
+
+    // Compound
+    error = benchmark_pd_spawn_osm(&pd, &ep, true);
+    test_error_eq(error, 0);
+    test_error_eq(maybe_terminate_pd(&pd), 0);
+
+    BENCH_UTILS_DESTROY;
+    return sel4test_get_result();
+}
+
+#define SERVER_THROUGHPUT_MAX_CLIENTS 4
+#define SERVER_THROUGHPUT_OPS_PER_CLIENT 100
+
+/**
+ * Client thread for the server throughput benchmark
+ * Allocates and frees MOs, then reports its error code to the benchmark
+ *
+ * @param argv[0] slot of the endpoint to notify when finished
+ */
+static void server_throughput_client(int argc, char **argv)
+{
+    int error = 0;
+    seL4_CPtr done_ep = (seL4_CPtr)atol(argv[0]);
+    seL4_CPtr mo_rde = sel4gpi_get_rde(GPICAP_TYPE_MO);
+
+    for (int i = 0; i < SERVER_THROUGHPUT_OPS_PER_CLIENT && error == 0; i++)
+    {
+        mo_client_context_t mo;
+        error = mo_component_client_connect(mo_rde, 1, MO_PAGE_BITS, &mo);
+        if (error == 0)
+        {
+            error = mo_component_client_disconnect(&mo);
+        }
+    }
+
+    // Block until we are terminated
+    seL4_SetMR(0, error);
+    seL4_Call(done_ep, seL4_MessageInfo_new(0, 0, 0, 1));
+}
+
+/**
+ * Benchmark the root task's request throughput with concurrent client PDs
+ * Each client performs SERVER_THROUGHPUT_OPS_PER_CLIENT MO allocations and frees,
+ * the result is the time until all clients have finished
+ * With GPI_SERVER_NUM_WORKERS > 1, only decoding and replying overlap, the handlers still run one at a time
+ */
+int benchmark_server_throughput(env_t env)
+{
+    int error = 0;
+
+    benchmark_init(env);
+
+    ep_client_context_t done_ep;
+    error = ep_component_client_connect(sel4gpi_get_rde(GPICAP_TYPE_EP), &done_ep);
+    test_error_eq(error, 0);
+
+    for (int n_clients = 1; n_clients <= SERVER_THROUGHPUT_MAX_CLIENTS; n_clients *= 2)
+    {
+        sel4gpi_runnable_t runnables[SERVER_THROUGHPUT_MAX_CLIENTS] = {0};
+        pd_config_t *cfgs[SERVER_THROUGHPUT_MAX_CLIENTS];
+
+        // Prepare all clients before timing
+        for (int i = 0; i < n_clients; i++)
+        {
+            cfgs[i] = sel4gpi_configure_thread(server_throughput_client, NULL, &runnables[i]);
+            test_assert(cfgs[i] != NULL);
+
+            seL4_Word done_ep_slot;
+            error = pd_client_send_cap(&runnables[i].pd, done_ep.raw_endpoint, &done_ep_slot);
+            test_error_eq(error, 0);
+
+            error = sel4gpi_prepare_pd(cfgs[i], &runnables[i], 1, &done_ep_slot);
+            test_error_eq(error, 0);
+        }
+
+        printf("Server throughput: %d clients, %d MO alloc/free each\n", n_clients, SERVER_THROUGHPUT_OPS_PER_CLIENT);
+
+        ccnt_t start, end;
+        SEL4BENCH_READ_CCNT(start);
+        for (int i = 0; i < n_clients; i++)
+        {
+            error = sel4gpi_start_pd(&runnables[i]);
+            test_error_eq(error, 0);
+        }
+
+        for (int i = 0; i < n_clients; i++)
+        {
+            seL4_Recv(done_ep.raw_endpoint, NULL);
+            test_error_eq(seL4_GetMR(0), 0);
+        }
+        SEL4BENCH_READ_CCNT(end);
+
+        benchmark_print_result(end - start);
+
+        for (int i = 0; i < n_clients; i++)
+        {
+            test_error_eq(maybe_terminate_pd(&runnables[i].pd), 0);
+            sel4gpi_config_destroy(cfgs[i]);
+        }
+    }
+
+    BENCH_UTILS_DESTROY;
+    return sel4test_get_result();
+}
+
 int benchmark_cleanup_ramdisk(env_t env)
 {
     return internal_benchmark_cleanup(env, CLEANUP_RAMDISK);
@@ -1346,6 +1476,233 @@ int benchmark_cleanup_kvstore(env_t env)
     return internal_benchmark_cleanup(env, CLEANUP_KVSTORE);
 }
 
+#define CLEANUP_SCALE_N_FILES 64
+#define CLEANUP_SCALE_N_HOLDERS 16
+
+/**
+ * Placeholder function for the holder PDs of the cleanup-at-scale benchmark
+ * The PDs are never started, they only hold file resources
+ */
+static void cleanup_scale_holder(int argc, char **argv)
+{
+}
+
+/**
+ * Benchmark the time to cleanup the fs server when many PDs hold many of its files
+ * Each of CLEANUP_SCALE_N_HOLDERS PDs holds all CLEANUP_SCALE_N_FILES files
+ */
+int benchmark_cleanup_fs_scale(env_t env)
+{
+    int error = 0;
+
+    benchmark_init(env);
+
+    pd_client_context_t pd_conn = sel4gpi_get_pd_conn();
+
+    /* Start the ramdisk and fs servers */
+    pd_client_context_t ramdisk_pd, fs_pd;
+    gpi_obj_id_t ramdisk_id, fs_id;
+
+    error = start_ramdisk_pd(&ramdisk_pd, &ramdisk_id);
+    test_assert(error == 0);
+
+    error = start_xv6fs_pd(ramdisk_id, &fs_pd, &fs_id);
+    test_assert(error == 0);
+
+    xv6fs_client_init();
+
+    /* Create the holder PDs, they do not need to run */
+    sel4gpi_runnable_t holders[CLEANUP_SCALE_N_HOLDERS] = {0};
+    pd_config_t *cfgs[CLEANUP_SCALE_N_HOLDERS];
+
+    for (int i = 0; i < CLEANUP_SCALE_N_HOLDERS; i++)
+    {
+        cfgs[i] = sel4gpi_configure_thread(cleanup_scale_holder, NULL, &holders[i]);
+        test_assert(cfgs[i] != NULL);
+
+        error = sel4gpi_prepare_pd(cfgs[i], &holders[i], 0, NULL);
+        test_error_eq(error, 0);
+    }
+
+    /* Create files and give every holder a copy, the test process does not keep any */
+    for (int i = 0; i < CLEANUP_SCALE_N_FILES; i++)
+    {
+        char fname[16];
+        snprintf(fname, sizeof(fname), "scale-%d", i);
+        int f = open(fname, O_CREAT | O_RDWR);
+        test_assert(f > 0);
+
+        seL4_CPtr file_cap;
+        error = xv6fs_client_get_file(f, &file_cap);
+        test_error_eq(error, 0);
+
+        for (int j = 0; j < CLEANUP_SCALE_N_HOLDERS; j++)
+        {
+            error = pd_client_send_cap(&holders[j].pd, file_cap, NULL);
+            test_error_eq(error, 0);
+        }
+
+        error = close(f);
+        test_error_eq(error, 0);
+    }
+
+    /* Remove RDEs from test process so that it won't be cleaned up by recursive cleanup */
+    error = pd_client_remove_rde(&pd_conn, sel4gpi_get_resource_type_code(BLOCK_RESOURCE_TYPE_NAME), BADGE_SPACE_ID_NULL);
+    test_assert(error == 0);
+
+    error = pd_client_remove_rde(&pd_conn, sel4gpi_get_resource_type_code(FILE_RESOURCE_TYPE_NAME), BADGE_SPACE_ID_NULL);
+    test_assert(error == 0);
+
+    /* Crash the fs server */
+    printf("Crashing fs PD, %d files held by %d PDs\n", CLEANUP_SCALE_N_FILES, CLEANUP_SCALE_N_HOLDERS);
+
+    ccnt_t start, end;
+    SEL4BENCH_READ_CCNT(start);
+    error = pd_client_terminate(&fs_pd);
+    SEL4BENCH_READ_CCNT(end);
+    test_assert(error == 0);
+
+    benchmark_print_result(end - start);
+
+    /* Cleanup other PDs */
+    for (int i = 0; i < CLEANUP_SCALE_N_HOLDERS; i++)
+    {
+        test_error_eq(maybe_terminate_pd(&holders[i].pd), 0);
+        sel4gpi_config_destroy(cfgs[i]);
+    }
+    test_error_eq(maybe_terminate_pd(&ramdisk_pd), 0);
+
+    BENCH_UTILS_DESTROY;
+    return sel4test_get_result();
+}
+
+#define RAMDISK_BENCH_BYTES (1u << 20)
+#define RAMDISK_BENCH_N_BLOCKS (RAMDISK_BENCH_BYTES / RAMDISK_BLOCK_SIZE)
+
+/**
+ * Benchmark sequential 1 MiB transfers to and from the ramdisk,
+ * one block per request vs. RAMDISK_MAX_VECTOR_BLOCKS blocks per READV/WRITEV request
+ */
+int benchmark_ramdisk_throughput(env_t env)
+{
+    int error = 0;
+
+    benchmark_init(env);
+
+    pd_client_context_t pd_conn = sel4gpi_get_pd_conn();
+
+    /* Start the ramdisk */
+    pd_client_context_t ramdisk_pd;
+    gpi_obj_id_t ramdisk_id;
+    error = start_ramdisk_pd(&ramdisk_pd, &ramdisk_id);
+    test_assert(error == 0);
+
+    seL4_CPtr ramdisk_ep = sel4gpi_get_rde(sel4gpi_get_resource_type_code(BLOCK_RESOURCE_TYPE_NAME));
+
+    /* Share enough memory for the largest vectored request */
+    mo_client_context_t mo_conn;
+    error = mo_component_client_connect(sel4gpi_get_rde(GPICAP_TYPE_MO), RAMDISK_MAX_VECTOR_BLOCKS,
+                                        MO_PAGE_BITS, &mo_conn);
+    test_error_eq(error, 0);
+
+    char *buf;
+    error = vmr_client_attach_no_reserve(sel4gpi_get_bound_vmr_rde(), NULL, &mo_conn,
+                                         SEL4UTILS_RES_TYPE_SHARED_FRAMES, (void **)&buf);
+    test_error_eq(error, 0);
+
+    error = ramdisk_client_bind(ramdisk_ep, &mo_conn, RAMDISK_MAX_VECTOR_BLOCKS);
+    test_error_eq(error, 0);
+
+    /* Allocate the blocks */
+    ramdisk_client_context_t *blocks = malloc(RAMDISK_BENCH_N_BLOCKS * sizeof(ramdisk_client_context_t));
+    gpi_obj_id_t *block_ids = malloc(RAMDISK_BENCH_N_BLOCKS * sizeof(gpi_obj_id_t));
+    test_assert(blocks != NULL && block_ids != NULL);
+
+    for (int i = 0; i < RAMDISK_BENCH_N_BLOCKS; i++)
+    {
+        error = ramdisk_client_alloc_block(ramdisk_ep, &blocks[i]);
+        test_error_eq(error, 0);
+        block_ids[i] = blocks[i].res_id;
+    }
+
+    ccnt_t start, end;
+
+    /* One block per request */
+    printf("Ramdisk sequential 1 MiB write, one block per request\n");
+    SEL4BENCH_READ_CCNT(start);
+    for (int i = 0; i < RAMDISK_BENCH_N_BLOCKS; i++)
+    {
+        buf[0] = (char)i;
+        error |= ramdisk_client_write(&blocks[i]);
+    }
+    SEL4BENCH_READ_CCNT(end);
+    test_error_eq(error, 0);
+    benchmark_print_result(end - start);
+
+    printf("Ramdisk sequential 1 MiB read, one block per request\n");
+    SEL4BENCH_READ_CCNT(start);
+    for (int i = 0; i < RAMDISK_BENCH_N_BLOCKS; i++)
+    {
+        error |= ramdisk_client_read(&blocks[i]);
+    }
+    SEL4BENCH_READ_CCNT(end);
+    test_error_eq(error, 0);
+    test_assert(buf[0] == (char)(RAMDISK_BENCH_N_BLOCKS - 1));
+    benchmark_print_result(end - start);
+
+    /* Vectored requests */
+    printf("Ramdisk sequential 1 MiB write, %d blocks per request\n", RAMDISK_MAX_VECTOR_BLOCKS);
+    SEL4BENCH_READ_CCNT(start);
+    for (int i = 0; i < RAMDISK_BENCH_N_BLOCKS; i += RAMDISK_MAX_VECTOR_BLOCKS)
+    {
+        for (int j = 0; j < RAMDISK_MAX_VECTOR_BLOCKS; j++)
+        {
+            buf[j * RAMDISK_BLOCK_SIZE] = (char)(i + j + 1);
+        }
+        error |= ramdisk_client_writev(ramdisk_ep, &block_ids[i], RAMDISK_MAX_VECTOR_BLOCKS);
+    }
+    SEL4BENCH_READ_CCNT(end);
+    test_error_eq(error, 0);
+    benchmark_print_result(end - start);
+
+    printf("Ramdisk sequential 1 MiB read, %d blocks per request\n", RAMDISK_MAX_VECTOR_BLOCKS);
+    SEL4BENCH_READ_CCNT(start);
+    for (int i = 0; i < RAMDISK_BENCH_N_BLOCKS; i += RAMDISK_MAX_VECTOR_BLOCKS)
+    {
+        error |= ramdisk_client_readv(ramdisk_ep, &block_ids[i], RAMDISK_MAX_VECTOR_BLOCKS);
+    }
+    SEL4BENCH_READ_CCNT(end);
+    test_error_eq(error, 0);
+    benchmark_print_result(end - start);
+
+    // The shared memory holds the last vectored read
+    for (int j = 0; j < RAMDISK_MAX_VECTOR_BLOCKS; j++)
+    {
+        test_assert(buf[j * RAMDISK_BLOCK_SIZE] == (char)(RAMDISK_BENCH_N_BLOCKS - RAMDISK_MAX_VECTOR_BLOCKS + j + 1));
+    }
+
+    /* Cleanup */
+    for (int i = 0; i < RAMDISK_BENCH_N_BLOCKS; i++)
+    {
+        error = ramdisk_client_free_block(&blocks[i]);
+        test_error_eq(error, 0);
+    }
+    free(blocks);
+    free(block_ids);
+
+    error = ramdisk_client_unbind(ramdisk_ep);
+    test_error_eq(error, 0);
+
+    /* Remove RDEs from test process so that it won't be cleaned up by recursive cleanup */
+    error = pd_client_remove_rde(&pd_conn, sel4gpi_get_resource_type_code(BLOCK_RESOURCE_TYPE_NAME), BADGE_SPACE_ID_NULL);
+    test_assert(error == 0);
+
+    test_error_eq(maybe_terminate_pd(&ramdisk_pd), 0);
+
+    BENCH_UTILS_DESTROY;
+    return sel4test_get_result();
+}
+
 DEFINE_TEST_WITH_TYPE_MULTIPLE(GPIBM001,
                                "sel4utils basic bench",
                                benchmark_basic_sel4utils,
@@ -1410,4 +1767,28 @@ DEFINE_TEST_WITH_TYPE_MULTIPLE(GPIBM011,
                                "osm crash kvstore server",
                                benchmark_cleanup_kvstore,
                                OSM,
-                               true)
\ No newline at end of file
+                               true)
+
+DEFINE_TEST_WITH_TYPE_MULTIPLE(GPIBM012,
+                               "osm bench process spawn, step by step vs. compound",
+                               benchmark_process_spawn_compound_osm,
+                               OSM,
+                               true)
+
+DEFINE_TEST_WITH_TYPE_MULTIPLE(GPIBM013,
+                               "osm root task request throughput with concurrent clients",
+                               benchmark_server_throughput,
+                               OSM,
+                               true)
+
+DEFINE_TEST_WITH_TYPE_MULTIPLE(GPIBM014,
+                               "osm crash fs server, files held by many PDs",
+                               benchmark_cleanup_fs_scale,
+                               OSM,
+                               true)
+
+DEFINE_TEST_WITH_TYPE_MULTIPLE(GPIBM015,
+                               "osm ramdisk sequential 1 MiB throughput, single vs. vectored requests",
+                               benchmark_ramdisk_throughput,
+                               OSM,
+                               true)
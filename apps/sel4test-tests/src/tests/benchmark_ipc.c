@@ -11,6 +11,11 @@
 #include <rpc.pb.h>
 
 #include <sel4gpi/bench_utils.h>
+#include <sel4gpi/gpi_rpc.h>
+#include <sel4gpi/mo_clientapi.h>
+#include <sel4gpi/pd_clientapi.h>
+#include <sel4gpi/pd_utils.h>
+#include <mo_component_rpc.pb.h>
 
 #include "../test.h"
 #include "../helpers.h"
@@ -115,6 +120,122 @@ static int internal_benchmark_nanopb_ipc(env_t env, int n_iters, int long_msg, s
     return sel4test_get_result();
 }
 
+static sel4gpi_rpc_env_t mo_rpc_env = {
+    .request_desc = &MoMessage_msg,
+    .reply_desc = &MoReturnMessage_msg,
+};
+
+static sel4gpi_rpc_env_t pd_rpc_env = {
+    .request_desc = &PdMessage_msg,
+    .reply_desc = &PdReturnMessage_msg,
+};
+
+/**
+ * Benchmark RTT of MO allocation requests to the root task
+ * The MO is disconnected after each iteration, outside of the timed region
+ *
+ * @param env
+ * @param n_iters number of test iterations to run
+ * @param raw if true, send the request with the raw message-register encoding
+ *            if false, send the request with NanoPB
+ */
+static int internal_benchmark_mo_alloc_rpc(env_t env, int n_iters, bool raw)
+{
+    int error = 0;
+    ccnt_t call_start;
+    ccnt_t call_end;
+    seL4_CPtr mo_rde = sel4gpi_get_rde(GPICAP_TYPE_MO);
+
+    benchmark_init(env);
+
+    for (int i = 0; i < n_iters; i++)
+    {
+        MoMessage msg = {
+            .magic = MO_RPC_MAGIC,
+            .which_msg = MoMessage_alloc_tag,
+            .msg.alloc = {
+                .num_pages = 1,
+                .page_bits = MO_PAGE_BITS,
+            }};
+
+        MoReturnMessage ret_msg = {0};
+
+        SEL4BENCH_READ_CCNT(call_start);
+        if (raw)
+        {
+            error = sel4gpi_rpc_call_raw(&mo_rpc_env, mo_rde, (void *)&msg, 0, NULL, (void *)&ret_msg);
+        }
+        else
+        {
+            error = sel4gpi_rpc_call(&mo_rpc_env, mo_rde, (void *)&msg, 0, NULL, (void *)&ret_msg);
+        }
+        SEL4BENCH_READ_CCNT(call_end);
+
+        test_error_eq(error, 0);
+        test_error_eq(ret_msg.errorCode, 0);
+
+        benchmark_print_result(call_end - call_start);
+
+        mo_client_context_t mo_conn = {
+            .ep = ret_msg.msg.alloc.slot,
+            .id = ret_msg.msg.alloc.id,
+        };
+        error = mo_component_client_disconnect(&mo_conn);
+        test_error_eq(error, 0);
+    }
+
+    BENCH_UTILS_DESTROY;
+    return sel4test_get_result();
+}
+
+/**
+ * Benchmark RTT of next_slot requests to the root task
+ *
+ * @param env
+ * @param n_iters number of test iterations to run
+ * @param raw if true, send the request with the raw message-register encoding
+ *            if false, send the request with NanoPB
+ */
+static int internal_benchmark_next_slot_rpc(env_t env, int n_iters, bool raw)
+{
+    int error = 0;
+    ccnt_t call_start;
+    ccnt_t call_end;
+    pd_client_context_t pd_conn = sel4gpi_get_pd_conn();
+
+    benchmark_init(env);
+
+    for (int i = 0; i < n_iters; i++)
+    {
+        PdMessage msg = {
+            .magic = PD_RPC_MAGIC,
+            .which_msg = PdMessage_next_slot_tag,
+        };
+
+        PdReturnMessage ret_msg = {0};
+
+        SEL4BENCH_READ_CCNT(call_start);
+        if (raw)
+        {
+            error = sel4gpi_rpc_call_raw(&pd_rpc_env, pd_conn.ep, (void *)&msg, 0, NULL, (void *)&ret_msg);
+        }
+        else
+        {
+            error = sel4gpi_rpc_call(&pd_rpc_env, pd_conn.ep, (void *)&msg, 0, NULL, (void *)&ret_msg);
+        }
+        SEL4BENCH_READ_CCNT(call_end);
+
+        test_error_eq(error, 0);
+        test_error_eq(ret_msg.errorCode, 0);
+        test_assert(ret_msg.msg.next_slot.slot != seL4_CapNull);
+
+        benchmark_print_result(call_end - call_start);
+    }
+
+    BENCH_UTILS_DESTROY;
+    return sel4test_get_result();
+}
+
 int benchmark_regular_ipc_nocap_short(env_t env)
 {
     return internal_benchmark_regular_ipc(env, 1, 0, NULL, 0);
@@ -377,6 +498,26 @@ int benchmark_nanopb_ipc_cap_2_unwrapped_long(env_t env)
     return internal_benchmark_nanopb_ipc(env, 1, 0, caps, 3);
 }
 
+int benchmark_nanopb_mo_alloc(env_t env)
+{
+    return internal_benchmark_mo_alloc_rpc(env, 1, false);
+}
+
+int benchmark_raw_mo_alloc(env_t env)
+{
+    return internal_benchmark_mo_alloc_rpc(env, 1, true);
+}
+
+int benchmark_nanopb_next_slot(env_t env)
+{
+    return internal_benchmark_next_slot_rpc(env, 1, false);
+}
+
+int benchmark_raw_next_slot(env_t env)
+{
+    return internal_benchmark_next_slot_rpc(env, 1, true);
+}
+
 DEFINE_TEST_WITH_TYPE_MULTIPLE(GPIBM100,
                                "benchmark_regular_ipc_nocap_short",
                                benchmark_regular_ipc_nocap_short,
@@ -519,4 +660,28 @@ DEFINE_TEST_WITH_TYPE_MULTIPLE(GPIBM123,
                                "benchmark_nanopb_ipc_cap_2_unwrapped_long",
                                benchmark_nanopb_ipc_cap_2_unwrapped_long,
                                BASIC,
+                               true)
+
+DEFINE_TEST_WITH_TYPE_MULTIPLE(GPIBM124,
+                               "benchmark_nanopb_mo_alloc",
+                               benchmark_nanopb_mo_alloc,
+                               OSM,
+                               true)
+
+DEFINE_TEST_WITH_TYPE_MULTIPLE(GPIBM125,
+                               "benchmark_raw_mo_alloc",
+                               benchmark_raw_mo_alloc,
+                               OSM,
+                               true)
+
+DEFINE_TEST_WITH_TYPE_MULTIPLE(GPIBM126,
+                               "benchmark_nanopb_next_slot",
+                               benchmark_nanopb_next_slot,
+                               OSM,
+                               true)
+
+DEFINE_TEST_WITH_TYPE_MULTIPLE(GPIBM127,
+                               "benchmark_raw_next_slot",
+                               benchmark_raw_next_slot,
+                               OSM,
                                true)
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include "../test.h"
 #include "../helpers.h"
 #include <stdio.h>
+#include <utils/util.h>
 
 #include <sel4gpi/debug.h>
 #include <sel4gpi/model_exporting.h>
@@ -34,12 +35,40 @@ char *csv_buffer =
     ",,MO,REQUEST,PD_1,PD_0,\n"
     ",,MO,REQUEST,PD_2,PD_0,\n";
 
+typedef struct
+{
+    char *buffer;
+    size_t written;
+    int n_chunks;
+} test_export_sink_t;
+
+static int test_sink_write(void *cookie, const void *data, size_t len)
+{
+    test_export_sink_t *sink = (test_export_sink_t *)cookie;
+
+    if (len > MODEL_EXPORT_CHUNK_SIZE)
+    {
+        return 1;
+    }
+
+    memcpy(sink->buffer + sink->written, data, len);
+    sink->written += len;
+    sink->n_chunks++;
+    return 0;
+}
+
+static int test_failing_sink_write(void *cookie, const void *data, size_t len)
+{
+    (*(int *)cookie)++;
+    return 1;
+}
+
 int test_model_state_export(env_t env)
 {
     model_state_t model_state_static;
     model_state_t *model_state = &model_state_static;
 
-    init_model_state(model_state, NULL, 0);
+    init_model_state(model_state);
 
     char output_buffer[10000];
 
@@ -77,7 +106,7 @@ int test_model_state_export(env_t env)
     add_edge(model_state, GPI_EDGE_TYPE_MAP, page2, mo2);
     add_request_edge(model_state, pd1, root_node, GPICAP_TYPE_MO);
 
-    export_model_state(model_state, output_buffer, sizeof(output_buffer));
+    test_assert(export_model_state(model_state, output_buffer, sizeof(output_buffer)) == 0);
     if (strncmp(output_buffer, csv_buffer, sizeof(output_buffer)) != 0)
     {
 
@@ -86,6 +115,43 @@ int test_model_state_export(env_t env)
         ZF_LOGF("CSV output does not match expected output");
     }
 
+    // Stream the model state in chunks
+    memset(output_buffer, 0, sizeof(output_buffer));
+    test_export_sink_t test_sink = {.buffer = output_buffer};
+    model_export_sink_t sink = {.write = test_sink_write, .cookie = &test_sink};
+    test_assert(stream_model_state_csv(model_state, &sink) == 0);
+    test_assert(test_sink.n_chunks == DIV_ROUND_UP(strlen(csv_buffer), MODEL_EXPORT_CHUNK_SIZE));
+    test_assert(strncmp(output_buffer, csv_buffer, sizeof(output_buffer)) == 0);
+
+    // The stream stops at the first sink error
+    int n_failed_writes = 0;
+    model_export_sink_t failing_sink = {.write = test_failing_sink_write, .cookie = &n_failed_writes};
+    test_assert(stream_model_state_csv(model_state, &failing_sink) != 0);
+    test_assert(n_failed_writes == 1);
+
+    // Round-trip the model state through the binary format
+    size_t bin_size = model_state_binary_size(model_state);
+    void *bin_buffer = malloc(bin_size);
+    test_assert(bin_buffer != NULL);
+    test_assert(serialize_model_state(model_state, bin_buffer, bin_size - 1) != 0);
+    test_assert(serialize_model_state(model_state, bin_buffer, bin_size) == 0);
+
+    model_state_t *combined_state = calloc(1, sizeof(model_state_t));
+    init_model_state(combined_state);
+    test_assert(combine_model_state_binary(combined_state, bin_buffer, bin_size) == 0);
+
+    test_assert(export_model_state(combined_state, output_buffer, sizeof(output_buffer)) == 0);
+    test_assert(strncmp(output_buffer, csv_buffer, sizeof(output_buffer)) == 0);
+
+    // A buffer that is too small holds a truncated, terminated export
+    char small_buffer[16];
+    test_assert(export_model_state(combined_state, small_buffer, sizeof(small_buffer)) != 0);
+    test_assert(strlen(small_buffer) == sizeof(small_buffer) - 1);
+    test_assert(strncmp(small_buffer, csv_buffer, sizeof(small_buffer) - 1) == 0);
+
+    destroy_model_state(combined_state);
+    free(bin_buffer);
+
     return sel4test_get_result();
 }
 DEFINE_TEST_OSM(GPIMS001, "Test construction and exporting of model state", test_model_state_export, true)
\ No newline at end of file
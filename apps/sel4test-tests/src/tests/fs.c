@@ -13,6 +13,7 @@
 #include <sel4gpi/ads_clientapi.h>
 #include <sel4gpi/vmr_clientapi.h>
 #include <sel4gpi/pd_utils.h>
+#include <sel4gpi/model_exporting.h>
 
 #include <ramdisk_client.h>
 #include <fs_client.h>
@@ -23,7 +24,11 @@
 #define TEST_FNAME "somefile"
 #define TEST_FNAME_2 "longfile"
 #define TEST_FNAME_3 "somefile2"
+#define TEST_FNAME_4 "hugefile"
+#define TEST_FNAME_MODEL "model.csv"
 #define RR_MO_N_PAGES 2
+// Past the 11 direct and the single-indirect blocks of an xv6fs inode
+#define TEST_HUGE_N_BLOCKS (11 + RAMDISK_BLOCK_SIZE / sizeof(uint32_t) + 4)
 
 int test_fs(env_t env)
 {
@@ -183,20 +188,192 @@ int test_fs(env_t env)
     f = open(TEST_FNAME, O_RDONLY);
     test_assert(f == -1); // File should no longer exist
 
-    // Write a large file
-    int file_n_blocks = 5;
-    void *write_buf = malloc(RAMDISK_BLOCK_SIZE);
+    // Write a large file, bigger than the minimum buffer cache
+    int file_n_blocks = NBUF + READAHEAD_BLOCKS + 2;
+    char *write_buf = malloc(RAMDISK_BLOCK_SIZE);
     f = open(TEST_FNAME_2, O_CREAT | O_RDWR);
 
     for (int i = 0; i < file_n_blocks; i++)
     {
-        write(f, write_buf, RAMDISK_BLOCK_SIZE);
+        memset(write_buf, i, RAMDISK_BLOCK_SIZE);
+        nbytes = write(f, write_buf, RAMDISK_BLOCK_SIZE);
+        test_assert(nbytes == RAMDISK_BLOCK_SIZE);
+    }
+
+    error = close(f);
+    test_assert(error == 0);
+
+    // Read it back sequentially, which is served by read-ahead
+    f = open(TEST_FNAME_2, O_RDONLY);
+    test_assert(f > 0);
+
+    for (int i = 0; i < file_n_blocks; i++)
+    {
+        nbytes = read(f, write_buf, RAMDISK_BLOCK_SIZE);
+        test_assert(nbytes == RAMDISK_BLOCK_SIZE);
+        test_assert(write_buf[0] == (char)i && write_buf[RAMDISK_BLOCK_SIZE - 1] == (char)i);
     }
     free(write_buf);
 
     error = close(f);
     test_assert(error == 0);
 
+    // Read the whole file with one call, which grows the client's shared memory
+    int file_size = file_n_blocks * RAMDISK_BLOCK_SIZE;
+    char *big_buf = malloc(file_size);
+    f = open(TEST_FNAME_2, O_RDONLY);
+    test_assert(f > 0);
+
+    nbytes = read(f, big_buf, file_size);
+    test_assert(nbytes == file_size);
+    for (int i = 0; i < file_n_blocks; i++)
+    {
+        test_assert(big_buf[i * RAMDISK_BLOCK_SIZE] == (char)i);
+    }
+    free(big_buf);
+
+    error = close(f);
+    test_assert(error == 0);
+
+    // Read and write through a registered MO, which the server accesses directly
+    mo_client_context_t io_mo;
+    void *io_vaddr;
+    error = mo_component_client_connect(sel4gpi_get_rde(GPICAP_TYPE_MO), file_n_blocks, MO_PAGE_BITS, &io_mo);
+    test_assert(error == 0);
+    error = vmr_client_attach_no_reserve(vmr_rde, NULL, &io_mo, SEL4UTILS_RES_TYPE_SHARED_FRAMES, &io_vaddr);
+    test_assert(error == 0);
+    error = xv6fs_client_register_buffer(&io_mo, io_vaddr);
+    test_assert(error == 0);
+
+    f = open(TEST_FNAME_2, O_RDWR);
+    test_assert(f > 0);
+
+    nbytes = pread(f, io_vaddr, file_size, 0);
+    test_assert(nbytes == file_size);
+    test_assert(((char *)io_vaddr)[(file_n_blocks - 1) * RAMDISK_BLOCK_SIZE] == (char)(file_n_blocks - 1));
+
+    memset(io_vaddr + RAMDISK_BLOCK_SIZE, 0xAB, RAMDISK_BLOCK_SIZE);
+    nbytes = lseek(f, 0, SEEK_SET);
+    test_assert(nbytes == 0);
+    nbytes = write(f, io_vaddr + RAMDISK_BLOCK_SIZE, RAMDISK_BLOCK_SIZE);
+    test_assert(nbytes == RAMDISK_BLOCK_SIZE);
+
+    nbytes = pread(f, buf, sizeof(buf), 0);
+    test_assert(nbytes == sizeof(buf));
+    test_assert(buf[0] == (char)0xAB && buf[sizeof(buf) - 1] == (char)0xAB);
+
+    error = close(f);
+    test_assert(error == 0);
+
+    error = xv6fs_client_unregister_buffer(io_vaddr);
+    test_assert(error == 0);
+    error = vmr_client_delete_by_vaddr(vmr_rde, io_vaddr);
+    test_assert(error == 0);
+    error = mo_component_client_disconnect(&io_mo);
+    test_assert(error == 0);
+
+    // Repeated small reads are served by the client page cache, which sees the client's own writes
+    error = xv6fs_client_enable_cache(true);
+    test_assert(error == 0);
+
+    f = open(TEST_FNAME_2, O_RDWR);
+    test_assert(f > 0);
+
+    struct stat st;
+    error = fstat(f, &st);
+    test_assert(error == 0 && st.st_size == file_size);
+
+    for (int i = 0; i < 4; i++)
+    {
+        nbytes = pread(f, buf, sizeof(buf), RAMDISK_BLOCK_SIZE - 16);
+        test_assert(nbytes == sizeof(buf));
+        test_assert(buf[0] == (char)0xAB && buf[sizeof(buf) - 1] == (char)1);
+    }
+
+    nbytes = lseek(f, file_size, SEEK_SET);
+    test_assert(nbytes == file_size);
+    nbytes = write(f, TEST_STR_1, strlen(TEST_STR_1) + 1);
+    test_assert(nbytes == strlen(TEST_STR_1) + 1);
+
+    nbytes = pread(f, buf, sizeof(buf), file_size);
+    test_assert(nbytes == strlen(TEST_STR_1) + 1);
+    test_assert(strcmp(buf, TEST_STR_1) == 0);
+
+    error = fstat(f, &st);
+    test_assert(error == 0 && st.st_size == file_size + strlen(TEST_STR_1) + 1);
+
+    error = close(f);
+    test_assert(error == 0);
+
+    error = xv6fs_client_enable_cache(false);
+    test_assert(error == 0);
+
+    // Map the start of the file, which reads and writes the ramdisk's blocks directly
+    mo_client_context_t map_mo;
+    char *map_vaddr;
+    f = open(TEST_FNAME_2, O_RDWR);
+    test_assert(f > 0);
+
+    error = xv6fs_client_mmap(f, 0, 2 * RAMDISK_BLOCK_SIZE, &map_mo, (void **)&map_vaddr);
+    test_assert(error == 0);
+    test_assert(map_vaddr[0] == (char)0xAB && map_vaddr[RAMDISK_BLOCK_SIZE] == (char)1);
+
+    // Writes through the server reach a mapped block directly
+    memset(buf, 0xEF, 16);
+    nbytes = lseek(f, 0, SEEK_SET);
+    test_assert(nbytes == 0);
+    nbytes = write(f, buf, 16);
+    test_assert(nbytes == 16);
+    test_assert(map_vaddr[0] == (char)0xEF && map_vaddr[16] == (char)0xAB);
+
+    memset(map_vaddr + RAMDISK_BLOCK_SIZE, 0xCD, 16);
+    error = xv6fs_client_munmap(f, 0, 2 * RAMDISK_BLOCK_SIZE, &map_mo, map_vaddr, true);
+    test_assert(error == 0);
+
+    nbytes = pread(f, buf, sizeof(buf), RAMDISK_BLOCK_SIZE);
+    test_assert(nbytes == sizeof(buf));
+    test_assert(buf[0] == (char)0xCD && buf[sizeof(buf) - 1] == (char)1);
+
+    // Ranges that are unaligned or past the end of the file cannot be mapped
+    error = xv6fs_client_mmap(f, 16, RAMDISK_BLOCK_SIZE, &map_mo, (void **)&map_vaddr);
+    test_assert(error != 0);
+    error = xv6fs_client_mmap(f, file_size + RAMDISK_BLOCK_SIZE, RAMDISK_BLOCK_SIZE, &map_mo, (void **)&map_vaddr);
+    test_assert(error != 0);
+
+    error = close(f);
+    test_assert(error == 0);
+
+    // Write a file that needs a double-indirect block, then free it by unlinking it
+    // The file system only fits two such files, so the second round fails if truncation leaked blocks
+    write_buf = malloc(RAMDISK_BLOCK_SIZE);
+    test_assert(write_buf != NULL);
+
+    for (int round = 0; round < 2; round++)
+    {
+        f = open(TEST_FNAME_4, O_CREAT | O_RDWR);
+        test_assert(f > 0);
+
+        for (int i = 0; i < TEST_HUGE_N_BLOCKS; i++)
+        {
+            memset(write_buf, i + round, RAMDISK_BLOCK_SIZE);
+            nbytes = write(f, write_buf, RAMDISK_BLOCK_SIZE);
+            test_assert(nbytes == RAMDISK_BLOCK_SIZE);
+        }
+
+        for (int i = TEST_HUGE_N_BLOCKS - 8; i < TEST_HUGE_N_BLOCKS; i++)
+        {
+            nbytes = pread(f, buf, sizeof(buf), i * RAMDISK_BLOCK_SIZE);
+            test_assert(nbytes == sizeof(buf));
+            test_assert(buf[0] == (char)(i + round) && buf[sizeof(buf) - 1] == (char)(i + round));
+        }
+
+        error = close(f);
+        test_assert(error == 0);
+        error = unlink(TEST_FNAME_4);
+        test_assert(error == 0);
+    }
+    free(write_buf);
+
     // Create a namespace
     gpi_space_id_t ns_id;
     error = xv6fs_client_new_ns(&ns_id);
@@ -283,6 +460,37 @@ int test_fs(env_t env)
     f = open(TEST_FNAME_3, O_RDWR);
     test_assert(f == -1);
 
+    // Test writing a model state to a file
+    model_state_t *model_state = calloc(1, sizeof(model_state_t));
+    test_assert(model_state != NULL);
+    init_model_state(model_state);
+    gpi_model_node_t *model_pd = add_pd_node(model_state, "Proc1", 1, true);
+    gpi_model_node_t *model_mo = add_resource_node(model_state, make_res_id(GPICAP_TYPE_MO, 1, 1), true);
+    add_edge(model_state, GPI_EDGE_TYPE_HOLD, model_pd, model_mo);
+
+    f = open(TEST_FNAME_MODEL, O_CREAT | O_RDWR);
+    test_assert(f > 0);
+    error = write_model_state_file(model_state, f);
+    test_assert(error == 0);
+
+    char *model_csv = malloc(RR_MO_N_PAGES * PAGE_SIZE_4K);
+    char *model_file = calloc(1, RR_MO_N_PAGES * PAGE_SIZE_4K);
+    test_assert(model_csv != NULL && model_file != NULL);
+    error = export_model_state(model_state, model_csv, RR_MO_N_PAGES * PAGE_SIZE_4K);
+    test_assert(error == 0);
+
+    nbytes = lseek(f, 0, SEEK_SET);
+    test_assert(nbytes == 0);
+    nbytes = read(f, model_file, RR_MO_N_PAGES * PAGE_SIZE_4K - 1);
+    test_assert(nbytes == strlen(model_csv));
+    test_assert(strcmp(model_file, model_csv) == 0);
+
+    error = close(f);
+    test_assert(error == 0);
+    free(model_csv);
+    free(model_file);
+    destroy_model_state(model_state);
+
     extract_model(&pd_conn);
 
     /* Remove RDEs from test process so that it won't be cleaned up by recursive cleanup */
@@ -13,13 +13,18 @@
 #include <sel4gpi/vmr_clientapi.h>
 #include <sel4gpi/pd_utils.h>
 #include <sel4gpi/pd_creation.h>
+#include <sel4gpi/bench_utils.h>
+#include <sel4bench/arch/sel4bench.h>
 
 #include <ramdisk_client.h>
 #include <fs_client.h>
 #include <kvstore_shared.h>
+#include <kvstore_server_rpc.pb.h>
 
 #define KVSTORE_SERVER_APP "kvstore_server"
 #define HELLO_KVSTORE_APP "hello_kvstore"
+#define KVSTORE_BENCH_N_OPS 1000
+#define KVSTORE_BENCH_N_HOT_KEYS 16
 
 static ads_client_context_t ads_conn;
 static pd_client_context_t pd_conn;
@@ -517,4 +522,270 @@ int test_kvstore_lib_in_diff_pd_crash(env_t env)
 }
 DEFINE_TEST_OSM(GPIKV008,
                 "Test kvstore with app and lib in different PDs, same FS, different NS: ramdisk crashes",
-                test_kvstore_lib_in_diff_pd_crash, true)
\ No newline at end of file
+                test_kvstore_lib_in_diff_pd_crash, true)
+
+#define KVSTORE_TEST_BLOB_KEY "blob key"
+#define KVSTORE_TEST_BLOB_PAGES 4
+
+int test_kvstore_blobs(env_t env)
+{
+    int error;
+
+    printf("------------------STARTING TEST: %s------------------\n", __func__);
+
+    error = setup(env);
+    test_assert(error == 0);
+
+    /* Start the kvstore PD, and use it from the test process */
+    pd_client_context_t kvstore_pd;
+    seL4_CPtr kvstore_server_ep;
+    error = start_kvstore_server(&kvstore_server_ep, BADGE_SPACE_ID_NULL, &kvstore_pd);
+    test_assert(error == 0);
+
+    error = kvstore_client_configure(SEPARATE_PROC, kvstore_server_ep);
+    test_assert(error == 0);
+
+    seL4_CPtr kvstore_ep;
+    gpi_obj_id_t kvstore_id;
+    error = kvstore_client_create_kvstore(&kvstore_ep, &kvstore_id);
+    test_assert(error == 0);
+
+    /* Shared memory for the blobs */
+    mo_client_context_t mo_conn;
+    error = mo_component_client_connect(sel4gpi_get_rde(GPICAP_TYPE_MO), KVSTORE_TEST_BLOB_PAGES,
+                                        MO_PAGE_BITS, &mo_conn);
+    test_error_eq(error, 0);
+
+    char *buf;
+    error = vmr_client_attach_no_reserve(sel4gpi_get_bound_vmr_rde(), NULL, &mo_conn,
+                                         SEL4UTILS_RES_TYPE_SHARED_FRAMES, (void **)&buf);
+    test_error_eq(error, 0);
+
+    /* Set a value spanning several pages */
+    uint32_t key_len = strlen(KVSTORE_TEST_BLOB_KEY);
+    uint32_t val_len = (KVSTORE_TEST_BLOB_PAGES - 1) * SIZE_BITS_TO_BYTES(MO_PAGE_BITS);
+    memcpy(buf, KVSTORE_TEST_BLOB_KEY, key_len);
+    for (uint32_t i = 0; i < val_len; i++)
+    {
+        buf[key_len + i] = (char)(i % 251);
+    }
+
+    error = kvstore_client_bset(kvstore_ep, kvstore_id, &mo_conn, buf, key_len, val_len);
+    test_error_eq(error, 0);
+
+    /* Get it back, the value replaces the key */
+    memset(buf, 0, SIZE_BITS_TO_BYTES(MO_PAGE_BITS) * KVSTORE_TEST_BLOB_PAGES);
+    memcpy(buf, KVSTORE_TEST_BLOB_KEY, key_len);
+
+    uint32_t ret_len = 0;
+    error = kvstore_client_bget(kvstore_ep, kvstore_id, &mo_conn, buf, key_len, &ret_len);
+    test_error_eq(error, 0);
+    test_assert(ret_len == val_len);
+    for (uint32_t i = 0; i < val_len; i++)
+    {
+        test_assert(buf[i] == (char)(i % 251));
+    }
+
+    /* A missing key */
+    memcpy(buf, "no such key", 11);
+    error = kvstore_client_bget(kvstore_ep, kvstore_id, &mo_conn, buf, 11, &ret_len);
+    test_error_eq(error, KvstoreError_KEY);
+
+    /* A value that doesn't fit reports its length */
+    mo_client_context_t small_mo;
+    error = mo_component_client_connect(sel4gpi_get_rde(GPICAP_TYPE_MO), 1, MO_PAGE_BITS, &small_mo);
+    test_error_eq(error, 0);
+
+    char *small_buf;
+    error = vmr_client_attach_no_reserve(sel4gpi_get_bound_vmr_rde(), NULL, &small_mo,
+                                         SEL4UTILS_RES_TYPE_SHARED_FRAMES, (void **)&small_buf);
+    test_error_eq(error, 0);
+
+    memcpy(small_buf, KVSTORE_TEST_BLOB_KEY, key_len);
+    ret_len = 0;
+    error = kvstore_client_bget(kvstore_ep, kvstore_id, &small_mo, small_buf, key_len, &ret_len);
+    test_error_eq(error, KvstoreError_SIZE);
+    test_assert(ret_len == val_len);
+
+    test_error_eq(remove_RDEs(), 0);
+
+    /* Cleanup servers */
+    test_error_eq(maybe_terminate_pd(&kvstore_pd), 0);
+    test_error_eq(maybe_terminate_pd(&fs_pd), 0);
+    test_error_eq(maybe_terminate_pd(&ramdisk_pd), 0);
+
+    printf("------------------ENDING: %s------------------\n", __func__);
+    return sel4test_get_result();
+}
+DEFINE_TEST_OSM(GPIKV009, "Test kvstore blob keys and values, from the test process", test_kvstore_blobs, true)
+
+int benchmark_kvstore_ops(env_t env)
+{
+    int error;
+
+    printf("------------------STARTING TEST: %s------------------\n", __func__);
+
+    benchmark_init(env);
+
+    error = setup(env);
+    test_assert(error == 0);
+
+    /* Start the kvstore PD, and use it from the test process */
+    pd_client_context_t kvstore_pd;
+    seL4_CPtr kvstore_server_ep;
+    error = start_kvstore_server(&kvstore_server_ep, BADGE_SPACE_ID_NULL, &kvstore_pd);
+    test_assert(error == 0);
+
+    error = kvstore_client_configure(SEPARATE_PROC, kvstore_server_ep);
+    test_assert(error == 0);
+
+    seL4_CPtr kvstore_ep;
+    gpi_obj_id_t kvstore_id;
+    error = kvstore_client_create_kvstore(&kvstore_ep, &kvstore_id);
+    test_assert(error == 0);
+
+    ccnt_t start, end;
+
+    /* Set distinct keys */
+    printf("kvstore %d sets\n", KVSTORE_BENCH_N_OPS);
+    SEL4BENCH_READ_CCNT(start);
+    for (int i = 0; i < KVSTORE_BENCH_N_OPS; i++)
+    {
+        error |= kvstore_client_set(kvstore_ep, kvstore_id, i, i * 3);
+    }
+    SEL4BENCH_READ_CCNT(end);
+    test_error_eq(error, 0);
+    benchmark_print_result(end - start);
+    printf("kvstore set: %lu cycles/op\n", (end - start) / KVSTORE_BENCH_N_OPS);
+
+    /* Get the same keys back */
+    seL4_Word val;
+    printf("kvstore %d gets\n", KVSTORE_BENCH_N_OPS);
+    SEL4BENCH_READ_CCNT(start);
+    for (int i = 0; i < KVSTORE_BENCH_N_OPS; i++)
+    {
+        error |= kvstore_client_get(kvstore_ep, kvstore_id, i, &val);
+    }
+    SEL4BENCH_READ_CCNT(end);
+    test_error_eq(error, 0);
+    test_assert(val == (KVSTORE_BENCH_N_OPS - 1) * 3);
+    benchmark_print_result(end - start);
+    printf("kvstore get: %lu cycles/op\n", (end - start) / KVSTORE_BENCH_N_OPS);
+
+    /* Get a small set of hot keys, which stay in the server's cache */
+    uint64_t hits_before, misses_before, hits, misses;
+    error = kvstore_client_get_cache_stats(kvstore_ep, kvstore_id, &hits_before, &misses_before);
+    test_error_eq(error, 0);
+
+    printf("kvstore %d gets, %d hot keys\n", KVSTORE_BENCH_N_OPS, KVSTORE_BENCH_N_HOT_KEYS);
+    SEL4BENCH_READ_CCNT(start);
+    for (int i = 0; i < KVSTORE_BENCH_N_OPS; i++)
+    {
+        error |= kvstore_client_get(kvstore_ep, kvstore_id, i % KVSTORE_BENCH_N_HOT_KEYS, &val);
+    }
+    SEL4BENCH_READ_CCNT(end);
+    test_error_eq(error, 0);
+    benchmark_print_result(end - start);
+    printf("kvstore hot get: %lu cycles/op\n", (end - start) / KVSTORE_BENCH_N_OPS);
+
+    error = kvstore_client_get_cache_stats(kvstore_ep, kvstore_id, &hits, &misses);
+    test_error_eq(error, 0);
+    printf("kvstore hot get: %lu cache hits, %lu cache misses\n", hits - hits_before, misses - misses_before);
+    test_assert(misses - misses_before <= KVSTORE_BENCH_N_HOT_KEYS);
+
+    /* Batched sets and gets through a shared MO */
+    mo_client_context_t mo_conn;
+    error = mo_component_client_connect(sel4gpi_get_rde(GPICAP_TYPE_MO), 1, MO_PAGE_BITS, &mo_conn);
+    test_error_eq(error, 0);
+
+    kvstore_pair_t *pairs;
+    error = vmr_client_attach_no_reserve(sel4gpi_get_bound_vmr_rde(), NULL, &mo_conn,
+                                         SEL4UTILS_RES_TYPE_SHARED_FRAMES, (void **)&pairs);
+    test_error_eq(error, 0);
+
+    uint32_t batch = KVSTORE_MAX_BATCH_PAIRS;
+    uint32_t n_batched = 0;
+
+    printf("kvstore %d sets, %u per request\n", KVSTORE_BENCH_N_OPS, batch);
+    SEL4BENCH_READ_CCNT(start);
+    for (uint32_t i = 0; i < KVSTORE_BENCH_N_OPS; i += batch)
+    {
+        uint32_t n = MIN(batch, KVSTORE_BENCH_N_OPS - i);
+        for (uint32_t j = 0; j < n; j++)
+        {
+            pairs[j].key = KVSTORE_BENCH_N_OPS + i + j;
+            pairs[j].val = i + j;
+        }
+        error |= kvstore_client_mset(kvstore_ep, kvstore_id, &mo_conn, pairs, n);
+    }
+    SEL4BENCH_READ_CCNT(end);
+    test_error_eq(error, 0);
+    benchmark_print_result(end - start);
+    printf("kvstore mset: %lu cycles/key\n", (end - start) / KVSTORE_BENCH_N_OPS);
+
+    printf("kvstore %d gets, %u per request\n", KVSTORE_BENCH_N_OPS, batch);
+    SEL4BENCH_READ_CCNT(start);
+    for (uint32_t i = 0; i < KVSTORE_BENCH_N_OPS; i += batch)
+    {
+        uint32_t n = MIN(batch, KVSTORE_BENCH_N_OPS - i);
+        uint32_t n_found;
+        for (uint32_t j = 0; j < n; j++)
+        {
+            pairs[j].key = KVSTORE_BENCH_N_OPS + i + j;
+        }
+        error |= kvstore_client_mget(kvstore_ep, kvstore_id, &mo_conn, pairs, n, &n_found);
+        n_batched += n_found;
+    }
+    SEL4BENCH_READ_CCNT(end);
+    test_error_eq(error, 0);
+    test_assert(n_batched == KVSTORE_BENCH_N_OPS);
+    test_assert(pairs[0].error == 0 && pairs[0].val == pairs[0].key - KVSTORE_BENCH_N_OPS);
+    benchmark_print_result(end - start);
+    printf("kvstore mget: %lu cycles/key\n", (end - start) / KVSTORE_BENCH_N_OPS);
+
+    /* Ordered scan over all keys written above, one page of pairs per request */
+    uint32_t n_scanned = 0;
+    seL4_Word prev_key = 0;
+    seL4_Word next_key = 0;
+    bool done = false;
+
+    printf("kvstore scan of %d keys, %u per request\n", KVSTORE_BENCH_N_OPS * 2, batch);
+    SEL4BENCH_READ_CCNT(start);
+    while (!done && error == 0)
+    {
+        uint32_t n_pairs;
+        error = kvstore_client_scan(kvstore_ep, kvstore_id, &mo_conn, pairs, batch,
+                                    next_key, KVSTORE_BENCH_N_OPS * 2, &n_pairs, &next_key, &done);
+
+        for (uint32_t j = 0; j < n_pairs; j++)
+        {
+            test_assert(n_scanned == 0 || pairs[j].key > prev_key);
+            prev_key = pairs[j].key;
+            n_scanned++;
+        }
+    }
+    SEL4BENCH_READ_CCNT(end);
+    test_error_eq(error, 0);
+    test_assert(n_scanned == KVSTORE_BENCH_N_OPS * 2);
+    benchmark_print_result(end - start);
+    printf("kvstore scan: %lu cycles/key\n", (end - start) / (KVSTORE_BENCH_N_OPS * 2));
+
+    error = vmr_client_delete_by_vaddr(sel4gpi_get_bound_vmr_rde(), pairs);
+    test_error_eq(error, 0);
+
+    test_error_eq(remove_RDEs(), 0);
+
+    /* Cleanup servers */
+    test_error_eq(maybe_terminate_pd(&kvstore_pd), 0);
+    test_error_eq(maybe_terminate_pd(&fs_pd), 0);
+    test_error_eq(maybe_terminate_pd(&ramdisk_pd), 0);
+
+    printf("------------------ENDING: %s------------------\n", __func__);
+    BENCH_UTILS_DESTROY;
+    return sel4test_get_result();
+}
+DEFINE_TEST_WITH_TYPE_MULTIPLE(GPIBM016,
+                               "osm kvstore get/set throughput, single vs. batched",
+                               benchmark_kvstore_ops,
+                               OSM,
+                               true)
@@ -24,6 +24,8 @@
 #include <utils/uthash.h>
 #include <sel4gpi/pd_utils.h>
 #include <sel4gpi/pd_creation.h>
+#include <sel4gpi/vmr_clientapi.h>
+#include <sel4gpi/model_exporting.h>
 #include <sel4runtime.h>
 #include "test_shared.h"
 
@@ -197,4 +199,143 @@ int test_send_resource(env_t env)
     printf("------------------ENDING: %s------------------\n", __func__);
     return sel4test_get_result();
 }
-DEFINE_TEST_OSM(GPIPD004, "Test sending resources to a PD", test_send_resource, true)
\ No newline at end of file
+DEFINE_TEST_OSM(GPIPD004, "Test sending resources to a PD", test_send_resource, true)
+
+int test_pd_dump_delta(env_t env)
+{
+    int error;
+    printf("------------------STARTING: %s------------------\n", __func__);
+
+    pd_client_context_t pd_conn = sel4gpi_get_pd_conn();
+
+    // MO to receive the journal entries
+    mo_client_context_t delta_mo;
+    error = mo_component_client_connect(sel4gpi_get_rde(GPICAP_TYPE_MO), 1, MO_PAGE_BITS, &delta_mo);
+    test_assert(error == 0);
+
+    gpi_model_journal_entry_t *entries;
+    error = vmr_client_attach_no_reserve(sel4gpi_get_bound_vmr_rde(), NULL, &delta_mo,
+                                         SEL4UTILS_RES_TYPE_SHARED_FRAMES, (void **)&entries);
+    test_assert(error == 0);
+
+    // Get the current epoch
+    uint32_t n_entries;
+    uint64_t start_epoch, epoch;
+    bool done;
+    error = pd_client_dump_delta(&pd_conn, NULL, 0, &n_entries, &start_epoch, &done);
+    test_assert(error == 0);
+    test_assert(n_entries == 0 && done);
+
+    // Allocating a resource adds a hold edge
+    mo_client_context_t mo;
+    error = mo_component_client_connect(sel4gpi_get_rde(GPICAP_TYPE_MO), 1, MO_PAGE_BITS, &mo);
+    test_assert(error == 0);
+
+    error = pd_client_dump_delta(&pd_conn, &delta_mo, start_epoch, &n_entries, &epoch, &done);
+    test_assert(error == 0);
+    test_assert(done && n_entries > 0 && epoch == start_epoch + n_entries);
+
+    bool found_hold = false;
+    for (uint32_t i = 0; i < n_entries; i++)
+    {
+        test_assert(entries[i].epoch == start_epoch + i + 1);
+        found_hold |= entries[i].op == GPI_JOURNAL_ADD_EDGE &&
+                      entries[i].edge.type == GPI_EDGE_TYPE_HOLD &&
+                      entries[i].edge.from == get_pd_key(pd_conn.id) &&
+                      get_cap_type_from_badge(entries[i].edge.to) == GPICAP_TYPE_MO &&
+                      get_object_id_from_badge(entries[i].edge.to) == mo.id;
+    }
+    test_assert(found_hold);
+
+    // Freeing the resource removes the hold edge
+    start_epoch = epoch;
+    error = mo_component_client_disconnect(&mo);
+    test_assert(error == 0);
+
+    error = pd_client_dump_delta(&pd_conn, &delta_mo, start_epoch, &n_entries, &epoch, &done);
+    test_assert(error == 0);
+    test_assert(done && n_entries > 0);
+
+    bool found_remove = false;
+    for (uint32_t i = 0; i < n_entries; i++)
+    {
+        found_remove |= entries[i].op == GPI_JOURNAL_REMOVE_EDGE &&
+                        entries[i].edge.type == GPI_EDGE_TYPE_HOLD &&
+                        entries[i].edge.from == get_pd_key(pd_conn.id) &&
+                        get_object_id_from_badge(entries[i].edge.to) == mo.id;
+    }
+    test_assert(found_remove);
+
+    error = vmr_client_delete_by_vaddr(sel4gpi_get_bound_vmr_rde(), entries);
+    test_assert(error == 0);
+
+    printf("------------------ENDING: %s------------------\n", __func__);
+    return sel4test_get_result();
+}
+DEFINE_TEST_OSM(GPIPD005, "Test incremental model extraction", test_pd_dump_delta, true)
+
+int test_pd_slot_lease(env_t env)
+{
+    int error;
+    printf("------------------STARTING: %s------------------\n", __func__);
+
+    pd_client_context_t pd_conn = sel4gpi_get_pd_conn();
+
+    // A lease is a contiguous range of free slots
+    seL4_CPtr base;
+    uint32_t n_slots;
+    error = pd_client_lease_slots(&pd_conn, 8, &base, &n_slots);
+    test_assert(error == 0);
+    test_assert(base != seL4_CapNull && n_slots > 0 && n_slots <= 8);
+
+    // The root task does not hand out leased slots
+    seL4_CPtr slot;
+    error = pd_client_next_slot(&pd_conn, &slot);
+    test_assert(error == 0);
+    test_assert(slot < base || slot >= base + n_slots);
+
+    error = pd_client_free_slot(&pd_conn, slot);
+    test_assert(error == 0);
+
+    error = pd_client_return_slots(&pd_conn, base, n_slots == 64 ? ~0ULL : (1ULL << n_slots) - 1);
+    test_assert(error == 0);
+
+    // Slots from the local allocator are distinct and usable
+    seL4_CPtr slots[16];
+    int n_alloc = sizeof(slots) / sizeof(slots[0]);
+    for (int i = 0; i < n_alloc; i++)
+    {
+        error = sel4gpi_alloc_slot(&slots[i]);
+        test_assert(error == 0);
+
+        for (int j = 0; j < i; j++)
+        {
+            test_assert(slots[i] != slots[j]);
+        }
+    }
+
+    error = seL4_CNode_Copy(PD_CAP_ROOT, slots[0], PD_CAP_DEPTH,
+                            PD_CAP_ROOT, pd_conn.ep, PD_CAP_DEPTH, seL4_AllRights);
+    test_assert(error == 0);
+
+    error = sel4gpi_clear_slot(slots[0]);
+    test_assert(error == 0);
+
+    // The cleared slot can be reused without reallocating it
+    error = seL4_CNode_Copy(PD_CAP_ROOT, slots[0], PD_CAP_DEPTH,
+                            PD_CAP_ROOT, pd_conn.ep, PD_CAP_DEPTH, seL4_AllRights);
+    test_assert(error == 0);
+
+    for (int i = 0; i < n_alloc; i++)
+    {
+        error = sel4gpi_free_slot(slots[i]);
+        test_assert(error == 0);
+    }
+
+    error = sel4gpi_return_free_slots();
+    test_assert(error == 0);
+
+    printf("------------------ENDING: %s------------------\n", __func__);
+    return sel4test_get_result();
+}
+DEFINE_TEST_OSM(GPIPD006, "Test leasing cspace slots", test_pd_slot_lease, true)
@@ -71,7 +71,7 @@ int test_ramdisk(env_t env)
     test_assert(error == 0);
 
     // Set up shared memory
-    error = ramdisk_client_bind(ramdisk_client_ep, &mo_conn);
+    error = ramdisk_client_bind(ramdisk_client_ep, &mo_conn, 1);
     test_assert(error == seL4_NoError);
 
     // Get a block
@@ -142,6 +142,34 @@ int test_ramdisk(env_t env)
         test_assert(error == seL4_NoError);
     }
 
+    // Allocate an extent and address blocks within it
+    ramdisk_client_context_t extent;
+    error = ramdisk_client_alloc_extent(ramdisk_client_ep, 8, &extent);
+    test_assert(error == seL4_NoError);
+    test_assert(extent.n_blocks == 8);
+
+    for (int i = 0; i < 8; i++)
+    {
+        buf[0] = i + 1;
+        error = ramdisk_client_write_block(&extent, i);
+        test_assert(error == seL4_NoError);
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        buf[0] = 0;
+        error = ramdisk_client_read_block(&extent, i);
+        test_assert(error == seL4_NoError);
+        test_assert(buf[0] == i + 1);
+    }
+
+    // Offsets past the end of the extent are rejected
+    error = ramdisk_client_read_block(&extent, 8);
+    test_assert(error != seL4_NoError);
+
+    error = ramdisk_client_free_block(&extent);
+    test_assert(error == seL4_NoError);
+
     // Unbind shared memory
     error = ramdisk_client_unbind(ramdisk_client_ep);
     test_assert(error == seL4_NoError);
@@ -8,6 +8,9 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <sys/stat.h>
+
 #include <sel4/sel4.h>
 #include <sel4/types.h>
 
@@ -81,16 +84,110 @@ int xv6fs_client_new_ns(gpi_space_id_t *ns_id);
  */
 int xv6fs_client_delete_ns(seL4_CPtr ns_ep);
 
+/**
+ * Registers an MO mapped in this process as a zero-copy file I/O buffer
+ * Reads and writes whose buffer lies within a registered MO hand the MO to the
+ * FS server directly, instead of copying through the shared memory
+ *
+ * @param mo the MO, which stays owned by the caller
+ * @param vaddr the address the MO is attached at
+ * @return 0 on success, -1 if there are no free buffer slots
+ */
+int xv6fs_client_register_buffer(mo_client_context_t *mo, void *vaddr);
+
+/**
+ * Removes a zero-copy file I/O buffer registered with xv6fs_client_register_buffer
+ * Must be called before the MO is unattached or freed
+ *
+ * @param vaddr the address the MO is attached at
+ * @return 0 on success, -1 if no buffer was registered at vaddr
+ */
+int xv6fs_client_unregister_buffer(void *vaddr);
+
+/**
+ * Enables or disables the client page cache
+ * While enabled, small reads and fstat are served from pages cached in this process,
+ * which are invalidated by this process's writes and by the FS server when other PDs write
+ *
+ * @param enable true to enable the cache, false to disable it and drop all cached pages
+ * @return 0 on success, -1 if the cache could not be allocated or registered for invalidations
+ */
+int xv6fs_client_enable_cache(bool enable);
+
+/**
+ * Maps a range of a file into this process
+ * The mapping is backed by the file's blocks in the ramdisk, so accesses through it need no
+ * requests or copies. Writes through the mapping must be reported with xv6fs_client_munmap.
+ * The mapping does not change the file size. While it exists, writes made through the FS server
+ * go straight to the ramdisk so the mapping sees them, the file cannot be truncated, and its
+ * blocks stay allocated even if it is unlinked.
+ *
+ * @param fd fd returned by libc open
+ * @param offset offset of the range, must be a multiple of RAMDISK_BLOCK_SIZE
+ * @param len length of the range, at most RAMDISK_MAX_VECTOR_BLOCKS blocks and within the file,
+ *            though the last block may extend past the end of the file
+ * @param mo returns the MO backing the mapping
+ * @param vaddr returns the address the range is mapped at
+ * @return 0 on success, -1 on failure
+ */
+int xv6fs_client_mmap(int fd, uint32_t offset, size_t len, mo_client_context_t *mo, void **vaddr);
+
+/**
+ * Unmaps a range of a file mapped with xv6fs_client_mmap, and frees its MO
+ * The FS server revokes the MO before it releases the blocks. A range still mapped when the
+ * client closes the file or exits is released the same way, and treated as dirty.
+ *
+ * @param fd fd the range was mapped from
+ * @param offset offset the range was mapped from
+ * @param len length of the mapped range
+ * @param mo the MO returned by xv6fs_client_mmap
+ * @param vaddr the address returned by xv6fs_client_mmap
+ * @param dirty true if the range was written through the mapping, so cached copies are dropped
+ * @return 0 on success, -1 on failure
+ */
+int xv6fs_client_munmap(int fd, uint32_t offset, size_t len, mo_client_context_t *mo, void *vaddr, bool dirty);
+
+#define XV6FS_CLIENT_MAX_BUFFERS 8
+#define XV6FS_CLIENT_SHARED_MEM_MAX_PAGES 256
+#define XV6FS_CLIENT_CACHE_PAGES 32   // Number of file pages kept by the client page cache
+#define XV6FS_CLIENT_CACHE_MAX_READ 4 // Reads of more pages than this bypass the client page cache
+
 /*
 Context of the client for a single file
 */
 typedef struct _xv6fs_client_context
 {
     seL4_CPtr ep;
+    gpi_obj_id_t id; // Object ID of the file, the same for every open of the file
     uint64_t offset;
     uint64_t flags; // For fcntl, can we remove?
+
+    // Result of the last fstat, while the client page cache is enabled
+    bool stat_valid;
+    struct stat stat;
 } xv6fs_client_context_t;
 
+/*
+A page of a file in the client page cache
+*/
+typedef struct _xv6fs_client_cache_page
+{
+    gpi_obj_id_t file_id; // BADGE_OBJ_ID_NULL if the entry is unused
+    uint64_t page;        // Index of the page within the file
+    uint32_t size;        // Number of valid bytes, less than a page at the end of the file
+    uint64_t last_used;
+    char *data;
+} xv6fs_client_cache_page_t;
+
+/*
+An MO registered by the application for zero-copy file I/O
+*/
+typedef struct _xv6fs_client_buffer
+{
+    mo_client_context_t *mo;
+    void *vaddr;
+} xv6fs_client_buffer_t;
+
 /*
 Context of the client for this process
 */
@@ -101,7 +198,16 @@ typedef struct _global_xv6fs_client_context_t
     gpi_space_id_t space_id;
     seL4_CPtr server_ep;
 
-    // Shared memory frame with the file server, sent on every request
+    // Shared memory with the file server, sent on every request
+    // Grows to fit the largest read or write, up to XV6FS_CLIENT_SHARED_MEM_MAX_PAGES
     mo_client_context_t *shared_mem;
     void *shared_mem_vaddr;
+
+    // Application MOs that are sent to the server in place of the shared memory
+    xv6fs_client_buffer_t buffers[XV6FS_CLIENT_MAX_BUFFERS];
+
+    // Client page cache, NULL if it is disabled
+    xv6fs_client_cache_page_t *cache;
+    char *cache_data;
+    uint64_t cache_clock;
 } global_xv6fs_client_context_t;
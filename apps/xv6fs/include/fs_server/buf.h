@@ -2,15 +2,19 @@
 
 #include <stdint.h>
 
+#define NOBLOCK ((uint32_t)-1) // blockno of a buffer that has never held a block
+
 struct buf
 {
   int valid; // has data been read from disk?
   int disk;  // does disk "own" buf?
+  int dirty; // has data changed since it was read from disk?
   uint32_t dev;
   uint32_t blockno;
   struct sleeplock lock;
   uint32_t refcnt;
   struct buf *prev; // LRU cache list
   struct buf *next;
-  uint8_t data[BSIZE];
+  struct buf *hnext; // hash chain of buffers in the same bucket
+  uint8_t *data;     // BSIZE bytes
 };
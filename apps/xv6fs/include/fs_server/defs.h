@@ -41,6 +41,10 @@ void brelse(struct buf *);
 void bwrite(struct buf *);
 void bpin(struct buf *);
 void bunpin(struct buf *);
+void bdirty(struct buf *);
+void bprefetch(uint32_t, uint32_t *, int);
+void bflush(uint32_t, uint32_t);
+void binval(uint32_t, uint32_t);
 
 // file.c
 struct file *filealloc(void);
@@ -68,6 +72,7 @@ int namecmp(const char *, const char *);
 struct inode *namei(char *);
 struct inode *nameiparent(char *, char *);
 uint32_t bmap_noalloc(struct inode *ip, uint32_t bn);
+uint32_t bmap_extent(struct inode *ip, uint32_t bn, uint32_t max, uint32_t *addr);
 int readi(struct inode *, int, uint64_t, uint32_t, uint32_t);
 void stati(struct inode *, struct stat *);
 int writei(struct inode *, int, uint64_t, uint32_t, uint32_t);
@@ -114,6 +119,26 @@ void xv6fs_bread(uint32_t sec, void *buf);
 void xv6fs_bwrite(uint32_t sec, void *buf);
 void disk_rw(struct buf *, int);
 
+/**
+ * The buffer cache uses this to read several blocks with a single disk request
+ * The FS server needs to implement this function
+ *
+ * @param bufs locked buffers to read, with blockno set
+ * @param n number of buffers, at most READAHEAD_BLOCKS
+ * @return 0 on success, error otherwise
+ */
+int disk_readv(struct buf **bufs, int n);
+
+/**
+ * The buffer cache uses this to allocate memory for block data
+ * The FS server needs to implement this function
+ *
+ * @param max_blocks the largest number of blocks to allocate
+ * @param data returns page-aligned memory for the blocks
+ * @return the number of blocks allocated, fewer than max_blocks if memory is short
+ */
+uint32_t disk_alloc_cache(uint32_t max_blocks, void **data);
+
 /**
  * The file system uses this to notify the file server when a block is assigned to a file
  * The FS server needs to implement this function
@@ -157,5 +182,32 @@ int xv6fs_sys_seek(void *fh, uint64_t off, int whence);
 int xv6fs_sys_fcntl(void *fh, int cmd, unsigned long arg);
 int xv6fs_sys_blocknos(struct file *f, int *buf, int buf_size, int* result_size);
 int xv6fs_sys_inode_blocknos(int inum, int *buf, int buf_size, int *result_size);
+
+/**
+ * Find the disk blocks holding a block-aligned range of a file, so they can be accessed
+ * directly instead of through the buffer cache. Cached changes to the blocks are written first.
+ * Until the range is unmapped, writes to the file go straight to disk, the file cannot be
+ * truncated, and its blocks stay allocated even if it is unlinked.
+ *
+ * @param f the file
+ * @param off offset of the range, must be a multiple of BSIZE
+ * @param n length of the range in bytes, the last block may extend past the end of the file
+ * @param blocknos returns the block number of each block in the range
+ * @param ret_ip returns the file's inode, which the mapping holds until it is unmapped
+ * @return the number of blocks in the range, or -1 if it is not within the file
+ */
+int xv6fs_sys_map_blocks(struct file *f, uint32_t off, uint32_t n, uint32_t *blocknos, struct inode **ret_ip);
+
+/**
+ * Release a range of a file mapped with xv6fs_sys_map_blocks
+ * Takes the inode rather than the file, since the file may be closed before the range is unmapped
+ *
+ * @param ip the inode returned by xv6fs_sys_map_blocks
+ * @param off offset of the range, as given to xv6fs_sys_map_blocks
+ * @param n length of the range in bytes, as given to xv6fs_sys_map_blocks
+ * @param dirty true if the blocks were changed, so cached copies are dropped
+ * @return 0 on success, or -1 if the range is not within the file or the file is not mapped
+ */
+int xv6fs_sys_unmap_blocks(struct inode *ip, uint32_t off, uint32_t n, bool dirty);
 int xv6fs_sys_walk(char *path, bool print, uint32_t *inums, int *n_files);
 struct inode *dirlookup_idx(struct inode *dp, int idx, char *de_name);
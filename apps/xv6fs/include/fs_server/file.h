@@ -40,7 +40,10 @@ struct inode
   int ctime;
   int atime;
   int mtime;
-  uint32_t addrs[NDIRECT + 1];
+  uint32_t addrs[NDIRECT + 2];
+  uint32_t ra_next;      // file block a sequential read would read next
+  uint32_t ra_end;       // first file block not prefetched by read-ahead
+  int nmap;              // number of client mappings of the data blocks, each holding a reference
 };
 
 // map major device number to device functions.
@@ -27,9 +27,10 @@ struct superblock
 
 #define FSMAGIC 0x10203040
 
-#define NDIRECT 12
+#define NDIRECT 11
 #define NINDIRECT (BSIZE / sizeof(uint32_t))
-#define MAXFILE (NDIRECT + NINDIRECT)
+#define NDINDIRECT (NINDIRECT * NINDIRECT)
+#define MAXFILE (NDIRECT + NINDIRECT + NDINDIRECT)
 
 // On-disk inode structure
 struct dinode
@@ -39,7 +40,7 @@ struct dinode
   short minor;                 // Minor device number (T_DEVICE only)
   short nlink;                 // Number of links to inode in file system
   uint32_t size;               // Size of file (bytes)
-  uint32_t addrs[NDIRECT + 1]; // Data block addresses
+  uint32_t addrs[NDIRECT + 2]; // Data block addresses, then the indirect and double-indirect blocks
 };
 
 // Inodes per block.
@@ -33,6 +33,20 @@ typedef struct _file_registry_entry
     struct file *file; // handle of the open file
 } file_registry_entry_t;
 
+// Registry of file ranges mapped into clients, keyed by the ID of the client's MO
+typedef struct _fs_mapping_entry
+{
+    resource_registry_node_t gen;
+    gpi_obj_id_t client_id;      // PD the range is mapped into
+    gpi_obj_id_t file_id;        // file the range belongs to
+    gpi_space_id_t ns_id;        // namespace the client holds the file in
+    struct inode *ip;            // inode of the file, held until the range is unmapped
+    uint32_t offset;             // offset of the range
+    uint32_t n;                  // length of the range in bytes
+    bool dirty;                  // true if the client may have written the blocks
+    mo_client_context_t disk_mo; // our MO for the blocks, the client's MO is a slice of it
+} fs_mapping_entry_t;
+
 // Registry of namespaces
 typedef struct _fs_namespace_entry
 {
@@ -55,11 +69,12 @@ typedef struct _xv6fs_server_context
     // Internal data
     resource_registry_t file_registry;
     resource_registry_t ns_registry;
+    resource_registry_t mapping_registry;
 
     // Fields for naive block implementation
     mo_client_context_t *shared_mem;
     void *shared_mem_vaddr;
-    ramdisk_client_context_t blocks[FS_SIZE];
+    ramdisk_client_context_t disk; ///< Extent of FS_SIZE blocks, fs block i is block i of the extent
 } xv6fs_server_context_t;
 
 /**
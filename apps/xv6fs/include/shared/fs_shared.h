@@ -17,5 +17,9 @@
 #define ROOTDEV 1                                             // device number of file system root disk
 #define MAXOPBLOCKS 10                                        // max # of blocks any FS op writes
 #define LOGSIZE 0                                             // use no log, previous value was (MAXOPBLOCKS * 3)
-#define NBUF (MAXOPBLOCKS * 3)                                // size of disk block cache
+#define NBUF (MAXOPBLOCKS * 3)                                // minimum size of disk block cache
+#ifndef NBUF_MAX
+#define NBUF_MAX (NBUF * 4)                                   // maximum size of disk block cache, can be set at build time
+#endif
+#define READAHEAD_BLOCKS 8                                    // max # of blocks prefetched by a sequential read
 #define MAXPATH 128                                           // maximum file path name
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include <sel4/sel4.h>
 #include <sel4utils/process.h>
 #include <vspace/vspace.h>
+#include <utils/util.h>
 
 #include <sel4gpi/ads_clientapi.h>
 #include <sel4gpi/vmr_clientapi.h>
@@ -86,13 +87,15 @@ static void fd_init(void)
 }
 
 // Add a file to the file descriptor table
-int fd_bind(seL4_CPtr file_cap)
+int fd_bind(seL4_CPtr file_cap, gpi_obj_id_t file_id)
 {
   for (int i = 5; i < FD_TABLE_SIZE; i++)
     if (fd_table[i].ep == 0)
     {
       fd_table[i].ep = file_cap;
+      fd_table[i].id = file_id;
       fd_table[i].offset = 0;
+      fd_table[i].stat_valid = false;
       // printf("%s: new fd %d\n", __func__, i);
       return i;
     }
@@ -230,7 +233,7 @@ static int xv6fs_libc_open(const char *pathname, int flags, int modes)
 
   // Add file to FD table
   seL4_CPtr dest = ret_msg.msg.create.slot;
-  int fd = fd_bind(dest);
+  int fd = fd_bind(dest, ret_msg.msg.create.file_id);
 
   if (fd == -1)
   {
@@ -243,62 +246,538 @@ static int xv6fs_libc_open(const char *pathname, int flags, int modes)
   return fd;
 }
 
-static int xv6fs_libc_pread(int fd, void *buf, int count, int offset)
+/**
+ * Replaces the shared memory with a larger MO that fits size bytes, if possible
+ * The size at least doubles, so that growing is rare
+ */
+static int xv6fs_client_grow_shared_mem(size_t size)
 {
   int error = 0;
+  global_xv6fs_client_context_t *client = get_xv6fs_client();
+  size_t page_size = SIZE_BITS_TO_BYTES(MO_PAGE_BITS);
+  size_t n_pages = client->shared_mem->size / page_size;
 
-  XV6FS_PRINTF("xv6fs_libc_read fd %d len %d offset %d\n", fd, count, offset);
+  if (n_pages >= XV6FS_CLIENT_SHARED_MEM_MAX_PAGES)
+  {
+    return 0;
+  }
+
+  while (n_pages * page_size < size && n_pages < XV6FS_CLIENT_SHARED_MEM_MAX_PAGES)
+  {
+    n_pages *= 2;
+  }
+  n_pages = MIN(n_pages, XV6FS_CLIENT_SHARED_MEM_MAX_PAGES);
+
+  XV6FS_PRINTF("Growing shared mem to %zu pages\n", n_pages);
+
+  mo_client_context_t new_mo;
+  void *new_vaddr;
+  seL4_CPtr vmr_rde = sel4gpi_get_bound_vmr_rde();
+
+  error = mo_component_client_connect(sel4gpi_get_rde(GPICAP_TYPE_MO), n_pages, MO_PAGE_BITS, &new_mo);
+  CHECK_ERROR(error, "failed to allocate larger shared mem");
+
+  error = vmr_client_attach_no_reserve(vmr_rde, NULL, &new_mo, SEL4UTILS_RES_TYPE_SHARED_FRAMES, &new_vaddr);
+  if (error)
+  {
+    mo_component_client_disconnect(&new_mo);
+    CHECK_ERROR(error, "failed to map larger shared mem");
+  }
+
+  /* Keep using the old shared mem if it cannot be unmapped */
+  error = vmr_client_delete_by_vaddr(vmr_rde, client->shared_mem_vaddr);
+  if (error)
+  {
+    vmr_client_delete_by_vaddr(vmr_rde, new_vaddr);
+    mo_component_client_disconnect(&new_mo);
+    CHECK_ERROR(error, "failed to unmap old shared mem");
+  }
+
+  mo_client_context_t old_mo = *client->shared_mem;
+  *client->shared_mem = new_mo;
+  client->shared_mem_vaddr = new_vaddr;
+
+  /* The server drops its cached mapping of the old MO when it is evicted or the MO is freed */
+  error = mo_component_client_disconnect(&old_mo);
+  if (error)
+  {
+    /* The new shared mem is already in use, so only the old MO is lost */
+    ZF_LOGW(XV6FS_C "%s: failed to free old shared mem, %d.", __func__, error);
+  }
+
+  return 0;
+}
+
+/**
+ * Picks the MO that carries up to count bytes at buf to or from the server
+ *
+ * @param buf the caller's buffer
+ * @param count the number of bytes to transfer
+ * @param mo returns the MO to send with the request
+ * @param mo_offset returns the offset of the data within the MO
+ * @param copy returns true if the data goes through the shared memory, false if buf is in the MO
+ * @return the number of bytes the MO can carry, or -1 on error
+ */
+static int xv6fs_client_io_mo(const void *buf, int count,
+                              mo_client_context_t **mo, uint64_t *mo_offset, bool *copy)
+{
+  global_xv6fs_client_context_t *client = get_xv6fs_client();
+
+  /* Use a registered buffer directly if it holds all of buf */
+  for (int i = 0; i < XV6FS_CLIENT_MAX_BUFFERS; i++)
+  {
+    xv6fs_client_buffer_t *buffer = &client->buffers[i];
+
+    if (buffer->mo != NULL && (uintptr_t)buf >= (uintptr_t)buffer->vaddr &&
+        (uintptr_t)buf + count <= (uintptr_t)buffer->vaddr + buffer->mo->size)
+    {
+      *mo = buffer->mo;
+      *mo_offset = (uintptr_t)buf - (uintptr_t)buffer->vaddr;
+      *copy = false;
+      return count;
+    }
+  }
+
+  /* Otherwise copy through the shared memory, growing it if needed */
+  if (count > client->shared_mem->size)
+  {
+    int error = xv6fs_client_grow_shared_mem(count);
+    CHECK_ERROR_EXIT(error, "failed to grow shared mem");
+  }
+
+  *mo = client->shared_mem;
+  *mo_offset = 0;
+  *copy = true;
+  return MIN(count, client->shared_mem->size);
 
-  if (count > RAMDISK_BLOCK_SIZE)
+exit:
+  return -1;
+}
+
+int xv6fs_client_register_buffer(mo_client_context_t *mo, void *vaddr)
+{
+  for (int i = 0; i < XV6FS_CLIENT_MAX_BUFFERS; i++)
+  {
+    xv6fs_client_buffer_t *buffer = &get_xv6fs_client()->buffers[i];
+
+    if (buffer->mo == NULL)
+    {
+      buffer->mo = mo;
+      buffer->vaddr = vaddr;
+      return 0;
+    }
+  }
+
+  XV6FS_PRINTF("Ran out of zero-copy buffer slots\n");
+  return -1;
+}
+
+int xv6fs_client_unregister_buffer(void *vaddr)
+{
+  for (int i = 0; i < XV6FS_CLIENT_MAX_BUFFERS; i++)
+  {
+    xv6fs_client_buffer_t *buffer = &get_xv6fs_client()->buffers[i];
+
+    if (buffer->mo != NULL && buffer->vaddr == vaddr)
+    {
+      buffer->mo = NULL;
+      buffer->vaddr = NULL;
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * Sends one read request for up to n bytes of a file into an MO
+ *
+ * @return the number of bytes read, or -1 on error
+ */
+static int xv6fs_client_read(xv6fs_client_context_t *file, mo_client_context_t *mo, uint64_t mo_offset,
+                             int n, int offset)
+{
+  seL4_CPtr caps[1] = {mo->ep};
+
+  FsMessage msg = {
+      .magic = FS_RPC_MAGIC,
+      .which_msg = FsMessage_read_tag,
+      .msg.read = {
+          .n = n,
+          .offset = offset,
+          .mo_id = mo->id,
+          .mo_offset = mo_offset,
+      }};
+
+  FsReturnMessage ret_msg = {0};
+
+  int error = sel4gpi_rpc_call(&rpc_client, file->ep,
+                               &msg, 1, caps, &ret_msg);
+
+  if (error || ret_msg.errorCode)
   {
-    // (XXX) Arya: Support larger file read/writes
-    XV6FS_PRINTF("Count too large for read\n");
     return -1;
   }
 
-  // Check for /dev/null
-  if (fd == dev_null_fd)
+  return ret_msg.msg.read.n;
+}
+
+/* Client page cache */
+
+/**
+ * Drops cached pages and fstat results of a file
+ *
+ * @param file_id the file, or BADGE_OBJ_ID_NULL for all files
+ * @param offset drop only pages overlapping the range starting at offset,
+ *               and pages that ended the file, since the range may extend it
+ * @param count length of the range, or 0 to drop all pages of the file
+ */
+static void xv6fs_cache_invalidate(gpi_obj_id_t file_id, uint64_t offset, size_t count)
+{
+  global_xv6fs_client_context_t *client = get_xv6fs_client();
+  uint64_t first_page = offset / RAMDISK_BLOCK_SIZE;
+  uint64_t end_page = DIV_ROUND_UP(offset + count, RAMDISK_BLOCK_SIZE);
+
+  for (int i = 0; i < XV6FS_CLIENT_CACHE_PAGES; i++)
+  {
+    xv6fs_client_cache_page_t *entry = &client->cache[i];
+
+    if (entry->file_id == BADGE_OBJ_ID_NULL || (file_id != BADGE_OBJ_ID_NULL && entry->file_id != file_id))
+    {
+      continue;
+    }
+
+    if (count == 0 || entry->size < RAMDISK_BLOCK_SIZE || (entry->page >= first_page && entry->page < end_page))
+    {
+      entry->file_id = BADGE_OBJ_ID_NULL;
+    }
+  }
+
+  for (int fd = 0; fd < FD_TABLE_SIZE; fd++)
+  {
+    if (file_id == BADGE_OBJ_ID_NULL || fd_table[fd].id == file_id)
+    {
+      fd_table[fd].stat_valid = false;
+    }
+  }
+}
+
+/**
+ * Applies the invalidations the FS server sent through the root task for files written by other PDs
+ * The root task counts pending invalidations in the PD's shared data, so this needs no RPC if there are none
+ */
+static void xv6fs_cache_sync(void)
+{
+  osm_pd_shared_data_t *shared_data = sel4gpi_get_shared_data();
+
+  while (shared_data->n_pending_invalidations > 0)
+  {
+    PdWorkReturnMessage work;
+    pd_client_context_t pd_conn = sel4gpi_get_pd_conn();
+
+    int error = pd_client_get_invalidations(&pd_conn, &work);
+    if (error)
+    {
+      // Without the list, nothing cached can be trusted
+      XV6FS_PRINTF("Failed to get invalidations, dropping the page cache\n");
+      xv6fs_cache_invalidate(BADGE_OBJ_ID_NULL, 0, 0);
+      break;
+    }
+
+    if (work.action == PdWorkAction_NO_WORK)
+    {
+      break;
+    }
+
+    for (int i = 0; i < work.object_ids_count; i++)
+    {
+      xv6fs_cache_invalidate(work.object_ids[i], 0, 0);
+    }
+  }
+}
+
+/**
+ * Finds a page of a file in the cache, reading it from the server on a miss
+ *
+ * @return the cache entry, or NULL on error
+ */
+static xv6fs_client_cache_page_t *xv6fs_cache_get(xv6fs_client_context_t *file, uint64_t page)
+{
+  global_xv6fs_client_context_t *client = get_xv6fs_client();
+  xv6fs_client_cache_page_t *victim = &client->cache[0];
+
+  client->cache_clock++;
+
+  for (int i = 0; i < XV6FS_CLIENT_CACHE_PAGES; i++)
+  {
+    xv6fs_client_cache_page_t *entry = &client->cache[i];
+
+    if (entry->file_id == file->id && entry->page == page)
+    {
+      entry->last_used = client->cache_clock;
+      return entry;
+    }
+
+    // Prefer an unused entry, otherwise the least recently used one
+    if (victim->file_id != BADGE_OBJ_ID_NULL &&
+        (entry->file_id == BADGE_OBJ_ID_NULL || entry->last_used < victim->last_used))
+    {
+      victim = entry;
+    }
+  }
+
+  victim->file_id = BADGE_OBJ_ID_NULL;
+
+  int bytes_read = xv6fs_client_read(file, client->shared_mem, 0, RAMDISK_BLOCK_SIZE, page * RAMDISK_BLOCK_SIZE);
+  if (bytes_read < 0)
+  {
+    return NULL;
+  }
+
+  memcpy(victim->data, client->shared_mem_vaddr, bytes_read);
+  victim->file_id = file->id;
+  victim->page = page;
+  victim->size = bytes_read;
+  victim->last_used = client->cache_clock;
+
+  return victim;
+}
+
+static int xv6fs_cache_pread(xv6fs_client_context_t *file, void *buf, int count, int offset)
+{
+  xv6fs_cache_sync();
+
+  int total = 0;
+  while (total < count)
+  {
+    uint64_t pos = offset + total;
+    uint32_t page_offset = pos % RAMDISK_BLOCK_SIZE;
+
+    xv6fs_client_cache_page_t *entry = xv6fs_cache_get(file, pos / RAMDISK_BLOCK_SIZE);
+    if (entry == NULL)
+    {
+      return total > 0 ? total : -1;
+    }
+
+    // Stop at the end of the file
+    if (page_offset >= entry->size)
+    {
+      break;
+    }
+
+    int n = MIN(count - total, entry->size - page_offset);
+    memcpy(buf + total, entry->data + page_offset, n);
+    total += n;
+  }
+
+  return total;
+}
+
+int xv6fs_client_enable_cache(bool enable)
+{
+  global_xv6fs_client_context_t *client = get_xv6fs_client();
+  pd_client_context_t pd_conn = sel4gpi_get_pd_conn();
+
+  if (enable && client->cache == NULL)
+  {
+    client->cache = calloc(XV6FS_CLIENT_CACHE_PAGES, sizeof(xv6fs_client_cache_page_t));
+    client->cache_data = malloc(XV6FS_CLIENT_CACHE_PAGES * RAMDISK_BLOCK_SIZE);
+
+    if (client->cache == NULL || client->cache_data == NULL)
+    {
+      XV6FS_PRINTF("Failed to allocate the page cache\n");
+      free(client->cache);
+      free(client->cache_data);
+      client->cache = NULL;
+      client->cache_data = NULL;
+      return -1;
+    }
+
+    for (int i = 0; i < XV6FS_CLIENT_CACHE_PAGES; i++)
+    {
+      client->cache[i].file_id = BADGE_OBJ_ID_NULL;
+      client->cache[i].data = client->cache_data + i * RAMDISK_BLOCK_SIZE;
+    }
+
+    if (pd_client_accept_invalidations(&pd_conn, true))
+    {
+      XV6FS_PRINTF("Failed to register for invalidations\n");
+      free(client->cache);
+      free(client->cache_data);
+      client->cache = NULL;
+      client->cache_data = NULL;
+      return -1;
+    }
+  }
+  else if (!enable && client->cache != NULL)
   {
+    if (pd_client_accept_invalidations(&pd_conn, false))
+    {
+      XV6FS_PRINTF("Failed to unregister from invalidations\n");
+    }
+
+    // Collect any queued invalidations, so the root task can free them
+    xv6fs_cache_sync();
+    xv6fs_cache_invalidate(BADGE_OBJ_ID_NULL, 0, 0);
+
+    free(client->cache);
+    free(client->cache_data);
+    client->cache = NULL;
+    client->cache_data = NULL;
+  }
+
+  return 0;
+}
+
+int xv6fs_client_mmap(int fd, uint32_t offset, size_t len, mo_client_context_t *mo, void **vaddr)
+{
+  XV6FS_PRINTF("xv6fs_client_mmap fd %d len %zu offset %u\n", fd, len, offset);
+  int error = 0;
+
+  xv6fs_client_context_t *file = fd_get(fd);
+  if (file == NULL)
+  {
+    XV6FS_PRINTF("xv6fs_client_mmap: Invalid FD provided\n");
     return -1;
   }
 
-  // Find the file by fd
+  FsMessage msg = {
+      .magic = FS_RPC_MAGIC,
+      .which_msg = FsMessage_mmap_tag,
+      .msg.mmap = {
+          .offset = offset,
+          .n = len,
+      }};
+
+  FsReturnMessage ret_msg = {0};
+
+  error = sel4gpi_rpc_call(&rpc_client, file->ep, &msg, 0, NULL, &ret_msg);
+  if (error || ret_msg.errorCode || ret_msg.which_msg != FsReturnMessage_mmap_tag)
+  {
+    XV6FS_PRINTF("xv6fs_client_mmap: Server failed to map the range\n");
+    return -1;
+  }
+
+  /* The MO is backed by the ramdisk's memory for the file's blocks */
+  mo->ep = ret_msg.msg.mmap.slot;
+  mo->id = ret_msg.msg.mmap.mo_id;
+  mo->size = ROUND_UP(len, RAMDISK_BLOCK_SIZE);
+
+  error = vmr_client_attach_no_reserve(sel4gpi_get_bound_vmr_rde(), NULL, mo,
+                                       SEL4UTILS_RES_TYPE_SHARED_FRAMES, vaddr);
+  if (error)
+  {
+    mo_component_client_disconnect(mo);
+    CHECK_ERROR(error, "failed to attach mapped file range");
+  }
+
+  return 0;
+}
+
+int xv6fs_client_munmap(int fd, uint32_t offset, size_t len, mo_client_context_t *mo, void *vaddr, bool dirty)
+{
+  XV6FS_PRINTF("xv6fs_client_munmap fd %d len %zu offset %u dirty %d\n", fd, len, offset, dirty);
+  int error = 0;
+
   xv6fs_client_context_t *file = fd_get(fd);
   if (file == NULL)
   {
-    XV6FS_PRINTF("xv6fs_libc_pread: Invalid FD provided\n");
+    XV6FS_PRINTF("xv6fs_client_munmap: Invalid FD provided\n");
     return -1;
   }
 
-  // Send IPC to fs server
-  seL4_CPtr caps[1] = {get_xv6fs_client()->shared_mem->ep};
+  gpi_obj_id_t mo_id = mo->id;
+
+  error = vmr_client_delete_by_vaddr(sel4gpi_get_bound_vmr_rde(), vaddr);
+  CHECK_ERROR(error, "failed to unmap mapped file range");
 
+  error = mo_component_client_disconnect(mo);
+  CHECK_ERROR(error, "failed to free mapped file range");
+
+  // The server revokes the MO in any case, and only then releases the blocks
   FsMessage msg = {
       .magic = FS_RPC_MAGIC,
-      .which_msg = FsMessage_read_tag,
-      .msg.read = {
-          .n = count,
+      .which_msg = FsMessage_munmap_tag,
+      .msg.munmap = {
           .offset = offset,
+          .n = len,
+          .dirty = dirty,
+          .mo_id = mo_id,
       }};
 
   FsReturnMessage ret_msg = {0};
 
-  error = sel4gpi_rpc_call(&rpc_client, file->ep,
-                           &msg, 1, caps, &ret_msg);
+  error = sel4gpi_rpc_call(&rpc_client, file->ep, &msg, 0, NULL, &ret_msg);
 
-  if (error || ret_msg.errorCode)
+  // The mapping changed the file without a write, so drop the pages it covers
+  if (dirty && get_xv6fs_client()->cache != NULL)
+  {
+    xv6fs_cache_invalidate(file->id, offset, len);
+  }
+
+  return error || ret_msg.errorCode ? -1 : 0;
+}
+
+static int xv6fs_libc_pread(int fd, void *buf, int count, int offset)
+{
+  XV6FS_PRINTF("xv6fs_libc_read fd %d len %d offset %d\n", fd, count, offset);
+
+  // Check for /dev/null
+  if (fd == dev_null_fd)
   {
     return -1;
   }
 
-  // Copy from shared mem to buf
-  int bytes_read = ret_msg.msg.read.n;
-  if (bytes_read > 0)
+  // Find the file by fd
+  xv6fs_client_context_t *file = fd_get(fd);
+  if (file == NULL)
   {
-    memcpy(buf, get_xv6fs_client()->shared_mem_vaddr, bytes_read);
+    XV6FS_PRINTF("xv6fs_libc_pread: Invalid FD provided\n");
+    return -1;
   }
 
-  return bytes_read;
+  // Serve small reads from the page cache, if it is enabled
+  if (get_xv6fs_client()->cache != NULL && count <= XV6FS_CLIENT_CACHE_MAX_READ * RAMDISK_BLOCK_SIZE)
+  {
+    return xv6fs_cache_pread(file, buf, count, offset);
+  }
+
+  // Reads only take more than one request if they exceed the maximum shared mem size
+  int total = 0;
+  while (total < count)
+  {
+    mo_client_context_t *mo;
+    uint64_t mo_offset;
+    bool copy;
+
+    int n = xv6fs_client_io_mo(buf + total, count - total, &mo, &mo_offset, &copy);
+    if (n < 0)
+    {
+      return -1;
+    }
+
+    int bytes_read = xv6fs_client_read(file, mo, mo_offset, n, offset + total);
+    if (bytes_read <= 0)
+    {
+      return total > 0 ? total : bytes_read;
+    }
+
+    // Copy from shared mem to buf
+    if (copy)
+    {
+      memcpy(buf + total, get_xv6fs_client()->shared_mem_vaddr, bytes_read);
+    }
+
+    total += bytes_read;
+
+    // Stop at the end of the file
+    if (bytes_read < n)
+    {
+      break;
+    }
+  }
+
+  return total;
 }
 
 static int xv6fs_libc_read(int fd, void *buf, int count)
@@ -334,13 +813,6 @@ static int xv6fs_libc_write(int fd, const void *buf, int count)
     return 0;
   }
 
-  if (count > RAMDISK_BLOCK_SIZE)
-  {
-    // (XXX) Arya: Support larger file read/writes
-    XV6FS_PRINTF("Count too large for read\n");
-    return -1;
-  }
-
   // Find the file by fd
   xv6fs_client_context_t *file = fd_get(fd);
   if (file == NULL)
@@ -349,41 +821,76 @@ static int xv6fs_libc_write(int fd, const void *buf, int count)
     return -1;
   }
 
-  // Copy from buf to shared mem
-  if (count > 0)
+  // Writes only take more than one request if they exceed the maximum shared mem size
+  uint64_t start_offset = file->offset;
+  int total = 0;
+  while (total < count)
   {
-    memcpy(get_xv6fs_client()->shared_mem_vaddr, buf, count);
-  }
+    mo_client_context_t *mo;
+    uint64_t mo_offset;
+    bool copy;
 
-  // Send IPC to fs server
-  seL4_CPtr caps[1] = {get_xv6fs_client()->shared_mem->ep};
+    int n = xv6fs_client_io_mo(buf + total, count - total, &mo, &mo_offset, &copy);
+    if (n < 0)
+    {
+      total = total > 0 ? total : -1;
+      break;
+    }
 
-  FsMessage msg = {
-      .magic = FS_RPC_MAGIC,
-      .which_msg = FsMessage_write_tag,
-      .msg.write = {
-          .n = count,
-          .offset = file->offset,
-      }};
+    // Copy from buf to shared mem
+    if (copy)
+    {
+      memcpy(get_xv6fs_client()->shared_mem_vaddr, buf + total, n);
+    }
 
-  FsReturnMessage ret_msg = {0};
+    // Send IPC to fs server
+    seL4_CPtr caps[1] = {mo->ep};
 
-  error = sel4gpi_rpc_call(&rpc_client, file->ep,
-                           &msg, 1, caps, &ret_msg);
+    FsMessage msg = {
+        .magic = FS_RPC_MAGIC,
+        .which_msg = FsMessage_write_tag,
+        .msg.write = {
+            .n = n,
+            .offset = file->offset,
+            .mo_id = mo->id,
+            .mo_offset = mo_offset,
+        }};
 
-  if (error || ret_msg.errorCode)
-  {
-    return -1;
+    FsReturnMessage ret_msg = {0};
+
+    error = sel4gpi_rpc_call(&rpc_client, file->ep,
+                             &msg, 1, caps, &ret_msg);
+
+    if (error || ret_msg.errorCode)
+    {
+      total = total > 0 ? total : -1;
+      break;
+    }
+
+    int bytes_written = ret_msg.msg.write.n;
+    if (bytes_written <= 0)
+    {
+      total = total > 0 ? total : bytes_written;
+      break;
+    }
+
+    // Update file offset
+    file->offset += bytes_written;
+    total += bytes_written;
+
+    if (bytes_written < n)
+    {
+      break;
+    }
   }
 
-  // Update file offset
-  int bytes_written = ret_msg.msg.write.n;
-  if (bytes_written > 0)
+  // Drop cached pages that may have changed, even if the write failed part way
+  if (get_xv6fs_client()->cache != NULL && count > 0)
   {
-    file->offset += bytes_written;
+    xv6fs_cache_invalidate(file->id, start_offset, count);
   }
 
-  return bytes_written;
+  return total;
 }
 
 static int xv6fs_libc_close(int fd)
@@ -424,8 +931,24 @@ static int xv6fs_libc_close(int fd)
   }
 
   // Close the FD locally
+  gpi_obj_id_t file_id = file->id;
   fd_close(fd);
 
+  // Once the file is not held, the server no longer sends invalidations for it
+  if (get_xv6fs_client()->cache != NULL)
+  {
+    bool still_open = false;
+    for (int i = 0; i < FD_TABLE_SIZE; i++)
+    {
+      still_open |= fd_table[i].ep != 0 && fd_table[i].id == file_id;
+    }
+
+    if (!still_open)
+    {
+      xv6fs_cache_invalidate(file_id, 0, 0);
+    }
+  }
+
   return error;
 }
 
@@ -482,13 +1005,27 @@ int xv6fs_libc_fstat(int fd, struct stat *buf)
     return -1;
   }
 
+  // Use the cached result, if the file has not changed since
+  if (get_xv6fs_client()->cache != NULL)
+  {
+    xv6fs_cache_sync();
+
+    if (file->stat_valid)
+    {
+      memcpy(buf, &file->stat, sizeof(struct stat));
+      return 0;
+    }
+  }
+
   // Send IPC to fs server
   seL4_CPtr caps[1] = {get_xv6fs_client()->shared_mem->ep};
 
   FsMessage msg = {
       .magic = FS_RPC_MAGIC,
       .which_msg = FsMessage_stat_tag,
-  };
+      .msg.stat = {
+          .mo_id = get_xv6fs_client()->shared_mem->id,
+      }};
 
   FsReturnMessage ret_msg = {0};
 
@@ -503,6 +1040,12 @@ int xv6fs_libc_fstat(int fd, struct stat *buf)
   // Copy from shared mem to buf
   memcpy(buf, get_xv6fs_client()->shared_mem_vaddr, sizeof(struct stat));
 
+  if (get_xv6fs_client()->cache != NULL)
+  {
+    memcpy(&file->stat, buf, sizeof(struct stat));
+    file->stat_valid = true;
+  }
+
   return 0;
 }
 
@@ -5,14 +5,24 @@
 // in memory reduces the number of disk reads and also provides
 // a synchronization point for disk blocks used by multiple processes.
 //
+// Buffers are also chained into a hash table by block number,
+// so a lookup does not walk the whole list. The number of buffers
+// is chosen at startup from the memory available to the server.
+//
 // Interface:
 // * To get a buffer for a particular disk block, call bread.
-// * After changing buffer data, call bwrite to write it to disk.
+// * After changing buffer data, call bwrite to write it to disk,
+//     or bdirty to write it when the buffer is recycled.
 // * When done with the buffer, call brelse.
 // * Do not use the buffer after calling brelse.
 // * Only one process at a time can use a buffer,
 //     so do not keep them longer than necessary.
+// * To read blocks ahead of a sequential reader, call bprefetch.
+// * Before handing a block's disk memory to someone else, call bflush,
+//     write it through with bwrite while they have it,
+//     and call binval before reading it after they may have changed it.
 
+#include <stdlib.h>
 #include <defs.h>
 #include <spinlock.h>
 #include <sleeplock.h>
@@ -23,7 +33,12 @@
 struct
 {
   struct spinlock lock;
-  struct buf buf[NBUF];
+  struct buf *buf;
+  uint32_t nbuf;
+
+  // Hash chains of buffers through hnext, indexed by blockno % nbucket.
+  struct buf **bucket;
+  uint32_t nbucket;
 
   // Linked list of all buffers, through prev/next.
   // Sorted by how recently the buffer was used.
@@ -31,17 +46,108 @@ struct
   struct buf head;
 } bcache;
 
+static inline struct buf **
+bbucket(uint32_t blockno)
+{
+  return &bcache.bucket[blockno % bcache.nbucket];
+}
+
+static void
+bhash_remove(struct buf *b)
+{
+  struct buf **p;
+
+  for (p = bbucket(b->blockno); *p != 0; p = &(*p)->hnext)
+  {
+    if (*p == b)
+    {
+      *p = b->hnext;
+      return;
+    }
+  }
+}
+
+static struct buf *
+bhash_find(uint32_t dev, uint32_t blockno)
+{
+  struct buf *b;
+
+  for (b = *bbucket(blockno); b != 0; b = b->hnext)
+  {
+    if (b->dev == dev && b->blockno == blockno)
+      return b;
+  }
+  return 0;
+}
+
+// Move a buffer to the head of the most-recently-used list.
+static void
+bmru(struct buf *b)
+{
+  b->next->prev = b->prev;
+  b->prev->next = b->next;
+  b->next = bcache.head.next;
+  b->prev = &bcache.head;
+  bcache.head.next->prev = b;
+  bcache.head.next = b;
+}
+
+// Recycle the least recently used (LRU) unused buffer for a block.
+// Caller must hold bcache.lock. Returns 0 if every buffer is in use.
+static struct buf *
+brecycle(uint32_t dev, uint32_t blockno)
+{
+  struct buf *b;
+
+  for (b = bcache.head.prev; b != &bcache.head; b = b->prev)
+  {
+    if (b->refcnt == 0)
+    {
+      if (b->dirty)
+      {
+        disk_rw(b, 1);
+        b->dirty = 0;
+      }
+      if (b->blockno != NOBLOCK)
+        bhash_remove(b);
+
+      b->dev = dev;
+      b->blockno = blockno;
+      b->valid = 0;
+      b->refcnt = 1;
+      b->hnext = *bbucket(blockno);
+      *bbucket(blockno) = b;
+      return b;
+    }
+  }
+  return 0;
+}
+
 void binit(void)
 {
   struct buf *b;
+  uint8_t *data;
 
   initlock(&bcache.lock, "bcache");
 
+  // Caching more blocks than the file system holds would waste memory
+  bcache.nbuf = disk_alloc_cache(NBUF_MAX < FS_SIZE ? NBUF_MAX : FS_SIZE, (void **)&data);
+  if (bcache.nbuf < NBUF)
+    xv6fs_panic("binit: no memory for buffers");
+
+  bcache.nbucket = bcache.nbuf;
+  bcache.buf = calloc(bcache.nbuf, sizeof(struct buf));
+  bcache.bucket = calloc(bcache.nbucket, sizeof(struct buf *));
+  if (bcache.buf == 0 || bcache.bucket == 0)
+    xv6fs_panic("binit: no memory for buffer headers");
+
   // Create linked list of buffers
   bcache.head.prev = &bcache.head;
   bcache.head.next = &bcache.head;
-  for (b = bcache.buf; b < bcache.buf + NBUF; b++)
+  for (b = bcache.buf; b < bcache.buf + bcache.nbuf; b++)
   {
+    b->data = data + (b - bcache.buf) * BSIZE;
+    b->blockno = NOBLOCK;
     b->next = bcache.head.next;
     b->prev = &bcache.head;
     initsleeplock(&b->lock, "buffer");
@@ -61,35 +167,64 @@ bget(uint32_t dev, uint32_t blockno)
   acquire(&bcache.lock);
 
   // Is the block already cached?
-  for (b = bcache.head.next; b != &bcache.head; b = b->next)
+  b = bhash_find(dev, blockno);
+  if (b != 0)
   {
-    if (b->dev == dev && b->blockno == blockno)
-    {
-      b->refcnt++;
-      release(&bcache.lock);
-      acquiresleep(&b->lock);
-      return b;
-    }
+    b->refcnt++;
+    release(&bcache.lock);
+    acquiresleep(&b->lock);
+    return b;
   }
 
   // Not cached.
-  // Recycle the least recently used (LRU) unused buffer.
-  for (b = bcache.head.prev; b != &bcache.head; b = b->prev)
+  b = brecycle(dev, blockno);
+  if (b != 0)
   {
-    if (b->refcnt == 0)
-    {
-      b->dev = dev;
-      b->blockno = blockno;
-      b->valid = 0;
-      b->refcnt = 1;
-      release(&bcache.lock);
-      acquiresleep(&b->lock);
-      return b;
-    }
+    release(&bcache.lock);
+    acquiresleep(&b->lock);
+    return b;
   }
   xv6fs_panic("bget: no buffers");
 }
 
+// Read blocks that are not cached yet into unused buffers,
+// with a single disk request. Blocks that are already cached,
+// and blocks beyond the number of unused buffers, are skipped.
+void bprefetch(uint32_t dev, uint32_t *blocknos, int n)
+{
+  struct buf *bufs[READAHEAD_BLOCKS];
+  struct buf *b;
+  int nread = 0;
+
+  acquire(&bcache.lock);
+  for (int i = 0; i < n && nread < READAHEAD_BLOCKS; i++)
+  {
+    if (blocknos[i] == 0 || bhash_find(dev, blocknos[i]) != 0)
+      continue;
+
+    b = brecycle(dev, blocknos[i]);
+    if (b == 0)
+      break;
+    bufs[nread++] = b;
+  }
+  release(&bcache.lock);
+
+  if (nread == 0)
+    return;
+
+  for (int i = 0; i < nread; i++)
+    acquiresleep(&bufs[i]->lock);
+
+  // On failure the buffers stay invalid, and bread reads them again
+  int valid = disk_readv(bufs, nread) == 0;
+
+  for (int i = 0; i < nread; i++)
+  {
+    bufs[i]->valid = valid;
+    brelse(bufs[i]);
+  }
+}
+
 // Return a locked buf with the contents of the indicated block.
 struct buf *
 bread(uint32_t dev, uint32_t blockno)
@@ -111,6 +246,54 @@ void bwrite(struct buf *b)
   if (!holdingsleep(&b->lock))
     xv6fs_panic("bwrite");
   disk_rw(b, 1);
+  b->dirty = 0;
+}
+
+// Mark b's contents as changed, to be written to disk
+// before the buffer is recycled. Must be locked.
+void bdirty(struct buf *b)
+{
+  if (!holdingsleep(&b->lock))
+    xv6fs_panic("bdirty");
+  b->dirty = 1;
+}
+
+// Write a cached block to disk if it has unwritten changes.
+void bflush(uint32_t dev, uint32_t blockno)
+{
+  struct buf *b;
+
+  acquire(&bcache.lock);
+  b = bhash_find(dev, blockno);
+  if (b == 0 || !b->dirty)
+  {
+    release(&bcache.lock);
+    return;
+  }
+  b->refcnt++;
+  release(&bcache.lock);
+
+  acquiresleep(&b->lock);
+  bwrite(b);
+  brelse(b);
+}
+
+// Drop the cached contents of a block that may have been changed on disk
+// without going through the cache, so the next bread reads it again.
+// A dirty buffer is newer than the disk, so it is kept.
+void binval(uint32_t dev, uint32_t blockno)
+{
+  struct buf *b;
+
+  acquire(&bcache.lock);
+  b = bhash_find(dev, blockno);
+  if (b != 0 && !b->dirty)
+  {
+    if (b->refcnt != 0)
+      xv6fs_panic("binval");
+    b->valid = 0;
+  }
+  release(&bcache.lock);
 }
 
 // Release a locked buffer.
@@ -127,12 +310,7 @@ void brelse(struct buf *b)
   if (b->refcnt == 0)
   {
     // no one is waiting for it.
-    b->next->prev = b->prev;
-    b->prev->next = b->next;
-    b->next = bcache.head.next;
-    b->prev = &bcache.head;
-    bcache.head.next->prev = b;
-    bcache.head.next = b;
+    bmru(b);
   }
 
   release(&bcache.lock);
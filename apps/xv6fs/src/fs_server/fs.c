@@ -21,6 +21,7 @@
 #include <file.h>
 
 #define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
 // there should be one superblock per disk device, but we run with
 // only one device
 struct superblock sb;
@@ -53,6 +54,7 @@ xv6fs_bzero(int dev, int bno)
 
   bp = bread(dev, bno);
   memset(bp->data, 0, BSIZE);
+  bdirty(bp);
   brelse(bp);
 }
 
@@ -84,6 +86,7 @@ balloc(uint32_t dev)
       if ((bp->data[bi / 8] & m) == 0)
       {                        // Is block free?
         bp->data[bi / 8] |= m; // Mark block in use.
+        bdirty(bp);
         brelse(bp);
         xv6fs_bzero(dev, b + bi);
         return b + bi;
@@ -108,6 +111,7 @@ bfree(int dev, uint32_t b)
   if ((bp->data[bi / 8] & m) == 0)
     xv6fs_panic("freeing free block");
   bp->data[bi / 8] &= ~m;
+  bdirty(bp);
   brelse(bp);
 }
 
@@ -218,6 +222,7 @@ ialloc(uint32_t dev, short type)
     { // a free inode
       memset(dip, 0, sizeof(*dip));
       dip->type = type;
+      bdirty(bp);
       brelse(bp);
       return iget(dev, inum);
     }
@@ -244,6 +249,7 @@ void iupdate(struct inode *ip)
   dip->nlink = ip->nlink;
   dip->size = ip->size;
   memmove(dip->addrs, ip->addrs, sizeof(ip->addrs));
+  bdirty(bp);
   brelse(bp);
 }
 
@@ -280,6 +286,9 @@ iget(uint32_t dev, uint32_t inum)
   ip->inum = inum;
   ip->ref = 1;
   ip->valid = 0;
+  ip->ra_next = 0;
+  ip->ra_end = 0;
+  ip->nmap = 0;
   release(&itable.lock);
 
   return ip;
@@ -381,102 +390,207 @@ void iunlockput(struct inode *ip)
 // The content (data) associated with each inode is stored
 // in blocks on the disk. The first NDIRECT block numbers
 // are listed in ip->addrs[].  The next NINDIRECT blocks are
-// listed in block ip->addrs[NDIRECT].
+// listed in block ip->addrs[NDIRECT].  The next NDINDIRECT
+// blocks are listed in the NINDIRECT blocks that are listed
+// in block ip->addrs[NDIRECT + 1].
 
-// Return the disk block address of the nth block in inode ip.
-// If there is no such block, bmap allocates one.
-// returns 0 if out of disk space.
+// Return the address in *slot, allocating a block
+// for it if it is empty and alloc is set.
+// returns 0 if there is no block.
 static uint32_t
-bmap(struct inode *ip, uint32_t bn)
+bmap_slot(struct inode *ip, uint32_t *slot, int alloc)
 {
-  uint32_t addr, *a;
-  struct buf *bp;
+  uint32_t addr = *slot;
 
-  if (bn < NDIRECT)
+  if (addr == 0 && alloc)
   {
-    if ((addr = ip->addrs[bn]) == 0)
-    {
-      addr = balloc(ip->dev);
-      map_file_to_block(ip->inum, addr);
-
-      if (addr == 0)
-        return 0;
-      ip->addrs[bn] = addr;
-    }
-    return addr;
+    addr = balloc(ip->dev);
+    map_file_to_block(ip->inum, addr);
+    *slot = addr;
   }
+  return addr;
+}
+
+// Return the address in entry idx of the pointer block
+// at addr, allocating a block for the entry if it is
+// empty and alloc is set.
+// returns 0 if there is no block.
+static uint32_t
+bmap_ptr(struct inode *ip, uint32_t addr, uint32_t idx, int alloc)
+{
+  struct buf *bp;
+  uint32_t *a;
+
+  if (addr == 0)
+    return 0;
+
+  bp = bread(ip->dev, addr);
+  a = (uint32_t *)bp->data;
+  if (a[idx] == 0 && alloc && bmap_slot(ip, &a[idx], alloc) != 0)
+    bdirty(bp);
+  addr = a[idx];
+  brelse(bp);
+  return addr;
+}
+
+static uint32_t
+bmap_lookup(struct inode *ip, uint32_t bn, int alloc)
+{
+  uint32_t addr;
+
+  if (bn < NDIRECT)
+    return bmap_slot(ip, &ip->addrs[bn], alloc);
   bn -= NDIRECT;
 
   if (bn < NINDIRECT)
   {
     // Load indirect block, allocating if necessary.
-    if ((addr = ip->addrs[NDIRECT]) == 0)
-    {
-      addr = balloc(ip->dev);
-      map_file_to_block(ip->inum, addr);
+    addr = bmap_slot(ip, &ip->addrs[NDIRECT], alloc);
+    return bmap_ptr(ip, addr, bn, alloc);
+  }
+  bn -= NINDIRECT;
 
-      if (addr == 0)
-        return 0;
-      ip->addrs[NDIRECT] = addr;
-    }
-    bp = bread(ip->dev, addr);
-    a = (uint32_t *)bp->data;
-    if ((addr = a[bn]) == 0)
-    {
-      addr = balloc(ip->dev);
-      map_file_to_block(ip->inum, addr);
-      
-      if (addr)
-      {
-        a[bn] = addr;
-      }
-    }
-    brelse(bp);
-    return addr;
+  if (bn < NDINDIRECT)
+  {
+    // Load double-indirect block, then the indirect block it points to.
+    addr = bmap_slot(ip, &ip->addrs[NDIRECT + 1], alloc);
+    addr = bmap_ptr(ip, addr, bn / NINDIRECT, alloc);
+    return bmap_ptr(ip, addr, bn % NINDIRECT, alloc);
   }
 
   xv6fs_panic("bmap: out of range");
 }
 
+// Return the disk block address of the nth block in inode ip.
+// If there is no such block, bmap allocates one.
+// returns 0 if out of disk space.
+static uint32_t
+bmap(struct inode *ip, uint32_t bn)
+{
+  return bmap_lookup(ip, bn, 1);
+}
+
 // Return the disk block address of the nth block in inode ip.
 // If there is no such block, returns 0
 uint32_t
 bmap_noalloc(struct inode *ip, uint32_t bn)
 {
-  uint32_t addr, *a;
+  return bmap_lookup(ip, bn, 0);
+}
+
+// A run of file blocks stored in consecutive disk blocks
+struct bextent
+{
+  uint32_t bn;   // first file block of the run
+  uint32_t addr; // disk block of the first file block
+  uint32_t len;  // number of blocks in the run
+};
+
+// Return the length of the run of consecutive disk blocks
+// in entries idx.. of the address array a of len entries,
+// at most max, and set *addr to the first one.
+static uint32_t
+extent_in(uint32_t *a, uint32_t idx, uint32_t len, uint32_t max, uint32_t *addr)
+{
+  uint32_t n;
+
+  *addr = a[idx];
+  if (*addr == 0)
+    return 0;
+  for (n = 1; n < max && idx + n < len && a[idx + n] == *addr + n; n++)
+    ;
+  return n;
+}
+
+// Resolve the run of file blocks from the nth block of
+// inode ip that are stored in consecutive disk blocks.
+// Sets *addr to the disk block of the nth block and returns
+// the length of the run, at most max. Does not allocate.
+// returns 0 if there is no such block.
+uint32_t
+bmap_extent(struct inode *ip, uint32_t bn, uint32_t max, uint32_t *addr)
+{
   struct buf *bp;
+  uint32_t ptr, n;
 
   if (bn < NDIRECT)
-  {
-    return ip->addrs[bn];
-  }
+    return extent_in(ip->addrs, bn, NDIRECT, max, addr);
   bn -= NDIRECT;
 
   if (bn < NINDIRECT)
   {
-    // Load indirect block, allocating if necessary.
-    if ((addr = ip->addrs[NDIRECT]) == 0)
-    {
-      // No indirect block
-      return 0;
-    }
-    bp = bread(ip->dev, addr);
-    a = (uint32_t *)bp->data;
-    addr = a[bn];
-    brelse(bp);
-    return addr;
+    ptr = ip->addrs[NDIRECT];
+  }
+  else if (bn - NINDIRECT < NDINDIRECT)
+  {
+    bn -= NINDIRECT;
+    ptr = bmap_ptr(ip, ip->addrs[NDIRECT + 1], bn / NINDIRECT, 0);
+    bn %= NINDIRECT;
+  }
+  else
+  {
+    xv6fs_panic("bmap_extent: out of range");
   }
 
-  xv6fs_panic("bmap_noalloc: out of range");
+  *addr = 0;
+  if (ptr == 0)
+    return 0;
+
+  bp = bread(ip->dev, ptr);
+  n = extent_in((uint32_t *)bp->data, bn, NINDIRECT, max, addr);
+  brelse(bp);
+  return n;
+}
+
+// Return the disk block address of the nth block in inode ip,
+// allocating it if there is none. Resolves the run of
+// consecutive disk blocks from bn up to (not including) the
+// end block at once and keeps it in ext, so later blocks of
+// the run need no pointer block lookups.
+// returns 0 if out of disk space.
+static uint32_t
+bmap_run(struct inode *ip, struct bextent *ext, uint32_t bn, uint32_t end)
+{
+  if (bn < ext->bn || bn >= ext->bn + ext->len)
+  {
+    ext->bn = bn;
+    ext->len = bmap_extent(ip, bn, end - bn, &ext->addr);
+    if (ext->len == 0)
+      return bmap(ip, bn);
+  }
+  return ext->addr + (bn - ext->bn);
+}
+
+// Free the blocks listed in the pointer block at addr,
+// and the pointer block itself. If depth is 2, the listed
+// blocks are pointer blocks themselves.
+static void
+bfree_ptr(struct inode *ip, uint32_t addr, int depth)
+{
+  struct buf *bp;
+  uint32_t *a;
+  int j;
+
+  bp = bread(ip->dev, addr);
+  a = (uint32_t *)bp->data;
+  for (j = 0; j < NINDIRECT; j++)
+  {
+    if (a[j] == 0)
+      continue;
+    if (depth > 1)
+      bfree_ptr(ip, a[j], depth - 1);
+    else
+      bfree(ip->dev, a[j]);
+  }
+  brelse(bp);
+  bfree(ip->dev, addr);
 }
 
 // Truncate inode (discard contents).
 // Caller must hold ip->lock.
 void itrunc(struct inode *ip)
 {
-  int i, j;
-  struct buf *bp;
-  uint32_t *a;
+  int i;
 
   for (i = 0; i < NDIRECT; i++)
   {
@@ -489,19 +603,20 @@ void itrunc(struct inode *ip)
 
   if (ip->addrs[NDIRECT])
   {
-    bp = bread(ip->dev, ip->addrs[NDIRECT]);
-    a = (uint32_t *)bp->data;
-    for (j = 0; j < NINDIRECT; j++)
-    {
-      if (a[j])
-        bfree(ip->dev, a[j]);
-    }
-    brelse(bp);
-    bfree(ip->dev, ip->addrs[NDIRECT]);
+    bfree_ptr(ip, ip->addrs[NDIRECT], 1);
     ip->addrs[NDIRECT] = 0;
   }
 
+  if (ip->addrs[NDIRECT + 1])
+  {
+    bfree_ptr(ip, ip->addrs[NDIRECT + 1], 2);
+    ip->addrs[NDIRECT + 1] = 0;
+  }
+
   ip->size = 0;
+  // Read-ahead state describes blocks that no longer exist
+  ip->ra_next = 0;
+  ip->ra_end = 0;
   iupdate(ip);
 }
 
@@ -543,6 +658,46 @@ void stati(struct inode *ip, struct stat *st)
   st->st_mtim.tv_sec = ip->mtime;
 }
 
+// If a read of n bytes at off continues the previous read
+// of the inode, prefetch the blocks that follow it in batches
+// of READAHEAD_BLOCKS, starting a new batch when the reader
+// is halfway through the previous one.
+// Caller must hold ip->lock.
+static void readahead(struct inode *ip, uint32_t off, uint32_t n)
+{
+  uint32_t blocknos[READAHEAD_BLOCKS];
+  uint32_t first = off / BSIZE;
+  uint32_t last = (off + n - 1) / BSIZE;
+  uint32_t end = (ip->size + BSIZE - 1) / BSIZE;
+  int sequential = first == ip->ra_next || first + 1 == ip->ra_next;
+  int nblocks = 0;
+  uint32_t bn, addr, run;
+
+  ip->ra_next = last + 1;
+  if (!sequential)
+  {
+    ip->ra_end = 0;
+    return;
+  }
+  if (last + READAHEAD_BLOCKS / 2 < ip->ra_end)
+    return;
+
+  if (end > MAXFILE)
+    end = MAXFILE;
+  for (bn = max(last + 1, ip->ra_end); bn < end && nblocks < READAHEAD_BLOCKS; bn += max(run, 1))
+  {
+    run = bmap_extent(ip, bn, min(end - bn, READAHEAD_BLOCKS - nblocks), &addr);
+    if (run == 0)
+      blocknos[nblocks++] = 0;
+    for (uint32_t i = 0; i < run; i++)
+      blocknos[nblocks++] = addr + i;
+  }
+  ip->ra_end = bn;
+
+  if (nblocks > 0)
+    bprefetch(ip->dev, blocknos, nblocks);
+}
+
 // Read data from inode.
 // Caller must hold ip->lock.
 // If user_dst==1, then dst is a user virtual address;
@@ -550,18 +705,25 @@ void stati(struct inode *ip, struct stat *st)
 int readi(struct inode *ip, int user_dst, uint64_t dst, uint32_t off, uint32_t n)
 {
   uint32_t tot, m;
+  struct bextent ext = {0};
   struct buf *bp;
 
   if (off > ip->size || off + n < off)
     return 0;
   if (off + n > ip->size)
     n = ip->size - off;
+  // Read-ahead of mapped blocks would be dropped before it is used
+  if (n > 0 && ip->nmap == 0)
+    readahead(ip, off, n);
 
   for (tot = 0; tot < n; tot += m, off += m, dst += m)
   {
-    uint32_t addr = bmap(ip, off / BSIZE);
+    uint32_t addr = bmap_run(ip, &ext, off / BSIZE, (off + n - tot - 1) / BSIZE + 1);
     if (addr == 0)
       break;
+    // Clients may have changed mapped blocks on disk
+    if (ip->nmap > 0)
+      binval(ip->dev, addr);
     bp = bread(ip->dev, addr);
     m = min(n - tot, BSIZE - off % BSIZE);
     memmove((char *)dst, bp->data + (off % BSIZE), m);
@@ -580,6 +742,7 @@ int readi(struct inode *ip, int user_dst, uint64_t dst, uint32_t off, uint32_t n
 int writei(struct inode *ip, int user_src, uint64_t src, uint32_t off, uint32_t n)
 {
   uint32_t tot, m;
+  struct bextent ext = {0};
   struct buf *bp;
 
   if (off > ip->size || off + n < off)
@@ -589,12 +752,20 @@ int writei(struct inode *ip, int user_src, uint64_t src, uint32_t off, uint32_t
 
   for (tot = 0; tot < n; tot += m, off += m, src += m)
   {
-    uint32_t addr = bmap(ip, off / BSIZE);
+    uint32_t addr = bmap_run(ip, &ext, off / BSIZE, (off + n - tot - 1) / BSIZE + 1);
     if (addr == 0)
       break;
+    // Mapped blocks are written through, so clients see the write
+    // and a later eviction cannot overwrite what they stored
+    if (ip->nmap > 0)
+      binval(ip->dev, addr);
     bp = bread(ip->dev, addr);
     m = min(n - tot, BSIZE - off % BSIZE);
     memmove(bp->data + (off % BSIZE), (void *)src, m);
+    if (ip->nmap > 0)
+      bwrite(bp);
+    else
+      bdirty(bp);
     brelse(bp);
   }
 
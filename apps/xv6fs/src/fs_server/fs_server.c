@@ -17,6 +17,7 @@
 #include <sel4gpi/ads_clientapi.h>
 #include <sel4gpi/vmr_clientapi.h>
 #include <sel4gpi/pd_clientapi.h>
+#include <sel4gpi/mo_clientapi.h>
 #include <sel4gpi/resource_server_utils.h>
 #include <sel4gpi/resource_space_clientapi.h>
 #include <sel4gpi/error_handle.h>
@@ -147,6 +148,8 @@ err_goto:
   ZF_LOGF("xv6fs Server: Failed to delete file %u\n", inum);
 }
 
+static void mapping_registry_entry_on_delete(resource_registry_node_t *node_gen, void *arg);
+
 /*--- XV6FS SERVER ---*/
 static xv6fs_server_context_t xv6fs_server;
 
@@ -157,19 +160,17 @@ xv6fs_server_context_t *get_xv6fs_server(void)
 
 /**
  * Initializes the file system by requesting
- * every block ahead of time, and using them later for read/write requests
+ * every block ahead of time as one extent, and using it later for read/write requests
  */
 static int init_blocks()
 {
   int error;
   seL4_CPtr ramdisk_ep = get_xv6fs_server()->rd_ep;
 
-  for (int i = 0; i < FS_SIZE; i++)
-  {
-    error = ramdisk_client_alloc_block(ramdisk_ep,
-                                       &get_xv6fs_server()->blocks[i]);
-    CHECK_ERROR(error, "failed to alloc a block from ramdisk");
-  }
+  error = ramdisk_client_alloc_extent(ramdisk_ep,
+                                      FS_SIZE,
+                                      &get_xv6fs_server()->disk);
+  CHECK_ERROR(error, "failed to alloc the disk extent from ramdisk");
 
   return 0;
 }
@@ -247,24 +248,25 @@ int xv6fs_init()
   xv6fs_server_context_t *server = get_xv6fs_server();
   int error;
 
-  /* Allocate the shared memory object used to communicate with the ramdisk*/
+  /* Allocate the shared memory object used to communicate with the ramdisk,
+     large enough for one batch of read-ahead blocks */
   server->shared_mem = malloc(sizeof(mo_client_context_t));
 
   error = mo_component_client_connect(server->gen.mo_ep,
-                                      1,
+                                      READAHEAD_BLOCKS,
                                       MO_PAGE_BITS,
                                       server->shared_mem);
-  CHECK_ERROR(error, "failed to allocate shared mem page");
+  CHECK_ERROR(error, "failed to allocate shared mem pages");
 
   error = vmr_client_attach_no_reserve(server->gen.vmr_rde,
                                        NULL,
                                        server->shared_mem,
                                        SEL4UTILS_RES_TYPE_SHARED_FRAMES,
                                        &server->shared_mem_vaddr);
-  CHECK_ERROR(error, "failed to map shared mem page");
+  CHECK_ERROR(error, "failed to map shared mem pages");
 
   /* Initialize connection with ramdisk */
-  error = ramdisk_client_bind(get_xv6fs_server()->rd_ep, server->shared_mem);
+  error = ramdisk_client_bind(get_xv6fs_server()->rd_ep, server->shared_mem, READAHEAD_BLOCKS);
   CHECK_ERROR(error, "failed to bind shared mem page");
 
   /* Map the file space to the block space */
@@ -287,12 +289,91 @@ int xv6fs_init()
                                NULL, BADGE_OBJ_ID_NULL - 1);
   resource_registry_initialize(&get_xv6fs_server()->ns_registry, ns_registry_entry_on_delete,
                                NULL, BADGE_SPACE_ID_NULL - 1);
+  resource_registry_initialize(&get_xv6fs_server()->mapping_registry, mapping_registry_entry_on_delete,
+                               NULL, BADGE_OBJ_ID_NULL - 1);
 
   XV6FS_PRINTF("Initialized file system\n");
 
   return error;
 }
 
+/**
+ * Tells PDs that cache a file, other than the one that wrote it, that its contents changed
+ * The file resource exists in the global namespace, and in the namespace it was written through
+ */
+static int xv6fs_invalidate_file(gpi_obj_id_t file_id, gpi_space_id_t ns_id, gpi_obj_id_t writer_id)
+{
+  resource_server_context_t *gen = &get_xv6fs_server()->gen;
+
+  // No PD caches resources, skip the RPCs
+  if (sel4gpi_get_shared_data()->n_invalidation_pds == 0)
+  {
+    return 0;
+  }
+
+  int error = pd_client_invalidate(&gen->pd_conn, make_res_id(gen->resource_type, gen->default_space.id, file_id),
+                                   writer_id);
+
+  if (!error && ns_id != gen->default_space.id)
+  {
+    error = pd_client_invalidate(&gen->pd_conn, make_res_id(gen->resource_type, ns_id, file_id), writer_id);
+  }
+
+  return error;
+}
+
+static void mapping_registry_entry_on_delete(resource_registry_node_t *node_gen, void *arg)
+{
+  fs_mapping_entry_t *node = (fs_mapping_entry_t *)node_gen;
+  gpi_obj_id_t client_mo_id = (gpi_obj_id_t)node->gen.object_id;
+
+  // Take the blocks back from the client, whether or not it unmapped them itself
+  int error = mo_component_client_revoke_slice(&node->disk_mo, client_mo_id);
+  if (error)
+  {
+    // The client may still write the blocks, so keep them allocated rather than risk reusing them
+    ZF_LOGE(XV6FS_S "Failed to revoke MO (%u) from client (%u), its blocks stay allocated\n",
+            client_mo_id, node->client_id);
+    return;
+  }
+
+  error = mo_component_client_disconnect(&node->disk_mo);
+  WARN_IF_COND(error, "Failed to release the ramdisk MO for mapped blocks\n");
+
+  // If the client wrote to the ramdisk directly, cached copies are stale
+  xv6fs_sys_unmap_blocks(node->ip, node->offset, node->n, node->dirty);
+
+  if (node->dirty)
+  {
+    error = xv6fs_invalidate_file(node->file_id, node->ns_id, node->client_id);
+    WARN_IF_COND(error, "Failed to invalidate cached copies of file (%u)\n", node->file_id);
+  }
+}
+
+/**
+ * Unmaps the file ranges mapped into a client, for a client or file that is going away
+ * The client may have written the blocks, so the ranges are treated as dirty
+ *
+ * @param client_id the client to unmap ranges from, or BADGE_OBJ_ID_NULL for all clients
+ * @param file_id the file to unmap ranges of, or BADGE_OBJ_ID_NULL for all files
+ */
+static void release_mappings(gpi_obj_id_t client_id, gpi_obj_id_t file_id)
+{
+  resource_registry_node_t *curr, *tmp;
+  HASH_ITER(hh, get_xv6fs_server()->mapping_registry.head, curr, tmp)
+  {
+    fs_mapping_entry_t *mapping = (fs_mapping_entry_t *)curr;
+
+    if ((client_id == BADGE_OBJ_ID_NULL || mapping->client_id == client_id) &&
+        (file_id == BADGE_OBJ_ID_NULL || mapping->file_id == file_id))
+    {
+      XV6FS_PRINTF("Release mapping of file (%u) in client (%u)\n", mapping->file_id, mapping->client_id);
+      mapping->dirty = true;
+      resource_registry_delete(&get_xv6fs_server()->mapping_registry, curr);
+    }
+  }
+}
+
 void xv6fs_request_handler(void *msg_p,
                            void *msg_reply_p,
                            seL4_Word sender_badge,
@@ -300,6 +381,7 @@ void xv6fs_request_handler(void *msg_p,
 {
   int error = 0;
   void *mo_vaddr;
+  size_t mo_size;
   *need_new_recv_cap = false;
   FsMessage *msg = (FsMessage *)msg_p;
   FsReturnMessage *reply_msg = (FsReturnMessage *)msg_reply_p;
@@ -453,6 +535,7 @@ void xv6fs_request_handler(void *msg_p,
       // Set the reply
       reply_msg->which_msg = FsReturnMessage_create_tag;
       reply_msg->msg.create.slot = dest;
+      reply_msg->msg.create.file_id = file->id;
       break;
     case FsMessage_link_tag:
       CHECK_ERROR_GOTO(!sel4gpi_rpc_check_cap(get_xv6fs_server()->gen.resource_type),
@@ -567,18 +650,18 @@ void xv6fs_request_handler(void *msg_p,
       int n_bytes_to_read = msg->msg.read.n;
       int offset = msg->msg.read.offset;
 
-      /* Attach memory object to server ADS */
-      error = resource_server_attach_mo(&get_xv6fs_server()->gen, cap, &mo_vaddr);
+      /* Get the client's memory object in the server ADS, it stays attached for later requests */
+      error = resource_server_attach_client_mo(&get_xv6fs_server()->gen, client_id, msg->msg.read.mo_id,
+                                               cap, &mo_vaddr, &mo_size);
       CHECK_ERROR_GOTO(error, "Failed to attach MO", error, done);
+      CHECK_ERROR_GOTO(n_bytes_to_read < 0 || msg->msg.read.mo_offset > mo_size ||
+                           (uint64_t)n_bytes_to_read > mo_size - msg->msg.read.mo_offset,
+                       "Read does not fit in the client's MO", FsError_UNKNOWN, done);
 
       // Perform file read
-      int n_bytes_ret = xv6fs_sys_read(reg_entry->file, mo_vaddr, n_bytes_to_read, offset);
+      int n_bytes_ret = xv6fs_sys_read(reg_entry->file, mo_vaddr + msg->msg.read.mo_offset, n_bytes_to_read, offset);
       XV6FS_PRINTF("Read %d bytes from file\n", n_bytes_ret);
 
-      // Unattach the MO
-      error = resource_server_unattach(&get_xv6fs_server()->gen, mo_vaddr);
-      CHECK_ERROR_GOTO(error, "Failed to unattach MO", error, done);
-
       reply_msg->which_msg = FsReturnMessage_read_tag;
       reply_msg->msg.read.n = n_bytes_ret;
       break;
@@ -588,21 +671,115 @@ void xv6fs_request_handler(void *msg_p,
       n_bytes_to_read = msg->msg.write.n;
       offset = msg->msg.write.offset;
 
-      /* Attach memory object to server ADS */
-      error = resource_server_attach_mo(&get_xv6fs_server()->gen, cap, &mo_vaddr);
+      /* Get the client's memory object in the server ADS, it stays attached for later requests */
+      error = resource_server_attach_client_mo(&get_xv6fs_server()->gen, client_id, msg->msg.write.mo_id,
+                                               cap, &mo_vaddr, &mo_size);
       CHECK_ERROR_GOTO(error, "Failed to attach MO", error, done);
+      CHECK_ERROR_GOTO(n_bytes_to_read < 0 || msg->msg.write.mo_offset > mo_size ||
+                           (uint64_t)n_bytes_to_read > mo_size - msg->msg.write.mo_offset,
+                       "Write does not fit in the client's MO", FsError_UNKNOWN, done);
 
       // Perform file write
-      n_bytes_ret = xv6fs_sys_write(reg_entry->file, mo_vaddr, n_bytes_to_read, offset);
+      n_bytes_ret = xv6fs_sys_write(reg_entry->file, mo_vaddr + msg->msg.write.mo_offset, n_bytes_to_read, offset);
       XV6FS_PRINTF("Wrote %d bytes to file\n", n_bytes_ret);
 
-      // Unattach the MO
-      error = resource_server_unattach(&get_xv6fs_server()->gen, mo_vaddr);
-      CHECK_ERROR_GOTO(error, "Failed to unattach MO", error, done);
+      if (n_bytes_ret > 0)
+      {
+        // Failing to notify other clients should not fail the write itself
+        int invalidate_error = xv6fs_invalidate_file(reg_entry->file->id, ns_id, client_id);
+        WARN_IF_COND(invalidate_error, "Failed to invalidate cached copies of file (%u)\n", reg_entry->file->id);
+      }
 
       reply_msg->which_msg = FsReturnMessage_write_tag;
       reply_msg->msg.write.n = n_bytes_ret;
       break;
+    case FsMessage_mmap_tag:
+      XV6FS_PRINTF("Map %u bytes at offset %u of file (%u)\n", msg->msg.mmap.n, msg->msg.mmap.offset,
+                   reg_entry->file->id);
+
+      uint32_t blocknos[RAMDISK_MAX_VECTOR_BLOCKS];
+      CHECK_ERROR_GOTO(msg->msg.mmap.n > RAMDISK_MAX_VECTOR_BLOCKS * BSIZE, "Range is too large to map",
+                       FsError_UNKNOWN, done);
+
+      struct inode *mapped_ip;
+      int n_blocks = xv6fs_sys_map_blocks(reg_entry->file, msg->msg.mmap.offset, msg->msg.mmap.n, blocknos,
+                                          &mapped_ip);
+      CHECK_ERROR_GOTO(n_blocks <= 0, "Range is not within the file", FsError_UNKNOWN, done);
+
+      /* The client gets the ramdisk's memory for the blocks */
+      gpi_obj_id_t block_ids[RAMDISK_MAX_VECTOR_BLOCKS];
+      for (int i = 0; i < n_blocks; i++)
+      {
+        block_ids[i] = get_xv6fs_server()->disk.res_id + blocknos[i];
+      }
+
+      mo_client_context_t disk_mo;
+      error = ramdisk_client_map(get_xv6fs_server()->rd_ep, block_ids, n_blocks, &disk_mo);
+      if (error)
+      {
+        xv6fs_sys_unmap_blocks(mapped_ip, msg->msg.mmap.offset, msg->msg.mmap.n, false);
+      }
+      CHECK_ERROR_GOTO(error, "Failed to map file blocks", FsError_UNKNOWN, done);
+
+      /* Slice the whole MO again for the client, which holds the file in this namespace
+         We keep ours, to revoke the client's slice when the range is unmapped */
+      uint32_t pages[RAMDISK_MAX_VECTOR_BLOCKS];
+      for (int i = 0; i < n_blocks; i++)
+      {
+        pages[i] = i;
+      }
+
+      mo_client_context_t block_mo;
+      fs_mapping_entry_t *mapping = NULL;
+      error = mo_component_client_slice(&disk_mo, pages, n_blocks, client_id, ns_id, &block_mo);
+      if (!error)
+      {
+        mapping = calloc(1, sizeof(fs_mapping_entry_t));
+      }
+
+      if (mapping == NULL)
+      {
+        if (!error)
+        {
+          mo_component_client_revoke_slice(&disk_mo, block_mo.id);
+        }
+        mo_component_client_disconnect(&disk_mo);
+        xv6fs_sys_unmap_blocks(mapped_ip, msg->msg.mmap.offset, msg->msg.mmap.n, false);
+      }
+      CHECK_ERROR_GOTO(error, "Failed to give mapped blocks to client", FsError_UNKNOWN, done);
+      CHECK_ERROR_GOTO(mapping == NULL, "Failed to allocate mapping entry", FsError_UNKNOWN, done);
+
+      /* Track the mapping, so it is released even if the client never unmaps it */
+      mapping->gen.object_id = block_mo.id;
+      mapping->client_id = client_id;
+      mapping->file_id = reg_entry->file->id;
+      mapping->ns_id = ns_id;
+      mapping->ip = mapped_ip;
+      mapping->offset = msg->msg.mmap.offset;
+      mapping->n = msg->msg.mmap.n;
+      mapping->disk_mo = disk_mo;
+      resource_registry_insert(&get_xv6fs_server()->mapping_registry, (resource_registry_node_t *)mapping);
+
+      reply_msg->which_msg = FsReturnMessage_mmap_tag;
+      reply_msg->msg.mmap.slot = block_mo.ep;
+      reply_msg->msg.mmap.mo_id = block_mo.id;
+      break;
+    case FsMessage_munmap_tag:
+      XV6FS_PRINTF("Unmap %u bytes at offset %u of file (%u), dirty %d\n", msg->msg.munmap.n,
+                   msg->msg.munmap.offset, reg_entry->file->id, msg->msg.munmap.dirty);
+
+      /* Only the client the range was mapped into can unmap it */
+      fs_mapping_entry_t *unmapping = (fs_mapping_entry_t *)resource_registry_get_by_id(
+          &get_xv6fs_server()->mapping_registry, msg->msg.munmap.mo_id);
+      CHECK_ERROR_GOTO(unmapping == NULL || unmapping->client_id != client_id ||
+                           unmapping->file_id != reg_entry->file->id ||
+                           unmapping->offset != msg->msg.munmap.offset || unmapping->n != msg->msg.munmap.n,
+                       "Range is not mapped by the client", FsError_UNKNOWN, done);
+
+      /* Revokes the client's MO, then releases the blocks and drops stale cached copies */
+      unmapping->dirty = msg->msg.munmap.dirty;
+      resource_registry_delete(&get_xv6fs_server()->mapping_registry, (resource_registry_node_t *)unmapping);
+      break;
     case FsMessage_close_tag:
       XV6FS_PRINTF("Close file (%u)\n", reg_entry->file->id);
 
@@ -633,16 +810,13 @@ void xv6fs_request_handler(void *msg_p,
     case FsMessage_stat_tag:
       *need_new_recv_cap = true;
 
-      /* Attach memory object to server ADS */
-      error = resource_server_attach_mo(&get_xv6fs_server()->gen, cap, &mo_vaddr);
+      /* Get the client's memory object in the server ADS, it stays attached for later requests */
+      error = resource_server_attach_client_mo(&get_xv6fs_server()->gen, client_id, msg->msg.stat.mo_id,
+                                               cap, &mo_vaddr, NULL);
       CHECK_ERROR_GOTO(error, "Failed to attach MO", error, done);
 
       /* Call function stat */
       error = xv6fs_sys_stat(reg_entry->file, (struct stat *)mo_vaddr);
-
-      // Unattach the MO
-      error = resource_server_unattach(&get_xv6fs_server()->gen, mo_vaddr);
-      CHECK_ERROR_GOTO(error, "Failed to unattach MO", error, done);
       break;
     default:
       CHECK_ERROR_GOTO(1, "got invalid op on badged ep with obj id", FsError_UNKNOWN, done);
@@ -656,7 +830,7 @@ done:
 static int block_read(uint32_t blockno, void *buf)
 {
   XV6FS_PRINTF("Reading blockno %d\n", blockno);
-  int error = ramdisk_client_read(&get_xv6fs_server()->blocks[blockno]);
+  int error = ramdisk_client_read_block(&get_xv6fs_server()->disk, blockno);
 
   if (error == 0)
   {
@@ -670,7 +844,7 @@ static int block_write(uint32_t blockno, void *buf)
 {
   XV6FS_PRINTF("Writing blockno %d\n", blockno);
   memcpy(get_xv6fs_server()->shared_mem_vaddr, buf, RAMDISK_BLOCK_SIZE);
-  return ramdisk_client_write(&get_xv6fs_server()->blocks[blockno]);
+  return ramdisk_client_write_block(&get_xv6fs_server()->disk, blockno);
 }
 
 /* Override xv6 block read/write functions */
@@ -706,6 +880,62 @@ void disk_rw(struct buf *b, int write)
   }
 }
 
+int disk_readv(struct buf **bufs, int n)
+{
+  gpi_obj_id_t block_ids[READAHEAD_BLOCKS];
+
+  XV6FS_PRINTF("Reading %d blocks from blockno %d\n", n, bufs[0]->blockno);
+  for (int i = 0; i < n; i++)
+  {
+    block_ids[i] = get_xv6fs_server()->disk.res_id + bufs[i]->blockno;
+  }
+
+  int error = ramdisk_client_readv(get_xv6fs_server()->rd_ep, block_ids, n);
+
+  if (error)
+  {
+    XV6FS_PRINTF("Warning: Failed vectored block read\n");
+    return error;
+  }
+
+  for (int i = 0; i < n; i++)
+  {
+    memcpy(bufs[i]->data, get_xv6fs_server()->shared_mem_vaddr + i * RAMDISK_BLOCK_SIZE, RAMDISK_BLOCK_SIZE);
+  }
+
+  return 0;
+}
+
+uint32_t disk_alloc_cache(uint32_t max_blocks, void **data)
+{
+  xv6fs_server_context_t *server = get_xv6fs_server();
+  mo_client_context_t cache_mo;
+  int error;
+
+  /* Take as much of the cache as the MO component can give, down to the minimum size */
+  for (uint32_t n_blocks = max_blocks; n_blocks >= NBUF; n_blocks /= 2)
+  {
+    error = mo_component_client_connect(server->gen.mo_ep, n_blocks, MO_PAGE_BITS, &cache_mo);
+    if (error)
+    {
+      continue;
+    }
+
+    error = vmr_client_attach_no_reserve(server->gen.vmr_rde, NULL, &cache_mo,
+                                         SEL4UTILS_RES_TYPE_GENERIC, data);
+    if (error)
+    {
+      mo_component_client_disconnect(&cache_mo);
+      continue;
+    }
+
+    XV6FS_PRINTF("Allocated buffer cache of %u blocks\n", n_blocks);
+    return n_blocks;
+  }
+
+  return 0;
+}
+
 /* Notifies the component when a new block is assigned to a file */
 // (XXX) Arya: If we used this, we would need to track unmapping as well
 void map_file_to_block(uint32_t file_id, uint32_t blockno)
@@ -725,8 +955,8 @@ void map_file_to_block(uint32_t file_id, uint32_t blockno)
   gpi_badge_t file_universal_id = compact_res_id(get_xv6fs_server()->gen.resource_type,
                                                  get_xv6fs_server()->gen.default_space.id, file_id);
   gpi_badge_t block_universal_id = compact_res_id(sel4gpi_get_resource_type_code(BLOCK_RESOURCE_TYPE_NAME),
-                                                  get_xv6fs_server()->blocks[blockno].space_id,
-                                                  get_xv6fs_server()->blocks[blockno].res_id);
+                                                  get_xv6fs_server()->disk.space_id,
+                                                  get_xv6fs_server()->disk.res_id);
 
   error = pd_client_map_resource(&get_xv6fs_server()->gen.pd_conn, file_universal_id, block_universal_id);
   SERVER_GOTO_IF_ERR(error, "Failed to map file (%u) to block (%u)\n", file_universal_id, block_universal_id);
@@ -793,26 +1023,20 @@ int xv6fs_work_handler(PdWorkReturnMessage *work)
       CHECK_ERROR_GOTO(error, "Failed to walk FS", FsError_UNKNOWN, err_goto);
 
       /* Add the PD nodes */
-      char client_pd_id_str[CSV_MAX_STRING_SIZE];
-      get_pd_id(client_pd_id, client_pd_id_str);
-      char fs_pd_id_str[CSV_MAX_STRING_SIZE];
-      get_pd_id(sel4gpi_get_pd_conn().id, fs_pd_id_str);
+      gpi_model_node_key_t client_pd_key = get_pd_key(client_pd_id);
+      gpi_model_node_key_t fs_pd_key = get_pd_key(sel4gpi_get_pd_conn().id);
 
       /* Add the file resource space ID(s) */
-      char file_space_id[CSV_MAX_STRING_SIZE];
-      get_resource_space_id(get_xv6fs_server()->gen.resource_type,
-                            get_xv6fs_server()->gen.default_space.id,
-                            file_space_id);
+      gpi_model_node_key_t file_space_key = get_resource_space_key(get_xv6fs_server()->gen.resource_type,
+                                                                   get_xv6fs_server()->gen.default_space.id);
 
-      char file_ns_space_id[CSV_MAX_STRING_SIZE];
-      get_resource_space_id(get_xv6fs_server()->gen.resource_type,
-                            space_id,
-                            file_ns_space_id);
+      gpi_model_node_key_t file_ns_space_key = get_resource_space_key(get_xv6fs_server()->gen.resource_type,
+                                                                      space_id);
 
       /* Add nodes for all files and blocks */
       gpi_cap_t block_cap_type = sel4gpi_get_resource_type_code(BLOCK_RESOURCE_TYPE_NAME);
       // (XXX) Arya: Assume only one block space
-      gpi_space_id_t block_space_id = get_xv6fs_server()->blocks[0].space_id;
+      gpi_space_id_t block_space_id = get_xv6fs_server()->disk.space_id;
       int n_blocknos = 100;
       // (XXX) Arya: assumes there are no more than 100 blocks per file
       int *blocknos = malloc(sizeof(int) * n_blocknos);
@@ -830,10 +1054,10 @@ int xv6fs_work_handler(PdWorkReturnMessage *work)
             true);
 
         /* Add the subset edge */
-        add_edge_by_id(model_state, GPI_EDGE_TYPE_SUBSET, file_node->id, file_space_id);
+        add_edge_by_id(model_state, GPI_EDGE_TYPE_SUBSET, file_node->id, file_space_key);
 
         /* Add the hold edges */
-        add_edge_by_id(model_state, GPI_EDGE_TYPE_HOLD, fs_pd_id_str, file_node->id);
+        add_edge_by_id(model_state, GPI_EDGE_TYPE_HOLD, fs_pd_key, file_node->id);
 
         /* If in a namespace, add the file resource node in the namespace */
         if (space_id != get_xv6fs_server()->gen.default_space.id)
@@ -844,21 +1068,21 @@ int xv6fs_work_handler(PdWorkReturnMessage *work)
               true);
 
           // Add the subset edge
-          add_edge_by_id(model_state, GPI_EDGE_TYPE_SUBSET, file_ns_node->id, file_ns_space_id);
+          add_edge_by_id(model_state, GPI_EDGE_TYPE_SUBSET, file_ns_node->id, file_ns_space_key);
 
           // Add the map edge to the file in the default file space
           add_edge(model_state, GPI_EDGE_TYPE_MAP, file_ns_node, file_node);
 
           // FS holds all files
-          add_edge_by_id(model_state, GPI_EDGE_TYPE_HOLD, fs_pd_id_str, file_ns_node->id);
+          add_edge_by_id(model_state, GPI_EDGE_TYPE_HOLD, fs_pd_key, file_ns_node->id);
 
           // Client holds the resource in the namespace
-          add_edge_by_id(model_state, GPI_EDGE_TYPE_HOLD, client_pd_id_str, file_ns_node->id);
+          add_edge_by_id(model_state, GPI_EDGE_TYPE_HOLD, client_pd_key, file_ns_node->id);
         }
         else
         {
           // Client holds the file directly
-          add_edge_by_id(model_state, GPI_EDGE_TYPE_HOLD, client_pd_id_str, file_node->id);
+          add_edge_by_id(model_state, GPI_EDGE_TYPE_HOLD, client_pd_key, file_node->id);
         }
 
         /* Add relations for blocks */
@@ -866,14 +1090,11 @@ int xv6fs_work_handler(PdWorkReturnMessage *work)
         CHECK_ERROR_GOTO(error, "Failed to get blocknos for file", FsError_UNKNOWN, err_goto);
         XV6FS_PRINTF("File has %d blocks\n", n_blocknos);
 
-        gpi_obj_id_t block_id;
-        for (int j = 0; j < n_blocknos; j++)
+        // All blocks belong to the single disk extent, so the file maps to it once
+        if (n_blocknos > 0)
         {
-          block_id = get_xv6fs_server()->blocks[blocknos[j]].res_id;
-
-          char block_id_str[CSV_MAX_STRING_SIZE];
-          get_resource_id(make_res_id(block_cap_type, block_space_id, block_id), block_id_str);
-          add_edge_by_id(model_state, GPI_EDGE_TYPE_MAP, file_node->id, block_id_str);
+          add_edge_by_id(model_state, GPI_EDGE_TYPE_MAP, file_node->id,
+                         get_resource_key(make_res_id(block_cap_type, block_space_id, get_xv6fs_server()->disk.res_id)));
         }
       }
 
@@ -892,6 +1113,9 @@ int xv6fs_work_handler(PdWorkReturnMessage *work)
       // We still want to keep it in the file system, but we can reduce the refcount
       gpi_obj_id_t file_id = work->object_ids[i];
 
+      // Ranges the client still has mapped are released, e.g. if the client crashed
+      release_mappings(work->pd_ids[i], file_id);
+
       // Find the registry entry
       file_registry_entry_t *reg_entry = (file_registry_entry_t *)resource_registry_get_by_id(
           &get_xv6fs_server()->file_registry,
@@ -921,6 +1145,7 @@ int xv6fs_work_handler(PdWorkReturnMessage *work)
       if (file_id != BADGE_OBJ_ID_NULL)
       {
         // Destroy a particular file
+        release_mappings(BADGE_OBJ_ID_NULL, file_id);
 
         // Find the registry entry
         file_registry_entry_t *reg_entry = (file_registry_entry_t *)resource_registry_get_by_id(
@@ -944,28 +1169,20 @@ int xv6fs_work_handler(PdWorkReturnMessage *work)
         if (space_id == get_xv6fs_server()->gen.default_space.id)
         {
           // Destroy the entire file system, this is done by releasing the disk
+          release_mappings(BADGE_OBJ_ID_NULL, BADGE_OBJ_ID_NULL);
 
           // Nothing to do if we can't access the disk
           if (sel4gpi_can_request_type(BLOCK_RESOURCE_TYPE_NAME))
           {
+            error = ramdisk_client_free_block(&get_xv6fs_server()->disk);
 
-            for (int i = 0; i < FS_SIZE; i++)
+            // An error is expected if we lost access to the ramdisk in the meantime
+            if (error && sel4gpi_can_request_type(BLOCK_RESOURCE_TYPE_NAME))
             {
-              error = ramdisk_client_free_block(&get_xv6fs_server()->blocks[i]);
-
-              if (error)
-              {
-                if (!sel4gpi_can_request_type(BLOCK_RESOURCE_TYPE_NAME))
-                {
-                  // We got an error because we no longer have access to the ramdisk
-                  break;
-                }
-                else
-                {
-                  CHECK_ERROR_GOTO(error, "Failed to free block\n", FsError_UNKNOWN, err_goto);
-                }
-              }
+              CHECK_ERROR_GOTO(error, "Failed to free disk extent\n", FsError_UNKNOWN, err_goto);
             }
+
+            error = 0;
           }
         }
         else
@@ -192,13 +192,27 @@ void mkfs_balloc(int used)
 
 #define min(a, b) ((a) < (b) ? (a) : (b))
 
+// Return entry idx of the pointer block at sector ptr,
+// allocating a block for the entry if it is empty.
+uint32_t iappend_ptr(uint32_t ptr, uint32_t idx)
+{
+  uint32_t indirect[NINDIRECT];
+
+  rsect(ptr, (char *)indirect);
+  if (indirect[idx] == 0)
+  {
+    indirect[idx] = xint(freeblock++);
+    wsect(ptr, (char *)indirect);
+  }
+  return xint(indirect[idx]);
+}
+
 void iappend(uint32_t inum, void *xp, int n)
 {
   char *p = (char *)xp;
   uint32_t fbn, off, n1;
   struct dinode din;
   char buf[BSIZE];
-  uint32_t indirect[NINDIRECT];
   uint32_t x;
 
   rinode(inum, &din);
@@ -216,19 +230,22 @@ void iappend(uint32_t inum, void *xp, int n)
       }
       x = xint(din.addrs[fbn]);
     }
-    else
+    else if (fbn < NDIRECT + NINDIRECT)
     {
       if (xint(din.addrs[NDIRECT]) == 0)
       {
         din.addrs[NDIRECT] = xint(freeblock++);
       }
-      rsect(xint(din.addrs[NDIRECT]), (char *)indirect);
-      if (indirect[fbn - NDIRECT] == 0)
+      x = iappend_ptr(xint(din.addrs[NDIRECT]), fbn - NDIRECT);
+    }
+    else
+    {
+      if (xint(din.addrs[NDIRECT + 1]) == 0)
       {
-        indirect[fbn - NDIRECT] = xint(freeblock++);
-        wsect(xint(din.addrs[NDIRECT]), (char *)indirect);
+        din.addrs[NDIRECT + 1] = xint(freeblock++);
       }
-      x = xint(indirect[fbn - NDIRECT]);
+      x = iappend_ptr(xint(din.addrs[NDIRECT + 1]), (fbn - NDIRECT - NINDIRECT) / NINDIRECT);
+      x = iappend_ptr(x, (fbn - NDIRECT - NINDIRECT) % NINDIRECT);
     }
     n1 = min(n, (fbn + 1) * BSIZE - off);
     rsect(x, buf);
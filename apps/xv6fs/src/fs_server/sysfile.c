@@ -335,6 +335,79 @@ int xv6fs_sys_fstat(char *path, void *buf)
   return r;
 }
 
+// Checks that [off, off + n) is a block-aligned range of the file, ip must be locked
+// Returns the number of blocks in the range, or -1
+static int map_range_blocks(struct inode *ip, uint32_t off, uint32_t n)
+{
+  if (ip->type != T_FILE || off % BSIZE != 0 || n == 0)
+    return -1;
+
+  uint32_t nblocks = (n + BSIZE - 1) / BSIZE;
+  uint32_t file_blocks = (ip->size + BSIZE - 1) / BSIZE;
+  if (off / BSIZE > file_blocks || nblocks > file_blocks - off / BSIZE)
+    return -1;
+
+  return nblocks;
+}
+
+int xv6fs_sys_map_blocks(struct file *f, uint32_t off, uint32_t n, uint32_t *blocknos, struct inode **ret_ip)
+{
+  if (f == 0)
+    return -1;
+
+  struct inode *ip = f->ip;
+  ilock(ip);
+
+  int nblocks = map_range_blocks(ip, off, n);
+  for (int i = 0; i < nblocks; i++)
+  {
+    blocknos[i] = bmap_noalloc(ip, off / BSIZE + i);
+    if (blocknos[i] == 0)
+    {
+      nblocks = -1;
+      break;
+    }
+
+    bflush(ip->dev, blocknos[i]);
+  }
+
+  // The mapping keeps the inode, and so its blocks, until it is unmapped
+  if (nblocks > 0)
+  {
+    ip->nmap++;
+    *ret_ip = idup(ip);
+  }
+
+  iunlock(ip);
+  return nblocks;
+}
+
+int xv6fs_sys_unmap_blocks(struct inode *ip, uint32_t off, uint32_t n, bool dirty)
+{
+  if (ip == 0)
+    return -1;
+
+  ilock(ip);
+
+  int nblocks = map_range_blocks(ip, off, n);
+  if (nblocks < 0 || ip->nmap == 0)
+  {
+    iunlock(ip);
+    return -1;
+  }
+
+  for (int i = 0; dirty && i < nblocks; i++)
+  {
+    uint32_t blockno = bmap_noalloc(ip, off / BSIZE + i);
+    if (blockno != 0)
+      binval(ip->dev, blockno);
+  }
+
+  ip->nmap--;
+  iunlockput(ip);
+  return 0;
+}
+
 int xv6fs_sys_readdirent(void *fh, struct dirent *e, uint32_t off)
 {
   struct file *f = (struct file *)fh;
@@ -353,6 +426,12 @@ int xv6fs_sys_truncate(char *path)
   struct file *f = xv6fs_sys_open(path, O_RDWR);
   if (f == 0)
     return -1;
+  // Clients can still write the blocks of a mapped file
+  if (f->ip->nmap > 0)
+  {
+    fileclose(f);
+    return -1;
+  }
   itrunc(f->ip);
   fileclose(f);
   return 0;
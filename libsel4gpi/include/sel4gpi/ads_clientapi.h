@@ -48,15 +48,28 @@ int ads_client_bind_cpu(ads_client_context_t *conn, seL4_CPtr cpu_cap);
  * every config option except `type` can be omitted, and the server will attempt to look for the typed VMR
  * to shallow copy.
  *
+ * If the config's `share_mode` is GPI_COW, writable regions are mapped read-only in dst_ads,
+ * and write faults must be resolved with ads_client_cow_fault.
+ *
  * @param src_ads the ADS to copy from
  * @param dst_ads the ADS to copy to
- * @param vmr_vfg the config describing one VMR, the `share_mode` and `mo` option are ignored
+ * @param vmr_vfg the config describing one VMR, the `mo` option is ignored
  * @return int 0 on success
  */
 int ads_client_shallow_copy(ads_client_context_t *src_ads,
                             ads_client_context_t *dst_ads,
                             vmr_config_t *vmr_cfg);
 
+/**
+ * @brief Resolve a write fault on a copy-on-write VMR, the faulting page is copied into a
+ * new frame that is mapped writable in the ADS
+ *
+ * @param ads the ADS that faulted
+ * @param vaddr the faulting address
+ * @return int 0 on success, other on error
+ */
+int ads_client_cow_fault(ads_client_context_t *ads, void *vaddr);
+
 /**
  * @brief Obtains info about an ADS reservation for a given VMR type. If multiple reservations of
  * the same type exist, info about the first one found is returned.
@@ -91,6 +91,14 @@ int ads_component_rm_by_id(gpi_obj_id_t ads_id, gpi_obj_id_t vmr_id);
  */
 int ads_component_rm_by_vaddr(gpi_obj_id_t ads_id, void *vaddr);
 
+/**
+ * Remove every attach of an MO, from every ADS
+ * Note: Only useable from the root task
+ *
+ * @param mo_id ID of the MO to remove
+ */
+int ads_component_rm_mo(gpi_obj_id_t mo_id);
+
 /**
  * Map an MO to the root task's address space
  *
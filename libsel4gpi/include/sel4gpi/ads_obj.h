@@ -14,6 +14,7 @@
 #include <sel4utils/process.h>
 #include <sel4gpi/model_exporting.h>
 #include <sel4gpi/resource_registry.h>
+#include <sel4gpi/range_tree.h>
 #include <sel4gpi/pd_creation.h>
 
 typedef struct _pd pd_t;
@@ -41,6 +42,9 @@ typedef struct _attach_node
 
     void *vaddr;                       ///< Attach vaddr, key for the UTHash
     attach_node_map_t *map_entry;      ///< the attach node map entry for this node
+    range_tree_node_t range;           ///< Range of the reservation, in the ADS's reservation index
+    struct _attach_node *type_next;    ///< Next reservation of the same type in the ADS
+    struct _attach_node *type_prev;    ///< Previous reservation of the same type in the ADS
     reservation_t res;                 ///< Reservation in the vspace
     sel4utils_reservation_type_t type; ///< Reservation type
     uint32_t n_pages;                  ///< Number of pages
@@ -54,6 +58,10 @@ typedef struct _attach_node
     gpi_obj_id_t mo_id;    ///< ID of the MO attached
     seL4_CPtr *frame_caps; ///< Array of frame caps copied for this attach
     uint32_t n_frames;     ///< Number of frame caps in the array
+
+    bool cow;                 ///< True if the MO is mapped copy-on-write (read-only until a page is written)
+    gpi_obj_id_t *cow_mo_ids; ///< For a cow attach, the private single-page MO of each copied frame,
+                              ///< or BADGE_OBJ_ID_NULL if the frame is still shared
 } attach_node_t;
 
 typedef struct _ads
@@ -66,6 +74,8 @@ typedef struct _ads
 
     resource_registry_t attach_registry;
     resource_registry_t attach_id_to_vaddr_map;
+    range_tree_t res_index;                                  ///< Reservations ordered by address range
+    attach_node_t *res_by_type[SEL4UTILS_RES_TYPE_MAX];      ///< Lists of reservations of each type
 } ads_t;
 
 /**
@@ -131,6 +141,15 @@ attach_node_t *ads_get_res_by_id(ads_t *ads, gpi_obj_id_t res_id);
  */
 attach_node_t *ads_get_res_by_vaddr(ads_t *ads, void *vaddr);
 
+/**
+ * Get the attach node whose reservation contains a vaddr
+ *
+ * @param ads ads object
+ * @param vaddr any address in the reservation to find
+ * @return the corresponding attach node, or NULL if no reservation contains vaddr
+ */
+attach_node_t *ads_get_res_containing(ads_t *ads, void *vaddr);
+
 /**
  * @brief finds the reservations for a VMR by the type (Multiple reservations of the type may exist)
  *
@@ -215,6 +234,7 @@ int ads_bind(ads_t *ads, vka_t *vka, seL4_CPtr *cpu_cap);
  * @brief Shallow copies a VMR from src_ads to dst_ads.
  * If config only specifies a VMR type that is neither SEL4UTILS_RES_TYPE_GENERIC nor SEL4UTILS_RES_TYPE_SHARED_FRAMES,
  * will search for the VMR reservation corresponding to the given type
+ * With GPI_COW, writable VMRs are remapped read-only in both ADSes, and each side copies a page on its first write
  *
  * @param loader the current vspace
  * @param vka vka object for cspace and page table allocations
@@ -225,6 +245,21 @@ int ads_bind(ads_t *ads, vka_t *vka, seL4_CPtr *cpu_cap);
  */
 int ads_shallow_copy(vspace_t *loader, vka_t *vka, ads_t *src_ads, ads_t *dst_ads, vmr_config_t *cfg);
 
+/**
+ * @brief Resolves a write fault on a copy-on-write VMR.
+ * The faulting page is copied into a new frame, which replaces the shared frame in the ADS with the
+ * reservation's original rights. Only the faulting page is copied.
+ * A fault on a page that was already copied, e.g. by another thread faulting on the same page, succeeds
+ * without copying again. If the copy cannot be mapped, the shared frame stays mapped read-only.
+ *
+ * @param loader the current vspace, used to map the frames for copying
+ * @param vka vka object for cspace and page table allocations
+ * @param ads the ADS that faulted
+ * @param vaddr the faulting address
+ * @return int 0 on success, 1 if vaddr is not in a copy-on-write VMR or the page could not be copied
+ */
+int ads_cow_fault(vspace_t *loader, vka_t *vka, ads_t *ads, void *vaddr);
+
 /**
  * @param ads ads object to dump the RR for
  * @param ms pointer to model state
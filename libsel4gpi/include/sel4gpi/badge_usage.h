@@ -56,10 +56,10 @@ gpi_cap_t get_cap_type_from_badge(gpi_badge_t badge);
 // Bits: 63:56 are for the cap type. Total of 8 bits, so 255 types.
 gpi_badge_t set_cap_type_to_badge(gpi_badge_t badge, gpi_cap_t type);
 
-// Bits: 55:40 are for the permisions. Total of 8 bits, as a bit-mask so 8 permissions.
+// Bits: 55:48 are for the permisions. Total of 8 bits, as a bit-mask so 8 permissions.
 gpi_perms_t get_perms_from_badge(gpi_badge_t badge);
 
-// Bits: 55:40 are for the permisions. Total of 8 bits, as a bit-mask so 8 permissions.
+// Bits: 55:48 are for the permisions. Total of 8 bits, as a bit-mask so 8 permissions.
 gpi_badge_t set_perms_to_badge(gpi_badge_t badge, gpi_perms_t perms);
 
 // Bits: 47:40 are for the resource space ID. Total of 8 bits, so 255 resource spaces
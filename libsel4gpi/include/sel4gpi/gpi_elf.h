@@ -68,12 +68,14 @@ typedef struct sel4gpi_elf_region
  * @param loadee_vka allocator to use for allocation in the loadee vspace
  * @param loader_vka allocator to use for loader vspace. Can be the same as loadee_vka.
  * @param elf the elf file to load
+ * @param image_name OPTIONAL name of the image the elf file was read from, if given,
+ *                   non-writable segments are shared with other loads of the same image (see ELF_SEGMENT_CACHE)
  *
  * @return The entry point of the new process, NULL on error
  */
 void *
 sel4gpi_elf_load(ads_t *loadee, ads_t *loader, vka_t *loadee_vka,
-                 vka_t *loader_vka, const elf_t *elf);
+                 vka_t *loader_vka, const elf_t *elf, const char *image_name);
 
 /**
  * Parses an elf file and returns the number of loadable regions. The result of this
@@ -55,6 +55,33 @@
  */
 #define STORE_REPLY_CAP 1
 
+/**
+ * Number of cspace slots a PD leases from the root task at once, at most PD_SLOT_LEASE_MAX (64)
+ * If 0:        sel4gpi_alloc_slot, sel4gpi_free_slot and sel4gpi_clear_slot make one root task RPC per slot.
+ * If > 0:      PDs lease contiguous slot ranges in one RPC and allocate from them locally with a bitmap.
+ *              Slots are cleared locally, and free slots are returned to the root task in bulk.
+ */
+#define PD_SLOT_LEASE_SIZE 32
+
+/**
+ * If true:     The root task keeps the MOs of non-writable ELF segments after loading an image, and later loads
+ *              of the same image map the cached MOs instead of allocating and copying new ones.
+ *              Writable segments are always copied.
+ * If false:    Every ELF load allocates and copies all segments.
+ */
+#define ELF_SEGMENT_CACHE 1
+
+/**
+ * Number of root-task threads serving requests on the GPI server endpoint
+ * If 1:        A single server thread receives and handles every request.
+ * If > 1:      A pool of server threads receives on the shared endpoint. Receiving, decoding and replying
+ *              proceed in parallel, and request handlers are serialized by the server mutex (`mx`), since
+ *              the components call into each other's registries and share the root task's VKA and vspace.
+ *              This is one coarse lock, not per-component or per-object locking: a slow handler, such as
+ *              an ELF load or a PD teardown, still blocks every other handler.
+ */
+#define GPI_SERVER_NUM_WORKERS 1
+
 /**
  * If true, outputs clock cycles for GPI server's message send/receive times
  */
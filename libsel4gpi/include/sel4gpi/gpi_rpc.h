@@ -9,6 +9,12 @@
  * Functions for sending/receiving RPC messages with protobuf
  */
 
+/**
+ * Message label of requests and replies that use the raw message-register encoding instead of protobuf
+ * Protobuf messages and successful replies are sent with label 0
+ */
+#define SEL4GPI_RPC_RAW_LABEL 0x4750
+
 typedef struct sel4gpi_rpc_env
 {
     const pb_msgdesc_t *request_desc; ///< Message description for this RPC protocol's requests
@@ -40,14 +46,33 @@ int sel4gpi_rpc_env_init(sel4gpi_rpc_env_t *client,
 int sel4gpi_rpc_call(sel4gpi_rpc_env_t *client, seL4_CPtr ep, void *msg,
                      int n_caps, seL4_CPtr *caps, void *reply);
 
+/**
+ * Send a fixed-layout message to an RPC server, placing its fields directly in message registers
+ * The layout is derived from the same message descriptions as the protobuf encoding, and the server
+ * replies in the same encoding. Messages that contain strings, bytes, or more fields than there are
+ * message registers are sent with protobuf, as by sel4gpi_rpc_call.
+ *
+ * @param client the client structure, initialized by sel4gpi_rpc_env_init
+ * @param ep the endpoint to send to
+ * @param msg the message to send, the type should correspond with the request_desc
+ * @param n_caps number of caps to send
+ * @param caps an array of capabilities to send
+ * @param reply returns the reply message, the type should correspond with the reply_desc
+ * @return 0 on success, -1 if there was an error encoding the message / decoding the reply
+ */
+int sel4gpi_rpc_call_raw(sel4gpi_rpc_env_t *client, seL4_CPtr ep, void *msg,
+                         int n_caps, seL4_CPtr *caps, void *reply);
+
 /**
  * To be called by an RPC server, parse an RPC message from the IPC buffer
  *
  * @param env the env structure, initialized by sel4gpi_rpc_env_init
+ * @param tag the MessageInfo the message was received with
  * @param res a message structure to be filled out, the type will correspond with the request_desc
+ * @param raw returns true if the message used the raw encoding, and should be replied to in kind
  * @return 0 on success, -1 if there was an error decoding the message
  */
-int sel4gpi_rpc_recv(sel4gpi_rpc_env_t *env, void *res);
+int sel4gpi_rpc_recv(sel4gpi_rpc_env_t *env, seL4_MessageInfo_t tag, void *res, bool *raw);
 
 /**
  * To be called by an RPC server, write an RPC reply to the IPC buffer
@@ -55,10 +80,11 @@ int sel4gpi_rpc_recv(sel4gpi_rpc_env_t *env, void *res);
  *
  * @param env the env structure, initialized by sel4gpi_rpc_env_init
  * @param msg a message structure to send, the type should correspond with the reply_desc
+ * @param raw true to reply with the raw encoding, as returned by sel4gpi_rpc_recv
  * @param msg_info returns the MessageInfo to send by IPC
  * @return 0 on success, -1 if there was an error decoding the message
  */
-int sel4gpi_rpc_reply(sel4gpi_rpc_env_t *env, void *msg, seL4_MessageInfo_t *msg_info);
+int sel4gpi_rpc_reply(sel4gpi_rpc_env_t *env, void *msg, bool raw, seL4_MessageInfo_t *msg_info);
 
 /**
  * Check if the first received cap has the given GPI type
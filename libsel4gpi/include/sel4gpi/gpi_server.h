@@ -118,6 +118,9 @@ typedef struct _gpi_server_context
     seL4_CPtr server_cspace;
     vspace_t *server_vspace;
     sel4utils_thread_t server_thread;
+#if GPI_SERVER_NUM_WORKERS > 1
+    sel4utils_thread_t worker_threads[GPI_SERVER_NUM_WORKERS - 1]; ///< Additional threads serving the endpoint
+#endif
 
     // The server listens on this endpoint.
     vka_object_t server_ep_obj;
@@ -150,6 +153,7 @@ typedef struct _gpi_server_context
     model_state_t *model_state;       ///< Partial model state for a pending model extraction
     seL4_CPtr model_extraction_reply; ///< The reply cap for the pending model extraction
     int model_extraction_n_missing;   ///< Number of missing replies before model state is complete
+    model_journal_t model_journal;    ///< Recent changes to the hold, request, and map edges of the model state
 
     /* Track a pending PD termination */
     /* (XXX) Arya: For now, we can only do one PD termination at a time */
@@ -164,7 +168,10 @@ typedef struct _gpi_server_context
 
     gpi_obj_id_t test_proc_id; ///< Use this to warn if we try to clean up the test process
 
-    sync_mutex_t *mx; ///< mutex for synchronization between the test driver and GPI server
+    uint32_t n_invalidation_pds; ///< Number of PDs that accept INVALIDATE work, published in every PD's shared data
+
+    sync_mutex_t *mx; ///< mutex for synchronization between the test driver and GPI server,
+                      ///< also serializes request handlers if there are multiple server threads
 
     int *num_gen_irqs;
     sel4ps_irq_t *gen_irqs;
@@ -175,6 +182,17 @@ typedef struct _gpi_server_context
  **/
 void gpi_server_main(void);
 
+/**
+ * Lock the GPI server before accessing component state, if there are multiple server threads
+ * This single lock covers every component's state, there are no per-component locks
+ */
+void gpi_server_lock(void);
+
+/**
+ * Unlock the GPI server, after gpi_server_lock
+ */
+void gpi_server_unlock(void);
+
 gpi_server_context_t *get_gpi_server(void);
 
 /**
@@ -5,6 +5,7 @@
 #pragma once
 #include <sel4/sel4.h>
 #include <stdint.h>
+#include <stddef.h>
 
 #define MO_PAGE_BITS seL4_PageBits
 #define MO_LARGE_PAGE_BITS seL4_LargePageBits
@@ -13,4 +14,5 @@ typedef struct _mo_client_context
 {
    seL4_CPtr ep;
    gpi_obj_id_t id; // Needed only for RR dump
+   size_t size;     // Size in bytes, set when the MO is allocated or attached
 } mo_client_context_t;
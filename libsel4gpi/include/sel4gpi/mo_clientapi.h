@@ -51,3 +51,33 @@ int mo_component_client_connect_paddr(seL4_CPtr server_ep_cap,
  * @return int 0 on success, -1 on failure.
  */
 int mo_component_client_disconnect(mo_client_context_t *conn);
+
+/**
+ * @brief Create an MO that shares some frames of an existing MO
+ * The existing MO is kept allocated until the new MO is destroyed
+ *
+ * @param conn the existing MO
+ * @param pages index in the existing MO of each frame of the new MO
+ * @param num_pages number of frames in the new MO, at most MO_SLICE_MAX_PAGES
+ * @param pd_id the PD to give the new MO to, either the caller or a client of the caller
+ * @param space_id if pd_id is not the caller, a resource space that the caller manages,
+ *                 and that pd_id holds a resource in
+ * @param ret_conn returns the new MO context, the slot is in the cspace of the PD given the MO
+ * @return int 0 on success, 1 on failure
+ */
+int mo_component_client_slice(mo_client_context_t *conn,
+                              uint32_t *pages,
+                              uint32_t num_pages,
+                              gpi_obj_id_t pd_id,
+                              gpi_space_id_t space_id,
+                              mo_client_context_t *ret_conn);
+
+/**
+ * @brief Revoke an MO sliced from an existing MO
+ * The slice is unmapped from every ADS and removed from every PD that holds it, then destroyed
+ *
+ * @param conn the existing MO, which the slice was made from
+ * @param slice_id ID of the slice to revoke, it is not an error if the slice was already destroyed
+ * @return int 0 on success, 1 on failure
+ */
+int mo_component_client_revoke_slice(mo_client_context_t *conn, gpi_obj_id_t slice_id);
@@ -29,6 +29,7 @@
 #define MO_RPC_MAGIC 0x4d4f
 #define MOSERVS "MOServ Component: "
 #define MOSERVC "MOServ Client   : "
+#define MO_SLICE_MAX_PAGES 32 // Max pages in one slice request, must match max_count of MoSliceMessage.pages
 
 /* Per-client context maintained by the server. */
 typedef struct _mo_component_registry_entry
@@ -14,15 +14,29 @@
 #include <sel4utils/process.h>
 #include <sel4gpi/model_exporting.h>
 
+/**
+ * A run of physically contiguous frames of an MO, retyped from one untyped
+ */
+typedef struct _mo_extent
+{
+    vka_object_t untyped; ///< The untyped the frames were retyped from
+    uintptr_t paddr;      ///< Physical address of the first frame
+    uint32_t first_page;  ///< Index of the first frame in the MO
+    uint32_t num_pages;   ///< Number of frames in the extent
+} mo_extent_t;
+
 typedef struct _mo
 {
     uint32_t id;
 
     seL4_CPtr *frame_caps_in_root_task;
-    vka_object_t *vka_objects;
-    uintptr_t *frame_paddrs;
+    vka_object_t *vka_objects; ///< Per-frame VKA objects, only for MOs allocated at a given paddr
+    uintptr_t *frame_paddrs;   ///< Per-frame paddrs, only for MOs that are not allocated as extents
+    mo_extent_t *extents;      ///< Contiguous runs of frames, for MOs allocated from untypeds
+    uint32_t num_extents;
     uint32_t num_pages;
     size_t page_bits;
+    uint32_t parent_id; ///< MO whose frames this MO shares, or 0 if the MO owns its frames
 } mo_t;
 
 /**
@@ -35,6 +49,8 @@ typedef struct _mo_new_args
     uint32_t num_pages;
     size_t page_bits;
     uintptr_t paddr;
+    mo_t *parent;           ///< If set, the new MO shares frames of this MO instead of allocating
+    uint32_t *parent_pages; ///< Index in the parent of each frame of the new MO
 } mo_new_args_t;
 
 /**
@@ -51,6 +67,15 @@ int mo_new(mo_t *mo,
            vspace_t *vspace,
            mo_new_args_t *alloc_args);
 
+/**
+ * @brief Get the physical address of one of the MO's frames
+ *
+ * @param mo mo object
+ * @param page index of the frame in the MO
+ * @return uintptr_t the physical address, or 0 if it is unknown
+ */
+uintptr_t mo_frame_paddr(mo_t *mo, uint32_t page);
+
 /**
  * @param mo mo object to dump the RR for
  * @param ms pointer to model state
@@ -61,6 +86,7 @@ gpi_model_node_t *mo_dump_rr(mo_t *mo, model_state_t *ms, gpi_model_node_t *pd_n
 
 /**
  * Destroys an MO, including all metadata and the underlying frames
+ * If the MO shares the frames of a parent MO, it releases the parent instead
  *
  * This does not remove the MO from the MO component registry
  * This function should only be called by the MO component
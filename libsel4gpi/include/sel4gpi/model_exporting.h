@@ -5,17 +5,12 @@
 
 #include <sel4/sel4.h>
 #include <utils/uthash.h>
+#include <sel4gpi/badge_usage.h>
 
 #define CSV_MAX_STRING_SIZE (size_t)100 // Define a suitable size for your strings
 
 /* Definition of the model state graph structure */
 
-typedef enum _gpi_model_component_type
-{
-    GPI_MODEL_NODE = 1,
-    GPI_MODEL_EDGE
-} gpi_model_component_type_t;
-
 typedef enum _gpi_node_type
 {
     GPI_NODE_TYPE_PD,
@@ -31,28 +26,43 @@ typedef enum _gpi_edge_type
     GPI_EDGE_TYPE_HOLD,
 } gpi_edge_type_t;
 
+/**
+ * Integer key of a node in the model state
+ * This is the compact resource ID of the node (see compact_res_id), with the node type in the unused permissions field
+ * PD nodes use the PD resource type and the PD's ID as the object ID, space nodes use a null object ID
+ */
+typedef gpi_badge_t gpi_model_node_key_t;
+
+/**
+ * A string interned in the model state, so that node data is only stored and compared once
+ */
+typedef struct _gpi_model_string
+{
+    uint32_t offset; ///< Offset of the string in the serialized string table
+    UT_hash_handle hh;
+    char str[]; ///< The string, also UTHash key
+} gpi_model_string_t;
+
 typedef struct _gpi_model_node
 {
+    gpi_model_node_key_t id; ///< Unique ID of the node, also UTHash key
     gpi_node_type_t node_type;
 
-    char id[CSV_MAX_STRING_SIZE]; ///< Unique ID of the node (unique relative to the node type)
-                                  ///< Also UTHash key
-
-    char data[CSV_MAX_STRING_SIZE];  ///< Stores any additional data in the node
-                                     ///< Eg. the name of a PD node, or the type of a resource node
-    char data2[CSV_MAX_STRING_SIZE]; ///< Stores extra data for the node
-    bool extracted;                  ///< whether or not the dependent relations have been extracted
-                                     ///< it's possible a node may be added as a dependency for another node
-                                     ///< before it has been extracted itself
+    const char *data;  ///< Stores any additional data in the node, interned in the model state, or NULL
+                       ///< Eg. the name of a PD node, or the type of a resource node
+    const char *data2; ///< Stores extra data for the node, interned in the model state, or NULL
+    bool extracted;    ///< whether or not the dependent relations have been extracted
+                       ///< it's possible a node may be added as a dependency for another node
+                       ///< before it has been extracted itself
     UT_hash_handle hh;
 } gpi_model_node_t;
 
 typedef struct
 {
-    gpi_edge_type_t type;           ///< Type of edge
-    gpi_cap_t req_type;             ///< For request edges only, type of resource requested
-    char from[CSV_MAX_STRING_SIZE]; ///< Name of the 'from' node
-    char to[CSV_MAX_STRING_SIZE];   ///< Name of the 'to' node
+    gpi_edge_type_t type;      ///< Type of edge
+    gpi_cap_t req_type;        ///< For request edges only, type of resource requested
+    gpi_model_node_key_t from; ///< ID of the 'from' node
+    gpi_model_node_key_t to;   ///< ID of the 'to' node
 } gpi_model_edge_key_t;
 
 typedef struct _gpi_model_edge
@@ -62,62 +72,119 @@ typedef struct _gpi_model_edge
     UT_hash_handle hh;
 } gpi_model_edge_t;
 
-// Generic component storage for portable model states
-typedef struct _gpi_model_state_component
-{
-    gpi_model_component_type_t type; ///< Type of component, node or edge
-
-    union
-    {
-        gpi_model_node_t node;
-        gpi_model_edge_t edge;
-    };
-} gpi_model_state_component_t;
-
 // Entire Model State
 typedef struct
 {
-    gpi_model_node_t *nodes; ///< UTHash table of nodes
-    gpi_model_edge_t *edges; ///< UTHash table of edges
-
-    gpi_model_state_component_t *mem_start; ///< Tracks free memory for structures
-                                            ///< Used only for portable model states
-                                            ///< Otherwise, uses malloc for structures
-    gpi_model_state_component_t *mem_ptr;   ///< Track the current position in the free memory
-    gpi_model_state_component_t *mem_end;   ///< Track the end of the free memory
+    gpi_model_node_t *nodes;     ///< UTHash table of nodes
+    gpi_model_edge_t *edges;     ///< UTHash table of edges
+    gpi_model_string_t *strings; ///< UTHash table of interned strings, in string table order
+    uint32_t n_nodes;            ///< Number of nodes
+    uint32_t n_edges;            ///< Number of edges
+    uint32_t strtab_size;        ///< Size in bytes of the serialized string table
 } model_state_t;
 
+/**
+ * Binary model state format, used to send a model state between PDs
+ * A header is followed by the nodes, the edges (as gpi_model_edge_key_t), and the string table
+ */
+#define GPI_MODEL_BIN_MAGIC 0x4c444f4d // "MODL"
+#define GPI_MODEL_STR_NONE UINT32_MAX  // String table offset for a missing string
+
+typedef struct _gpi_model_bin_header
+{
+    uint32_t magic;       ///< GPI_MODEL_BIN_MAGIC
+    uint32_t n_nodes;     ///< Number of gpi_model_bin_node_t following the header
+    uint32_t n_edges;     ///< Number of gpi_model_edge_key_t following the nodes
+    uint32_t strtab_size; ///< Size in bytes of the string table following the edges
+} gpi_model_bin_header_t;
+
+typedef struct _gpi_model_bin_node
+{
+    gpi_model_node_key_t id; ///< Unique ID of the node
+    uint32_t data;           ///< String table offset of the node data, or GPI_MODEL_STR_NONE
+    uint32_t data2;          ///< String table offset of the node extra data, or GPI_MODEL_STR_NONE
+} gpi_model_bin_node_t;
+
+/**
+ * Journal of changes to the model state's edges, so that a monitor can extract only what changed since an epoch
+ * Each change gets the next epoch, starting from 1, and only the most recent MODEL_JOURNAL_SIZE changes are kept
+ */
+#define MODEL_JOURNAL_SIZE 1024
+
+typedef enum _gpi_journal_op
+{
+    GPI_JOURNAL_ADD_EDGE = 1,
+    GPI_JOURNAL_REMOVE_EDGE,
+} gpi_journal_op_t;
+
+typedef struct _gpi_model_journal_entry
+{
+    uint64_t epoch;            ///< Epoch of the change
+    gpi_journal_op_t op;       ///< Whether the edge was added or removed
+    gpi_model_edge_key_t edge; ///< The edge that changed
+} gpi_model_journal_entry_t;
+
+typedef struct _model_journal
+{
+    gpi_model_journal_entry_t entries[MODEL_JOURNAL_SIZE]; ///< Ring buffer of the most recent changes
+    uint64_t epoch;                                        ///< Epoch of the most recent change, 0 if none
+} model_journal_t;
+
+/**
+ * Sink for a streamed model export
+ * The export calls write with each chunk of output in order, and stops at the first error
+ */
+#define MODEL_EXPORT_CHUNK_SIZE 512                         // Maximum bytes passed to a sink per write
+#define MODEL_EXPORT_ROW_SIZE (CSV_MAX_STRING_SIZE * 7 + 8) // Maximum length of one CSV row
+
+typedef struct _model_export_sink
+{
+    int (*write)(void *cookie, const void *data, size_t len); ///< Returns 0 on success, error otherwise
+    void *cookie;                                             ///< Passed to write
+} model_export_sink_t;
+
 /**
  * Initialize a new model state
  *
  * @param model_state An allocated model state structure to initialize
- * @param free_ptr Pointer to some memory to use for state structures
- *                 If provided, nodes and edges will be stored here
- *                 If NULL, will use malloc instead
- * @param free_size Size in bytes of the memory pointed to by free_ptr, if provided
  */
-void init_model_state(model_state_t *model_state, void *free_ptr, size_t free_size);
+void init_model_state(model_state_t *model_state);
 
 /**
- * Clean up any non-portable data of the model state before sharing with another process
+ * Frees the entire model state
  *
  * @param model_state
  */
-void clean_model_state(model_state_t *model_state);
+void destroy_model_state(model_state_t *model_state);
 
 /**
- * Frees the entire model state
+ * Stream the model state to a sink with CSV formatting
+ * Rows are rendered one at a time, so the output never needs to fit in memory
  *
  * @param model_state
+ * @param sink receives the output in chunks of at most MODEL_EXPORT_CHUNK_SIZE
+ * @return 0 on success, or the first error returned by the sink
  */
-void destroy_model_state(model_state_t *model_state);
+int stream_model_state_csv(model_state_t *model_state, model_export_sink_t *sink);
+
+/**
+ * Stream the model state to a sink in the binary format
+ *
+ * @param model_state
+ * @param sink receives the output in chunks of at most MODEL_EXPORT_CHUNK_SIZE
+ * @return 0 on success, or the first error returned by the sink
+ */
+int stream_model_state_binary(model_state_t *model_state, model_export_sink_t *sink);
 
 /**
  * Export the model state to a buffer with CSV formatting
  *
  * @param model_state
+ * @param buffer receives the null-terminated output
+ * @param len size of the buffer
+ * @return 0 on success, 1 if the buffer was too small and the output was truncated
  */
-void export_model_state(model_state_t *model_state, char *buffer, size_t len);
+int export_model_state(model_state_t *model_state, char *buffer, size_t len);
 
 /**
  * Print the model state to a terminal with CSV formatting
@@ -126,6 +193,16 @@ void export_model_state(model_state_t *model_state, char *buffer, size_t len);
  */
 void print_model_state(model_state_t *model_state);
 
+/**
+ * Write the model state to a file with CSV formatting
+ * The output goes through libc write, so fd can be a file opened through a file system client (e.g. xv6fs)
+ *
+ * @param model_state
+ * @param fd an open file descriptor to write to
+ * @return 0 on success, 1 if a write failed
+ */
+int write_model_state_file(model_state_t *model_state, int fd);
+
 /**
  * Add any nodes and edges from source state to dest state
  *
@@ -133,6 +210,34 @@ void print_model_state(model_state_t *model_state);
  */
 void combine_model_states(model_state_t *dest, model_state_t *src);
 
+/**
+ * Get the size of the model state in the binary format
+ *
+ * @param model_state
+ * @return size in bytes
+ */
+size_t model_state_binary_size(model_state_t *model_state);
+
+/**
+ * Serialize the model state to a buffer in the binary format
+ *
+ * @param model_state
+ * @param buffer the buffer to write to
+ * @param len size of the buffer
+ * @return 0 on success, 1 if the buffer is too small
+ */
+int serialize_model_state(model_state_t *model_state, void *buffer, size_t len);
+
+/**
+ * Add any nodes and edges from a model state in the binary format to dest state
+ *
+ * @param dest
+ * @param buffer a model state serialized by serialize_model_state
+ * @param len size of the buffer
+ * @return 0 on success, 1 if the buffer is not a valid binary model state
+ */
+int combine_model_state_binary(model_state_t *dest, void *buffer, size_t len);
+
 /**
  * Add a resource to the model state, may overwrite node data if it exists, but empty
  *
@@ -157,10 +262,11 @@ gpi_model_node_t *get_resource_node(model_state_t *model_state, gpi_res_id_t res
 /**
  * Add extra data to a node
  *
+ * @param model_state
  * @param node
  * @param extra data to copy to the 'extra' field of the node
  */
-void set_node_extra(gpi_model_node_t *node, char *extra);
+void set_node_extra(model_state_t *model_state, gpi_model_node_t *node, char *extra);
 
 /**
  * Add a resource space to the model state, may overwrite node data if it exists, but empty
@@ -212,26 +318,33 @@ gpi_model_node_t *get_pd_node(model_state_t *model_state, gpi_obj_id_t pd_id);
 gpi_model_node_t *get_root_node(model_state_t *model_state);
 
 /**
- * Generate the string ID for a resource space
+ * Generate the node key for a resource space
  * @param resource_type type of the resource space
  * @param res_space_id unique ID of the resource space
- * @param str_id returns the string ID, must be a buffer of length CSV_MAX_STRING_SIZE
+ * @return the node key
  */
-void get_resource_space_id(gpi_cap_t resource_type, gpi_space_id_t res_space_id, char *str_id);
+gpi_model_node_key_t get_resource_space_key(gpi_cap_t resource_type, gpi_space_id_t res_space_id);
 
 /**
- * Generate the string ID for a resource node
+ * Generate the node key for a resource node
  * @param res_id unique ID of the resource
- * @param str_id returns the string ID, must be a buffer of length CSV_MAX_STRING_SIZE
+ * @return the node key
  */
-void get_resource_id(gpi_res_id_t res_id, char *str_id);
+gpi_model_node_key_t get_resource_key(gpi_res_id_t res_id);
 
 /**
- * Generate the string ID for a PD node from its numeric ID
+ * Generate the node key for a PD node from its numeric ID
  * @param pd_id unique ID of the PD
+ * @return the node key
+ */
+gpi_model_node_key_t get_pd_key(gpi_obj_id_t pd_id);
+
+/**
+ * Generate the string ID of a node, used when exporting the model state
+ * @param key the node key
  * @param str_id returns the string ID, must be a buffer of length CSV_MAX_STRING_SIZE
  */
-void get_pd_id(gpi_obj_id_t pd_id, char *str_id);
+void get_node_str_id(gpi_model_node_key_t key, char *str_id);
 
 /**
  * Functions to add edges to the model state
@@ -251,7 +364,8 @@ void add_edge(model_state_t *model_state, gpi_edge_type_t type, gpi_model_node_t
  * @param from The ID of the source node of the directed edge
  * @param to The ID of the destination node of the directed edge
  */
-void add_edge_by_id(model_state_t *model_state, gpi_edge_type_t type, char *from, char *to);
+void add_edge_by_id(model_state_t *model_state, gpi_edge_type_t type, gpi_model_node_key_t from,
+                    gpi_model_node_key_t to);
 
 /**
  * Add a directed REQUEST edge to the model state
@@ -267,4 +381,33 @@ void add_request_edge(model_state_t *model_state, gpi_model_node_t *from, gpi_mo
  * @param to The ID of the destination node of the directed edge
  * @param req_type The type of object for the request
  */
-void add_request_edge_by_id(model_state_t *model_state, char *from, char *to, gpi_cap_t req_type);
\ No newline at end of file
+void add_request_edge_by_id(model_state_t *model_state, gpi_model_node_key_t from, gpi_model_node_key_t to,
+                            gpi_cap_t req_type);
+
+/**
+ * Record a change to an edge in the journal
+ *
+ * @param journal
+ * @param op whether the edge was added or removed
+ * @param type The edge type
+ * @param from The ID of the source node of the directed edge
+ * @param to The ID of the destination node of the directed edge
+ * @param req_type For request edges only, the type of object for the request
+ */
+void model_journal_record(model_journal_t *journal, gpi_journal_op_t op, gpi_edge_type_t type,
+                          gpi_model_node_key_t from, gpi_model_node_key_t to, gpi_cap_t req_type);
+
+/**
+ * Read the changes in the journal after an epoch, in epoch order
+ *
+ * @param journal
+ * @param since_epoch return changes after this epoch
+ * @param entries returns the changes
+ * @param max_entries maximum number of changes to return
+ * @param n_entries returns the number of changes returned
+ * @param epoch returns the epoch of the last change returned, or since_epoch if there were none
+ * @param done returns true if there are no more changes after epoch
+ * @return 0 on success, 1 if the journal no longer holds all changes since since_epoch
+ */
+int model_journal_read(model_journal_t *journal, uint64_t since_epoch, gpi_model_journal_entry_t *entries,
+                       uint32_t max_entries, uint32_t *n_entries, uint64_t *epoch, bool *done);
@@ -21,6 +21,14 @@
 
 #define PD_MAX_ARGC 8 // Should be the same as the length of the args array in the protobuf file
 
+// Should be the same as the lengths of the arrays in PdSpawnMessage in the protobuf file
+#define PD_SPAWN_MAX_VMRS 8
+#define PD_SPAWN_MAX_RDES 16
+#define PD_SPAWN_MAX_RES_TYPES 8
+
+// Maximum number of slots in one lease, bounded by the width of the bitmap in PdReturnSlotsMessage
+#define PD_SLOT_LEASE_MAX 64
+
 /** PD CREATION / INITIALIZATION **/
 
 /**
@@ -112,6 +120,28 @@ int pd_client_runtime_setup(pd_client_context_t *target_pd,
                             void *ipc_buf_addr,
                             void *osm_data_in_PD);
 
+/**
+ * @brief Performs all the steps of sel4gpi_prepare_pd in a single request to the PD component.
+ * Only supports process-style configurations, see sel4gpi_spawn_pd for the restrictions.
+ * The VMR configs in cfg are updated with the allocated addresses and MOs, cfg->fault_ep
+ * is filled in with a newly allocated fault endpoint, and cfg->osm_data with the OSmosis data address.
+ * If the request fails, the MOs and fault EP allocated for the caller are released again.
+ *
+ * @param target_pd the PD to spawn
+ * @param target_ads the PD's ADS
+ * @param target_cpu the PD's CPU
+ * @param cfg the configuration to follow
+ * @param argc the number of arguments to pass to the PD
+ * @param args the arguments
+ * @return int 0 on success
+ */
+int pd_client_spawn(pd_client_context_t *target_pd,
+                    ads_client_context_t *target_ads,
+                    cpu_client_context_t *target_cpu,
+                    pd_config_t *cfg,
+                    int argc,
+                    seL4_Word *args);
+
 /**
  * @brief shares all resources of the given type from src_pd to dest_pd
  *
@@ -157,6 +187,35 @@ int pd_client_free_slot(pd_client_context_t *conn,
 int pd_client_clear_slot(pd_client_context_t *conn,
                          seL4_CPtr slot);
 
+/**
+ * @brief Lease a contiguous range of free slots in the PD's cspace.
+ * The root task may return fewer slots than requested, but at least one.
+ * The slots stay allocated until they are returned with pd_client_return_slots.
+ *
+ * @param conn client connection object
+ * @param count maximum number of slots to lease, at most PD_SLOT_LEASE_MAX
+ * @param base returns the first leased slot
+ * @param n_slots returns the number of slots leased
+ * @return int returns 0 on success, 1 on failure
+ */
+int pd_client_lease_slots(pd_client_context_t *conn,
+                          uint32_t count,
+                          seL4_CPtr *base,
+                          uint32_t *n_slots);
+
+/**
+ * @brief Free a set of slots in the PD's cspace in one request.
+ * Any capabilities in the slots will be deleted.
+ *
+ * @param conn client connection object
+ * @param base first slot of the range
+ * @param bitmap bit i is set if slot (base + i) should be freed
+ * @return int returns 0 on success, 1 on failure
+ */
+int pd_client_return_slots(pd_client_context_t *conn,
+                           seL4_CPtr base,
+                           uint64_t bitmap);
+
 /** RESOURCE SERVER PD OPERATIONS **/
 
 /**
@@ -199,6 +258,39 @@ int pd_client_map_resource(pd_client_context_t *conn,
  */
 int pd_client_get_work(pd_client_context_t *conn, PdWorkReturnMessage *work);
 
+/**
+ * For a PD that caches resources to start or stop receiving INVALIDATE work
+ * The root task publishes the number of such PDs as n_invalidation_pds in every PD's shared data
+ *
+ * @param conn the PD's own pd connection
+ * @param accept true to receive invalidations, false to stop
+ * @return 0 on success, error otherwise
+ */
+int pd_client_accept_invalidations(pd_client_context_t *conn, bool accept);
+
+/**
+ * For a PD that caches resources to collect pending invalidations
+ * These are only queued if the PD called pd_client_accept_invalidations,
+ * and n_pending_invalidations in the shared data is non-zero while any are pending
+ *
+ * @param conn the PD's own pd connection
+ * @param work returns up to 16 invalidated resources, or action NO_WORK if there are none
+ *             an object ID of BADGE_OBJ_ID_NULL means all resources are invalidated
+ * @return 0 on success, error otherwise
+ */
+int pd_client_get_invalidations(pd_client_context_t *conn, PdWorkReturnMessage *work);
+
+/**
+ * For a resource server to tell PDs that cache one of its resources that it was modified
+ * The server can skip this when n_invalidation_pds in its shared data is zero
+ *
+ * @param conn the resource server's pd connection
+ * @param res_id the modified resource
+ * @param except_pd_id the PD that made the change, which is not told, or BADGE_OBJ_ID_NULL
+ * @return 0 on success, error otherwise
+ */
+int pd_client_invalidate(pd_client_context_t *conn, gpi_res_id_t res_id, gpi_obj_id_t except_pd_id);
+
 /**
  * @brief For a resource server to send a subgraph as a response to pd_client_get_work of type PdWorkAction_EXTRACT
  *
@@ -265,6 +357,27 @@ int pd_client_link_child(pd_client_context_t *parent, pd_client_context_t *child
 int pd_client_dump(pd_client_context_t *conn,
                    char *buf, size_t size);
 
+/**
+ * @brief Get the changes to the model's hold, request, and map edges since an epoch
+ * The root task journals these changes as they happen, so this does not walk any PD or contact resource servers
+ * Changes are written to the MO as gpi_model_journal_entry_t, in epoch order
+ * To continue, call again with the returned epoch, until done is set
+ * Map edges added by resource servers with pd_client_map_resource are never removed, since there is no unmap request
+ *
+ * @param conn client connection object
+ * @param mo OPTIONAL memory object to receive the changes, if NULL, only returns the current epoch
+ *           must hold at least one gpi_model_journal_entry_t
+ * @param since_epoch return changes after this epoch, use 0 for all changes since boot
+ * @param n_entries returns the number of changes written to the MO
+ * @param epoch returns the epoch of the last change returned
+ * @param done returns true if there are no more changes after epoch
+ * @return int 0 on success,
+ *         PdComponentError_JOURNAL_TRUNCATED if the changes since the epoch are no longer journaled,
+ *         and a full dump is needed instead, error otherwise
+ */
+int pd_client_dump_delta(pd_client_context_t *conn, mo_client_context_t *mo, uint64_t since_epoch,
+                         uint32_t *n_entries, uint64_t *epoch, bool *done);
+
 #ifdef CONFIG_DEBUG_BUILD
 /**
  * @brief Assign a human-readable name to a PD, for debug / model extraction
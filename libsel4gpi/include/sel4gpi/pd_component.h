@@ -33,13 +33,16 @@
 
 #define PD_TERMINATED_CODE 127
 
+// Maximum number of INVALIDATE work entries queued for a PD before they are merged into one
+#define PD_INVALIDATE_WORK_MAX 16
+
 // Data to send when a PD requests work
 typedef struct _pd_work_entry
 {
     gpi_res_id_t res_id;       ///< Identifier of the resource the work is for
     gpi_obj_id_t client_pd_id; ///< Identifier of the PD the work is for
                                ///< For model extraction: The client PD that held the resource we are extracting
-                               ///< For resource free: Currently unused
+                               ///< For resource free: The PD that freed the resource
     bool is_critical;          ///< If true, this work is to be counted as essential for some pending operation
                                ///< Eg. this work is to free something as part of a PD termination
 } pd_work_entry_t;
@@ -85,7 +88,7 @@ int pd_add_resource_by_id(gpi_obj_id_t pd_id,
 #if TRACK_MAP_RELATIONS
 /***
  * Map one resource to another
- * At the moment this does nothing but check that the mapping is valid
+ * At the moment this only checks that the mapping is valid and records it in the model journal
  *
  * @param client_pd_id ID of the PD that is requesting the mapping
  * @param src_res_id the universal ID of the source resource
@@ -93,6 +96,16 @@ int pd_add_resource_by_id(gpi_obj_id_t pd_id,
  * @return 0 on success, error otherwise
  */
 int pd_component_map_resources(gpi_obj_id_t client_pd_id, gpi_obj_id_t src_res_id, gpi_obj_id_t dest_res_id);
+
+/***
+ * Record that a mapping made with pd_component_map_resources was torn down
+ * Only the root task's own mappings are removed this way, resource servers have no unmap request,
+ * so the map edges they add stay in model deltas until a full extraction
+ *
+ * @param src_res_id the universal ID of the source resource
+ * @param dest_res_id the universal ID of the destination resource
+ */
+void pd_component_unmap_resources(gpi_badge_t src_res_id, gpi_badge_t dest_res_id);
 #endif
 
 /**
@@ -181,6 +194,15 @@ void pd_component_queue_destroy_work(pd_component_registry_entry_t *pd_entry, pd
  */
 void pd_component_queue_notify_send_work(pd_component_registry_entry_t *pd_entry, pd_work_entry_t *work);
 
+/**
+ * Queue an invalidation for a PD that caches one of its held resources
+ * If too many invalidations are pending, they are merged into one for all resources
+ *
+ * @param pd_entry the PD to queue work for
+ * @param work the details of the work
+ */
+void pd_component_queue_invalidate_work(pd_component_registry_entry_t *pd_entry, pd_work_entry_t *work);
+
 /**
  * Allocate a PD from the root task
  *
@@ -61,6 +61,8 @@ typedef enum _gpi_share_degree
     GPI_SHARED = 1, ///< this resource is directly shared with the other PD,
                     ///< e.g. virt pages that map to the same phys page
     GPI_DISJOINT,   ///< this resource exists in the other PD, but has no relation with the source PD
+    GPI_COW,        ///< this resource initially maps the same phys pages read-only in both PDs,
+                    ///< a page is copied on its first write fault (see sel4gpi_handle_cow_fault)
 } gpi_share_degree_t;
 
 /**
@@ -68,18 +70,22 @@ typedef enum _gpi_share_degree
  *
  * Sharing mode dictates which options are optional and/or ignored
  *
- * +--------------+------------+--------------+-----------------------------------------+
- * |    Option    | GPI_SHARED | GPI_DISJOINT |         Default (when optional)         |
- * +--------------+------------+--------------+-----------------------------------------+
- * | type         | required   | required     |                                         |
- * | start        | required   | optional     | any available vaddr                     |
- * | dest_start   | optional   | ignored      | `start`                                 |
- * | region_pages | required^1 | required     |                                         |
- * | page_bits    | ignored    | optional     | 4K pages (ARM specific)                 |
- * | mo           | ignored    | optional     | new MO will be allocated                |
- * +--------------+------------+--------------+-----------------------------------------+
+ * +--------------+---------------------+--------------+-----------------------------------------+
+ * |    Option    | GPI_SHARED, GPI_COW | GPI_DISJOINT |         Default (when optional)         |
+ * +--------------+---------------------+--------------+-----------------------------------------+
+ * | type         | required            | required     |                                         |
+ * | start        | required            | optional     | any available vaddr                     |
+ * | dest_start   | optional            | ignored      | `start`                                 |
+ * | region_pages | required^1          | required     |                                         |
+ * | page_bits    | ignored             | optional     | 4K pages (ARM specific)                 |
+ * | mo           | ignored             | optional     | new MO will be allocated                |
+ * +--------------+---------------------+--------------+-----------------------------------------+
  * 1 = optional if type != SHARED_FRAMES or GENERIC, the VMR will be searched
  *     for by type, and info will be taken from the found VMR
+ *
+ * GPI_COW regions are mapped read-only in both the source and destination PDs, so a page is copied on
+ * the first write from either side. Both PDs' fault handlers must forward write faults to sel4gpi_handle_cow_fault.
+ * A region whose pages were already copied by an earlier GPI_COW share cannot be shared copy-on-write again.
  */
 typedef struct _vmr_config
 {
@@ -139,6 +145,7 @@ typedef struct _rde_config
 typedef struct _pd_config
 {
     mo_client_context_t osm_data_mo; ///< the MO for holding a PD's OSmosis data
+    void *osm_data;                  ///< OUT: vaddr of the OSmosis data MO in the PD's ADS, once prepared
     ads_config_t ads_cfg;            ///< the ADS config
     linked_list_t *rde_cfg;          ///< the RDE config
     linked_list_t *gpi_res_type_cfg; ///< a list of GPICAP_TYPE_X resource types,
@@ -200,6 +207,20 @@ pd_config_t *sel4gpi_configure_thread(void *thread_fn, ep_client_context_t *faul
  */
 int sel4gpi_prepare_pd(pd_config_t *cfg, sel4gpi_runnable_t *runnable, int argc, seL4_Word *args);
 
+/**
+ * @brief same as sel4gpi_prepare_pd, but the PD component performs all of the setup in a single request.
+ * This applies to process-style configs (see sel4gpi_configure_process): a CODE VMR that loads an ELF,
+ * only GPI_DISJOINT VMRs without provided MOs, no elevated CPU, and no provided or badged fault EP.
+ * Any other config falls back to sel4gpi_prepare_pd.
+ *
+ * @param cfg the configuration of resources to follow
+ * @param runnable a runnable struct with the PD, ADS, and CPU contexts populated
+ * @param argc the number of arguments to pass to the PD
+ * @param args the arguments
+ * @return int returns 0 on success, 1 on failure
+ */
+int sel4gpi_spawn_pd(pd_config_t *cfg, sel4gpi_runnable_t *runnable, int argc, seL4_Word *args);
+
 /**
  * @brief start a prepared PD (via cpu_start)
  *
@@ -208,6 +229,17 @@ int sel4gpi_prepare_pd(pd_config_t *cfg, sel4gpi_runnable_t *runnable, int argc,
  */
 int sel4gpi_start_pd(sel4gpi_runnable_t *runnable);
 
+/**
+ * @brief resolve a write fault on a GPI_COW region of a PD, by giving the PD a private copy of the page
+ * Must be called from the PD's fault handler, before the next receive on the fault endpoint.
+ * On success, the caller should reply to the fault to resume the faulting thread.
+ *
+ * @param runnable the runnable of the faulting PD
+ * @param fault_tag the message info received on the PD's fault endpoint
+ * @return int returns 0 if the fault was resolved, 1 if it is not a write fault on a GPI_COW region
+ */
+int sel4gpi_handle_cow_fault(sel4gpi_runnable_t *runnable, seL4_MessageInfo_t fault_tag);
+
 /* helpers to get commonly used PD configurations */
 /**
  * @brief populates a config with PD options that describe a process
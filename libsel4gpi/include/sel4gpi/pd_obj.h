@@ -89,14 +89,54 @@ typedef struct _pd_hold_node
 
     gpi_res_id_t res_id;
 
+    struct _pd *pd;                      ///< PD holding the resource
+    struct _pd_hold_node *holder_next;   ///< Next hold node for the same resource, in another PD
+    struct _pd_hold_node *holder_prev;   ///< Previous hold node for the same resource, in another PD
+    struct _pd_hold_node *space_next;    ///< Next resource from the same space held by this PD
+    struct _pd_hold_node *space_prev;    ///< Previous resource from the same space held by this PD
 } pd_hold_node_t;
 
+/**
+ * Index entry for all the hold nodes of one resource, across PDs
+ */
+typedef struct _pd_holder_index
+{
+    UT_hash_handle hh;
+    gpi_badge_t res_key;   ///< Compact resource ID, key for the UTHash
+    pd_hold_node_t *head;  ///< Hold nodes of PDs holding the resource
+    size_t count;          ///< Number of PDs holding the resource
+} pd_holder_index_t;
+
+/**
+ * Index entry for the resources a PD holds from one resource space
+ */
+typedef struct _pd_space_index
+{
+    UT_hash_handle hh;
+    gpi_space_id_t space_id; ///< Key for the UTHash
+    pd_hold_node_t *head;    ///< Hold nodes of resources from the space
+    size_t count;            ///< Number of resources held from the space
+} pd_space_index_t;
+
 typedef struct _pd_link_node
 {
     resource_registry_node_t gen;
     gpi_obj_id_t linked_pd_id;
 } pd_link_node_t;
 
+/* Maximum number of slot leases a PD holds at once */
+#define PD_SLOT_MAX_LEASES 4
+
+/**
+ * A contiguous range of slots a PD leased from the root task
+ */
+typedef struct _pd_slot_lease
+{
+    seL4_CPtr base; ///< first slot of the lease
+    uint64_t owned; ///< bit i is set if slot (base + i) is still leased, 0 if the entry is unused
+    uint64_t free;  ///< bit i is set if slot (base + i) is leased and free
+} pd_slot_lease_t;
+
 /**
  * The data given to initialize a new Osmosis PD
  */
@@ -113,6 +153,14 @@ typedef struct _osm_pd_shared_data
     osmosis_rde_t rde[GPICAP_TYPE_MAX][MAX_NS_PER_RDE];              ///< Resource directory
     uint64_t rde_count;
 
+    volatile uint32_t n_pending_invalidations; ///< Number of queued INVALIDATE work entries, set by the RT
+                                               ///< so the PD can check for them without an RPC
+    volatile uint32_t n_invalidation_pds;      ///< Number of PDs that accept INVALIDATE work, set by the RT
+                                               ///< so a resource server can skip invalidating when there are none
+
+    pd_slot_lease_t slot_leases[PD_SLOT_MAX_LEASES]; ///< Slots leased from the RT, only used by the PD itself
+                                                     ///< kept here since thread PDs share the ADS but not the cspace
+
     seL4_CPtr reply_cap;           ///< For resource servers, store the reply cap of the
                                    ///< request that is currently being processed
     char test_name[TEST_NAME_MAX]; ///< For a test process, the name of the test to run
@@ -144,6 +192,7 @@ typedef struct _pd
     vka_t *pd_vka;                                          ///< Allocator for the PD's cspace
     char allocator_mem_pool[PD_ALLOCATOR_STATIC_POOL_SIZE]; ///< Memory pool to bootstrap the PD's VKA
     resource_registry_t hold_registry;                      ///< Registry of PD's resources
+    pd_space_index_t *hold_by_space;                        ///< Held resources, indexed by resource space
     resource_registry_t linked_registry;                    ///< Registry of PDs which are linked to this one
                                                             ///< Destruction of this PD will destroy all linked PDs
 
@@ -154,6 +203,7 @@ typedef struct _pd
     /* other general PD metadata */
     int exit_code;      ///< Value of PD's exit code
     bool deleting;      ///< Set to true while the PD is being deleted
+    bool accept_invalidations; ///< True if the PD caches resources, to receive INVALIDATE work
     bool to_delete;     ///< true if PD is marked for deletion
     int deletion_depth; ///< If the PD is being deleted as a result of another PD, this is the recursive depth
 } pd_t;
@@ -239,6 +289,33 @@ int pd_free_slot(pd_t *pd,
 int pd_clear_slot(pd_t *pd,
                   seL4_CPtr slot);
 
+/**
+ * @brief Allocate a contiguous range of free slots from the PD's cspace
+ * Stops at the first slot that would not extend the range, so fewer than `count` slots may be returned
+ *
+ * @param pd the target PD
+ * @param count maximum number of slots to allocate
+ * @param base returns the first allocated slot
+ * @param n_slots returns the number of slots allocated, at least 1 on success
+ * @return 0 on success, error otherwise
+ */
+int pd_lease_slots(pd_t *pd,
+                   uint32_t count,
+                   seL4_CPtr *base,
+                   uint32_t *n_slots);
+
+/**
+ * @brief Clear and free a set of slots from the PD's cspace
+ *
+ * @param pd the target PD
+ * @param base first slot of the range
+ * @param bitmap bit i is set if slot (base + i) should be freed
+ * @return 0 on success, otherwise the first error, slots that could not be cleared stay allocated
+ */
+int pd_return_slots(pd_t *pd,
+                    seL4_CPtr base,
+                    uint64_t bitmap);
+
 /**
  * Bootstraps a VKA allocator for the PD's cspace
  * Requires an existing 1-level cspace
@@ -342,6 +419,15 @@ bool pd_has_resources_in_space(pd_t *pd, gpi_space_id_t space_id);
  */
 int pd_remove_resources_in_space(pd_t *pd, gpi_space_id_t space_id);
 
+/**
+ * @brief Get the IDs of all PDs holding a resource
+ *
+ * @param res_id the resource to look up
+ * @param ret_count returns the number of PDs holding the resource
+ * @return an array of PD IDs which the caller must free, or NULL if no PD holds the resource
+ */
+gpi_obj_id_t *pd_get_resource_holders(gpi_res_id_t res_id, size_t *ret_count);
+
 /**
  * @brief gets all resources of the given type that belongs to the given PD
  *
@@ -142,10 +142,47 @@ seL4_CPtr sel4gpi_get_reply_cap(void);
  * For a resource manager to clear the reply ap.
  * This should be called when a request is complete.
  * 
- * This function will make IPC calls to the root task to clear / reallocate the reply cap slot
+ * The reply cap slot is allocated and cleared with sel4gpi_alloc_slot / sel4gpi_clear_slot
 */
 void sel4gpi_clear_reply_cap(void);
 
+/** SLOT ALLOCATION **/
+
+/**
+ * Allocate a free slot in this PD's cspace
+ * With PD_SLOT_LEASE_SIZE > 0, this only calls the root task when no leased slot is free.
+ * This function is not thread-safe.
+ *
+ * @param slot returns the allocated slot
+ * @return 0 on success, error otherwise
+ */
+int sel4gpi_alloc_slot(seL4_CPtr *slot);
+
+/**
+ * Free a slot in this PD's cspace, deleting any capability in it
+ * A leased slot is kept for reuse, and whole free leases are returned to the root task.
+ *
+ * @param slot the slot to free
+ * @return 0 on success, error otherwise
+ */
+int sel4gpi_free_slot(seL4_CPtr slot);
+
+/**
+ * Delete the capability in a slot of this PD's cspace, without freeing the slot
+ * With PD_SLOT_LEASE_SIZE > 0, the capability is deleted locally without calling the root task.
+ *
+ * @param slot the slot to clear
+ * @return 0 on success, error otherwise
+ */
+int sel4gpi_clear_slot(seL4_CPtr slot);
+
+/**
+ * Return every free leased slot to the root task, one RPC per lease
+ *
+ * @return 0 on success, error otherwise
+ */
+int sel4gpi_return_free_slots(void);
+
 /** OTHER UTIL FUNCTIONS **/
 
 /**
@@ -228,3 +265,11 @@ int sel4gpi_copy_data_to_mo(void *vaddr, size_t size_bytes, mo_client_context_t
  * @param range byte range to dump
  */
 void debug_print_mem_at(void *start_addr, uint32_t range);
+
+/**
+ * @brief checks if the VM fault in the current IPC buffer was caused by a write
+ * Must be called after receiving a seL4_Fault_VMFault, before the message registers are overwritten
+ *
+ * @return true if the fault is a data write fault, false otherwise
+ */
+bool sel4gpi_is_write_fault(void);
@@ -0,0 +1,69 @@
+/**
+ * @file range_tree.h
+ * @brief Ordered index of non-overlapping address ranges, as an intrusive AVL tree
+ * @version 0.1
+ * @date 2024-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * A range in the tree, embed this in the indexed structure
+ */
+typedef struct _range_tree_node
+{
+    uintptr_t start; ///< First address of the range
+    uintptr_t end;   ///< First address after the range
+
+    struct _range_tree_node *left;
+    struct _range_tree_node *right;
+    int height;
+} range_tree_node_t;
+
+typedef struct _range_tree
+{
+    range_tree_node_t *root;
+    size_t count;
+} range_tree_t;
+
+/**
+ * @brief inserts a range into the tree, the caller sets the node's start and end
+ *
+ * @param tree an existing tree
+ * @param node the node to insert
+ * @return int 0 on success, 1 if the range is empty or overlaps a range already in the tree
+ */
+int range_tree_insert(range_tree_t *tree, range_tree_node_t *node);
+
+/**
+ * @brief removes a range from the tree
+ *
+ * @param tree an existing tree
+ * @param node a node previously inserted in the tree
+ */
+void range_tree_remove(range_tree_t *tree, range_tree_node_t *node);
+
+/**
+ * @brief finds the range containing an address
+ *
+ * @param tree an existing tree
+ * @param addr the address to look for
+ * @return range_tree_node_t* the range containing addr, or NULL if there is none
+ */
+range_tree_node_t *range_tree_find(range_tree_t *tree, uintptr_t addr);
+
+/**
+ * @brief finds a range overlapping [start, end)
+ *
+ * @param tree an existing tree
+ * @param start first address of the range to check
+ * @param end first address after the range to check
+ * @return range_tree_node_t* the first range overlapping [start, end), or NULL if there is none
+ */
+range_tree_node_t *range_tree_find_overlap(range_tree_t *tree, uintptr_t start, uintptr_t end);
@@ -25,6 +25,9 @@
 
 #define BENCHMARK_RESOURCE_SERVER 0
 
+// Number of client MOs a resource server keeps attached between requests
+#define RESOURCE_SERVER_MO_CACHE_SIZE 8
+
 // Could use the server's debug function instead
 #if RESOURCE_SERVER_DEBUG
 #define RESOURCE_SERVER_PRINTF(...)                                       \
@@ -40,6 +43,19 @@
 #define RESOURCE_SERVER_PRINTF(...)
 #endif
 
+/**
+ * A client MO that stays attached to the server's ADS between requests
+ */
+typedef struct _resource_server_mo_cache_entry
+{
+    bool valid;             ///< True if the entry holds an attached MO
+    gpi_obj_id_t client_id; ///< ID of the client PD that sent the MO
+    gpi_obj_id_t mo_id;     ///< ID of the attached MO
+    void *vaddr;            ///< Where the MO is attached in the server's ADS
+    size_t size;            ///< Size of the MO in bytes
+    uint64_t last_used;     ///< Value of the cache clock when the entry was last used
+} resource_server_mo_cache_entry_t;
+
 /**
  * Generic resource server context
  */
@@ -75,6 +91,9 @@ typedef struct _resource_server_context
     ep_client_context_t server_ep; ///< The server's own endpoint that it listens for requests on
 
     seL4_CPtr mcs_reply; ///< Unused
+
+    resource_server_mo_cache_entry_t mo_cache[RESOURCE_SERVER_MO_CACHE_SIZE]; ///< Recently used client MOs
+    uint64_t mo_cache_clock;                                                  ///< Incremented on every cache access
 } resource_server_context_t;
 
 /**
@@ -119,10 +138,12 @@ int resource_server_main(void *context_v);
  * Attach a MO from a client request to the server's ADS
  * @param mo_cap The MO cap to attach
  * @param vaddr Returns the vaddr where MO was attached
+ * @param size Returns the size of the MO in bytes (optional)
  */
 int resource_server_attach_mo(resource_server_context_t *context,
                               seL4_CPtr mo_cap,
-                              void **vaddr);
+                              void **vaddr,
+                              size_t *size);
 
 /**
  * Remove a previously attached MO from the server's ADS
@@ -131,6 +152,34 @@ int resource_server_attach_mo(resource_server_context_t *context,
 int resource_server_unattach(resource_server_context_t *context,
                              void *vaddr);
 
+/**
+ * Get a client's MO attached to the server's ADS, reusing an attachment from a previous request if possible
+ * The MO stays attached until it is evicted or released, so do not unattach it
+ *
+ * The cache is keyed by the client PD and the MO ID the client claims to send, a client can only
+ * reach MOs it sent earlier. On a miss, the received cap is attached and cached under its real ID.
+ *
+ * @param client_id ID of the client PD, from the request's badge
+ * @param mo_id ID of the MO, as given by the client
+ * @param mo_cap The MO cap received with the request
+ * @param vaddr Returns the vaddr where MO is attached
+ * @param size Returns the size of the MO in bytes (optional)
+ */
+int resource_server_attach_client_mo(resource_server_context_t *context,
+                                     gpi_obj_id_t client_id,
+                                     gpi_obj_id_t mo_id,
+                                     seL4_CPtr mo_cap,
+                                     void **vaddr,
+                                     size_t *size);
+
+/**
+ * Unattach the cached MOs of a client
+ *
+ * @param client_id ID of the client PD, or BADGE_OBJ_ID_NULL to release the MOs of all clients
+ */
+int resource_server_release_client_mos(resource_server_context_t *context,
+                                       gpi_obj_id_t client_id);
+
 /**
  * Notifies the PD component of a resource that is created, but not yet
  * given to a client PD
@@ -175,7 +224,7 @@ int resource_server_new_res_space(resource_server_context_t *context,
  * @param context
  * @param n_pages number of pages to allocate for the MO
  * @param mo this structure will be filled out with the MO allocated for model extraction
- * @param ms returns the location of the model state
+ * @param ms returns the model state to fill in, freed by resource_server_extraction_finish
  * @return 0 on success, error otherwise
  */
 int resource_server_extraction_setup(resource_server_context_t *context,
@@ -185,10 +234,12 @@ int resource_server_extraction_setup(resource_server_context_t *context,
 
 /**
  * Finish model extraction by sending the result to the RT and destroying the allocated MO
+ * The MO and model state are destroyed even if sending fails
+ * The model state is sent in the binary format, so it must fit in the MO
  *
  * @param context
  * @param mo the MO allocated for model extraction
- * @param ms returns the location of the model state
+ * @param ms the model state from resource_server_extraction_setup
  * @param n_work the number of work requests being fulfilled
  * @return 0 on success, error otherwise
  */
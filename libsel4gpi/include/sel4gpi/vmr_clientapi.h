@@ -52,7 +52,7 @@ int vmr_client_attach(ads_vmr_context_t *reservation,
  *
  * @param vmr_rde the endpoint for the VMR space
  * @param vaddr virtual address to attach at, can be NULL
- * @param mo_cap MO cap of the memory to attach
+ * @param mo_cap MO cap of the memory to attach, its ID is set to the attached MO's ID on success
  * @param vmr_type the type of virtual memory (e.g. stack, heap, ipc buffer)
  * @param ret_vaddr virtual address where the MO was attached.
  * @return int 0 on success, 1 on failure.
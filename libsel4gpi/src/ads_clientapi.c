@@ -96,6 +96,7 @@ int ads_client_shallow_copy(ads_client_context_t *src_ads, ads_client_context_t
             .type = (uint32_t)vmr_cfg->type,
             .src_vaddr = (uint64_t)vmr_cfg->start,
             .dest_vaddr = (uint64_t)vmr_cfg->dest_start,
+            .share_mode = (uint32_t)vmr_cfg->share_mode,
         }};
 
     AdsReturnMessage ret_msg = {0};
@@ -107,6 +108,27 @@ int ads_client_shallow_copy(ads_client_context_t *src_ads, ads_client_context_t
     return error;
 }
 
+int ads_client_cow_fault(ads_client_context_t *ads, void *vaddr)
+{
+    OSDB_PRINTF("Sending copy-on-write fault request to ADS component\n");
+
+    int error = 0;
+
+    AdsMessage msg = {
+        .magic = ADS_RPC_MAGIC,
+        .which_msg = AdsMessage_cow_fault_tag,
+        .msg.cow_fault = {
+            .vaddr = (uint64_t)vaddr,
+        }};
+
+    AdsReturnMessage ret_msg = {0};
+
+    error = sel4gpi_rpc_call(&rpc_env, ads->ep, (void *)&msg, 0, NULL, (void *)&ret_msg);
+    error |= ret_msg.errorCode;
+
+    return error;
+}
+
 int ads_client_get_reservation(ads_client_context_t *ads, sel4utils_reservation_type_t res_type,
                                void **ret_vaddr, size_t *ret_num_pages, size_t *ret_page_bits)
 {
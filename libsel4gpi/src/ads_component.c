@@ -227,11 +227,20 @@ static void handle_vmr_attach_no_reserve_req(seL4_Word sender_badge,
                         cap_type_to_str(get_cap_type_from_badge(mo_badge)), mo_badge);
 
     error = ads_component_attach(ads_id, mo_id, vmr_type, vaddr, &vaddr);
+    SERVER_GOTO_IF_ERR(error, "Failed to attach MO (%u) to ADS (%u)\n", mo_id, ads_id);
 
     OSDB_PRINTF("Successfully reserved an ads region (%s) at %p and attached MO (%u).\n",
                 human_readable_va_res_type(vmr_type), vaddr, mo_id);
 
     reply_msg->msg.attach_no_reserve.vaddr = (uint64_t)vaddr;
+    reply_msg->msg.attach_no_reserve.mo_id = mo_id;
+
+    mo_component_registry_entry_t *mo_reg = (mo_component_registry_entry_t *)
+        resource_component_registry_get_by_id(get_mo_component(), mo_id);
+    if (mo_reg != NULL)
+    {
+        reply_msg->msg.attach_no_reserve.size = (uint64_t)mo_reg->mo.num_pages * BIT(mo_reg->mo.page_bits);
+    }
 
 err_goto:
     reply_msg->which_msg = AdsReturnMessage_attach_no_reserve_tag;
@@ -353,7 +362,8 @@ static void handle_copy_req(seL4_Word sender_badge, AdsShallowCopyMessage *msg,
     vmr_config_t cfg = {.start = (void *)msg->src_vaddr,
                         .dest_start = (void *)msg->dest_vaddr,
                         .region_pages = msg->pages,
-                        .type = (sel4utils_reservation_type_t)msg->type};
+                        .type = (sel4utils_reservation_type_t)msg->type,
+                        .share_mode = (gpi_share_degree_t)msg->share_mode};
 
     error = ads_shallow_copy(get_ads_component()->server_vspace, get_ads_component()->server_vka,
                              &src_ads_data->ads, &dst_ads_data->ads, &cfg);
@@ -451,6 +461,29 @@ err_goto:
     reply_msg->errorCode = error;
 }
 
+static void handle_cow_fault_request(seL4_Word sender_badge,
+                                     AdsCowFaultMessage *msg,
+                                     AdsReturnMessage *reply_msg)
+{
+    OSDB_PRINTF("Got copy-on-write fault request from Client: ");
+    BADGE_PRINT(sender_badge);
+
+    int error = 0;
+
+    // Find the faulting ADS
+    ads_component_registry_entry_t *target_ads = (ads_component_registry_entry_t *)
+        resource_component_registry_get_by_badge(get_ads_component(), sender_badge);
+    SERVER_GOTO_IF_COND(target_ads == NULL, "Couldn't find target ADS (%u)\n",
+                        get_object_id_from_badge(sender_badge));
+
+    error = ads_cow_fault(get_ads_component()->server_vspace, get_ads_component()->server_vka,
+                          &target_ads->ads, (void *)msg->vaddr);
+
+err_goto:
+    reply_msg->which_msg = AdsReturnMessage_basic_tag;
+    reply_msg->errorCode = error;
+}
+
 static void handle_disconnect_request(seL4_Word sender_badge,
                                       AdsDisconnectMessage *msg,
                                       AdsReturnMessage *reply_msg)
@@ -683,6 +716,9 @@ static void ads_component_handle(void *msg_p,
         case AdsMessage_disconnect_tag:
             handle_disconnect_request(sender_badge, &msg->msg.disconnect, reply_msg);
             break;
+        case AdsMessage_cow_fault_tag:
+            handle_cow_fault_request(sender_badge, &msg->msg.cow_fault, reply_msg);
+            break;
         default:
             SERVER_GOTO_IF_COND(1, "Unknown request received: %u\n", msg->which_msg);
             break;
@@ -825,7 +861,7 @@ int ads_component_rm_by_id(gpi_obj_id_t ads_id, gpi_obj_id_t vmr_id)
     SERVER_GOTO_IF_COND(ads_entry == NULL, "Couldn't find ADS (%u)\n", ads_id);
 
     attach_node_t *attach_node = ads_get_res_by_id(&ads_entry->ads, vmr_id);
-    SERVER_GOTO_IF_COND(ads_entry == NULL, "Couldn't find VMR (%u)\n", vmr_id);
+    SERVER_GOTO_IF_COND(attach_node == NULL, "Couldn't find VMR (%u)\n", vmr_id);
     error = ads_rm(&ads_entry->ads, get_ads_component()->server_vka, attach_node->vaddr);
 
 err_goto:
@@ -846,6 +882,28 @@ err_goto:
     return error;
 }
 
+int ads_component_rm_mo(gpi_obj_id_t mo_id)
+{
+    resource_registry_node_t *curr_ads, *tmp_ads;
+    HASH_ITER(hh, get_ads_component()->registry.head, curr_ads, tmp_ads)
+    {
+        ads_t *ads = &((ads_component_registry_entry_t *)curr_ads)->ads;
+
+        resource_registry_node_t *curr, *tmp;
+        HASH_ITER(hh, ads->attach_registry.head, curr, tmp)
+        {
+            attach_node_t *node = (attach_node_t *)curr;
+            if (node->mo_attached && node->mo_id == mo_id)
+            {
+                OSDB_PRINTF("Removing MO (%u) from ADS (%u) at %p\n", mo_id, ads->id, node->vaddr);
+                resource_registry_delete(&ads->attach_registry, curr);
+            }
+        }
+    }
+
+    return 0;
+}
+
 int ads_component_attach_to_rt(gpi_obj_id_t mo_id, void **ret_vaddr)
 {
     return ads_component_attach(get_gpi_server()->rt_ads_id, mo_id, SEL4UTILS_RES_TYPE_GENERIC, NULL, ret_vaddr);
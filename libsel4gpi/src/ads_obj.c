@@ -42,6 +42,75 @@ typedef struct _pd pd_t;
 typedef struct _mo mo_t;
 typedef struct _cpu cpu_t;
 
+/**
+ * Delete and free a frame cap that was copied in the root task's cspace
+ */
+static void free_frame_cap(seL4_CPtr cap)
+{
+    cspacepath_t path;
+    vka_cspace_make_path(get_ads_component()->server_vka, cap, &path);
+    vka_cnode_delete(&path);
+    vka_cspace_free_path(get_ads_component()->server_vka, path);
+}
+
+/**
+ * Add a reservation to the ADS's range index and to the list for its type
+ *
+ * @return 0 on success, 1 if the range overlaps an indexed reservation
+ */
+static int index_attach_node(ads_t *ads, attach_node_t *node)
+{
+    node->range.start = (uintptr_t)node->vaddr;
+    node->range.end = (uintptr_t)node->vaddr + node->n_pages * SIZE_BITS_TO_BYTES(node->page_bits);
+
+    int error = range_tree_insert(&ads->res_index, &node->range);
+    if (error)
+    {
+        return error;
+    }
+
+    node->type_prev = NULL;
+    node->type_next = ads->res_by_type[node->type];
+    if (node->type_next)
+    {
+        node->type_next->type_prev = node;
+    }
+    ads->res_by_type[node->type] = node;
+
+    return 0;
+}
+
+/**
+ * Remove a reservation from the ADS's range index and type list, if it was indexed
+ */
+static void unindex_attach_node(ads_t *ads, attach_node_t *node)
+{
+    // Nodes in the tree always have a non-zero height
+    if (node->range.height == 0)
+    {
+        return;
+    }
+
+    range_tree_remove(&ads->res_index, &node->range);
+
+    if (node->type_prev)
+    {
+        node->type_prev->type_next = node->type_next;
+    }
+    else
+    {
+        ads->res_by_type[node->type] = node->type_next;
+    }
+
+    if (node->type_next)
+    {
+        node->type_next->type_prev = node->type_prev;
+    }
+
+    node->type_next = NULL;
+    node->type_prev = NULL;
+}
+
 /**
  * Callback when an attach node is deleted
  * Perform cleanup here
@@ -55,6 +124,7 @@ static void on_attach_registry_delete(resource_registry_node_t *node_gen, void *
                 ads->id, node->vaddr, node->mo_attached, human_readable_va_res_type(node->type));
 
     // Remove the reservation
+    unindex_attach_node(ads, node);
     sel4utils_free_reservation(ads->vspace, node->res);
 
     // Remove the attached MO
@@ -67,15 +137,21 @@ static void on_attach_registry_delete(resource_registry_node_t *node_gen, void *
         sel4utils_unmap_pages(ads->vspace, node->vaddr + node->mo_offset,
                               node->n_frames, node->page_bits, VSPACE_PRESERVE);
 
+#if TRACK_MAP_RELATIONS
+        /* Remove the VMR to MO mapping made in ads_attach_to_res */
+        pd_component_unmap_resources(compact_res_id(GPICAP_TYPE_VMR, ads->id, node->map_entry->gen.object_id),
+                                     compact_res_id(GPICAP_TYPE_MO, get_mo_component()->space_id, node->mo_id));
+#endif
+
         // Free the frame caps (duplicated for this attach)
         if (node->frame_caps)
         {
             for (int i = 0; i < node->n_frames; i++)
             {
-                cspacepath_t path;
-                vka_cspace_make_path(get_ads_component()->server_vka, node->frame_caps[i], &path);
-                vka_cnode_delete(&path);
-                vka_cspace_free_path(get_ads_component()->server_vka, path);
+                if (node->frame_caps[i] != seL4_CapNull)
+                {
+                    free_frame_cap(node->frame_caps[i]);
+                }
             }
 
             free(node->frame_caps);
@@ -84,6 +160,20 @@ static void on_attach_registry_delete(resource_registry_node_t *node_gen, void *
         // It is important to do this after freeing the caps, since if the MO is freed,
         // it will return the frames to the VKA, and the VKA expects that there are no copies
         resource_component_dec(get_mo_component(), node->mo_id);
+
+        // Release the private pages of a copy-on-write attach
+        if (node->cow_mo_ids)
+        {
+            for (int i = 0; i < node->n_frames; i++)
+            {
+                if (node->cow_mo_ids[i] != BADGE_OBJ_ID_NULL)
+                {
+                    resource_component_dec(get_mo_component(), node->cow_mo_ids[i]);
+                }
+            }
+
+            free(node->cow_mo_ids);
+        }
     }
 
     // Delete the corresponding map entry
@@ -97,6 +187,8 @@ int ads_initialize(ads_t *ads)
     // Initialize VMR registry
     resource_registry_initialize(&ads->attach_registry, on_attach_registry_delete, (void *)ads, BADGE_MAX - 1);
     resource_registry_initialize(&ads->attach_id_to_vaddr_map, NULL, NULL, BADGE_OBJ_ID_NULL - 1);
+    memset(&ads->res_index, 0, sizeof(range_tree_t));
+    memset(ads->res_by_type, 0, sizeof(ads->res_by_type));
 
     /* The root task holds the ADS by default */
     error = pd_add_resource_by_id(get_gpi_server()->rt_pd_id,
@@ -258,6 +350,11 @@ int ads_reserve(ads_t *ads,
     }
     else
     {
+        uintptr_t start = (uintptr_t)vaddr;
+        SERVER_GOTO_IF_COND(range_tree_find_overlap(&ads->res_index, start,
+                                                    start + num_pages * SIZE_BITS_TO_BYTES(size_bits)) != NULL,
+                            "Range at %p overlaps an existing reservation\n", vaddr);
+
         res = sel4utils_reserve_range_at(target,
                                          vaddr,
                                          num_pages * SIZE_BITS_TO_BYTES(size_bits),
@@ -295,6 +392,9 @@ int ads_reserve(ads_t *ads,
     resource_registry_insert(&ads->attach_registry, (resource_registry_node_t *)attach_node);
     nodes_inserted = true;
 
+    error = index_attach_node(ads, attach_node);
+    SERVER_GOTO_IF_ERR(error, "Failed to index reservation at %p\n", vaddr);
+
     // The root task holds the VMR by default
     gpi_obj_id_t vmr_id = attach_node_map_entry->gen.object_id;
     error = pd_add_resource_by_id(get_gpi_server()->rt_pd_id,
@@ -344,17 +444,24 @@ attach_node_t *ads_get_res_by_vaddr(ads_t *ads, void *vaddr)
     return (attach_node_t *)resource_registry_get_by_id(&ads->attach_registry, (uint64_t)vaddr);
 }
 
+attach_node_t *ads_get_res_containing(ads_t *ads, void *vaddr)
+{
+    range_tree_node_t *range = range_tree_find(&ads->res_index, (uintptr_t)vaddr);
+
+    if (range == NULL)
+    {
+        return NULL;
+    }
+    return (attach_node_t *)((uintptr_t)range - offsetof(attach_node_t, range));
+}
+
 linked_list_t *ads_get_res_by_type(ads_t *src_ads, sel4utils_reservation_type_t vmr_type)
 {
     linked_list_t *found_nodes = linked_list_new();
-    resource_registry_node_t *current, *tmp;
-    HASH_ITER(hh, src_ads->attach_registry.head, current, tmp)
+
+    for (attach_node_t *node = src_ads->res_by_type[vmr_type]; node != NULL; node = node->type_next)
     {
-        attach_node_t *node = (attach_node_t *)current;
-        if (node->type == vmr_type)
-        {
-            linked_list_insert(found_nodes, node);
-        }
+        linked_list_insert(found_nodes, node);
     }
 
     return found_nodes;
@@ -483,6 +590,7 @@ int ads_attach(ads_t *ads,
 int ads_forge_attach(ads_t *ads, sel4utils_res_t *res, mo_t *mo)
 {
     int error = 0;
+    bool map_entry_inserted = false;
 
     // Add the attach node for this region
     attach_node_t *attach_node = calloc(1, sizeof(attach_node_t));
@@ -493,6 +601,7 @@ int ads_forge_attach(ads_t *ads, sel4utils_res_t *res, mo_t *mo)
     // Map a shorter attach node ID to vaddr
     attach_node_map_entry->vaddr = (void *)res->start;
     resource_registry_insert_new_id(&ads->attach_id_to_vaddr_map, (resource_registry_node_t *)attach_node_map_entry);
+    map_entry_inserted = true;
 
     // The attach node is keyed by vaddr
     memset((void *)attach_node, 0, sizeof(attach_node_t));
@@ -507,21 +616,31 @@ int ads_forge_attach(ads_t *ads, sel4utils_res_t *res, mo_t *mo)
     attach_node->mo_offset = 0;
     attach_node->page_bits = mo->page_bits;
 
-    resource_registry_insert(&ads->attach_registry, (resource_registry_node_t *)attach_node);
+    error = index_attach_node(ads, attach_node);
+    SERVER_GOTO_IF_ERR(error, "Forged attach at %p overlaps an existing reservation\n", attach_node->vaddr);
 
     // Track this attachment as a refcount to the MO
     error = resource_component_inc(get_mo_component(), mo->id);
     SERVER_GOTO_IF_ERR(error, "Failed to increment refcount of MO\n");
 
+    // Insert last, since deleting from the registry would also free the forged reservation
+    resource_registry_insert(&ads->attach_registry, (resource_registry_node_t *)attach_node);
+
     return error;
 
 err_goto:
     if (attach_node)
     {
+        // Does nothing if the node was not indexed
+        unindex_attach_node(ads, attach_node);
         free(attach_node);
     }
 
-    if (attach_node_map_entry)
+    if (map_entry_inserted)
+    {
+        resource_registry_delete(&ads->attach_id_to_vaddr_map, (resource_registry_node_t *)attach_node_map_entry);
+    }
+    else if (attach_node_map_entry)
     {
         free(attach_node_map_entry);
     }
@@ -591,7 +710,7 @@ gpi_model_node_t *ads_dump_rr(ads_t *ads, model_state_t *ms, gpi_model_node_t *p
                      res->vaddr,
                      human_readable_va_res_type(res->type),
                      res->n_pages, res->page_bits);
-            set_node_extra(vmr_node, extra);
+            set_node_extra(ms, vmr_node, extra);
 
             /* Add the relation from VMR to MO node, if there is one */
             if (res->mo_attached)
@@ -673,6 +792,45 @@ err_goto:
     return error;
 }
 
+/**
+ * Remap the MO attached to a VMR read-only and track its pages for copy-on-write,
+ * so that the VMR's own writes are copied instead of reaching the shared frames
+ */
+static int ads_make_cow(ads_t *ads, attach_node_t *node)
+{
+    int error = 0;
+
+    if (node->cow)
+    {
+        // Already read-only, the caller has checked that no page was copied yet
+        goto err_goto;
+    }
+
+    node->cow_mo_ids = malloc(node->n_frames * sizeof(gpi_obj_id_t));
+    SERVER_GOTO_IF_COND(node->cow_mo_ids == NULL, "Failed to allocate copy-on-write page list\n");
+    for (int i = 0; i < node->n_frames; i++)
+    {
+        node->cow_mo_ids[i] = BADGE_OBJ_ID_NULL;
+    }
+
+    void *mo_vaddr = node->vaddr + node->mo_offset;
+    sel4utils_unmap_pages(ads->vspace, mo_vaddr, node->n_frames, node->page_bits, VSPACE_PRESERVE);
+
+    // Map the same frames back read-only, the reservation keeps its rights for the pages copied on fault
+    sel4utils_res_t *res = reservation_to_res(node->res);
+    seL4_CapRights_t res_rights = res->rights;
+    res->rights = seL4_CanRead;
+    error = sel4utils_map_pages_at_vaddr(ads->vspace, node->frame_caps, NULL, mo_vaddr,
+                                         node->n_frames, node->page_bits, node->res);
+    res->rights = res_rights;
+    SERVER_GOTO_IF_ERR(error, "Failed to remap VMR %p of ADS (%u) read-only\n", node->vaddr, ads->id);
+
+    node->cow = true;
+
+err_goto:
+    return error;
+}
+
 int ads_shallow_copy(vspace_t *loader,
                      vka_t *vka,
                      ads_t *src_ads,
@@ -738,8 +896,46 @@ int ads_shallow_copy(vspace_t *loader,
                             src_attach_node->mo_id, (void *)src_attach_node->vaddr);
         old_mo = &old_mo_reg_entry->mo;
 
-        error = ads_attach_to_res(dst_ads, vka, new_attach_node, src_attach_node->mo_offset, old_mo);
-        SERVER_GOTO_IF_ERR(error, "Failed to attach source MO (%u) to dst ADS (%u)\n", old_mo->id, dst_ads->id);
+        // Read-only regions gain nothing from copy-on-write, they are simply shared
+        bool cow = cfg->share_mode == GPI_COW && seL4_CapRights_get_capAllowWrite(src_attach_node->rights);
+
+        if (cow && src_attach_node->cow)
+        {
+            // The destination would see the shared frames, not the source's private copies
+            for (int i = 0; i < src_attach_node->n_frames; i++)
+            {
+                SERVER_GOTO_IF_COND(src_attach_node->cow_mo_ids[i] != BADGE_OBJ_ID_NULL,
+                                    "Cannot copy-on-write VMR %p of ADS (%u), page %d was already copied\n",
+                                    src_attach_node->vaddr, src_ads->id, i);
+            }
+        }
+
+        if (cow)
+        {
+            // Map the shared frames read-only, the reservation keeps its rights for the pages copied on fault
+            sel4utils_res_t *dst_res = reservation_to_res(new_attach_node->res);
+            seL4_CapRights_t res_rights = dst_res->rights;
+            dst_res->rights = seL4_CanRead;
+            error = ads_attach_to_res(dst_ads, vka, new_attach_node, src_attach_node->mo_offset, old_mo);
+            dst_res->rights = res_rights;
+            SERVER_GOTO_IF_ERR(error, "Failed to attach source MO (%u) to dst ADS (%u)\n", old_mo->id, dst_ads->id);
+
+            new_attach_node->cow_mo_ids = malloc(new_attach_node->n_frames * sizeof(gpi_obj_id_t));
+            SERVER_GOTO_IF_COND(new_attach_node->cow_mo_ids == NULL, "Failed to allocate copy-on-write page list\n");
+            for (int i = 0; i < new_attach_node->n_frames; i++)
+            {
+                new_attach_node->cow_mo_ids[i] = BADGE_OBJ_ID_NULL;
+            }
+            new_attach_node->cow = true;
+
+            error = ads_make_cow(src_ads, src_attach_node);
+            SERVER_GOTO_IF_ERR(error, "Failed to make source VMR %p copy-on-write\n", src_attach_node->vaddr);
+        }
+        else
+        {
+            error = ads_attach_to_res(dst_ads, vka, new_attach_node, src_attach_node->mo_offset, old_mo);
+            SERVER_GOTO_IF_ERR(error, "Failed to attach source MO (%u) to dst ADS (%u)\n", old_mo->id, dst_ads->id);
+        }
     }
 
 err_goto:
@@ -748,6 +944,117 @@ err_goto:
     return error;
 }
 
+int ads_cow_fault(vspace_t *loader, vka_t *vka, ads_t *ads, void *vaddr)
+{
+    int error = 0;
+    attach_node_t *node = NULL;
+    seL4_CPtr src_copy_cap = seL4_CapNull;
+    seL4_CPtr dst_copy_cap = seL4_CapNull;
+    void *src_va = NULL;
+    void *dst_va = NULL;
+    mo_t *new_mo = NULL;
+
+    /* Find the copy-on-write VMR containing the faulting address */
+    node = ads_get_res_containing(ads, vaddr);
+    SERVER_GOTO_IF_COND(node == NULL || !node->cow, "%p is not in a copy-on-write VMR of ADS (%u)\n", vaddr, ads->id);
+    SERVER_GOTO_IF_COND(node->page_bits != MO_PAGE_BITS, "Copy-on-write is only supported for %zu-byte pages\n",
+                        SIZE_BITS_TO_BYTES(MO_PAGE_BITS));
+
+    size_t page_size = SIZE_BITS_TO_BYTES(node->page_bits);
+    void *mo_vaddr = node->vaddr + node->mo_offset;
+    SERVER_GOTO_IF_COND(vaddr < mo_vaddr || vaddr >= mo_vaddr + node->n_frames * page_size,
+                        "No MO attached at %p in ADS (%u)\n", vaddr, ads->id);
+
+    size_t frame_idx = (vaddr - mo_vaddr) / page_size;
+    void *page_vaddr = mo_vaddr + frame_idx * page_size;
+    if (node->cow_mo_ids[frame_idx] != BADGE_OBJ_ID_NULL)
+    {
+        // Another thread faulted on the page before it was copied, the retried write will succeed
+        OSDB_PRINTF("Page %p of ADS (%u) was already copied\n", page_vaddr, ads->id);
+        goto err_goto;
+    }
+
+    OSDB_PRINTF("Copy-on-write fault in ADS (%u) at %p, copying page %zu of MO (%u)\n",
+                ads->id, vaddr, frame_idx, node->mo_id);
+
+    mo_component_registry_entry_t *src_mo_entry = (mo_component_registry_entry_t *)
+        resource_component_registry_get_by_id(get_mo_component(), node->mo_id);
+    SERVER_GOTO_IF_COND(src_mo_entry == NULL, "Failed to find the MO (%u) for vaddr: %p\n", node->mo_id, vaddr);
+    mo_t *src_mo = &src_mo_entry->mo;
+
+    /* The root task holds the private page until the attach node is deleted */
+    error = mo_component_allocate_rt(1, &new_mo);
+    SERVER_GOTO_IF_ERR(error, "Failed to allocate a new MO for copy-on-write\n");
+
+    /* Copy the page through temporary mappings in the root task */
+    error = copy_frame_caps_for_mapping(&src_mo->frame_caps_in_root_task[frame_idx], &src_copy_cap, 1);
+    SERVER_GOTO_IF_ERR(error, "Failed to copy source frame cap\n");
+    error = copy_frame_caps_for_mapping(new_mo->frame_caps_in_root_task, &dst_copy_cap, 1);
+    SERVER_GOTO_IF_ERR(error, "Failed to copy new frame cap\n");
+
+    src_va = vspace_map_pages(loader, &src_copy_cap, NULL, seL4_CanRead, 1, node->page_bits, node->cacheable);
+    SERVER_GOTO_IF_COND(src_va == NULL, "Failed to map source frame for copy-on-write\n");
+    dst_va = vspace_map_pages(loader, &dst_copy_cap, NULL, seL4_AllRights, 1, node->page_bits, node->cacheable);
+    SERVER_GOTO_IF_COND(dst_va == NULL, "Failed to map new frame for copy-on-write\n");
+
+    memcpy(dst_va, src_va, page_size);
+
+    /* Replace the shared frame in the ADS with the private one, mapped with the reservation's rights */
+    seL4_CPtr new_frame_cap = seL4_CapNull;
+    error = copy_frame_caps_for_mapping(new_mo->frame_caps_in_root_task, &new_frame_cap, 1);
+    SERVER_GOTO_IF_ERR(error, "Failed to copy new frame cap for mapping\n");
+
+    sel4utils_unmap_pages(ads->vspace, page_vaddr, 1, node->page_bits, VSPACE_PRESERVE);
+    error = sel4utils_map_pages_at_vaddr(ads->vspace, &new_frame_cap, NULL,
+                                         page_vaddr, 1, node->page_bits, node->res);
+    if (error)
+    {
+        // Put the shared frame back read-only, the private MO is released below and must have no remaining copies
+        sel4utils_res_t *res = reservation_to_res(node->res);
+        seL4_CapRights_t res_rights = res->rights;
+        res->rights = seL4_CanRead;
+        int remap_error = sel4utils_map_pages_at_vaddr(ads->vspace, &node->frame_caps[frame_idx], NULL,
+                                                       page_vaddr, 1, node->page_bits, node->res);
+        res->rights = res_rights;
+        WARN_IF_COND(remap_error, "Failed to restore the shared page at %p of ADS (%u)\n", page_vaddr, ads->id);
+
+        free_frame_cap(new_frame_cap);
+    }
+    SERVER_GOTO_IF_ERR(error, "Failed to map copied page at %p\n", page_vaddr);
+
+    free_frame_cap(node->frame_caps[frame_idx]);
+    node->frame_caps[frame_idx] = new_frame_cap;
+    node->cow_mo_ids[frame_idx] = new_mo->id;
+
+err_goto:
+    if (src_va)
+    {
+        vspace_unmap_pages(loader, src_va, 1, node->page_bits, VSPACE_PRESERVE);
+    }
+
+    if (dst_va)
+    {
+        vspace_unmap_pages(loader, dst_va, 1, node->page_bits, VSPACE_PRESERVE);
+    }
+
+    if (src_copy_cap != seL4_CapNull)
+    {
+        free_frame_cap(src_copy_cap);
+    }
+
+    if (dst_copy_cap != seL4_CapNull)
+    {
+        free_frame_cap(dst_copy_cap);
+    }
+
+    if (error && new_mo)
+    {
+        resource_component_dec(get_mo_component(), new_mo->id);
+    }
+
+    return error;
+}
+
 void ads_destroy(ads_t *ads)
 {
     /* Destroy the hash tables of attach nodes */
@@ -795,7 +1102,7 @@ int ads_load_elf(ads_t *loadee,
     elf_t elf;
     elf_newFile(file, size, &elf);
 
-    *ret_entry_point = sel4gpi_elf_load(loadee, loader, server_vka, server_vka, &elf);
+    *ret_entry_point = sel4gpi_elf_load(loadee, loader, server_vka, server_vka, &elf, image_name);
     SERVER_GOTO_IF_COND(*ret_entry_point == NULL, "Failed to load elf file\n");
 
     pd->sysinfo = sel4gpi_elf_get_vsyscall(&elf);
@@ -52,7 +52,7 @@ gpi_badge_t set_perms_to_badge(gpi_badge_t badge, gpi_perms_t perms)
 {
     assert(perms <= 0xFF);
     uint64_t shifted_perms = perms;
-    shifted_perms = shifted_perms << 56;
+    shifted_perms = shifted_perms << 48;
     return (badge & 0xFF00FFFFFFFFFFFF) | shifted_perms;
 }
 
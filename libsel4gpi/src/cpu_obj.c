@@ -174,7 +174,7 @@ gpi_model_node_t *cpu_dump_rr(cpu_t *cpu, model_state_t *ms, gpi_model_node_t *p
 
         if (cpu->vcpu.cptr != seL4_CapNull)
         {
-            set_node_extra(cpu_node, "elevated");
+            set_node_extra(ms, cpu_node, "elevated");
         }
         add_edge(ms, GPI_EDGE_TYPE_HOLD, pd_node, cpu_node);
         add_edge(ms, GPI_EDGE_TYPE_SUBSET, cpu_node, vcpu_space_node);
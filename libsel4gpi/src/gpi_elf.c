@@ -14,9 +14,17 @@
 #include <sel4utils/mapping.h>
 #include <sel4gpi/gpi_elf.h>
 #include <sel4gpi/mo_component.h>
+#include <sel4gpi/gpi_options.h>
+#include <sel4gpi/linked_list.h>
 
 #define GPI_ELF_DEBUG 0
 
+// Should be at least the length of the image name in AdsLoadElfMessage
+#define ELF_SEGMENT_CACHE_NAME_LEN 64
+
+// Maximum number of cached segments, the oldest is evicted to make room for a new one
+#define ELF_SEGMENT_CACHE_MAX_ENTRIES 64
+
 /*
  * Convert ELF permissions into seL4 permissions.
  *
@@ -60,6 +68,125 @@ static void copy_region(void *dest, const char *src, size_t src_file_size, size_
     }
 }
 
+#if ELF_SEGMENT_CACHE
+/**
+ * Cache of the MOs of non-writable ELF segments, keyed by image name and segment index
+ * The cache holds the root task's reference to each MO until the entry is replaced or evicted
+ */
+typedef struct _elf_segment_cache_entry
+{
+    char image_name[ELF_SEGMENT_CACHE_NAME_LEN];
+    int segment_index;
+    uint32_t num_pages;
+    gpi_obj_id_t mo_id;
+} elf_segment_cache_entry_t;
+
+static linked_list_t *elf_segment_cache;
+
+static elf_segment_cache_entry_t *elf_segment_cache_find(const char *image_name, int segment_index)
+{
+    if (elf_segment_cache == NULL)
+    {
+        return NULL;
+    }
+
+    for (linked_list_node_t *curr = elf_segment_cache->head; curr != NULL; curr = curr->next)
+    {
+        elf_segment_cache_entry_t *entry = (elf_segment_cache_entry_t *)curr->data;
+        if (entry->segment_index == segment_index && strcmp(entry->image_name, image_name) == 0)
+        {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Drop the cache's reference to an entry's MO, if the MO still exists
+ */
+static void elf_segment_cache_release(elf_segment_cache_entry_t *entry)
+{
+    if (resource_component_registry_get_by_id(get_mo_component(), entry->mo_id) != NULL)
+    {
+        resource_component_dec(get_mo_component(), entry->mo_id);
+    }
+}
+
+static mo_t *elf_segment_cache_get(const char *image_name, int segment_index, uint32_t num_pages)
+{
+    elf_segment_cache_entry_t *entry = elf_segment_cache_find(image_name, segment_index);
+    if (entry == NULL)
+    {
+        return NULL;
+    }
+
+    if (entry->num_pages != num_pages)
+    {
+        // The image changed, the entry is replaced once the segment is loaded again
+        ZF_LOGE("Cached segment %d of %s has %u pages, expected %u", segment_index, image_name,
+                entry->num_pages, num_pages);
+        return NULL;
+    }
+
+    mo_component_registry_entry_t *mo_entry = (mo_component_registry_entry_t *)
+        resource_component_registry_get_by_id(get_mo_component(), entry->mo_id);
+    return mo_entry == NULL ? NULL : &mo_entry->mo;
+}
+
+/**
+ * Cache a segment's MO, replacing any stale entry for the same segment
+ *
+ * @return true if the cache took the root task's reference to the MO, false if the caller keeps it
+ */
+static bool elf_segment_cache_insert(const char *image_name, int segment_index, mo_t *mo)
+{
+    if (strlen(image_name) >= ELF_SEGMENT_CACHE_NAME_LEN)
+    {
+        return false;
+    }
+
+    if (elf_segment_cache == NULL)
+    {
+        elf_segment_cache = linked_list_new();
+    }
+
+    elf_segment_cache_entry_t *entry = elf_segment_cache_find(image_name, segment_index);
+    if (entry != NULL)
+    {
+        if (entry->mo_id != mo->id)
+        {
+            elf_segment_cache_release(entry);
+        }
+    }
+    else
+    {
+        if (elf_segment_cache->count >= ELF_SEGMENT_CACHE_MAX_ENTRIES)
+        {
+            linked_list_pop_head(elf_segment_cache, (void **)&entry);
+            elf_segment_cache_release(entry);
+        }
+        else
+        {
+            entry = malloc(sizeof(elf_segment_cache_entry_t));
+            if (entry == NULL)
+            {
+                return false;
+            }
+        }
+
+        memset(entry, 0, sizeof(elf_segment_cache_entry_t));
+        strncpy(entry->image_name, image_name, ELF_SEGMENT_CACHE_NAME_LEN);
+        entry->segment_index = segment_index;
+        linked_list_insert(elf_segment_cache, entry);
+    }
+
+    entry->num_pages = mo->num_pages;
+    entry->mo_id = mo->id;
+    return true;
+}
+#endif
+
 /**
  * Load an array of regions into an ads.
  *
@@ -67,12 +194,16 @@ static void copy_region(void *dest, const char *src, size_t src_file_size, size_
  * State in the adses and vkas will be mutated to track resources used.
  * If this function fails, any allocated and mapped frames will not be freed.
  *
+ * If ELF_SEGMENT_CACHE is enabled and an image name is given, non-writable regions reuse the MO
+ * from a previous load of the same image, and are not copied again.
+ *
  * @param loadee_ads target ads to map frames into.
  * @param loader_ads ads of the caller.  Frames are temporarily mapped into this to init with
  *                      elf data from elf file.
  * @param loadee_vka target vka
  * @param loader_vka caller vka
  * @param elf_file pointer to elf object
+ * @param image_name name of the image, or NULL to skip the segment cache
  * @param num_regions total number of segments/regions to load.
  * @param regions region array containing segment info.
  *
@@ -80,7 +211,7 @@ static void copy_region(void *dest, const char *src, size_t src_file_size, size_
  */
 static int load_segments(ads_t *loadee_ads, ads_t *loader_ads,
                          vka_t *loadee_vka, vka_t *loader_vka, const elf_t *elf_file,
-                         int num_regions, sel4gpi_elf_region_t regions[num_regions])
+                         const char *image_name, int num_regions, sel4gpi_elf_region_t regions[num_regions])
 {
     int error = 0;
 
@@ -110,7 +241,6 @@ static int load_segments(ads_t *loadee_ads, ads_t *loader_ads,
          * This used to work one page at a time, I have modified the logic
          * to make it easier to use with the ADS component, but I am not certain if it is still correct
          **/
-        unsigned int pos = 0;                         // Position in the region
         uintptr_t dst = (uintptr_t)region.elf_vstart; // Destination addr in the loadee
         void *loader_vaddr = 0;
         void *loadee_vaddr = (void *)((seL4_Word)ROUND_DOWN(dst, PAGE_SIZE_4K));
@@ -118,8 +248,63 @@ static int load_segments(ads_t *loadee_ads, ads_t *loader_ads,
         void *loader_ptr = NULL;
         size_t size_to_write = 0;
 
+        /* Work out where this region's data goes in the reservation */
+        size_t write_offset = 0; // Offset of this region's data in the reservation
+        size_t region_size_to_write = region.size;
+        int64_t underflow = (region.reservation_vstart - region.elf_vstart);
+        size_t src_offset = 0;
+
+        if (underflow > 0)
+        {
+            // Some of this region was already written to the previous reservation
+            region_size_to_write -= underflow;
+            src_offset = underflow;
+        }
+        else if (underflow < 0)
+        {
+            // Some padding at the beginning of the reservation
+            write_offset = -underflow;
+        }
+
+        // Overflow from the previous region, to write at the start of this one
+        int64_t prev_overflow_bytes = overflow_bytes;
+        size_t prev_overflow_src_offset = overflow_src_offset;
+
+        overflow_bytes = (int64_t)(write_offset + region_size_to_write) - (int64_t)region.reservation_size;
+        if (overflow_bytes > 0)
+        {
+            region_size_to_write -= overflow_bytes;
+            overflow_src_offset = region_size_to_write; // Next iteration will handle this overflow
+        }
+
+        mo_t *mo = NULL;
+        bool writable = seL4_CapRights_get_capAllowWrite(region.rights);
+
+#if ELF_SEGMENT_CACHE
+        /* Non-writable regions can share the MO of a previous load of the same image */
+        if (!writable && image_name != NULL)
+        {
+            mo = elf_segment_cache_get(image_name, segment_index, region.reservation_pages);
+        }
+
+        if (mo != NULL)
+        {
+#if GPI_ELF_DEBUG
+            printf("gpi_elf: mapping cached region %d (%s, segment %d) to %p\n",
+                   i, image_name, segment_index, loadee_vaddr);
+#endif
+            error = ads_attach_to_res(loadee_ads, loadee_vka, region.reservation, 0, mo);
+            if (error)
+            {
+                ZF_LOGE("Error, failed to attach cached MO to loadee for elf segment");
+                return error;
+            }
+
+            continue;
+        }
+#endif
+
         /* Reserve the region's memory */
-        mo_t *mo;
         error = mo_component_allocate_rt(region.reservation_pages, &mo);
         if (error)
         {
@@ -146,10 +331,10 @@ static int load_segments(ads_t *loadee_ads, ads_t *loader_ads,
         loader_ptr = loader_vaddr;
 
         /* Check if the previous region has some overflow */
-        if (overflow_bytes > 0)
+        if (prev_overflow_bytes > 0)
         {
             vaddr_to_write = loader_vaddr;
-            size_to_write = overflow_bytes;
+            size_to_write = prev_overflow_bytes;
 
 #if GPI_ELF_DEBUG
             printf("gpi_elf: writing overflow from region %d to [%p,%p]  -> [%p,%p]\n",
@@ -160,34 +345,14 @@ static int load_segments(ads_t *loadee_ads, ads_t *loader_ads,
                    loadee_vaddr + (vaddr_to_write - loader_vaddr) + size_to_write);
 #endif
 
-            copy_region(vaddr_to_write, regions[i - 1].src, regions[i - 1].src_size, overflow_src_offset, size_to_write);
+            copy_region(vaddr_to_write, regions[i - 1].src, regions[i - 1].src_size, prev_overflow_src_offset,
+                        size_to_write);
             loader_ptr += size_to_write;
         }
 
         /* Write this region's data (as much as possible) */
-        vaddr_to_write = loader_vaddr;
-        size_to_write = region.size;
-        int64_t underflow = (region.reservation_vstart - region.elf_vstart);
-        size_t src_offset = 0;
-
-        if (underflow > 0)
-        {
-            // Some of this region was already written to the previous reservation
-            size_to_write -= underflow;
-            src_offset = underflow;
-        }
-        else if (underflow < 0)
-        {
-            // Some padding at the beginning of the reservation
-            vaddr_to_write += -underflow;
-        }
-
-        overflow_bytes = (vaddr_to_write + size_to_write) - (loader_vaddr + region.reservation_size);
-        if (overflow_bytes > 0)
-        {
-            size_to_write -= overflow_bytes;
-            overflow_src_offset = size_to_write; // Next iteration will handle this overflow
-        }
+        vaddr_to_write = loader_vaddr + write_offset;
+        size_to_write = region_size_to_write;
 
 #if GPI_ELF_DEBUG
         printf("gpi_elf: writing region %d to [%p,%p] -> [%p,%p]\n",
@@ -261,6 +426,14 @@ static int load_segments(ads_t *loadee_ads, ads_t *loader_ads,
             return error;
         }
 
+#if ELF_SEGMENT_CACHE
+        // The cache keeps the refcount of the MO created by RT
+        if (!writable && image_name != NULL && elf_segment_cache_insert(image_name, segment_index, mo))
+        {
+            continue;
+        }
+#endif
+
         // Decrement refcount of MO created by RT, not held by PD
         error = resource_component_dec(get_mo_component(), mo->id);
         if (error)
@@ -579,7 +752,8 @@ static void *entry_point(const elf_t *elf_file)
 }
 
 static void *sel4gpi_elf_load_record_regions(ads_t *loadee, ads_t *loader, vka_t *loadee_vka, vka_t *loader_vka,
-                                             const elf_t *elf_file, sel4gpi_elf_region_t *regions, int mapanywhere)
+                                             const elf_t *elf_file, const char *image_name,
+                                             sel4gpi_elf_region_t *regions, int mapanywhere)
 {
     /* Calculate number of loadable regions.  Use stack array if one wasn't passed in */
     int num_regions = count_loadable_regions(elf_file);
@@ -600,7 +774,7 @@ static void *sel4gpi_elf_load_record_regions(ads_t *loadee, ads_t *loader, vka_t
     }
 
     /* Load Map reservations and load in elf data */
-    error = load_segments(loadee, loader, loadee_vka, loader_vka, elf_file, num_regions, regions);
+    error = load_segments(loadee, loader, loadee_vka, loader_vka, elf_file, image_name, num_regions, regions);
     if (error)
     {
         ZF_LOGE("Failed to load segments");
@@ -644,9 +818,9 @@ uintptr_t sel4gpi_elf_get_section(const elf_t *elf_file, const char *section_nam
 }
 
 void *sel4gpi_elf_load(ads_t *loadee, ads_t *loader, vka_t *loadee_vka, vka_t *loader_vka,
-                       const elf_t *elf_file)
+                       const elf_t *elf_file, const char *image_name)
 {
-    return sel4gpi_elf_load_record_regions(loadee, loader, loadee_vka, loader_vka, elf_file, NULL, 0);
+    return sel4gpi_elf_load_record_regions(loadee, loader, loadee_vka, loader_vka, elf_file, image_name, NULL, 0);
 }
 
 uint32_t sel4gpi_elf_num_phdrs(const elf_t *elf_file)
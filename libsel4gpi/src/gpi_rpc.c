@@ -3,6 +3,7 @@
 #include <pb_print.h>
 #include <sel4nanopb/sel4nanopb.h>
 
+#include <string.h>
 #include <utils/zf_log.h>
 
 #include <sel4gpi/gpi_rpc.h>
@@ -13,6 +14,291 @@
  * Functions for sending/receiving RPC messages
  */
 
+/**
+ * Raw message-register encoding
+ *
+ * Fields are walked in the order of the nanopb message descriptor and each scalar is placed in its own
+ * message register. Submessages are flattened in place, a oneof is preceded by the tag of its active member,
+ * and a repeated field is preceded by its count. Messages with strings, bytes, or callback fields cannot be
+ * encoded this way, and fall back to protobuf.
+ */
+
+static bool raw_field_is_scalar(pb_type_t type)
+{
+    switch (PB_LTYPE(type))
+    {
+    case PB_LTYPE_BOOL:
+    case PB_LTYPE_VARINT:
+    case PB_LTYPE_UVARINT:
+    case PB_LTYPE_SVARINT:
+    case PB_LTYPE_FIXED32:
+    case PB_LTYPE_FIXED64:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool raw_put_word(seL4_Word word, size_t *n_words)
+{
+    if (*n_words >= seL4_MsgMaxLength)
+    {
+        return false;
+    }
+
+    seL4_SetMR((*n_words)++, word);
+    return true;
+}
+
+static bool raw_get_word(size_t max_words, size_t *n_words, seL4_Word *word)
+{
+    if (*n_words >= max_words)
+    {
+        return false;
+    }
+
+    *word = seL4_GetMR((*n_words)++);
+    return true;
+}
+
+static bool raw_encode_msg(const pb_msgdesc_t *desc, const void *msg, size_t *n_words);
+static bool raw_decode_msg(const pb_msgdesc_t *desc, void *msg, size_t max_words, size_t *n_words);
+
+static bool raw_encode_value(const pb_field_iter_t *iter, const void *data, size_t *n_words)
+{
+    if (PB_LTYPE(iter->type) == PB_LTYPE_SUBMESSAGE)
+    {
+        return raw_encode_msg(iter->submsg_desc, data, n_words);
+    }
+
+    if (!raw_field_is_scalar(iter->type) || iter->data_size > sizeof(seL4_Word))
+    {
+        return false;
+    }
+
+    seL4_Word word = 0;
+    memcpy(&word, data, iter->data_size);
+    return raw_put_word(word, n_words);
+}
+
+static bool raw_decode_value(const pb_field_iter_t *iter, void *data, size_t max_words, size_t *n_words)
+{
+    if (PB_LTYPE(iter->type) == PB_LTYPE_SUBMESSAGE)
+    {
+        return raw_decode_msg(iter->submsg_desc, data, max_words, n_words);
+    }
+
+    if (!raw_field_is_scalar(iter->type) || iter->data_size > sizeof(seL4_Word))
+    {
+        return false;
+    }
+
+    seL4_Word word;
+    if (!raw_get_word(max_words, n_words, &word))
+    {
+        return false;
+    }
+
+    memcpy(data, &word, iter->data_size);
+    return true;
+}
+
+static bool raw_encode_msg(const pb_msgdesc_t *desc, const void *msg, size_t *n_words)
+{
+    pb_field_iter_t iter;
+    const void *oneof_size = NULL;
+
+    if (!pb_field_iter_begin(&iter, desc, (void *)msg))
+    {
+        /* Message has no fields */
+        return true;
+    }
+
+    do
+    {
+        if (PB_ATYPE(iter.type) != PB_ATYPE_STATIC)
+        {
+            return false;
+        }
+
+        if (PB_HTYPE(iter.type) == PB_HTYPE_ONEOF)
+        {
+            pb_size_t which = *(const pb_size_t *)iter.pSize;
+
+            /* The first member of a oneof carries the tag of the active member */
+            if (iter.pSize != oneof_size)
+            {
+                oneof_size = iter.pSize;
+                if (!raw_put_word(which, n_words))
+                {
+                    return false;
+                }
+            }
+
+            if (which == iter.tag && !raw_encode_value(&iter, iter.pData, n_words))
+            {
+                return false;
+            }
+        }
+        else if (PB_HTYPE(iter.type) == PB_HTYPE_REPEATED)
+        {
+            pb_size_t count = iter.array_size;
+
+            /* Fixed arrays have no count field */
+            if (iter.pSize != NULL)
+            {
+                count = *(const pb_size_t *)iter.pSize;
+                if (count > iter.array_size || !raw_put_word(count, n_words))
+                {
+                    return false;
+                }
+            }
+
+            for (pb_size_t i = 0; i < count; i++)
+            {
+                if (!raw_encode_value(&iter, (const char *)iter.pData + i * iter.data_size, n_words))
+                {
+                    return false;
+                }
+            }
+        }
+        else
+        {
+            /* Optional fields carry their has_ flag, proto3 singular fields have none */
+            if (PB_HTYPE(iter.type) == PB_HTYPE_OPTIONAL && iter.pSize != NULL &&
+                !raw_put_word(*(const bool *)iter.pSize, n_words))
+            {
+                return false;
+            }
+
+            if (!raw_encode_value(&iter, iter.pData, n_words))
+            {
+                return false;
+            }
+        }
+    } while (pb_field_iter_next(&iter));
+
+    return true;
+}
+
+/**
+ * Zero every field of a message, like the protobuf decoder does before decoding,
+ * so inactive oneof members and unused repeated elements are never left uninitialized
+ */
+static void raw_clear_msg(const pb_msgdesc_t *desc, void *msg)
+{
+    pb_field_iter_t iter;
+
+    if (!pb_field_iter_begin(&iter, desc, msg))
+    {
+        return;
+    }
+
+    do
+    {
+        if (PB_ATYPE(iter.type) != PB_ATYPE_STATIC)
+        {
+            continue;
+        }
+
+        size_t n_elems = PB_HTYPE(iter.type) == PB_HTYPE_REPEATED ? iter.array_size : 1;
+        memset(iter.pData, 0, n_elems * iter.data_size);
+
+        if (PB_HTYPE(iter.type) == PB_HTYPE_ONEOF || PB_HTYPE(iter.type) == PB_HTYPE_REPEATED)
+        {
+            if (iter.pSize != NULL)
+            {
+                *(pb_size_t *)iter.pSize = 0;
+            }
+        }
+        else if (PB_HTYPE(iter.type) == PB_HTYPE_OPTIONAL && iter.pSize != NULL)
+        {
+            *(bool *)iter.pSize = false;
+        }
+    } while (pb_field_iter_next(&iter));
+}
+
+static bool raw_decode_msg(const pb_msgdesc_t *desc, void *msg, size_t max_words, size_t *n_words)
+{
+    pb_field_iter_t iter;
+    const void *oneof_size = NULL;
+    seL4_Word word;
+
+    raw_clear_msg(desc, msg);
+
+    if (!pb_field_iter_begin(&iter, desc, msg))
+    {
+        /* Message has no fields */
+        return true;
+    }
+
+    do
+    {
+        if (PB_ATYPE(iter.type) != PB_ATYPE_STATIC)
+        {
+            return false;
+        }
+
+        if (PB_HTYPE(iter.type) == PB_HTYPE_ONEOF)
+        {
+            if (iter.pSize != oneof_size)
+            {
+                oneof_size = iter.pSize;
+                if (!raw_get_word(max_words, n_words, &word))
+                {
+                    return false;
+                }
+                *(pb_size_t *)iter.pSize = word;
+            }
+
+            if (*(pb_size_t *)iter.pSize == iter.tag && !raw_decode_value(&iter, iter.pData, max_words, n_words))
+            {
+                return false;
+            }
+        }
+        else if (PB_HTYPE(iter.type) == PB_HTYPE_REPEATED)
+        {
+            pb_size_t count = iter.array_size;
+
+            if (iter.pSize != NULL)
+            {
+                if (!raw_get_word(max_words, n_words, &word) || word > iter.array_size)
+                {
+                    return false;
+                }
+                count = word;
+                *(pb_size_t *)iter.pSize = count;
+            }
+
+            for (pb_size_t i = 0; i < count; i++)
+            {
+                if (!raw_decode_value(&iter, (char *)iter.pData + i * iter.data_size, max_words, n_words))
+                {
+                    return false;
+                }
+            }
+        }
+        else
+        {
+            if (PB_HTYPE(iter.type) == PB_HTYPE_OPTIONAL && iter.pSize != NULL)
+            {
+                if (!raw_get_word(max_words, n_words, &word))
+                {
+                    return false;
+                }
+                *(bool *)iter.pSize = word != 0;
+            }
+
+            if (!raw_decode_value(&iter, iter.pData, max_words, n_words))
+            {
+                return false;
+            }
+        }
+    } while (pb_field_iter_next(&iter));
+
+    return true;
+}
+
 int sel4gpi_rpc_env_init(sel4gpi_rpc_env_t *env,
                          const pb_msgdesc_t *request_desc,
                          const pb_msgdesc_t *reply_desc)
@@ -22,6 +308,38 @@ int sel4gpi_rpc_env_init(sel4gpi_rpc_env_t *env,
     return 0;
 }
 
+static int sel4gpi_rpc_decode_reply(sel4gpi_rpc_env_t *env, seL4_MessageInfo_t reply_tag, void *reply)
+{
+    seL4_Word label = seL4_MessageInfo_get_label(reply_tag);
+
+    if (label == SEL4GPI_RPC_RAW_LABEL)
+    {
+        size_t n_words = 0;
+        if (!raw_decode_msg(env->reply_desc, reply, seL4_MessageInfo_get_length(reply_tag), &n_words))
+        {
+            ZF_LOGE("sel4gpi_rpc: Failed to decode raw server reply");
+            return 1;
+        }
+
+        return 0;
+    }
+
+    if (label != seL4_NoError)
+    {
+        return 1;
+    }
+
+    pb_istream_t istream = pb_istream_from_IPC(0);
+    bool ret = pb_decode_delimited(&istream, env->reply_desc, reply);
+    if (!ret)
+    {
+        ZF_LOGE("sel4gpi_rpc: Failed to decode server reply (%s)", PB_GET_ERROR(&istream));
+        return 1;
+    }
+
+    return 0;
+}
+
 int sel4gpi_rpc_call(sel4gpi_rpc_env_t *env, seL4_CPtr ep, void *msg,
                      int n_caps, seL4_CPtr *caps, void *reply)
 {
@@ -50,24 +368,47 @@ int sel4gpi_rpc_call(sel4gpi_rpc_env_t *env, seL4_CPtr ep, void *msg,
     /* make the call */
     seL4_MessageInfo_t reply_tag = seL4_Call(ep, seL4_MessageInfo_new(0, 0, n_caps, stream_size));
 
-    if (seL4_MessageInfo_ptr_get_label(&reply_tag) != seL4_NoError)
+    return sel4gpi_rpc_decode_reply(env, reply_tag, reply);
+}
+
+int sel4gpi_rpc_call_raw(sel4gpi_rpc_env_t *env, seL4_CPtr ep, void *msg,
+                         int n_caps, seL4_CPtr *caps, void *reply)
+{
+    size_t n_words = 0;
+    if (!raw_encode_msg(env->request_desc, msg, &n_words))
     {
-        return 1;
+        /* Not a fixed-layout message, send it with protobuf instead */
+        return sel4gpi_rpc_call(env, ep, msg, n_caps, caps, reply);
     }
 
-    pb_istream_t istream = pb_istream_from_IPC(0);
-    ret = pb_decode_delimited(&istream, env->reply_desc, reply);
-    if (!ret)
+    /* set the caps to send */
+    for (int i = 0; i < n_caps; i++)
     {
-        ZF_LOGE("sel4gpi_rpc: Failed to decode server reply (%s)", PB_GET_ERROR(&stream));
-        return 1;
+        seL4_SetCap(i, caps[i]);
     }
 
-    return 0;
+    /* make the call */
+    seL4_MessageInfo_t reply_tag = seL4_Call(ep, seL4_MessageInfo_new(SEL4GPI_RPC_RAW_LABEL, 0, n_caps, n_words));
+
+    return sel4gpi_rpc_decode_reply(env, reply_tag, reply);
 }
 
-int sel4gpi_rpc_recv(sel4gpi_rpc_env_t *env, void *res)
+int sel4gpi_rpc_recv(sel4gpi_rpc_env_t *env, seL4_MessageInfo_t tag, void *res, bool *raw)
 {
+    *raw = seL4_MessageInfo_get_label(tag) == SEL4GPI_RPC_RAW_LABEL;
+
+    if (*raw)
+    {
+        size_t n_words = 0;
+        if (!raw_decode_msg(env->request_desc, res, seL4_MessageInfo_get_length(tag), &n_words))
+        {
+            ZF_LOGE("Invalid raw message");
+            return 1;
+        }
+
+        return 0;
+    }
+
     pb_istream_t stream = pb_istream_from_IPC(0);
     bool ret = pb_decode_delimited(&stream, env->request_desc, res);
     if (!ret)
@@ -79,8 +420,20 @@ int sel4gpi_rpc_recv(sel4gpi_rpc_env_t *env, void *res)
     return 0;
 }
 
-int sel4gpi_rpc_reply(sel4gpi_rpc_env_t *env, void *msg, seL4_MessageInfo_t *msg_info)
+int sel4gpi_rpc_reply(sel4gpi_rpc_env_t *env, void *msg, bool raw, seL4_MessageInfo_t *msg_info)
 {
+    if (raw)
+    {
+        size_t n_words = 0;
+        if (raw_encode_msg(env->reply_desc, msg, &n_words))
+        {
+            *msg_info = seL4_MessageInfo_new(SEL4GPI_RPC_RAW_LABEL, 0, 0, n_words);
+            return 0;
+        }
+
+        /* The reply does not have a fixed layout, the client decodes it as protobuf instead */
+    }
+
     pb_ostream_t ostream = pb_ostream_from_IPC(0);
 
     bool ret = pb_encode_delimited(&ostream, env->reply_desc, msg);
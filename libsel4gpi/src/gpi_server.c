@@ -45,7 +45,7 @@ gpi_server_context_t *get_gpi_server(void)
     return &gpi_server;
 }
 
-static inline seL4_MessageInfo_t recv(seL4_Word *sender_badge_ptr)
+static inline seL4_MessageInfo_t recv(sel4utils_thread_t *thread, seL4_Word *sender_badge_ptr)
 {
     /** NOTE:
 
@@ -54,14 +54,42 @@ static inline seL4_MessageInfo_t recv(seL4_Word *sender_badge_ptr)
 
     return api_recv(get_gpi_server()->server_ep_obj.cptr,
                     sender_badge_ptr,
-                    get_gpi_server()->server_thread.reply.cptr);
+                    thread->reply.cptr);
 }
 
-static inline void reply(seL4_MessageInfo_t tag)
+static inline void reply(sel4utils_thread_t *thread, seL4_MessageInfo_t tag)
 {
-    api_reply(get_gpi_server()->server_thread.reply.cptr, tag);
+    api_reply(thread->reply.cptr, tag);
 }
 
+void gpi_server_lock(void)
+{
+#if GPI_SERVER_NUM_WORKERS > 1
+    sync_mutex_lock(get_gpi_server()->mx);
+#endif
+}
+
+void gpi_server_unlock(void)
+{
+#if GPI_SERVER_NUM_WORKERS > 1
+    sync_mutex_unlock(get_gpi_server()->mx);
+#endif
+}
+
+static void gpi_server_loop(sel4utils_thread_t *thread);
+
+#if GPI_SERVER_NUM_WORKERS > 1
+/**
+ * @brief The starting point for the additional server threads
+ *
+ * @param arg0 the sel4utils thread of this worker
+ */
+static void gpi_server_worker_main(void *arg0, void *arg1, void *ipc_buf)
+{
+    gpi_server_loop((sel4utils_thread_t *)arg0);
+}
+#endif
+
 seL4_Error
 gpi_server_parent_spawn_thread(simple_t *parent_simple, vka_t *parent_vka,
                                vspace_t *parent_vspace,
@@ -182,6 +210,29 @@ gpi_server_parent_spawn_thread(simple_t *parent_simple, vka_t *parent_vka,
     }
 
     NAME_THREAD(get_gpi_server()->server_thread.tcb.cptr, "gpi server");
+
+#if GPI_SERVER_NUM_WORKERS > 1
+    // The workers serialize request handling with the driver's mutex
+    assert(mx != NULL);
+
+    // Configure the workers before any server thread runs, since they share the parent's VKA
+    for (int i = 0; i < GPI_SERVER_NUM_WORKERS - 1; i++)
+    {
+        error = sel4utils_configure_thread_config(parent_vka,
+                                                  parent_vspace,
+                                                  parent_vspace,
+                                                  config,
+                                                  &get_gpi_server()->worker_threads[i]);
+        if (error != 0)
+        {
+            ZF_LOGE(GPISERVP "spawn_thread: failed to configure worker thread %d, err=%u.", i, error);
+            goto out;
+        }
+
+        NAME_THREAD(get_gpi_server()->worker_threads[i].tcb.cptr, "gpi server worker");
+    }
+#endif
+
     error = sel4utils_start_thread(&get_gpi_server()->server_thread,
                                    (sel4utils_thread_entry_fn)&gpi_server_main,
                                    NULL, NULL, 1);
@@ -209,6 +260,20 @@ gpi_server_parent_spawn_thread(simple_t *parent_simple, vka_t *parent_vka,
         goto out;
     }
 
+#if GPI_SERVER_NUM_WORKERS > 1
+    for (int i = 0; i < GPI_SERVER_NUM_WORKERS - 1; i++)
+    {
+        error = sel4utils_start_thread(&get_gpi_server()->worker_threads[i],
+                                       (sel4utils_thread_entry_fn)&gpi_server_worker_main,
+                                       &get_gpi_server()->worker_threads[i], NULL, 1);
+        if (error != 0)
+        {
+            ZF_LOGE(GPISERVP "spawn_thread: failed to start worker thread %d, err=%u.", i, error);
+            goto out;
+        }
+    }
+#endif
+
     OSDB_PRINTF("spawn_thread: Server thread binded well. at public EP %lu\n",
                 get_gpi_server()->server_ep_obj.cptr);
     return 0;
@@ -232,7 +297,6 @@ void gpi_server_main()
 {
     int error = 0;
     seL4_MessageInfo_t tag;
-    cspacepath_t received_cap_path;
 
 #if BENCHMARK_GPI_SERVER
     sel4bench_init();
@@ -246,11 +310,11 @@ void gpi_server_main()
      * seL4_Reply to report our status.
      */
     seL4_Word sender_badge;
-    recv(&sender_badge);
+    recv(&get_gpi_server()->server_thread, &sender_badge);
     assert(sender_badge == GPI_SERVER_BADGE_PARENT_VALUE);
 
     tag = seL4_MessageInfo_new(0, 0, 0, 1);
-    reply(tag);
+    reply(&get_gpi_server()->server_thread, tag);
 
     /* If the bind failed, this thread has essentially failed its mandate, so
      * there is no reason to leave it scheduled. Kill it (to whatever extent
@@ -263,8 +327,25 @@ void gpi_server_main()
         seL4_TCB_Suspend(get_gpi_server()->server_thread.tcb.cptr);
     }
 
+    gpi_server_loop(&get_gpi_server()->server_thread);
+}
+
+/**
+ * @brief Receive and dispatch requests on the server endpoint, run by every server thread
+ *
+ * @param thread the sel4utils thread running the loop
+ */
+static void gpi_server_loop(sel4utils_thread_t *thread)
+{
+    int error = 0;
+    seL4_MessageInfo_t tag;
+    seL4_Word sender_badge;
+    cspacepath_t received_cap_path;
+
     // Allocate an initial receive path
+    gpi_server_lock();
     error = vka_cspace_alloc_path(get_gpi_server()->server_vka, &received_cap_path);
+    gpi_server_unlock();
     assert(error == 0);
     OSDB_PRINTF("main: Entering main loop and accepting requests.\n");
 
@@ -275,7 +356,7 @@ void gpi_server_main()
             /* _service */ received_cap_path.root,
             /* index */ received_cap_path.capPtr,
             /* depth */ received_cap_path.capDepth);
-        tag = recv(&sender_badge);
+        tag = recv(thread, &sender_badge);
 
         OSDB_PRINTF("Got message on EP with ");
         BADGE_PRINT(sender_badge);
@@ -320,7 +401,7 @@ void gpi_server_main()
     // serial_server_func_kill();
     /* After we break out of the loop, seL4_TCB_Suspend ourselves */
     ZF_LOGI(GPISERVS "main: Suspending.");
-    seL4_TCB_Suspend(get_gpi_server()->server_thread.tcb.cptr);
+    seL4_TCB_Suspend(thread->tcb.cptr);
 }
 
 void gpi_panic(char *reason, uint64_t code)
@@ -46,14 +46,15 @@ static int mo_connect(seL4_CPtr server_ep_cap,
 
     MoReturnMessage ret_msg = {0};
 
-    error = sel4gpi_rpc_call(&rpc_env, server_ep_cap, (void *)&msg,
-                             0, NULL, (void *)&ret_msg);
+    error = sel4gpi_rpc_call_raw(&rpc_env, server_ep_cap, (void *)&msg,
+                                 0, NULL, (void *)&ret_msg);
     error |= ret_msg.errorCode;
 
     if (!error)
     {
         ret_conn->ep = ret_msg.msg.alloc.slot;
         ret_conn->id = ret_msg.msg.alloc.id;
+        ret_conn->size = (size_t)num_pages << page_bits;
     }
 
     return error;
@@ -94,4 +95,73 @@ int mo_component_client_disconnect(mo_client_context_t *conn)
     error |= ret_msg.errorCode;
 
     return error;
-}
\ No newline at end of file
+}
+
+int mo_component_client_slice(mo_client_context_t *conn,
+                              uint32_t *pages,
+                              uint32_t num_pages,
+                              gpi_obj_id_t pd_id,
+                              gpi_space_id_t space_id,
+                              mo_client_context_t *ret_conn)
+{
+    OSDB_PRINTF("Sending slice request to MO component\n");
+
+    int error = 0;
+
+    MoMessage msg = {
+        .magic = MO_RPC_MAGIC,
+        .which_msg = MoMessage_slice_tag,
+        .msg.slice = {
+            .pages_count = num_pages,
+            .pd_id = pd_id,
+            .space_id = space_id,
+        }};
+
+    if (num_pages > MO_SLICE_MAX_PAGES)
+    {
+        OSDB_PRINTERR("Cannot slice %u pages, the maximum is %u\n", num_pages, MO_SLICE_MAX_PAGES);
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < num_pages; i++)
+    {
+        msg.msg.slice.pages[i] = pages[i];
+    }
+
+    MoReturnMessage ret_msg = {0};
+
+    error = sel4gpi_rpc_call_raw(&rpc_env, conn->ep, (void *)&msg,
+                                 0, NULL, (void *)&ret_msg);
+    error |= ret_msg.errorCode;
+
+    if (!error)
+    {
+        ret_conn->ep = ret_msg.msg.alloc.slot;
+        ret_conn->id = ret_msg.msg.alloc.id;
+        ret_conn->size = (size_t)num_pages << MO_PAGE_BITS;
+    }
+
+    return error;
+}
+
+int mo_component_client_revoke_slice(mo_client_context_t *conn, gpi_obj_id_t slice_id)
+{
+    OSDB_PRINTF("Sending revoke slice request to MO component\n");
+
+    int error = 0;
+
+    MoMessage msg = {
+        .magic = MO_RPC_MAGIC,
+        .which_msg = MoMessage_revoke_slice_tag,
+        .msg.revoke_slice = {
+            .slice_id = slice_id,
+        }};
+
+    MoReturnMessage ret_msg = {0};
+
+    error = sel4gpi_rpc_call_raw(&rpc_env, conn->ep, (void *)&msg,
+                                 0, NULL, (void *)&ret_msg);
+    error |= ret_msg.errorCode;
+
+    return error;
+}
@@ -28,6 +28,9 @@
 #include <sel4gpi/mo_clientapi.h>
 
 #include <sel4gpi/gpi_server.h>
+#include <sel4gpi/pd_component.h>
+#include <sel4gpi/ads_component.h>
+#include <sel4gpi/resource_space_component.h>
 #include <sel4gpi/badge_usage.h>
 #include <sel4gpi/debug.h>
 #include <sel4gpi/error_handle.h>
@@ -147,6 +150,123 @@ err_goto:
     reply_msg->errorCode = error;
 }
 
+static void handle_mo_slice_request(seL4_Word sender_badge,
+                                    MoSliceMessage *msg, MoReturnMessage *reply_msg)
+{
+    OSDB_PRINTF("Got MO slice request from %lx\n", sender_badge);
+    BADGE_PRINT(sender_badge);
+
+    int error = 0;
+    seL4_CPtr ret_cap;
+    mo_component_registry_entry_t *new_entry;
+    gpi_obj_id_t mo_id = get_object_id_from_badge(sender_badge);
+
+    mo_component_registry_entry_t *parent_entry =
+        (mo_component_registry_entry_t *)resource_component_registry_get_by_id(get_mo_component(), mo_id);
+    SERVER_GOTO_IF_COND(parent_entry == NULL, "Couldn't find MO (%u)\n", mo_id);
+    mo_t *parent = &parent_entry->mo;
+
+    /* The new MO can only go to the sender, or to a client of a resource space the sender manages */
+    gpi_obj_id_t client_id = get_client_id_from_badge(sender_badge);
+    if (msg->pd_id != client_id)
+    {
+        resspc_component_registry_entry_t *space_entry = resource_space_get_entry_by_id(msg->space_id);
+        SERVER_GOTO_IF_COND(space_entry == NULL || space_entry->space.pd_id != client_id,
+                            "PD (%u) does not manage resource space (%u)\n", client_id, msg->space_id);
+
+        pd_component_registry_entry_t *target_pd = pd_component_registry_get_entry_by_id(msg->pd_id);
+        SERVER_GOTO_IF_COND(target_pd == NULL, "Couldn't find PD (%u)\n", msg->pd_id);
+        SERVER_GOTO_IF_COND(!pd_has_resources_in_space(&target_pd->pd, msg->space_id),
+                            "PD (%u) holds no resources from space (%u)\n", msg->pd_id, msg->space_id);
+    }
+
+    SERVER_GOTO_IF_COND(msg->pages_count == 0, "Cannot slice an MO with no pages\n");
+    for (int i = 0; i < msg->pages_count; i++)
+    {
+        SERVER_GOTO_IF_COND(msg->pages[i] >= parent->num_pages,
+                            "Page %u is out of range for MO (%u) with %u pages\n",
+                            msg->pages[i], mo_id, parent->num_pages);
+        SERVER_GOTO_IF_COND(parent->frame_caps_in_root_task[msg->pages[i]] == seL4_CapNull,
+                            "Page %u of MO (%u) is not backed by a frame\n", msg->pages[i], mo_id);
+    }
+
+    mo_new_args_t alloc_args = {
+        .num_pages = msg->pages_count,
+        .page_bits = parent->page_bits,
+        .parent = parent,
+        .parent_pages = msg->pages,
+    };
+
+    error = resource_component_allocate(get_mo_component(), msg->pd_id, BADGE_OBJ_ID_NULL, false, (void *)&alloc_args,
+                                        (resource_registry_node_t **)&new_entry, &ret_cap);
+    SERVER_GOTO_IF_ERR(error, "Failed to allocate MO slice for PD (%u)\n", msg->pd_id);
+
+    OSDB_PRINTF("Sliced MO (%u) with %u pages from MO (%u) for PD (%u)\n",
+                new_entry->mo.id, new_entry->mo.num_pages, mo_id, msg->pd_id);
+
+    reply_msg->msg.alloc.id = new_entry->mo.id;
+    reply_msg->msg.alloc.slot = ret_cap;
+
+err_goto:
+    reply_msg->which_msg = MoReturnMessage_alloc_tag;
+    reply_msg->errorCode = error;
+}
+
+static void handle_mo_revoke_slice_request(seL4_Word sender_badge,
+                                           MoRevokeSliceMessage *msg, MoReturnMessage *reply_msg)
+{
+    OSDB_PRINTF("Got MO revoke slice request from %lx\n", sender_badge);
+    BADGE_PRINT(sender_badge);
+
+    int error = 0;
+    gpi_obj_id_t *holder_ids = NULL;
+    gpi_obj_id_t mo_id = get_object_id_from_badge(sender_badge);
+
+    mo_component_registry_entry_t *slice_entry =
+        (mo_component_registry_entry_t *)resource_component_registry_get_by_id(get_mo_component(), msg->slice_id);
+    if (slice_entry == NULL)
+    {
+        // Every holder already released the slice
+        OSDB_PRINTF("MO slice (%u) no longer exists, nothing to revoke\n", msg->slice_id);
+        goto err_goto;
+    }
+    SERVER_GOTO_IF_COND(slice_entry->mo.parent_id != mo_id, "MO (%u) is not a slice of MO (%u)\n",
+                        msg->slice_id, mo_id);
+
+    /* Hold the slice, so it outlives the removals below */
+    error = resource_component_inc(get_mo_component(), msg->slice_id);
+    SERVER_GOTO_IF_ERR(error, "Failed to hold MO slice (%u)\n", msg->slice_id);
+
+    /* Unmap the slice from every ADS */
+    error = ads_component_rm_mo(msg->slice_id);
+    SERVER_WARN_IF_COND(error, "Failed to remove some attaches of MO slice (%u)\n", msg->slice_id);
+
+    /* Revoke the slice from every PD that holds it */
+    gpi_res_id_t res_id = make_res_id(GPICAP_TYPE_MO, get_mo_component()->space_id, msg->slice_id);
+    size_t n_holders;
+    holder_ids = pd_get_resource_holders(res_id, &n_holders);
+
+    for (size_t i = 0; i < n_holders; i++)
+    {
+        pd_component_registry_entry_t *pd_entry = pd_component_registry_get_entry_by_id(holder_ids[i]);
+        if (pd_entry != NULL)
+        {
+            pd_delete_resource(&pd_entry->pd, res_id);
+        }
+    }
+
+    OSDB_PRINTF("Revoked MO slice (%u) of MO (%u) from %zu PDs\n", msg->slice_id, mo_id, n_holders);
+
+    /* The slice, and its hold on this MO, are freed here */
+    resource_component_dec(get_mo_component(), msg->slice_id);
+    error = 0;
+
+err_goto:
+    free(holder_ids);
+    reply_msg->which_msg = MoReturnMessage_basic_tag;
+    reply_msg->errorCode = error;
+}
+
 static void mo_component_handle(void *msg_p,
                                 seL4_Word sender_badge,
                                 seL4_CPtr received_cap,
@@ -174,6 +294,12 @@ static void mo_component_handle(void *msg_p,
         case MoMessage_disconnect_tag:
             handle_mo_disconnect_request(sender_badge, &msg->msg.disconnect, reply_msg);
             break;
+        case MoMessage_slice_tag:
+            handle_mo_slice_request(sender_badge, &msg->msg.slice, reply_msg);
+            break;
+        case MoMessage_revoke_slice_tag:
+            handle_mo_revoke_slice_request(sender_badge, &msg->msg.revoke_slice, reply_msg);
+            break;
         default:
             SERVER_GOTO_IF_COND(1, "Unknown request received: %u\n", msg->which_msg);
             break;
@@ -14,6 +14,7 @@
 #include <sel4utils/util.h>
 #include <sel4utils/helpers.h>
 #include <vka/object.h>
+#include <vka/capops.h>
 
 #include <sel4gpi/mo_component.h>
 #include <sel4gpi/mo_obj.h>
@@ -27,22 +28,133 @@
 #define SERVER_ID MOSERVS
 #define DEFAULT_ERR MoComponentError_UNKNOWN
 
+/**
+ * Delete the frame caps of an extent and return its untyped to the VKA
+ */
+static void free_extent(vka_t *vka, mo_t *mo, mo_extent_t *extent)
+{
+    for (uint32_t i = extent->first_page; i < extent->first_page + extent->num_pages; i++)
+    {
+        if (mo->frame_caps_in_root_task[i] == seL4_CapNull)
+        {
+            continue;
+        }
+
+        // Check if the cap is the last copy - it should be
+        // If not, the untyped will be reused while the frame is still mapped
+#ifdef CONFIG_DEBUG_BUILD
+        if (!seL4_DebugCapIsLastCopy(mo->frame_caps_in_root_task[i]))
+        {
+            OSDB_PRINTERR("Freeing frame (%lx) for MO (%u), cap (%lu) is not last copy\n",
+                          mo_frame_paddr(mo, i), mo->id, mo->frame_caps_in_root_task[i]);
+        }
+#endif
+
+        cspacepath_t path;
+        vka_cspace_make_path(vka, mo->frame_caps_in_root_task[i], &path);
+        vka_cnode_delete(&path);
+        vka_cspace_free_path(vka, path);
+        mo->frame_caps_in_root_task[i] = seL4_CapNull;
+    }
+
+    // The untyped must have no remaining children before it is returned
+    vka_free_object(vka, &extent->untyped);
+}
+
+/**
+ * Allocate a power-of-two run of frames from a single untyped, so they are physically contiguous
+ *
+ * @param extent returns the allocated extent
+ * @param first_page index in the MO of the first frame to allocate
+ * @param num_pages number of frames to allocate, must be a power of two
+ * @return int 0 on success, 1 if there is no untyped large enough or the retype failed
+ */
+static int alloc_extent(vka_t *vka, mo_t *mo, mo_extent_t *extent, uint32_t first_page, uint32_t num_pages,
+                        size_t page_bits)
+{
+    int error = 0;
+    assert((num_pages & (num_pages - 1)) == 0);
+
+    size_t untyped_bits = page_bits + __builtin_ctz(num_pages);
+    error = vka_alloc_untyped(vka, untyped_bits, &extent->untyped);
+    if (error)
+    {
+        return error;
+    }
+
+    extent->paddr = vka_object_paddr(vka, &extent->untyped);
+    extent->first_page = first_page;
+    extent->num_pages = num_pages;
+
+    // Frames are retyped in order from the start of the untyped
+    // (XXX) The VKA does not allocate contiguous slot ranges, so each frame is retyped separately
+    seL4_Word frame_type = kobject_get_type(KOBJECT_FRAME, page_bits);
+    for (uint32_t i = 0; i < num_pages; i++)
+    {
+        cspacepath_t path;
+        error = vka_cspace_alloc_path(vka, &path);
+        SERVER_GOTO_IF_ERR(error, "failed to allocate slot for MO frame\n");
+
+        error = vka_untyped_retype(&extent->untyped, frame_type, page_bits, 1, &path);
+        if (error)
+        {
+            vka_cspace_free_path(vka, path);
+        }
+        SERVER_GOTO_IF_ERR(error, "failed to retype frame for MO\n");
+
+        mo->frame_caps_in_root_task[first_page + i] = path.capPtr;
+    }
+
+    return error;
+
+err_goto:
+    free_extent(vka, mo, extent);
+    return error;
+}
+
 static int alloc_frames(vka_t *vka, mo_t *mo, uint32_t num_pages, size_t page_bits)
 {
     int error = 0;
-    for (int i = 0; i < num_pages; i++)
+    uint32_t max_extents = 0;
+    uint32_t page = 0;
+
+    while (page < num_pages)
     {
-        error = vka_alloc_frame_maybe_device(vka,
-                                             page_bits,
-                                             false,
-                                             &mo->vka_objects[i]);
-        SERVER_GOTO_IF_ERR(error, "failed to allocate page for MO\n");
-        mo->frame_caps_in_root_task[i] = mo->vka_objects[i].cptr;
-        mo->frame_paddrs[i] = vka_object_paddr(vka, &mo->vka_objects[i]);
+        // Take the largest power-of-two run of the remaining pages,
+        // and halve it until the VKA has an untyped large enough
+        uint32_t remaining = num_pages - page;
+        uint32_t run = 1u << (31 - __builtin_clz(remaining));
+
+        if (mo->num_extents == max_extents)
+        {
+            max_extents = max_extents ? max_extents * 2 : __builtin_popcount(remaining);
+            mo_extent_t *extents = realloc(mo->extents, max_extents * sizeof(mo_extent_t));
+            SERVER_GOTO_IF_COND(extents == NULL, "malloc ran out of memory to allocate MO extents\n");
+            mo->extents = extents;
+        }
+
+        while (alloc_extent(vka, mo, &mo->extents[mo->num_extents], page, run, page_bits) != 0)
+        {
+            SERVER_GOTO_IF_COND(run == 1, "failed to allocate page for MO\n");
+            run /= 2;
+        }
+
+        mo->num_extents++;
+        page += run;
     }
 
+    OSDB_PRINTF("Allocated %u pages for MO in %u extents\n", num_pages, mo->num_extents);
+
+    return error;
+
 err_goto:
-    // TODO: free frames if something failed mid-allocation
+    for (uint32_t i = 0; i < mo->num_extents; i++)
+    {
+        free_extent(vka, mo, &mo->extents[i]);
+    }
+    free(mo->extents);
+    mo->extents = NULL;
+    mo->num_extents = 0;
     return error;
 }
 
@@ -74,15 +186,39 @@ int mo_new(mo_t *mo,
 
     mo->num_pages = alloc_args->num_pages;
     mo->page_bits = alloc_args->page_bits;
+    mo->parent_id = 0;
     mo->frame_caps_in_root_task = calloc(alloc_args->num_pages, sizeof(seL4_CPtr));
-    mo->frame_paddrs = calloc(alloc_args->num_pages, sizeof(uintptr_t));
-    mo->vka_objects = calloc(alloc_args->num_pages, sizeof(vka_object_t));
-    SERVER_GOTO_IF_COND(mo->frame_caps_in_root_task == NULL || mo->frame_paddrs == NULL || mo->vka_objects == NULL,
+    SERVER_GOTO_IF_COND(mo->frame_caps_in_root_task == NULL,
                         "malloc ran out of memory to allocate MO with %u frames\n", alloc_args->num_pages);
 
     /* Allocate frames */
-    if (alloc_args->paddr)
+    if (alloc_args->parent)
+    {
+        // Frames are shared with the parent, which is kept alive until this MO is destroyed
+        mo_t *parent = alloc_args->parent;
+        mo->page_bits = parent->page_bits;
+        mo->frame_paddrs = calloc(alloc_args->num_pages, sizeof(uintptr_t));
+        SERVER_GOTO_IF_COND(mo->frame_paddrs == NULL,
+                            "malloc ran out of memory to allocate MO with %u frames\n", alloc_args->num_pages);
+
+        for (uint32_t i = 0; i < alloc_args->num_pages; i++)
+        {
+            mo->frame_caps_in_root_task[i] = parent->frame_caps_in_root_task[alloc_args->parent_pages[i]];
+            mo->frame_paddrs[i] = mo_frame_paddr(parent, alloc_args->parent_pages[i]);
+        }
+
+        error = resource_component_inc(get_mo_component(), parent->id);
+        SERVER_GOTO_IF_ERR(error, "Failed to hold parent MO (%u)\n", parent->id);
+        mo->parent_id = parent->id;
+    }
+    else if (alloc_args->paddr)
     {
+        // Frames at a given paddr (e.g. device memory) are allocated one by one
+        mo->frame_paddrs = calloc(alloc_args->num_pages, sizeof(uintptr_t));
+        mo->vka_objects = calloc(alloc_args->num_pages, sizeof(vka_object_t));
+        SERVER_GOTO_IF_COND(mo->frame_paddrs == NULL || mo->vka_objects == NULL,
+                            "malloc ran out of memory to allocate MO with %u frames\n", alloc_args->num_pages);
+
         error = alloc_frames_at_paddr(vka, mo, alloc_args->num_pages, alloc_args->page_bits, alloc_args->paddr);
     }
     else
@@ -102,6 +238,25 @@ err_goto:
     return error;
 }
 
+uintptr_t mo_frame_paddr(mo_t *mo, uint32_t page)
+{
+    if (mo->frame_paddrs)
+    {
+        return mo->frame_paddrs[page];
+    }
+
+    for (uint32_t i = 0; i < mo->num_extents; i++)
+    {
+        mo_extent_t *extent = &mo->extents[i];
+        if (page >= extent->first_page && page < extent->first_page + extent->num_pages)
+        {
+            return extent->paddr + (page - extent->first_page) * SIZE_BITS_TO_BYTES(mo->page_bits);
+        }
+    }
+
+    return 0;
+}
+
 gpi_model_node_t *mo_dump_rr(mo_t *mo, model_state_t *ms, gpi_model_node_t *pd_node)
 {
     gpi_model_node_t *root_node = get_root_node(ms);
@@ -150,8 +305,8 @@ gpi_model_node_t *mo_dump_rr(mo_t *mo, model_state_t *ms, gpi_model_node_t *pd_n
 
         // Set the number of pages, page size and starting phys addr as extra data on the MO
         char extra_str[CSV_MAX_STRING_SIZE];
-        snprintf(extra_str, CSV_MAX_STRING_SIZE, "0x%lx_%u_%zu", mo->frame_paddrs[0], num_pages, mo->page_bits);
-        set_node_extra(mo_node, extra_str);
+        snprintf(extra_str, CSV_MAX_STRING_SIZE, "0x%lx_%u_%zu", mo_frame_paddr(mo, 0), num_pages, mo->page_bits);
+        set_node_extra(ms, mo_node, extra_str);
 
         mo_node->extracted = true;
     }
@@ -160,29 +315,44 @@ gpi_model_node_t *mo_dump_rr(mo_t *mo, model_state_t *ms, gpi_model_node_t *pd_n
 
 void mo_destroy(mo_t *mo, vka_t *server_vka)
 {
-    if (mo->vka_objects == NULL)
+    /* Free all MO frames */
+    if (mo->parent_id)
     {
-        OSDB_PRINTWARN("Can't free frames for MO (%u), no associated vka objects\n", mo->id);
-        return;
+        // The frames belong to the parent MO, which may now be deleted too
+        resource_component_dec(get_mo_component(), mo->parent_id);
     }
-
-    /* Free all MO frames */
-    for (int i = 0; i < mo->num_pages; i++)
+    else if (mo->extents)
     {
-        // Check if the cap is the last copy - it should be
-        // If not, it will cause errors with the VKA later
-#ifdef CONFIG_DEBUG_BUILD
-        if (!seL4_DebugCapIsLastCopy(mo->vka_objects[i].cptr))
+        for (uint32_t i = 0; i < mo->num_extents; i++)
         {
-            OSDB_PRINTERR("Freeing frame (%lx) for MO (%u), cap (%lu) is not last copy\n",
-                          mo->frame_paddrs[i], mo->id, mo->vka_objects[i].cptr);
+            free_extent(server_vka, mo, &mo->extents[i]);
         }
+    }
+    else if (mo->vka_objects)
+    {
+        for (int i = 0; i < mo->num_pages; i++)
+        {
+            // Check if the cap is the last copy - it should be
+            // If not, it will cause errors with the VKA later
+#ifdef CONFIG_DEBUG_BUILD
+            if (!seL4_DebugCapIsLastCopy(mo->vka_objects[i].cptr))
+            {
+                OSDB_PRINTERR("Freeing frame (%lx) for MO (%u), cap (%lu) is not last copy\n",
+                              mo->frame_paddrs[i], mo->id, mo->vka_objects[i].cptr);
+            }
 #endif
 
-        vka_free_object(server_vka, &mo->vka_objects[i]);
+            vka_free_object(server_vka, &mo->vka_objects[i]);
+        }
+    }
+    else
+    {
+        OSDB_PRINTWARN("Can't free frames for MO (%u), no associated vka objects\n", mo->id);
+        return;
     }
 
     free(mo->frame_caps_in_root_task);
     free(mo->frame_paddrs);
     free(mo->vka_objects);
-}
\ No newline at end of file
+    free(mo->extents);
+}
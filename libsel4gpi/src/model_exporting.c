@@ -1,7 +1,7 @@
 /**
  * @file model_exporting.c
  * @author Sid Agrawal(sid@sid-agrawal.ca)
- * @brief Implements the methods to export the model state as a CSV
+ * @brief Implements the methods to export the model state as a CSV or in a binary format
  * @version 0.1
  * @date 2023-12-27
  *
@@ -9,6 +9,10 @@
  *
  */
 
+#include <stddef.h>
+#include <unistd.h>
+#include <utils/util.h>
+
 #include <sel4utils/process.h>
 #include <sel4utils/vspace.h>
 #include <sel4utils/util.h>
@@ -49,42 +53,67 @@ static char *node_type_to_str(gpi_node_type_t node_type)
     }
 }
 
-// Create a string ID for a node
-static void make_node_id(char *str_id, char *prefix, gpi_obj_id_t id)
+// Create the integer key for a node
+static gpi_model_node_key_t make_node_key(gpi_node_type_t node_type, gpi_cap_t type,
+                                          gpi_space_id_t space_id, gpi_obj_id_t object_id)
 {
-    snprintf(str_id, CSV_MAX_STRING_SIZE, "%s_%x", prefix, id);
+    return set_perms_to_badge(compact_res_id(type, space_id, object_id), node_type);
 }
 
-// Create a string ID for a node with two IDs
-static void make_node_id_2(char *str_id, char *prefix, gpi_obj_id_t id1, gpi_obj_id_t id2)
+static gpi_node_type_t node_key_type(gpi_model_node_key_t key)
 {
-    snprintf(str_id, CSV_MAX_STRING_SIZE, "%s_%x_%x", prefix, id1, id2);
+    return (gpi_node_type_t)get_perms_from_badge(key);
 }
 
-void init_model_state(model_state_t *model_state, void *free_ptr, size_t free_size)
+// Get the interned copy of a string, adding it to the string table if needed
+static const char *intern_string(model_state_t *model_state, const char *str)
 {
-    assert(model_state != NULL);
+    if (str == NULL || str[0] == '\0')
+    {
+        return NULL;
+    }
 
-    memset(model_state, 0, sizeof(model_state_t));
+    size_t len = strlen(str);
+    gpi_model_string_t *entry;
+    HASH_FIND(hh, model_state->strings, str, len, entry);
 
-    model_state->nodes = NULL;
-    model_state->edges = NULL;
-    model_state->mem_start = (gpi_model_state_component_t *)free_ptr;
-    model_state->mem_ptr = model_state->mem_start;
-    model_state->mem_end = (gpi_model_state_component_t *)(free_ptr + free_size);
-    assert(model_state->mem_start == free_ptr);
-    assert(model_state->mem_end == free_ptr + free_size);
+    if (entry == NULL)
+    {
+        entry = malloc(sizeof(gpi_model_string_t) + len + 1);
+        assert(entry != NULL);
+
+        entry->offset = model_state->strtab_size;
+        memcpy(entry->str, str, len + 1);
+        model_state->strtab_size += len + 1;
+
+        HASH_ADD_KEYPTR(hh, model_state->strings, entry->str, len, entry);
+    }
+
+    return entry->str;
+}
 
-    if (free_ptr != NULL)
+// Get the string table offset of an interned string
+static uint32_t string_offset(const char *str)
+{
+    if (str == NULL)
     {
-        memset(free_ptr, 0, free_size);
+        return GPI_MODEL_STR_NONE;
     }
+
+    gpi_model_string_t *entry = (gpi_model_string_t *)(str - offsetof(gpi_model_string_t, str));
+    return entry->offset;
 }
 
-void clean_model_state(model_state_t *model_state)
+static const char *str_or_empty(const char *str)
 {
-    HASH_CLEAR(hh, model_state->nodes);
-    HASH_CLEAR(hh, model_state->edges);
+    return str == NULL ? "" : str;
+}
+
+void init_model_state(model_state_t *model_state)
+{
+    assert(model_state != NULL);
+
+    memset(model_state, 0, sizeof(model_state_t));
 }
 
 void destroy_model_state(model_state_t *model_state)
@@ -105,169 +134,228 @@ void destroy_model_state(model_state_t *model_state)
         free(current_edge);
     }
 
+    // Delete all strings
+    gpi_model_string_t *current_str, *tmp3;
+    HASH_ITER(hh, model_state->strings, current_str, tmp3)
+    {
+        HASH_DEL(model_state->strings, current_str);
+        free(current_str);
+    }
+
     // Free the model state
     free(model_state);
 }
 
-// Function to export the model state to a buffer with CSV formatting
-void export_model_state(model_state_t *model_state, char *buffer, size_t buf_len)
+// Chunked output to a model export sink
+typedef struct _model_export_stream
+{
+    model_export_sink_t *sink;
+    char chunk[MODEL_EXPORT_CHUNK_SIZE]; ///< Output not yet passed to the sink
+    size_t len;                          ///< Bytes used in the chunk
+    int error;                           ///< First error returned by the sink
+} model_export_stream_t;
+
+static void stream_flush(model_export_stream_t *stream)
+{
+    if (stream->len > 0 && stream->error == 0)
+    {
+        stream->error = stream->sink->write(stream->sink->cookie, stream->chunk, stream->len);
+    }
+
+    stream->len = 0;
+}
+
+static void stream_write(model_export_stream_t *stream, const void *data, size_t len)
+{
+    while (len > 0 && stream->error == 0)
+    {
+        if (stream->len == MODEL_EXPORT_CHUNK_SIZE)
+        {
+            stream_flush(stream);
+        }
+
+        size_t n = MIN(len, MODEL_EXPORT_CHUNK_SIZE - stream->len);
+        memcpy(stream->chunk + stream->len, data, n);
+        stream->len += n;
+        data = (const char *)data + n;
+        len -= n;
+    }
+}
+
+// Write one CSV row, only one row is formatted at a time
+static void stream_csv_row(model_export_stream_t *stream, const char *node_type, const char *node_id,
+                           const char *data, const char *edge_type, const char *edge_from,
+                           const char *edge_to, const char *extra)
 {
+    char row[MODEL_EXPORT_ROW_SIZE];
+    int n = snprintf(row, sizeof(row), "%s,%s,%s,%s,%s,%s,%s\n",
+                     node_type, node_id, data, edge_type, edge_from, edge_to, extra);
 
+    stream_write(stream, row, MIN((size_t)n, sizeof(row) - 1));
+}
+
+int stream_model_state_csv(model_state_t *model_state, model_export_sink_t *sink)
+{
     assert(model_state != NULL);
 
-    size_t buf_written_total = 0;
-    uint8_t width = 0;
+    model_export_stream_t stream = {.sink = sink};
+    char id[CSV_MAX_STRING_SIZE];
+    char from[CSV_MAX_STRING_SIZE];
+    char to[CSV_MAX_STRING_SIZE];
 
     // Print the headers
-    size_t buf_written = snprintf(buffer, buf_len - buf_written_total,
-                                  "%-*s,%-*s,%-*s,%-*s,%-*s,%-*s,%-*s\n",
-                                  width,
-                                  "NODE_TYPE",
-                                  width,
-                                  "NODE_ID",
-                                  width,
-                                  "DATA",
-                                  width,
-                                  "EDGE_TYPE",
-                                  width,
-                                  "EDGE_FROM",
-                                  width,
-                                  "EDGE_TO",
-                                  width,
-                                  "EXTRA");
-
-    buffer += buf_written;
-    buf_written_total += buf_written;
+    stream_csv_row(&stream, "NODE_TYPE", "NODE_ID", "DATA", "EDGE_TYPE", "EDGE_FROM", "EDGE_TO", "EXTRA");
 
     // Print the nodes
-    for (gpi_model_node_t *node = model_state->nodes; node != NULL; node = node->hh.next)
+    for (gpi_model_node_t *node = model_state->nodes; node != NULL && stream.error == 0; node = node->hh.next)
     {
-        size_t buf_written = snprintf(buffer, buf_len - buf_written_total,
-                                      "%-*s,%-*s,%-*s,%-*s,%-*s,%-*s,%-*s\n",
-                                      width,
-                                      node_type_to_str(node->node_type),
-                                      width,
-                                      node->id,
-                                      width,
-                                      node->data,
-                                      width,
-                                      "",
-                                      width,
-                                      "",
-                                      width,
-                                      "",
-                                      width,
-                                      node->data2);
-
-        buffer += buf_written;
-        buf_written_total += buf_written;
-
-        assert(buf_written_total < buf_len);
+        get_node_str_id(node->id, id);
+        stream_csv_row(&stream, node_type_to_str(node->node_type), id, str_or_empty(node->data),
+                       "", "", "", str_or_empty(node->data2));
     }
 
     // Print the edges
-    for (gpi_model_edge_t *edge = model_state->edges; edge != NULL; edge = edge->hh.next)
+    for (gpi_model_edge_t *edge = model_state->edges; edge != NULL && stream.error == 0; edge = edge->hh.next)
     {
-        size_t buf_written = snprintf(buffer, buf_len - buf_written_total,
-                                      "%-*s,%-*s,%-*s,%-*s,%-*s,%-*s,%-*s\n",
-                                      width,
-                                      "",
-                                      width,
-                                      "",
-                                      width,
-                                      cap_type_to_str(edge->k.req_type),
-                                      width,
-                                      edge_type_to_str(edge->k.type),
-                                      width,
-                                      edge->k.from,
-                                      width,
-                                      edge->k.to,
-                                      width,
-                                      "");
-
-        buffer += buf_written;
-        buf_written_total += buf_written;
-
-        assert(buf_written_total < buf_len);
+        get_node_str_id(edge->k.from, from);
+        get_node_str_id(edge->k.to, to);
+        stream_csv_row(&stream, "", "", cap_type_to_str(edge->k.req_type), edge_type_to_str(edge->k.type),
+                       from, to, "");
     }
+
+    stream_flush(&stream);
+    return stream.error;
 }
 
-// Function to export the model state to a buffer with CSV formatting
-void print_model_state(model_state_t *model_state)
+int stream_model_state_binary(model_state_t *model_state, model_export_sink_t *sink)
 {
-
     assert(model_state != NULL);
-    uint8_t width = 0;
 
-    // Print the headers
-    printf("%-*s,%-*s,%-*s,%-*s,%-*s,%-*s,%-*s\n",
-           width,
-           "NODE_TYPE",
-           width,
-           "NODE_ID",
-           width,
-           "DATA",
-           width,
-           "EDGE_TYPE",
-           width,
-           "EDGE_FROM",
-           width,
-           "EDGE_TO",
-           width,
-           "EXTRA");
+    model_export_stream_t stream = {.sink = sink};
 
-    // Print the nodes
-    for (gpi_model_node_t *node = model_state->nodes; node != NULL; node = node->hh.next)
+    gpi_model_bin_header_t header = {
+        .magic = GPI_MODEL_BIN_MAGIC,
+        .n_nodes = model_state->n_nodes,
+        .n_edges = model_state->n_edges,
+        .strtab_size = model_state->strtab_size,
+    };
+    stream_write(&stream, &header, sizeof(header));
+
+    for (gpi_model_node_t *node = model_state->nodes; node != NULL && stream.error == 0; node = node->hh.next)
     {
-        printf("%-*s,%-*s,%-*s,%-*s,%-*s,%-*s,%-*s\n",
-               width,
-               node_type_to_str(node->node_type),
-               width,
-               node->id,
-               width,
-               node->data,
-               width,
-               "",
-               width,
-               "",
-               width,
-               "",
-               width,
-               node->data2);
+        gpi_model_bin_node_t bin_node = {
+            .id = node->id,
+            .data = string_offset(node->data),
+            .data2 = string_offset(node->data2),
+        };
+        stream_write(&stream, &bin_node, sizeof(bin_node));
     }
 
-    // Print the edges
-    for (gpi_model_edge_t *edge = model_state->edges; edge != NULL; edge = edge->hh.next)
+    for (gpi_model_edge_t *edge = model_state->edges; edge != NULL && stream.error == 0; edge = edge->hh.next)
+    {
+        stream_write(&stream, &edge->k, sizeof(gpi_model_edge_key_t));
+    }
+
+    // Strings are kept in insertion order, which is also their order in the string table
+    for (gpi_model_string_t *str = model_state->strings; str != NULL && stream.error == 0; str = str->hh.next)
+    {
+        stream_write(&stream, str->str, strlen(str->str) + 1);
+    }
+
+    stream_flush(&stream);
+    return stream.error;
+}
+
+// Sink that appends to a fixed buffer
+typedef struct _model_export_buffer
+{
+    char *buffer;
+    size_t len;
+    size_t written;
+} model_export_buffer_t;
+
+static int buffer_sink_write(void *cookie, const void *data, size_t len)
+{
+    model_export_buffer_t *buf = (model_export_buffer_t *)cookie;
+
+    // Keep whatever fits, so a full buffer holds a truncated export
+    size_t n = MIN(len, buf->len - buf->written);
+    memcpy(buf->buffer + buf->written, data, n);
+    buf->written += n;
+
+    return n < len ? 1 : 0;
+}
+
+// Sink that prints to the terminal
+static int print_sink_write(void *cookie, const void *data, size_t len)
+{
+    printf("%.*s", (int)len, (const char *)data);
+    return 0;
+}
+
+// Sink that writes to a file descriptor
+static int file_sink_write(void *cookie, const void *data, size_t len)
+{
+    int fd = (int)(uintptr_t)cookie;
+    const char *pos = (const char *)data;
+
+    while (len > 0)
+    {
+        ssize_t n = write(fd, pos, len);
+        if (n <= 0)
+        {
+            return 1;
+        }
+
+        pos += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+// Function to export the model state to a buffer with CSV formatting
+int export_model_state(model_state_t *model_state, char *buffer, size_t buf_len)
+{
+    if (buf_len == 0)
     {
-        printf("%-*s,%-*s,%-*s,%-*s,%-*s,%-*s,%-*s\n",
-               width,
-               "",
-               width,
-               "",
-               width,
-               cap_type_to_str(edge->k.req_type),
-               width,
-               edge_type_to_str(edge->k.type),
-               width,
-               edge->k.from,
-               width,
-               edge->k.to,
-               width,
-               "");
+        return 1;
     }
+
+    // Leave room for the terminator
+    model_export_buffer_t buf = {.buffer = buffer, .len = buf_len - 1};
+    model_export_sink_t sink = {.write = buffer_sink_write, .cookie = &buf};
+
+    int error = stream_model_state_csv(model_state, &sink);
+    buffer[buf.written] = '\0';
+
+    return error;
+}
+
+// Function to print the model state to a terminal with CSV formatting
+void print_model_state(model_state_t *model_state)
+{
+    model_export_sink_t sink = {.write = print_sink_write, .cookie = NULL};
+    stream_model_state_csv(model_state, &sink);
+}
+
+// Function to write the model state to a file with CSV formatting
+int write_model_state_file(model_state_t *model_state, int fd)
+{
+    model_export_sink_t sink = {.write = file_sink_write, .cookie = (void *)(uintptr_t)fd};
+    return stream_model_state_csv(model_state, &sink);
 }
 
 // Get a node from the model state
-static gpi_model_node_t *get_node(model_state_t *model_state, char *id)
+static gpi_model_node_t *get_node(model_state_t *model_state, gpi_model_node_key_t id)
 {
     gpi_model_node_t *node;
-    HASH_FIND_STR(model_state->nodes, id, node);
+    HASH_FIND(hh, model_state->nodes, &id, sizeof(gpi_model_node_key_t), node);
     return node;
 }
 
 // Add a node to the model state
-static gpi_model_node_t *add_node(model_state_t *model_state, gpi_node_type_t node_type,
-                                  char *id, char *data, bool extracted)
+static gpi_model_node_t *add_node(model_state_t *model_state, gpi_model_node_key_t id, const char *data, bool extracted)
 {
     gpi_model_node_t *node = get_node(model_state, id);
 
@@ -276,68 +364,48 @@ static gpi_model_node_t *add_node(model_state_t *model_state, gpi_node_type_t no
         // This node already exists, don't duplicate it
 
         // Do overwrite data if it was empty before
-        if ((strlen(node->data) == 0) && (data != NULL))
+        if (node->data == NULL)
         {
-            strncpy(node->data, data, CSV_MAX_STRING_SIZE);
+            node->data = intern_string(model_state, data);
         }
 
         return node;
     }
-    if (model_state->mem_start == NULL)
-    {
-        // No free pointer, allocate a node from heap
-        node = calloc(1, sizeof(gpi_model_node_t));
-    }
-    else
-    {
-        assert(model_state->mem_ptr + 1 < model_state->mem_end);
-
-        // Allocate a node from free pointer
-        gpi_model_state_component_t *component = model_state->mem_ptr;
-
-        component->type = GPI_MODEL_NODE;
-        node = &component->node;
-        model_state->mem_ptr++;
-    }
 
+    node = calloc(1, sizeof(gpi_model_node_t));
     assert(node != NULL);
-    node->node_type = node_type;
-    memset(node->data2, 0, CSV_MAX_STRING_SIZE);
-    memset(node->id, 0, CSV_MAX_STRING_SIZE);
-    strncpy(node->id, id, CSV_MAX_STRING_SIZE);
 
-    if (data != NULL)
-    {
-        strncpy(node->data, data, CSV_MAX_STRING_SIZE);
-    }
+    node->id = id;
+    node->node_type = node_key_type(id);
+    node->data = intern_string(model_state, data);
 
     // whether dependent relations for this node has been dumped
     node->extracted = extracted;
 
-    // HASH_ADD_KEYPTR(hh, model_state->nodes, &node->id, CSV_MAX_STRING_SIZE, node);
-    HASH_ADD_STR(model_state->nodes, id, node);
+    HASH_ADD(hh, model_state->nodes, id, sizeof(gpi_model_node_key_t), node);
+    model_state->n_nodes++;
 
     return node;
 }
 
-void set_node_extra(gpi_model_node_t *node, char *extra)
+void set_node_extra(model_state_t *model_state, gpi_model_node_t *node, char *extra)
 {
     assert(strlen(extra) < CSV_MAX_STRING_SIZE);
-    strncpy(node->data2, extra, CSV_MAX_STRING_SIZE);
+    node->data2 = intern_string(model_state, extra);
 }
 
-static void internal_add_edge_by_id(model_state_t *model_state, gpi_edge_type_t type, char *from_id,
-                                    char *to_id, gpi_cap_t req_type)
+static void internal_add_edge_by_id(model_state_t *model_state, gpi_edge_type_t type, gpi_model_node_key_t from_id,
+                                    gpi_model_node_key_t to_id, gpi_cap_t req_type)
 {
-    gpi_model_edge_t edge_static;
-    memset(&edge_static, 0, sizeof(gpi_model_edge_t));
-    edge_static.k.type = type;
-    edge_static.k.req_type = req_type;
-    strcpy(edge_static.k.from, from_id);
-    strcpy(edge_static.k.to, to_id);
+    gpi_model_edge_key_t key;
+    memset(&key, 0, sizeof(gpi_model_edge_key_t));
+    key.type = type;
+    key.req_type = req_type;
+    key.from = from_id;
+    key.to = to_id;
 
     gpi_model_edge_t *edge;
-    HASH_FIND(hh, model_state->edges, &edge_static.k, sizeof(gpi_model_edge_key_t), edge);
+    HASH_FIND(hh, model_state->edges, &key, sizeof(gpi_model_edge_key_t), edge);
 
     if (edge != NULL)
     {
@@ -345,27 +413,12 @@ static void internal_add_edge_by_id(model_state_t *model_state, gpi_edge_type_t
         return;
     }
 
-    if (model_state->mem_start == NULL)
-    {
-        // No free pointer, allocate an edge from heap
-        edge = calloc(1, sizeof(gpi_model_edge_t));
-    }
-    else
-    {
-        assert(model_state->mem_ptr + 1 < model_state->mem_end);
-
-        // Allocate a node from free pointer
-        gpi_model_state_component_t *component = model_state->mem_ptr;
-
-        component->type = GPI_MODEL_EDGE;
-        edge = &component->edge;
-        model_state->mem_ptr++;
-    }
-
+    edge = calloc(1, sizeof(gpi_model_edge_t));
     assert(edge != NULL);
-    *edge = edge_static;
+    edge->k = key;
 
     HASH_ADD_KEYPTR(hh, model_state->edges, &edge->k, sizeof(gpi_model_edge_key_t), edge);
+    model_state->n_edges++;
 }
 
 // Generic edge function
@@ -380,7 +433,8 @@ void add_edge(model_state_t *model_state, gpi_edge_type_t type, gpi_model_node_t
     add_edge_private(model_state, type, from, to, GPICAP_TYPE_NONE);
 }
 
-void add_edge_by_id(model_state_t *model_state, gpi_edge_type_t type, char *from, char *to)
+void add_edge_by_id(model_state_t *model_state, gpi_edge_type_t type, gpi_model_node_key_t from,
+                    gpi_model_node_key_t to)
 {
     internal_add_edge_by_id(model_state, type, from, to, GPICAP_TYPE_NONE);
 }
@@ -390,77 +444,79 @@ void add_request_edge(model_state_t *model_state, gpi_model_node_t *from, gpi_mo
     add_edge_private(model_state, GPI_EDGE_TYPE_REQUEST, from, to, req_type);
 }
 
-void add_request_edge_by_id(model_state_t *model_state, char *from, char *to, gpi_cap_t req_type)
+void add_request_edge_by_id(model_state_t *model_state, gpi_model_node_key_t from, gpi_model_node_key_t to,
+                            gpi_cap_t req_type)
 {
     internal_add_edge_by_id(model_state, GPI_EDGE_TYPE_REQUEST, from, to, req_type);
 }
 
-void get_resource_space_id(gpi_cap_t resource_type, gpi_space_id_t res_space_id, char *str_id)
+gpi_model_node_key_t get_resource_space_key(gpi_cap_t resource_type, gpi_space_id_t res_space_id)
 {
-    char prefix[CSV_MAX_STRING_SIZE];
-    snprintf(prefix, CSV_MAX_STRING_SIZE, "%s_SPACE", cap_type_to_str(resource_type));
-    make_node_id(str_id, prefix, res_space_id);
+    return make_node_key(GPI_NODE_TYPE_SPACE, resource_type, res_space_id, 0);
 }
 
-void get_resource_id(gpi_res_id_t res_id, char *str_id)
+gpi_model_node_key_t get_resource_key(gpi_res_id_t res_id)
 {
-    make_node_id_2(str_id, cap_type_to_str(res_id.type), res_id.space_id, res_id.object_id);
+    return make_node_key(GPI_NODE_TYPE_RESOURCE, res_id.type, res_id.space_id, res_id.object_id);
 }
 
-void get_pd_id(gpi_obj_id_t pd_id, char *str_id)
+gpi_model_node_key_t get_pd_key(gpi_obj_id_t pd_id)
 {
-    make_node_id(str_id, "PD", pd_id);
+    return make_node_key(GPI_NODE_TYPE_PD, GPICAP_TYPE_PD, 0, pd_id);
 }
 
-gpi_model_node_t *add_resource_node(model_state_t *model_state, gpi_res_id_t res_id, bool extracted)
+void get_node_str_id(gpi_model_node_key_t key, char *str_id)
 {
-    char node_id[CSV_MAX_STRING_SIZE];
-    get_resource_id(res_id, node_id);
+    gpi_cap_t type = get_cap_type_from_badge(key);
+    gpi_space_id_t space_id = get_space_id_from_badge(key);
+    gpi_obj_id_t object_id = get_object_id_from_badge(key);
+
+    switch (node_key_type(key))
+    {
+    case GPI_NODE_TYPE_PD:
+        snprintf(str_id, CSV_MAX_STRING_SIZE, "PD_%x", object_id);
+        break;
+    case GPI_NODE_TYPE_SPACE:
+        snprintf(str_id, CSV_MAX_STRING_SIZE, "%s_SPACE_%x", cap_type_to_str(type), space_id);
+        break;
+    default:
+        snprintf(str_id, CSV_MAX_STRING_SIZE, "%s_%x_%x", cap_type_to_str(type), space_id, object_id);
+        break;
+    }
+}
 
-    return add_node(model_state, GPI_NODE_TYPE_RESOURCE, node_id, cap_type_to_str(res_id.type), extracted);
+gpi_model_node_t *add_resource_node(model_state_t *model_state, gpi_res_id_t res_id, bool extracted)
+{
+    return add_node(model_state, get_resource_key(res_id), cap_type_to_str(res_id.type), extracted);
 }
 
 gpi_model_node_t *get_resource_node(model_state_t *model_state, gpi_res_id_t res_id)
 {
-    char node_id[CSV_MAX_STRING_SIZE];
-    get_resource_id(res_id, node_id);
-
-    return get_node(model_state, node_id);
+    return get_node(model_state, get_resource_key(res_id));
 }
 
 gpi_model_node_t *add_resource_space_node(model_state_t *model_state, gpi_cap_t resource_type,
                                           gpi_space_id_t res_space_id, bool extracted)
 {
-    char node_id[CSV_MAX_STRING_SIZE];
-    get_resource_space_id(resource_type, res_space_id, node_id);
-
-    return add_node(model_state, GPI_NODE_TYPE_SPACE, node_id, cap_type_to_str(resource_type), extracted);
+    return add_node(model_state, get_resource_space_key(resource_type, res_space_id),
+                    cap_type_to_str(resource_type), extracted);
 }
 
 gpi_model_node_t *get_resource_space_node(model_state_t *model_state, gpi_cap_t resource_type,
                                           gpi_space_id_t res_space_id)
 {
-    char node_id[CSV_MAX_STRING_SIZE];
-    get_resource_space_id(resource_type, res_space_id, node_id);
-
-    return get_node(model_state, node_id);
+    return get_node(model_state, get_resource_space_key(resource_type, res_space_id));
 }
 
 // Add a PD to the model state
 gpi_model_node_t *add_pd_node(model_state_t *model_state, char *pd_name, gpi_obj_id_t pd_id, bool extracted)
 {
-    char node_id[CSV_MAX_STRING_SIZE];
-    get_pd_id(pd_id, node_id);
-
-    return add_node(model_state, GPI_NODE_TYPE_PD, node_id, pd_name, extracted);
+    return add_node(model_state, get_pd_key(pd_id), pd_name, extracted);
 }
 
 gpi_model_node_t *get_pd_node(model_state_t *model_state, gpi_obj_id_t pd_id)
 {
-    char node_id[CSV_MAX_STRING_SIZE];
-    get_pd_id(pd_id, node_id);
-
-    return get_node(model_state, node_id);
+    return get_node(model_state, get_pd_key(pd_id));
 }
 
 gpi_model_node_t *get_root_node(model_state_t *model_state)
@@ -468,35 +524,151 @@ gpi_model_node_t *get_root_node(model_state_t *model_state)
     return add_pd_node(model_state, "ROOT_TASK", 0, true);
 }
 
+// Add a node from another model state, including its extra data
+static void combine_node(model_state_t *dest, gpi_model_node_key_t id, const char *data, const char *data2)
+{
+    gpi_model_node_t *node = add_node(dest, id, data, true);
+
+    if (data2 != NULL && data2[0] != '\0')
+    {
+        node->data2 = intern_string(dest, data2);
+    }
+}
+
 // Add any nodes and edges from source state to dest state
 void combine_model_states(model_state_t *dest, model_state_t *src)
 {
-    if (src->mem_start != NULL)
+    for (gpi_model_node_t *node = src->nodes; node != NULL; node = node->hh.next)
     {
-        // Combine a portable source model state with the destination model state
-        for (gpi_model_state_component_t *item = src->mem_start; item < src->mem_ptr; item += 1)
-        {
-            if (item->type == GPI_MODEL_NODE)
-            {
-                add_node(dest, item->node.node_type, item->node.id, item->node.data, true);
-            }
-            else if (item->type == GPI_MODEL_EDGE)
-            {
-                internal_add_edge_by_id(dest, item->edge.k.type, item->edge.k.from, item->edge.k.to, item->edge.k.req_type);
-            }
-        }
+        combine_node(dest, node->id, node->data, node->data2);
+    }
+
+    for (gpi_model_edge_t *edge = src->edges; edge != NULL; edge = edge->hh.next)
+    {
+        internal_add_edge_by_id(dest, edge->k.type, edge->k.from, edge->k.to, edge->k.req_type);
+    }
+}
+
+size_t model_state_binary_size(model_state_t *model_state)
+{
+    return sizeof(gpi_model_bin_header_t) + model_state->n_nodes * sizeof(gpi_model_bin_node_t) +
+           model_state->n_edges * sizeof(gpi_model_edge_key_t) + model_state->strtab_size;
+}
+
+int serialize_model_state(model_state_t *model_state, void *buffer, size_t len)
+{
+    model_export_buffer_t buf = {.buffer = buffer, .len = len};
+    model_export_sink_t sink = {.write = buffer_sink_write, .cookie = &buf};
+
+    return stream_model_state_binary(model_state, &sink);
+}
+
+// Get a string from a serialized string table
+static const char *strtab_get(const char *strtab, uint32_t strtab_size, uint32_t offset)
+{
+    return offset < strtab_size ? strtab + offset : NULL;
+}
+
+int combine_model_state_binary(model_state_t *dest, void *buffer, size_t len)
+{
+    char *strtab = NULL;
+
+    // The buffer may be shared with its sender, so each part is copied out once before it is checked or used
+    gpi_model_bin_header_t header;
+    if (len < sizeof(gpi_model_bin_header_t))
+    {
+        return 1;
     }
-    else
+    memcpy(&header, buffer, sizeof(header));
+
+    if (header.magic != GPI_MODEL_BIN_MAGIC)
+    {
+        return 1;
+    }
+
+    size_t bin_size = sizeof(gpi_model_bin_header_t) + (size_t)header.n_nodes * sizeof(gpi_model_bin_node_t) +
+                      (size_t)header.n_edges * sizeof(gpi_model_edge_key_t) + header.strtab_size;
+    if (bin_size > len)
+    {
+        return 1;
+    }
+
+    gpi_model_bin_node_t *bin_nodes = (gpi_model_bin_node_t *)((gpi_model_bin_header_t *)buffer + 1);
+    gpi_model_edge_key_t *bin_edges = (gpi_model_edge_key_t *)(bin_nodes + header.n_nodes);
+
+    if (header.strtab_size > 0)
     {
-        // Combine a source model state from the same heap as the destination model state
-        for (gpi_model_node_t *node = src->nodes; node != NULL; node = node->hh.next)
+        strtab = malloc(header.strtab_size);
+        if (strtab == NULL)
         {
-            add_node(dest, node->node_type, node->id, node->data, true);
+            return 1;
         }
+        memcpy(strtab, bin_edges + header.n_edges, header.strtab_size);
 
-        for (gpi_model_edge_t *edge = src->edges; edge != NULL; edge = edge->hh.next)
+        // The string table must end with a terminated string
+        if (strtab[header.strtab_size - 1] != '\0')
         {
-            internal_add_edge_by_id(dest, edge->k.type, edge->k.from, edge->k.to, edge->k.req_type);
+            free(strtab);
+            return 1;
         }
     }
-}
\ No newline at end of file
+
+    for (uint32_t i = 0; i < header.n_nodes; i++)
+    {
+        gpi_model_bin_node_t bin_node;
+        memcpy(&bin_node, &bin_nodes[i], sizeof(bin_node));
+        combine_node(dest, bin_node.id,
+                     strtab_get(strtab, header.strtab_size, bin_node.data),
+                     strtab_get(strtab, header.strtab_size, bin_node.data2));
+    }
+
+    for (uint32_t i = 0; i < header.n_edges; i++)
+    {
+        gpi_model_edge_key_t bin_edge;
+        memcpy(&bin_edge, &bin_edges[i], sizeof(bin_edge));
+        internal_add_edge_by_id(dest, bin_edge.type, bin_edge.from, bin_edge.to, bin_edge.req_type);
+    }
+
+    free(strtab);
+    return 0;
+}
+
+void model_journal_record(model_journal_t *journal, gpi_journal_op_t op, gpi_edge_type_t type,
+                          gpi_model_node_key_t from, gpi_model_node_key_t to, gpi_cap_t req_type)
+{
+    journal->epoch++;
+
+    // The oldest change is overwritten once the ring is full
+    gpi_model_journal_entry_t *entry = &journal->entries[(journal->epoch - 1) % MODEL_JOURNAL_SIZE];
+    memset(entry, 0, sizeof(gpi_model_journal_entry_t));
+    entry->epoch = journal->epoch;
+    entry->op = op;
+    entry->edge.type = type;
+    entry->edge.req_type = req_type;
+    entry->edge.from = from;
+    entry->edge.to = to;
+}
+
+int model_journal_read(model_journal_t *journal, uint64_t since_epoch, gpi_model_journal_entry_t *entries,
+                       uint32_t max_entries, uint32_t *n_entries, uint64_t *epoch, bool *done)
+{
+    *n_entries = 0;
+    *epoch = since_epoch;
+    *done = since_epoch >= journal->epoch;
+
+    if (journal->epoch > MODEL_JOURNAL_SIZE && since_epoch < journal->epoch - MODEL_JOURNAL_SIZE)
+    {
+        // Some changes after since_epoch were overwritten
+        return 1;
+    }
+
+    while (*epoch < journal->epoch && *n_entries < max_entries)
+    {
+        (*epoch)++;
+        entries[*n_entries] = journal->entries[(*epoch - 1) % MODEL_JOURNAL_SIZE];
+        (*n_entries)++;
+    }
+
+    *done = *epoch >= journal->epoch;
+    return 0;
+}
@@ -105,6 +105,35 @@ int pd_client_dump(pd_client_context_t *conn,
     return error;
 }
 
+int pd_client_dump_delta(pd_client_context_t *conn, mo_client_context_t *mo, uint64_t since_epoch,
+                         uint32_t *n_entries, uint64_t *epoch, bool *done)
+{
+    OSDB_PRINTF("Sending dump delta request to PD component\n");
+
+    int error = 0;
+
+    PdMessage msg = {
+        .magic = PD_RPC_MAGIC,
+        .which_msg = PdMessage_dump_delta_tag,
+        .msg.dump_delta = {
+            .epoch = since_epoch,
+            .has_mo = mo != NULL,
+        }};
+
+    PdReturnMessage ret_msg = {0};
+
+    seL4_CPtr mo_cap = mo == NULL ? seL4_CapNull : mo->ep;
+    error = sel4gpi_rpc_call(&rpc_env, conn->ep, (void *)&msg,
+                             mo == NULL ? 0 : 1, &mo_cap, (void *)&ret_msg);
+    error |= ret_msg.errorCode;
+
+    *n_entries = ret_msg.msg.dump_delta.n_entries;
+    *epoch = ret_msg.msg.dump_delta.epoch;
+    *done = ret_msg.msg.dump_delta.done;
+
+    return error;
+}
+
 static int send_cap_req(pd_client_context_t *conn, seL4_CPtr cap_to_send, seL4_CPtr *slot, bool is_core)
 {
     OSDB_PRINTF("Sending 'send cap' request to PD component\n");
@@ -163,8 +192,8 @@ int pd_client_next_slot(pd_client_context_t *conn,
 
     PdReturnMessage ret_msg = {0};
 
-    error = sel4gpi_rpc_call(&rpc_env, conn->ep, (void *)&msg,
-                             0, NULL, (void *)&ret_msg);
+    error = sel4gpi_rpc_call_raw(&rpc_env, conn->ep, (void *)&msg,
+                                 0, NULL, (void *)&ret_msg);
     error |= ret_msg.errorCode;
 
     if (!error)
@@ -185,7 +214,9 @@ int pd_client_free_slot(pd_client_context_t *conn,
     PdMessage msg = {
         .magic = PD_RPC_MAGIC,
         .which_msg = PdMessage_free_slot_tag,
-    };
+        .msg.free_slot = {
+            .slot = slot,
+        }};
 
     PdReturnMessage ret_msg = {0};
 
@@ -219,6 +250,62 @@ int pd_client_clear_slot(pd_client_context_t *conn,
     return error;
 }
 
+int pd_client_lease_slots(pd_client_context_t *conn,
+                          uint32_t count,
+                          seL4_CPtr *base,
+                          uint32_t *n_slots)
+{
+    OSDB_PRINT_VERBOSE("Sending 'lease slots' request to PD component\n");
+
+    int error = 0;
+
+    PdMessage msg = {
+        .magic = PD_RPC_MAGIC,
+        .which_msg = PdMessage_lease_slots_tag,
+        .msg.lease_slots = {
+            .count = count,
+        }};
+
+    PdReturnMessage ret_msg = {0};
+
+    error = sel4gpi_rpc_call_raw(&rpc_env, conn->ep, (void *)&msg,
+                                 0, NULL, (void *)&ret_msg);
+    error |= ret_msg.errorCode;
+
+    if (!error)
+    {
+        *base = ret_msg.msg.lease_slots.base;
+        *n_slots = ret_msg.msg.lease_slots.count;
+    }
+
+    return error;
+}
+
+int pd_client_return_slots(pd_client_context_t *conn,
+                           seL4_CPtr base,
+                           uint64_t bitmap)
+{
+    OSDB_PRINT_VERBOSE("Sending 'return slots' request to PD component\n");
+
+    int error = 0;
+
+    PdMessage msg = {
+        .magic = PD_RPC_MAGIC,
+        .which_msg = PdMessage_return_slots_tag,
+        .msg.return_slots = {
+            .base = base,
+            .bitmap = bitmap,
+        }};
+
+    PdReturnMessage ret_msg = {0};
+
+    error = sel4gpi_rpc_call_raw(&rpc_env, conn->ep, (void *)&msg,
+                                 0, NULL, (void *)&ret_msg);
+    error |= ret_msg.errorCode;
+
+    return error;
+}
+
 int pd_client_share_rde(pd_client_context_t *target_pd,
                         gpi_cap_t cap_type,
                         gpi_space_id_t space_id)
@@ -330,6 +417,80 @@ int pd_client_get_work(pd_client_context_t *conn, PdWorkReturnMessage *work)
     return error;
 }
 
+int pd_client_get_invalidations(pd_client_context_t *conn, PdWorkReturnMessage *work)
+{
+    OSDB_PRINT_VERBOSE("Sending 'get invalidations' request to PD component\n");
+
+    int error = 0;
+
+    PdMessage msg = {
+        .magic = PD_RPC_MAGIC,
+        .which_msg = PdMessage_get_work_tag,
+        .msg.get_work = {
+            .invalidations = true,
+        }};
+
+    PdReturnMessage ret_msg = {0};
+
+    error = sel4gpi_rpc_call(&rpc_env, conn->ep, (void *)&msg,
+                             0, NULL, (void *)&ret_msg);
+    error |= ret_msg.errorCode;
+
+    if (!error)
+    {
+        *work = ret_msg.msg.work;
+    }
+
+    return error;
+}
+
+int pd_client_accept_invalidations(pd_client_context_t *conn, bool accept)
+{
+    OSDB_PRINT_VERBOSE("Sending 'accept invalidations' request to PD component\n");
+
+    int error = 0;
+
+    PdMessage msg = {
+        .magic = PD_RPC_MAGIC,
+        .which_msg = PdMessage_accept_invalidations_tag,
+        .msg.accept_invalidations = {
+            .accept = accept,
+        }};
+
+    PdReturnMessage ret_msg = {0};
+
+    error = sel4gpi_rpc_call_raw(&rpc_env, conn->ep, (void *)&msg,
+                                 0, NULL, (void *)&ret_msg);
+    error |= ret_msg.errorCode;
+
+    return error;
+}
+
+int pd_client_invalidate(pd_client_context_t *conn, gpi_res_id_t res_id, gpi_obj_id_t except_pd_id)
+{
+    OSDB_PRINT_VERBOSE("Sending 'invalidate' request to PD component\n");
+
+    int error = 0;
+
+    PdMessage msg = {
+        .magic = PD_RPC_MAGIC,
+        .which_msg = PdMessage_invalidate_tag,
+        .msg.invalidate = {
+            .res_type = res_id.type,
+            .space_id = res_id.space_id,
+            .object_id = res_id.object_id,
+            .except_pd_id = except_pd_id,
+        }};
+
+    PdReturnMessage ret_msg = {0};
+
+    error = sel4gpi_rpc_call_raw(&rpc_env, conn->ep, (void *)&msg,
+                                 0, NULL, (void *)&ret_msg);
+    error |= ret_msg.errorCode;
+
+    return error;
+}
+
 int pd_client_send_subgraph(pd_client_context_t *conn, mo_client_context_t *mo_conn, bool has_data, int n_requests)
 {
     OSDB_PRINTF("Sending 'send subgraph' request to PD component\n");
@@ -503,6 +664,110 @@ err_goto:
     return error;
 }
 
+int pd_client_spawn(pd_client_context_t *target_pd,
+                    ads_client_context_t *target_ads,
+                    cpu_client_context_t *target_cpu,
+                    pd_config_t *cfg,
+                    int argc,
+                    seL4_Word *args)
+{
+    OSDB_PRINTF("Sending 'spawn' request to PD component\n");
+
+    int error = 0;
+
+    GOTO_IF_COND(argc > PD_MAX_ARGC, "Cannot spawn PD with more than %d arguments\n", PD_MAX_ARGC);
+
+    PdMessage msg = {
+        .magic = PD_RPC_MAGIC,
+        .which_msg = PdMessage_spawn_tag,
+        .msg.spawn = {
+            .entry_point = (uint64_t)cfg->ads_cfg.entry_point,
+            .link_with_current = cfg->link_with_current,
+            .cpu_prio = cfg->cpu_prio,
+            .args_count = argc,
+        }};
+    memcpy(msg.msg.spawn.args, args, sizeof(seL4_Word) * argc);
+
+    if (cfg->ads_cfg.image_name)
+    {
+        GOTO_IF_COND(strlen(cfg->ads_cfg.image_name) >= sizeof(msg.msg.spawn.image_name),
+                     "Image name too long: %s\n", cfg->ads_cfg.image_name);
+        strncpy(msg.msg.spawn.image_name, cfg->ads_cfg.image_name, sizeof(msg.msg.spawn.image_name));
+    }
+
+    /* Serialize the config */
+    linked_list_node_t *curr;
+    if (cfg->ads_cfg.vmr_cfgs)
+    {
+        for (curr = cfg->ads_cfg.vmr_cfgs->head; curr != NULL; curr = curr->next)
+        {
+            vmr_config_t *vmr = (vmr_config_t *)curr->data;
+            GOTO_IF_COND(msg.msg.spawn.vmrs_count >= PD_SPAWN_MAX_VMRS, "Too many VMRs to spawn PD\n");
+            msg.msg.spawn.vmrs[msg.msg.spawn.vmrs_count++] = (PdSpawnVmrConfig){
+                .type = vmr->type,
+                .start = (uint64_t)vmr->start,
+                .region_pages = vmr->region_pages,
+                .page_bits = vmr->page_bits,
+            };
+        }
+    }
+
+    if (cfg->rde_cfg)
+    {
+        for (curr = cfg->rde_cfg->head; curr != NULL; curr = curr->next)
+        {
+            rde_config_t *rde = (rde_config_t *)curr->data;
+            GOTO_IF_COND(msg.msg.spawn.rdes_count >= PD_SPAWN_MAX_RDES, "Too many RDEs to spawn PD\n");
+            msg.msg.spawn.rdes[msg.msg.spawn.rdes_count++] = (PdSpawnRdeConfig){
+                .res_type = rde->type,
+                .space_id = rde->space_id,
+            };
+        }
+    }
+
+    if (cfg->gpi_res_type_cfg)
+    {
+        for (curr = cfg->gpi_res_type_cfg->head; curr != NULL; curr = curr->next)
+        {
+            GOTO_IF_COND(msg.msg.spawn.res_types_count >= PD_SPAWN_MAX_RES_TYPES,
+                         "Too many resource types to spawn PD\n");
+            msg.msg.spawn.res_types[msg.msg.spawn.res_types_count++] = (gpi_cap_t)curr->data;
+        }
+    }
+
+    seL4_CPtr caps[2] = {target_ads->ep, target_cpu->ep};
+
+    PdReturnMessage ret_msg = {0};
+
+    error = sel4gpi_rpc_call(&rpc_env, target_pd->ep, (void *)&msg,
+                             2, caps, (void *)&ret_msg);
+    error |= ret_msg.errorCode;
+    GOTO_IF_ERR(error, "Spawn request failed\n");
+
+    /* Return the allocated VMRs, fault EP and OSmosis data in the config, as sel4gpi_prepare_pd would */
+    int i = 0;
+    if (cfg->ads_cfg.vmr_cfgs)
+    {
+        for (curr = cfg->ads_cfg.vmr_cfgs->head; curr != NULL; curr = curr->next, i++)
+        {
+            vmr_config_t *vmr = (vmr_config_t *)curr->data;
+            if (vmr->type != SEL4UTILS_RES_TYPE_CODE)
+            {
+                vmr->start = (void *)ret_msg.msg.spawn.vmr_starts[i];
+                vmr->mo.ep = ret_msg.msg.spawn.mo_slots[i];
+                vmr->mo.id = ret_msg.msg.spawn.mo_ids[i];
+            }
+        }
+    }
+
+    cfg->fault_ep.ep = ret_msg.msg.spawn.fault_ep_slot;
+    cfg->fault_ep.raw_endpoint = ret_msg.msg.spawn.fault_ep_raw_slot;
+    cfg->osm_data = (void *)ret_msg.msg.spawn.osm_data_addr;
+
+err_goto:
+    return error;
+}
+
 int pd_client_share_resource_by_type(pd_client_context_t *src_pd, pd_client_context_t *dest_pd, gpi_cap_t res_type)
 {
     OSDB_PRINTF("Sending 'share resource by type' request to PD component\n");
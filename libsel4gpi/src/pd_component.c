@@ -68,6 +68,34 @@ pd_component_registry_entry_t *pd_component_registry_get_entry_by_badge(seL4_Wor
         resource_component_registry_get_by_badge(get_pd_component(), badge);
 }
 
+/**
+ * Publish the number of PDs that accept invalidations in the shared data of every PD
+ * This only changes when a cache is enabled or disabled, or a caching PD is deleted
+ */
+static void publish_n_invalidation_pds(void)
+{
+    resource_registry_node_t *curr, *tmp;
+    HASH_ITER(hh, get_pd_component()->registry.head, curr, tmp)
+    {
+        pd_component_registry_entry_t *pd_entry = (pd_component_registry_entry_t *)curr;
+
+        if (pd_entry->pd.shared_data != NULL && !pd_entry->pd.deleting)
+        {
+            pd_entry->pd.shared_data->n_invalidation_pds = get_gpi_server()->n_invalidation_pds;
+        }
+    }
+}
+
+static void set_accept_invalidations(pd_t *pd, bool accept)
+{
+    if (pd->accept_invalidations != accept)
+    {
+        pd->accept_invalidations = accept;
+        get_gpi_server()->n_invalidation_pds += accept ? 1 : -1;
+        publish_n_invalidation_pds();
+    }
+}
+
 // Called when an item from the PD registry is deleted
 static void on_pd_registry_delete(resource_registry_node_t *node_gen, void *arg)
 {
@@ -75,6 +103,9 @@ static void on_pd_registry_delete(resource_registry_node_t *node_gen, void *arg)
 
     resource_component_remove_from_rt(get_pd_component(), node->pd.id);
 
+    // Stop counting the PD while its shared data is still mapped
+    set_accept_invalidations(&node->pd, false);
+
     // Destroy PD
     pd_destroy(&node->pd, get_pd_component()->server_vka, get_pd_component()->server_vspace);
 
@@ -289,6 +320,106 @@ err_goto:
     reply_msg->errorCode = error;
 }
 
+static void handle_lease_slots_req(seL4_Word sender_badge, PdLeaseSlotsMessage *msg, PdReturnMessage *reply_msg)
+{
+    OSDB_PRINT_VERBOSE("Got lease slots request from client badge %lx.\n", sender_badge);
+    int error = 0;
+
+    pd_component_registry_entry_t *client_data = pd_component_registry_get_entry_by_badge(sender_badge);
+    SERVER_GOTO_IF_COND(client_data == NULL, "Couldn't find PD (%u)\n", get_object_id_from_badge(sender_badge));
+    SERVER_GOTO_IF_COND(msg->count == 0 || msg->count > PD_SLOT_LEASE_MAX, "Invalid slot lease size %u\n", msg->count);
+
+    seL4_CPtr base;
+    uint32_t n_slots;
+    error = pd_lease_slots(&client_data->pd, msg->count, &base, &n_slots);
+    SERVER_GOTO_IF_ERR(error, "Failed to lease slots for PD (%u)\n", client_data->pd.id);
+
+    reply_msg->msg.lease_slots.base = base;
+    reply_msg->msg.lease_slots.count = n_slots;
+
+err_goto:
+    reply_msg->which_msg = PdReturnMessage_lease_slots_tag;
+    reply_msg->errorCode = error;
+}
+
+static void handle_return_slots_req(seL4_Word sender_badge, PdReturnSlotsMessage *msg, PdReturnMessage *reply_msg)
+{
+    OSDB_PRINT_VERBOSE("Got return slots request from client badge %lx.\n", sender_badge);
+    int error = 0;
+
+    pd_component_registry_entry_t *client_data = pd_component_registry_get_entry_by_badge(sender_badge);
+    SERVER_GOTO_IF_COND(client_data == NULL, "Couldn't find PD (%u)\n", get_object_id_from_badge(sender_badge));
+
+    error = pd_return_slots(&client_data->pd, msg->base, msg->bitmap);
+    SERVER_GOTO_IF_ERR(error, "Failed to return slots of PD (%u)\n", client_data->pd.id);
+
+err_goto:
+    reply_msg->which_msg = PdReturnMessage_basic_tag;
+    reply_msg->errorCode = error;
+}
+
+static void handle_accept_invalidations_req(seL4_Word sender_badge, PdAcceptInvalidationsMessage *msg,
+                                            PdReturnMessage *reply_msg)
+{
+    OSDB_PRINT_VERBOSE("Got accept invalidations request from client badge %lx.\n", sender_badge);
+    int error = 0;
+
+    pd_component_registry_entry_t *client_data = pd_component_registry_get_entry_by_badge(sender_badge);
+    SERVER_GOTO_IF_COND(client_data == NULL, "Couldn't find PD (%u)\n", get_object_id_from_badge(sender_badge));
+
+    set_accept_invalidations(&client_data->pd, msg->accept);
+
+err_goto:
+    reply_msg->which_msg = PdReturnMessage_basic_tag;
+    reply_msg->errorCode = error;
+}
+
+static void handle_invalidate_req(seL4_Word sender_badge, PdInvalidateMessage *msg, PdReturnMessage *reply_msg)
+{
+    OSDB_PRINT_VERBOSE("Got invalidate request from client badge %lx.\n", sender_badge);
+    int error = 0;
+    gpi_obj_id_t *holder_ids = NULL;
+
+    pd_component_registry_entry_t *server_data = pd_component_registry_get_entry_by_badge(sender_badge);
+    SERVER_GOTO_IF_COND(server_data == NULL, "Couldn't find PD (%u)\n", get_object_id_from_badge(sender_badge));
+
+    // Only the manager of a resource space can invalidate its resources
+    resspc_component_registry_entry_t *space_entry = resource_space_get_entry_by_id(msg->space_id);
+    SERVER_GOTO_IF_COND(space_entry == NULL, "Couldn't find resource space (%u)\n", msg->space_id);
+    SERVER_GOTO_IF_COND(space_entry->space.pd_id != server_data->pd.id,
+                        "PD (%u) does not manage resource space (%u)\n", server_data->pd.id, msg->space_id);
+
+    gpi_res_id_t res_id = make_res_id(msg->res_type, msg->space_id, msg->object_id);
+    size_t n_holders;
+    holder_ids = pd_get_resource_holders(res_id, &n_holders);
+
+    for (size_t i = 0; i < n_holders; i++)
+    {
+        pd_component_registry_entry_t *pd_entry = pd_component_registry_get_entry_by_id(holder_ids[i]);
+
+        // Skip PDs that do not cache resources, and the PD that made the change
+        if (pd_entry == NULL || pd_entry->pd.id == msg->except_pd_id || pd_entry->pd.to_delete ||
+            pd_entry->pd.shared_data == NULL || !pd_entry->pd.accept_invalidations)
+        {
+            continue;
+        }
+
+        pd_work_entry_t *work_entry = calloc(1, sizeof(pd_work_entry_t));
+        SERVER_GOTO_IF_COND(work_entry == NULL, "Failed to allocate work entry node\n");
+        work_entry->res_id = res_id;
+        work_entry->client_pd_id = server_data->pd.id;
+
+        OSDB_PRINT_VERBOSE("Queue work: invalidate resource " RES_ID_PRINTF " in PD (%u).\n",
+                           RES_ID_PRINT_ARGS(res_id), pd_entry->pd.id);
+        pd_component_queue_invalidate_work(pd_entry, work_entry);
+    }
+
+err_goto:
+    free(holder_ids);
+    reply_msg->which_msg = PdReturnMessage_basic_tag;
+    reply_msg->errorCode = error;
+}
+
 static void handle_send_cap_req(seL4_Word sender_badge, PdSendCapMessage *msg, PdReturnMessage *reply_msg,
                                 seL4_CPtr received_cap, bool *should_reply)
 {
@@ -365,7 +496,7 @@ static void handle_dump_cap_req(seL4_Word sender_badge, PdDumpMessage *msg,
 
     /* Initialize the model state */
     model_state_t *ms = calloc(1, sizeof(model_state_t));
-    init_model_state(ms, NULL, 0);
+    init_model_state(ms);
     get_gpi_server()->model_extraction_n_missing = 0;
 
     /* Start the extraction */
@@ -397,31 +528,73 @@ err_goto:
     reply_msg->errorCode = error;
 }
 
-static void handle_share_rde_req(seL4_Word sender_badge, PdShareRDEMessage *msg, PdReturnMessage *reply_msg)
+static void handle_dump_delta_req(seL4_Word sender_badge, PdDumpDeltaMessage *msg, PdReturnMessage *reply_msg)
 {
     int error = 0;
+    void *mo_vaddr = NULL;
+    uint32_t n_entries = 0;
+    uint64_t epoch = msg->epoch;
+    bool done = false;
 
-    gpi_cap_t type = msg->res_type;
-    gpi_space_id_t space_id = msg->space_id;
+    OSDB_PRINTF("Got model delta request since epoch %lu from client badge %lx\n", msg->epoch, sender_badge);
 
-    OSDB_PRINTF("share_rde_req: Got request from client badge %lx for RDE type %s with space %u.\n",
-                sender_badge, cap_type_to_str(type), space_id);
+    if (msg->has_mo)
+    {
+        SERVER_GOTO_IF_COND(!sel4gpi_rpc_check_cap(GPICAP_TYPE_MO), "Did not receive MO cap\n");
 
-    /* Find the source PD */
-    gpi_obj_id_t client_id = get_client_id_from_badge(sender_badge);
-    pd_component_registry_entry_t *client_data = pd_component_registry_get_entry_by_id(client_id);
-    SERVER_GOTO_IF_COND(client_data == NULL, "Couldn't find client PD (%u)\n", client_id);
+        /* Attach the included MO */
+        gpi_obj_id_t mo_id = get_object_id_from_badge(seL4_GetBadge(0));
+        mo_component_registry_entry_t *mo_reg = (mo_component_registry_entry_t *)
+            resource_component_registry_get_by_id(get_mo_component(), mo_id);
+        SERVER_GOTO_IF_COND(mo_reg == NULL, "Couldn't find MO (%u)\n", mo_id);
+        size_t mo_size = (size_t)mo_reg->mo.num_pages * BIT(mo_reg->mo.page_bits);
 
-    /* Find the destination PD */
-    pd_component_registry_entry_t *target_data = pd_component_registry_get_entry_by_badge(sender_badge);
-    SERVER_GOTO_IF_COND(target_data == NULL, "Couldn't find target PD (%u)\n", get_object_id_from_badge(sender_badge));
+        /* A smaller MO would never make progress, and the client would keep asking */
+        SERVER_GOTO_IF_COND(mo_size < sizeof(gpi_model_journal_entry_t),
+                            "MO (%u) is too small to hold a journal entry\n", mo_id);
+
+        error = ads_component_attach_to_rt(mo_id, &mo_vaddr);
+        SERVER_GOTO_IF_ERR(error, "Failed to attach MO to RT\n");
+
+        /* Copy the changes since the epoch */
+        int read_error = model_journal_read(&get_gpi_server()->model_journal, msg->epoch,
+                                            (gpi_model_journal_entry_t *)mo_vaddr,
+                                            mo_size / sizeof(gpi_model_journal_entry_t),
+                                            &n_entries, &epoch, &done);
+
+        error = ads_component_remove_from_rt(mo_vaddr);
+        SERVER_GOTO_IF_ERR(error, "Failed to remove MO from RT\n");
+        SERVER_GOTO_IF_COND_2(read_error, PdComponentError_JOURNAL_TRUNCATED,
+                              "Journal no longer holds changes since epoch %lu\n", msg->epoch);
+    }
+    else
+    {
+        /* Only report the current epoch */
+        epoch = get_gpi_server()->model_journal.epoch;
+        done = true;
+    }
+
+err_goto:
+    reply_msg->which_msg = PdReturnMessage_dump_delta_tag;
+    reply_msg->msg.dump_delta.epoch = epoch;
+    reply_msg->msg.dump_delta.n_entries = n_entries;
+    reply_msg->msg.dump_delta.done = done;
+    reply_msg->errorCode = error;
+}
+
+/**
+ * Copy one of src_pd's RDEs to target_pd, does nothing if target_pd already has the RDE
+ */
+static int pd_component_share_rde(pd_t *src_pd, pd_t *target_pd, gpi_cap_t type, gpi_space_id_t space_id)
+{
+    int error = 0;
 
     /* Find the source RDE */
-    osmosis_rde_t *rde = pd_rde_get(&client_data->pd, type, space_id);
+    osmosis_rde_t *rde = pd_rde_get(src_pd, type, space_id);
     SERVER_GOTO_IF_COND(rde == NULL, "share_rde_req: Failed to find RDE for type %u and space %u.\n", type, space_id);
 
     /* Check if RDE already exists in target */
-    osmosis_rde_t *target_pd_rde = pd_rde_get(&target_data->pd, type, space_id);
+    osmosis_rde_t *target_pd_rde = pd_rde_get(target_pd, type, space_id);
     if (target_pd_rde != NULL)
     {
         printf("RDE already exists in target PD\n");
@@ -436,12 +609,37 @@ static void handle_share_rde_req(seL4_Word sender_badge, PdShareRDEMessage *msg,
 
     /* Copy the RDE */
     rde_type_t rde_type = {.type = type};
-    error = pd_add_rde(&target_data->pd,
+    error = pd_add_rde(target_pd,
                        rde_type,
-                       client_data->pd.shared_data->type_names[type],
+                       src_pd->shared_data->type_names[type],
                        rde->space_id,
                        resource_space_data->space.server_ep);
 
+err_goto:
+    return error;
+}
+
+static void handle_share_rde_req(seL4_Word sender_badge, PdShareRDEMessage *msg, PdReturnMessage *reply_msg)
+{
+    int error = 0;
+
+    gpi_cap_t type = msg->res_type;
+    gpi_space_id_t space_id = msg->space_id;
+
+    OSDB_PRINTF("share_rde_req: Got request from client badge %lx for RDE type %s with space %u.\n",
+                sender_badge, cap_type_to_str(type), space_id);
+
+    /* Find the source PD */
+    gpi_obj_id_t client_id = get_client_id_from_badge(sender_badge);
+    pd_component_registry_entry_t *client_data = pd_component_registry_get_entry_by_id(client_id);
+    SERVER_GOTO_IF_COND(client_data == NULL, "Couldn't find client PD (%u)\n", client_id);
+
+    /* Find the destination PD */
+    pd_component_registry_entry_t *target_data = pd_component_registry_get_entry_by_badge(sender_badge);
+    SERVER_GOTO_IF_COND(target_data == NULL, "Couldn't find target PD (%u)\n", get_object_id_from_badge(sender_badge));
+
+    error = pd_component_share_rde(&client_data->pd, &target_data->pd, type, space_id);
+
 err_goto:
     reply_msg->which_msg = PdReturnMessage_basic_tag;
     reply_msg->errorCode = error;
@@ -553,10 +751,23 @@ int pd_component_map_resources(gpi_obj_id_t client_pd_id, gpi_obj_id_t src_res_i
                         src_res->space_id, dest_res->space_id);
 
     // (XXX) Arya: should we also track the mapping?
+    model_journal_record(&get_gpi_server()->model_journal, GPI_JOURNAL_ADD_EDGE, GPI_EDGE_TYPE_MAP,
+                         get_resource_key(src_res->res_id), get_resource_key(dest_res->res_id), GPICAP_TYPE_NONE);
 
 err_goto:
     return error;
 }
+
+void pd_component_unmap_resources(gpi_badge_t src_res_id, gpi_badge_t dest_res_id)
+{
+    gpi_res_id_t src = make_res_id(get_cap_type_from_badge(src_res_id), get_space_id_from_badge(src_res_id),
+                                   get_object_id_from_badge(src_res_id));
+    gpi_res_id_t dest = make_res_id(get_cap_type_from_badge(dest_res_id), get_space_id_from_badge(dest_res_id),
+                                    get_object_id_from_badge(dest_res_id));
+
+    model_journal_record(&get_gpi_server()->model_journal, GPI_JOURNAL_REMOVE_EDGE, GPI_EDGE_TYPE_MAP,
+                         get_resource_key(src), get_resource_key(dest), GPICAP_TYPE_NONE);
+}
 #endif
 
 #if TRACK_MAP_RELATIONS
@@ -745,29 +956,18 @@ err_goto:
     reply_msg->errorCode = error;
 }
 
-static void handle_share_resource_type_req(seL4_Word sender_badge,
-                                           PdShareResTypeMessage *msg, PdReturnMessage *reply_msg)
+/**
+ * Share all of src_pd's resources of the given type with dst_pd
+ */
+static int pd_component_share_resource_type(pd_t *src_pd, pd_t *dst_pd, gpi_cap_t res_type)
 {
     int error = 0;
-    OSDB_PRINTF("Got Share Resource Type Request: ");
-    BADGE_PRINT(sender_badge);
-    gpi_cap_t res_type = (gpi_cap_t)msg->res_type;
-
-    SERVER_GOTO_IF_COND(!sel4gpi_rpc_check_cap(GPICAP_TYPE_PD), "Did not receive PD cap\n");
-
-    /* Find the source PD */
-    pd_component_registry_entry_t *src_pd_data = pd_component_registry_get_entry_by_badge(sender_badge);
-    SERVER_GOTO_IF_COND_BG(src_pd_data == NULL, sender_badge, "Failed to find source PD data ");
-
-    /* Find the destination PD */
-    seL4_Word dst_pd_badge = seL4_GetBadge(0);
-    pd_component_registry_entry_t *dst_pd_data = pd_component_registry_get_entry_by_badge(dst_pd_badge);
-    SERVER_GOTO_IF_COND_BG(dst_pd_data == NULL, dst_pd_badge, "Failed to find dest PD data ");
+    linked_list_t *resources = NULL;
 
     /* Check for invalid sharing */
-    SERVER_GOTO_IF_COND(src_pd_data->pd.id == dst_pd_data->pd.id,
+    SERVER_GOTO_IF_COND(src_pd->id == dst_pd->id,
                         "Invalid sharing of resources between the same PD (%u -> %u)\n",
-                        src_pd_data->pd.id, dst_pd_data->pd.id);
+                        src_pd->id, dst_pd->id);
 
     // (XXX) Linh: currently only allow MOs to be bulk shared with another PD,
     //             a use-case for sharing other RT resource types is unclear
@@ -776,12 +976,12 @@ static void handle_share_resource_type_req(seL4_Word sender_badge,
                         cap_type_to_str(res_type));
 
     /* Share all resources of given type */
-    linked_list_t *resources = pd_get_resources_of_type(&src_pd_data->pd, res_type);
-    error = pd_bulk_add_resource(&dst_pd_data->pd, resources);
+    resources = pd_get_resources_of_type(src_pd, res_type);
+    error = pd_bulk_add_resource(dst_pd, resources);
     SERVER_GOTO_IF_ERR(error, "Error occurred during resource sharing (some may still have been successful)\n");
 
     OSDB_PRINTF("Shared %s resources between PDs (%u -> %u)\n", cap_type_to_str(res_type),
-                src_pd_data->pd.id, dst_pd_data->pd.id);
+                src_pd->id, dst_pd->id);
 
 err_goto:
     if (resources)
@@ -789,6 +989,346 @@ err_goto:
         linked_list_destroy(resources, false);
     }
 
+    return error;
+}
+
+/**
+ * Allocate an MO held by the client PD and attach it to the ADS for one VMR of a spawn request
+ * A STACK VMR gets a guard page below it, and the returned vaddr is the top of the stack
+ * The returned attach vaddr is the start of the VMR's attach node, for removing it later
+ * On failure, nothing allocated for the VMR is left behind
+ */
+static int pd_component_spawn_vmr(pd_t *client_pd,
+                                  ads_t *ads,
+                                  PdSpawnVmrConfig *vmr_cfg,
+                                  void **ret_vaddr,
+                                  void **ret_attach_vaddr,
+                                  mo_t **ret_mo,
+                                  seL4_CPtr *ret_mo_slot)
+{
+    int error = 0;
+    sel4utils_reservation_type_t vmr_type = (sel4utils_reservation_type_t)vmr_cfg->type;
+    size_t page_bits = vmr_type == SEL4UTILS_RES_TYPE_STACK || vmr_cfg->page_bits == 0 ? MO_PAGE_BITS
+                                                                                      : vmr_cfg->page_bits;
+    mo_component_registry_entry_t *mo_entry = NULL;
+    attach_node_t *reservation = NULL;
+
+    /* Allocate the MO for the sender, as sel4gpi_prepare_pd would */
+    mo_new_args_t alloc_args = {.num_pages = vmr_cfg->region_pages, .paddr = 0, .page_bits = page_bits};
+    error = resource_component_allocate(get_mo_component(), client_pd->id, BADGE_OBJ_ID_NULL, false,
+                                        (void *)&alloc_args, (resource_registry_node_t **)&mo_entry, ret_mo_slot);
+    SERVER_GOTO_IF_ERR(error, "Failed to allocate MO for %s VMR\n", human_readable_va_res_type(vmr_type));
+
+    if (vmr_type == SEL4UTILS_RES_TYPE_STACK)
+    {
+        /* reserve one extra page for the guard */
+        error = ads_reserve(ads, NULL, vmr_cfg->region_pages + 1, page_bits, vmr_type, 1, seL4_AllRights, &reservation);
+        SERVER_GOTO_IF_ERR(error, "Failed to reserve stack VMR\n");
+
+        error = ads_attach_to_res(ads, get_ads_component()->server_vka, reservation,
+                                  SIZE_BITS_TO_BYTES(page_bits), &mo_entry->mo);
+        SERVER_GOTO_IF_ERR(error, "Failed to attach MO to reserved stack\n");
+
+        *ret_attach_vaddr = reservation->vaddr;
+        *ret_vaddr = reservation->vaddr + (vmr_cfg->region_pages + 1) * SIZE_BITS_TO_BYTES(page_bits);
+    }
+    else
+    {
+        error = ads_component_attach(ads->id, mo_entry->mo.id, vmr_type, (void *)vmr_cfg->start, ret_vaddr);
+        SERVER_GOTO_IF_ERR(error, "Failed to attach MO for %s VMR\n", human_readable_va_res_type(vmr_type));
+
+        *ret_attach_vaddr = *ret_vaddr;
+    }
+
+    *ret_mo = &mo_entry->mo;
+
+err_goto:
+    if (error)
+    {
+        if (reservation)
+        {
+            ads_rm(ads, get_ads_component()->server_vka, reservation->vaddr);
+        }
+
+        if (mo_entry)
+        {
+            /* revokes the sender's cap and drops its hold, freeing the MO */
+            pd_delete_resource(client_pd, make_res_id(GPICAP_TYPE_MO, get_mo_component()->space_id,
+                                                      mo_entry->mo.id));
+            *ret_mo_slot = seL4_CapNull;
+        }
+    }
+
+    return error;
+}
+
+/**
+ * Remove the VMRs of one type that were attached to an ADS after `old_head` was the newest one
+ * Attach nodes are indexed at the head of their type's list, so the new ones are ahead of `old_head`
+ */
+static void pd_component_spawn_rm_new_vmrs(ads_t *ads, sel4utils_reservation_type_t type, attach_node_t *old_head)
+{
+    while (ads->res_by_type[type] != NULL && ads->res_by_type[type] != old_head)
+    {
+        resource_registry_delete(&ads->attach_registry, (resource_registry_node_t *)ads->res_by_type[type]);
+    }
+}
+
+/**
+ * Performs all the steps of sel4gpi_prepare_pd for a process-style configuration in one request:
+ * sets up the ADS, RDEs, core caps, fault EP, linkage, runtime, and CPU of a new PD
+ * On failure, the VMRs, MOs, and fault EP allocated for the sender are removed again,
+ * anything already given to the new PD is released when it is terminated
+ */
+static int pd_component_spawn(pd_t *client_pd,
+                              pd_t *pd,
+                              ads_t *ads,
+                              cpu_t *cpu,
+                              seL4_Word pd_badge,
+                              seL4_Word ads_badge,
+                              seL4_Word cpu_badge,
+                              PdSpawnMessage *msg,
+                              PdSpawnReturnMessage *ret)
+{
+    int error = 0;
+    void *osm_data = NULL;
+    void *entry_point = NULL;
+    void *stack_top = NULL;
+    void *ipc_buf_addr = NULL;
+    mo_t *ipc_buf_mo = NULL;
+    bool pending_work;
+    seL4_CPtr slot;
+
+    /* Track what was set up, to undo it on failure */
+    void *vmr_attach_addrs[PD_SPAWN_MAX_VMRS] = {0};
+    int n_vmrs = 0;
+    bool loaded_elf = false;
+    attach_node_t *old_code_head = ads->res_by_type[SEL4UTILS_RES_TYPE_CODE];
+    attach_node_t *old_data_head = ads->res_by_type[SEL4UTILS_RES_TYPE_DATA];
+    ep_t *fault_ep = NULL;
+    seL4_CPtr fault_ep_raw_in_client = seL4_CapNull;
+    seL4_CPtr fault_ep_in_client = seL4_CapNull;
+
+    SERVER_GOTO_IF_COND(msg->vmrs_count > PD_SPAWN_MAX_VMRS, "Too many VMRs to spawn PD (%d)\n", msg->vmrs_count);
+
+    /* Attach the OSmosis data MO */
+    error = ads_component_attach(ads->id, pd->shared_data_mo_id, SEL4UTILS_RES_TYPE_OSM_DATA, NULL, &osm_data);
+    SERVER_GOTO_IF_ERR(error, "Failed to attach OSmosis data MO to PD's ADS\n");
+
+    /* Configure the VMRs */
+    for (int i = 0; i < msg->vmrs_count; i++)
+    {
+        PdSpawnVmrConfig *vmr_cfg = &msg->vmrs[i];
+        void *vmr_addr = NULL;
+        mo_t *mo = NULL;
+        seL4_CPtr mo_slot = seL4_CapNull;
+
+        if (vmr_cfg->type == SEL4UTILS_RES_TYPE_CODE)
+        {
+            loaded_elf = true;
+            error = ads_component_load_elf(ads, pd, msg->image_name, &entry_point);
+            SERVER_GOTO_IF_ERR(error, "Failed to load ELF (%s)\n", msg->image_name);
+        }
+        else
+        {
+            error = pd_component_spawn_vmr(client_pd, ads, vmr_cfg, &vmr_addr, &vmr_attach_addrs[i], &mo, &mo_slot);
+            SERVER_GOTO_IF_ERR(error, "Failed to configure VMR %d\n", i);
+        }
+        n_vmrs = i + 1;
+
+        if (vmr_cfg->type == SEL4UTILS_RES_TYPE_STACK)
+        {
+            stack_top = vmr_addr;
+        }
+        else if (vmr_cfg->type == SEL4UTILS_RES_TYPE_IPC_BUF)
+        {
+            ipc_buf_addr = vmr_addr;
+            ipc_buf_mo = mo;
+        }
+
+        ret->vmr_starts[i] = (uint64_t)vmr_addr;
+        ret->mo_slots[i] = mo_slot;
+        ret->mo_ids[i] = mo == NULL ? 0 : mo->id;
+    }
+    ret->vmr_starts_count = msg->vmrs_count;
+    ret->mo_slots_count = msg->vmrs_count;
+    ret->mo_ids_count = msg->vmrs_count;
+
+    SERVER_GOTO_IF_COND(pd->num_elf_phdrs == 0, "Spawn requires an ELF to be loaded for the PD\n");
+    SERVER_GOTO_IF_COND(stack_top == NULL, "Spawn requires a stack VMR\n");
+
+    if (msg->entry_point)
+    {
+        entry_point = (void *)msg->entry_point;
+    }
+
+    /* Share the RDEs */
+    for (int i = 0; i < msg->rdes_count; i++)
+    {
+        int rde_err = pd_component_share_rde(client_pd, pd, msg->rdes[i].res_type, msg->rdes[i].space_id);
+        SERVER_WARN_IF_COND(rde_err, "Couldn't share RDE (type: %u, space ID: %u)\n",
+                            msg->rdes[i].res_type, msg->rdes[i].space_id);
+    }
+
+    /* Give the PD its core caps */
+    error = pd_send_cap(pd, client_pd, seL4_CapNull, seL4_CapNull, cpu_badge, &slot, true, true, &pending_work);
+    SERVER_GOTO_IF_ERR(error, "Failed to send CPU cap to PD\n");
+
+    error = pd_send_cap(pd, client_pd, seL4_CapNull, seL4_CapNull, ads_badge, &slot, true, true, &pending_work);
+    SERVER_GOTO_IF_ERR(error, "Failed to send ADS cap to PD\n");
+
+    error = pd_send_cap(pd, client_pd, seL4_CapNull, seL4_CapNull, pd_badge, &slot, true, true, &pending_work);
+    SERVER_GOTO_IF_ERR(error, "Failed to send PD cap to PD\n");
+
+    for (int i = 0; i < msg->res_types_count; i++)
+    {
+        int share_err = pd_component_share_resource_type(client_pd, pd, msg->res_types[i]);
+        SERVER_WARN_IF_COND(share_err, "Failed to share %s resources with PD\n",
+                            cap_type_to_str(msg->res_types[i]));
+    }
+
+    /* Allocate the fault EP for the sender, and give it to the PD */
+    error = ep_component_allocate(client_pd->id, &fault_ep_raw_in_client, &fault_ep_in_client, &fault_ep);
+    SERVER_GOTO_IF_ERR(error, "Couldn't allocate fault EP for PD\n");
+
+    seL4_Word fault_ep_badge = gpi_new_badge(GPICAP_TYPE_EP, 0x00, client_pd->id,
+                                             get_ep_component()->space_id, fault_ep->id);
+    error = pd_send_cap(pd, client_pd, fault_ep_in_client, seL4_CapNull, fault_ep_badge,
+                        &slot, true, true, &pending_work);
+    SERVER_GOTO_IF_ERR(error, "Failed to send fault EP to PD\n");
+
+    cspacepath_t fault_ep_raw_in_pd;
+    error = resource_component_transfer_cap(get_ep_component()->server_vka, pd->pd_vka,
+                                            fault_ep->endpoint_in_RT.cptr, &fault_ep_raw_in_pd, false, 0);
+    SERVER_GOTO_IF_ERR(error, "Failed to copy raw fault EP to PD\n");
+
+    ret->fault_ep_slot = fault_ep_in_client;
+    ret->fault_ep_raw_slot = fault_ep_raw_in_client;
+    ret->osm_data_addr = (uint64_t)osm_data;
+
+    if (msg->link_with_current)
+    {
+        int link_err = pd_add_linkage(client_pd, pd->id);
+        SERVER_WARN_IF_COND(link_err, "Failed to link PD with sender, it will not be terminated when sender exits\n");
+    }
+
+    /* Set up the runtime and CPU */
+    error = pd_component_runtime_setup(pd, ads, cpu, msg->args_count, (seL4_Word *)msg->args,
+                                       stack_top, entry_point, ipc_buf_addr, osm_data);
+    SERVER_GOTO_IF_ERR(error, "Failed to setup PD runtime\n");
+
+    error = cpu_component_configure(cpu, ads, pd, pd->cnode_guard, fault_ep_raw_in_pd.capPtr,
+                                    ipc_buf_mo, ipc_buf_addr, msg->cpu_prio);
+    SERVER_GOTO_IF_ERR(error, "Failed to configure CPU\n");
+
+err_goto:
+    if (error)
+    {
+        OSDB_PRINTF("Spawn failed, removing what was set up for the sender\n");
+
+        if (fault_ep)
+        {
+            /* the sender's badged cap and hold, the PD's copy goes with the PD */
+            pd_delete_resource(client_pd, make_res_id(GPICAP_TYPE_EP, get_ep_component()->space_id, fault_ep->id));
+            pd_clear_slot(client_pd, fault_ep_raw_in_client);
+            pd_free_slot(client_pd, fault_ep_raw_in_client);
+        }
+
+        for (int i = 0; i < n_vmrs; i++)
+        {
+            if (vmr_attach_addrs[i] != NULL)
+            {
+                ads_rm(ads, get_ads_component()->server_vka, vmr_attach_addrs[i]);
+                pd_delete_resource(client_pd, make_res_id(GPICAP_TYPE_MO, get_mo_component()->space_id,
+                                                          ret->mo_ids[i]));
+            }
+        }
+
+        if (loaded_elf)
+        {
+            pd_component_spawn_rm_new_vmrs(ads, SEL4UTILS_RES_TYPE_CODE, old_code_head);
+            pd_component_spawn_rm_new_vmrs(ads, SEL4UTILS_RES_TYPE_DATA, old_data_head);
+        }
+
+        if (osm_data)
+        {
+            ads_rm(ads, get_ads_component()->server_vka, osm_data);
+        }
+
+        memset(ret, 0, sizeof(*ret));
+    }
+
+    return error;
+}
+
+static void handle_spawn_req(seL4_Word sender_badge, PdSpawnMessage *msg, PdReturnMessage *reply_msg)
+{
+    OSDB_PRINTF("Got spawn request from client badge: ");
+    BADGE_PRINT(sender_badge);
+
+    int error = 0;
+    SERVER_GOTO_IF_COND(!sel4gpi_rpc_check_caps_2(GPICAP_TYPE_ADS, GPICAP_TYPE_CPU), "Did not receive ADS & CPU cap\n");
+
+    seL4_Word ads_badge = seL4_GetBadge(0);
+    seL4_Word cpu_badge = seL4_GetBadge(1);
+
+    /* Find the client PD */
+    gpi_obj_id_t client_id = get_client_id_from_badge(sender_badge);
+    pd_component_registry_entry_t *client_data = pd_component_registry_get_entry_by_id(client_id);
+    SERVER_GOTO_IF_COND(client_data == NULL, "Couldn't find client PD (%u)\n", client_id);
+
+    /* Find the target PD */
+    pd_component_registry_entry_t *target_pd = pd_component_registry_get_entry_by_badge(sender_badge);
+    SERVER_GOTO_IF_COND(target_pd == NULL, "Couldn't find target PD (%u)\n", get_object_id_from_badge(sender_badge));
+
+    /* Find the target ADS */
+    ads_component_registry_entry_t *target_ads = (ads_component_registry_entry_t *)
+        resource_component_registry_get_by_badge(get_ads_component(), ads_badge);
+    SERVER_GOTO_IF_COND(target_ads == NULL, "Couldn't find target ADS (%u)\n", get_object_id_from_badge(ads_badge));
+
+    /* Find the target CPU */
+    cpu_component_registry_entry_t *target_cpu = (cpu_component_registry_entry_t *)
+        resource_component_registry_get_by_badge(get_cpu_component(), cpu_badge);
+    SERVER_GOTO_IF_COND(target_cpu == NULL, "Couldn't find target CPU (%u)\n", get_object_id_from_badge(cpu_badge));
+
+    error = pd_component_spawn(&client_data->pd,
+                               &target_pd->pd,
+                               &target_ads->ads,
+                               &target_cpu->cpu,
+                               sender_badge,
+                               ads_badge,
+                               cpu_badge,
+                               msg,
+                               &reply_msg->msg.spawn);
+    SERVER_GOTO_IF_ERR(error, "Failed to spawn PD\n");
+
+err_goto:
+    reply_msg->which_msg = PdReturnMessage_spawn_tag;
+    reply_msg->errorCode = error;
+}
+
+static void handle_share_resource_type_req(seL4_Word sender_badge,
+                                           PdShareResTypeMessage *msg, PdReturnMessage *reply_msg)
+{
+    int error = 0;
+    OSDB_PRINTF("Got Share Resource Type Request: ");
+    BADGE_PRINT(sender_badge);
+    gpi_cap_t res_type = (gpi_cap_t)msg->res_type;
+
+    SERVER_GOTO_IF_COND(!sel4gpi_rpc_check_cap(GPICAP_TYPE_PD), "Did not receive PD cap\n");
+
+    /* Find the source PD */
+    pd_component_registry_entry_t *src_pd_data = pd_component_registry_get_entry_by_badge(sender_badge);
+    SERVER_GOTO_IF_COND_BG(src_pd_data == NULL, sender_badge, "Failed to find source PD data ");
+
+    /* Find the destination PD */
+    seL4_Word dst_pd_badge = seL4_GetBadge(0);
+    pd_component_registry_entry_t *dst_pd_data = pd_component_registry_get_entry_by_badge(dst_pd_badge);
+    SERVER_GOTO_IF_COND_BG(dst_pd_data == NULL, dst_pd_badge, "Failed to find dest PD data ");
+
+    error = pd_component_share_resource_type(&src_pd_data->pd, &dst_pd_data->pd, res_type);
+
+err_goto:
     reply_msg->which_msg = PdReturnMessage_basic_tag;
     reply_msg->errorCode = error;
 }
@@ -813,7 +1353,11 @@ static void handle_get_work_req(seL4_Word sender_badge, PdGetWorkMessage *msg, P
     int n_object_ids = sizeof(reply_msg->msg.work.object_ids) / sizeof(reply_msg->msg.work.object_ids[0]);
 
     // Order of pd pending work types gives the priority of different types of work
-    for (int i = 0; i < PdWorkAction_MAX; i++)
+    // Invalidations are collected by the PD's client libraries, separately from its other work
+    int first_action = msg->invalidations ? PdWorkAction_INVALIDATE : 0;
+    int end_action = msg->invalidations ? PdWorkAction_INVALIDATE + 1 : PdWorkAction_INVALIDATE;
+
+    for (int i = first_action; i < end_action; i++)
     {
         pd_work_entry_t *work_res;
         linked_list_t *list = pd_data->pending_work[i];
@@ -838,6 +1382,11 @@ static void handle_get_work_req(seL4_Word sender_badge, PdGetWorkMessage *msg, P
                 free(work_res);
             }
 
+            if (i == PdWorkAction_INVALIDATE)
+            {
+                pd_data->pd.shared_data->n_pending_invalidations = list->count;
+            }
+
             break;
         }
     }
@@ -875,22 +1424,22 @@ static void handle_send_subgraph_req(seL4_Word sender_badge, PdSendSubgraphMessa
         seL4_Word mo_badge = seL4_GetBadge(0);
         SERVER_GOTO_IF_COND(get_cap_type_from_badge(mo_badge) != GPICAP_TYPE_MO, "Provided cap was not an MO\n");
 
+        mo_component_registry_entry_t *mo_reg = (mo_component_registry_entry_t *)
+            resource_component_registry_get_by_id(get_mo_component(), get_object_id_from_badge(mo_badge));
+        SERVER_GOTO_IF_COND(mo_reg == NULL, "Couldn't find MO (%u)\n", get_object_id_from_badge(mo_badge));
+        size_t mo_size = (size_t)mo_reg->mo.num_pages * BIT(mo_reg->mo.page_bits);
+
         void *mo_vaddr;
         error = ads_component_attach_to_rt(get_object_id_from_badge(mo_badge), &mo_vaddr);
         SERVER_GOTO_IF_ERR(error, "Failed to attach MO to RT\n");
 
-        // Update model state's pointers
-        model_state_t *model_state = (model_state_t *)mo_vaddr;
-        gpi_model_state_component_t *old_mem_start = model_state->mem_start;
-        model_state->mem_start = (gpi_model_state_component_t *)(mo_vaddr + sizeof(model_state_t));
-        model_state->mem_ptr = model_state->mem_ptr - old_mem_start + model_state->mem_start;
-
-        // Combine with current model state
-        combine_model_states(get_gpi_server()->model_state, model_state);
+        // Combine the binary subgraph with current model state
+        int combine_error = combine_model_state_binary(get_gpi_server()->model_state, mo_vaddr, mo_size);
 
         /* Unattach the MO */
         error = ads_component_remove_from_rt(mo_vaddr);
         SERVER_GOTO_IF_ERR(error, "Failed to remove MO from RT\n");
+        SERVER_GOTO_IF_COND(combine_error, "Subgraph is not a valid binary model state\n");
     }
 
     // Update the pending model counter
@@ -914,7 +1463,7 @@ static void handle_send_subgraph_req(seL4_Word sender_badge, PdSendSubgraphMessa
             .errorCode = PdComponentError_NONE};
 
         seL4_MessageInfo_t dump_return_tag;
-        sel4gpi_rpc_reply(&get_pd_component()->rpc_env, (void *)&dump_return_msg, &dump_return_tag);
+        sel4gpi_rpc_reply(&get_pd_component()->rpc_env, (void *)&dump_return_msg, false, &dump_return_tag);
         seL4_Send(get_gpi_server()->model_extraction_reply, dump_return_tag);
 
         // Free the reply cap's slot
@@ -974,7 +1523,7 @@ static void handle_finish_work_req(seL4_Word sender_badge, PdFinishWorkMessage *
                 .errorCode = PdComponentError_NONE};
 
             seL4_MessageInfo_t return_tag;
-            sel4gpi_rpc_reply(&get_pd_component()->rpc_env, (void *)&return_msg, &return_tag);
+            sel4gpi_rpc_reply(&get_pd_component()->rpc_env, (void *)&return_msg, false, &return_tag);
             seL4_Send(get_gpi_server()->pd_termination_reply, return_tag);
 
             // Free the reply cap's slot
@@ -1003,7 +1552,7 @@ static void handle_finish_work_req(seL4_Word sender_badge, PdFinishWorkMessage *
             .errorCode = PdComponentError_NONE};
 
         seL4_MessageInfo_t return_tag;
-        sel4gpi_rpc_reply(&get_pd_component()->rpc_env, (void *)&return_msg, &return_tag);
+        sel4gpi_rpc_reply(&get_pd_component()->rpc_env, (void *)&return_msg, false, &return_tag);
         seL4_Send(get_gpi_server()->send_resource_reply, return_tag);
 
         // Free the reply cap's slot
@@ -1148,6 +1697,21 @@ static void pd_component_handle(void *msg_p,
         case PdMessage_dump_tag:
             handle_dump_cap_req(sender_badge, &msg->msg.dump, reply_msg, should_reply);
             break;
+        case PdMessage_dump_delta_tag:
+            handle_dump_delta_req(sender_badge, &msg->msg.dump_delta, reply_msg);
+            break;
+        case PdMessage_lease_slots_tag:
+            handle_lease_slots_req(sender_badge, &msg->msg.lease_slots, reply_msg);
+            break;
+        case PdMessage_return_slots_tag:
+            handle_return_slots_req(sender_badge, &msg->msg.return_slots, reply_msg);
+            break;
+        case PdMessage_invalidate_tag:
+            handle_invalidate_req(sender_badge, &msg->msg.invalidate, reply_msg);
+            break;
+        case PdMessage_accept_invalidations_tag:
+            handle_accept_invalidations_req(sender_badge, &msg->msg.accept_invalidations, reply_msg);
+            break;
         case PdMessage_share_rde_tag:
             handle_share_rde_req(sender_badge, &msg->msg.share_rde, reply_msg);
             break;
@@ -1195,6 +1759,9 @@ static void pd_component_handle(void *msg_p,
         case PdMessage_irq_handler_bind_tag:
             handle_irq_handler_bind_req(sender_badge, &msg->msg.irq_handler_bind, reply_msg);
             break;
+        case PdMessage_spawn_tag:
+            handle_spawn_req(sender_badge, &msg->msg.spawn, reply_msg);
+            break;
         default:
             SERVER_GOTO_IF_COND(1, "Unknown request received: %u\n", msg->which_msg);
             break;
@@ -1293,15 +1860,18 @@ int pd_component_resource_cleanup(gpi_res_id_t res_id)
 {
     int error = 0;
 
-    // Iterate over all live PDs
-    resource_registry_node_t *curr, *tmp;
-    HASH_ITER(hh, get_pd_component()->registry.head, curr, tmp)
+    // Only visit the PDs holding the resource
+    // Take a copy of their IDs, since removing the resource may change the holder index
+    size_t n_holders;
+    gpi_obj_id_t *holder_ids = pd_get_resource_holders(res_id, &n_holders);
+
+    for (size_t i = 0; i < n_holders; i++)
     {
-        pd_component_registry_entry_t *pd_entry = (pd_component_registry_entry_t *)curr;
+        pd_component_registry_entry_t *pd_entry = pd_component_registry_get_entry_by_id(holder_ids[i]);
 
-        if (pd_entry->pd.id == get_gpi_server()->rt_pd_id || pd_entry->pd.to_delete)
+        if (pd_entry == NULL || pd_entry->pd.id == get_gpi_server()->rt_pd_id || pd_entry->pd.to_delete)
         {
-            // Skip a PD currently being deleted
+            // Skip the root task, or a PD currently being deleted
             continue;
         }
 
@@ -1315,6 +1885,7 @@ int pd_component_resource_cleanup(gpi_res_id_t res_id)
     }
 
 err_goto:
+    free(holder_ids);
     return error;
 }
 
@@ -1489,6 +2060,39 @@ void pd_component_queue_notify_send_work(pd_component_registry_entry_t *pd_entry
     seL4_Signal(pd_entry->pd.badged_notification);
 }
 
+void pd_component_queue_invalidate_work(pd_component_registry_entry_t *pd_entry, pd_work_entry_t *work)
+{
+    assert(work != NULL);
+
+    linked_list_t *list = pd_entry->pending_work[PdWorkAction_INVALIDATE];
+    pd_work_entry_t *head = list->count > 0 ? linked_list_get_at_idx(list, 0) : NULL;
+
+    if (head != NULL && head->res_id.object_id == BADGE_OBJ_ID_NULL)
+    {
+        // The PD will already drop everything it has cached
+        free(work);
+        return;
+    }
+
+    if (list->count >= PD_INVALIDATE_WORK_MAX)
+    {
+        // Too many pending invalidations, replace them with one for all resources
+        while (list->count > 0)
+        {
+            linked_list_pop_head(list, (void **)&head);
+            free(head);
+        }
+
+        work->res_id.object_id = BADGE_OBJ_ID_NULL;
+    }
+
+    // Add to the list
+    linked_list_insert(list, (void *)work);
+
+    // The PD polls the count instead of being notified, since it need not be a resource server
+    pd_entry->pd.shared_data->n_pending_invalidations = list->count;
+}
+
 seL4_CPtr pd_component_create_ipc_bench_ep(void)
 {
     // Make a special badged endpoint just for IPC benchmark request
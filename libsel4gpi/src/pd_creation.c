@@ -273,6 +273,7 @@ int sel4gpi_ads_configure(ads_config_t *cfg,
             switch (vmr->share_mode)
             {
             case GPI_SHARED:
+            case GPI_COW:
                 /* shallow copying when we're in the same ADS doesn't make sense */
                 if (current_ads_id != runnable->ads.id)
                 {
@@ -432,6 +433,7 @@ int sel4gpi_prepare_pd(pd_config_t *cfg, sel4gpi_runnable_t *runnable, int argc,
 
     error = sel4gpi_ads_configure(&cfg->ads_cfg, runnable, &cfg->osm_data_mo, &runtime_context);
     GOTO_IF_ERR(error, "Failed to configure ADS\n");
+    cfg->osm_data = runtime_context.osm_data;
 
     error = rde_configure(cfg, runnable);
     GOTO_IF_ERR(error, "Failed to configure RDEs\n");
@@ -561,6 +563,53 @@ err_goto:
     return error;
 }
 
+/**
+ * @brief checks if a config can be prepared by a single spawn request to the PD component
+ * This is the case for process-style configs: an ELF is loaded, all VMRs are disjoint and allocated fresh,
+ * and the fault EP is allocated fresh and unbadged
+ */
+static bool can_spawn_pd(pd_config_t *cfg, sel4gpi_runnable_t *runnable)
+{
+    if (cfg->elevated_cpu || cfg->fault_ep.ep != seL4_CapNull || cfg->fault_ep_badge
+        || runnable->ads.id == sel4gpi_get_binded_ads_id() || cfg->ads_cfg.vmr_cfgs == NULL)
+    {
+        return false;
+    }
+
+    bool has_code = false;
+    for (linked_list_node_t *curr = cfg->ads_cfg.vmr_cfgs->head; curr != NULL; curr = curr->next)
+    {
+        vmr_config_t *vmr = (vmr_config_t *)curr->data;
+        if (vmr->share_mode != GPI_DISJOINT || vmr->mo.ep != seL4_CapNull)
+        {
+            return false;
+        }
+
+        has_code |= vmr->type == SEL4UTILS_RES_TYPE_CODE;
+    }
+
+    return has_code && cfg->ads_cfg.image_name != NULL
+           && cfg->ads_cfg.vmr_cfgs->count <= PD_SPAWN_MAX_VMRS
+           && (cfg->rde_cfg == NULL || cfg->rde_cfg->count <= PD_SPAWN_MAX_RDES)
+           && (cfg->gpi_res_type_cfg == NULL || cfg->gpi_res_type_cfg->count <= PD_SPAWN_MAX_RES_TYPES);
+}
+
+int sel4gpi_spawn_pd(pd_config_t *cfg, sel4gpi_runnable_t *runnable, int argc, seL4_Word *args)
+{
+    assert(cfg != NULL);
+    assert(runnable != NULL);
+    assert(argc == 0 || args != NULL);
+
+    if (!can_spawn_pd(cfg, runnable))
+    {
+        PD_CREATION_PRINT("Config cannot be spawned in one request, preparing PD step by step\n");
+        return sel4gpi_prepare_pd(cfg, runnable, argc, args);
+    }
+
+    PD_CREATION_PRINT("Spawning PD with image: %s\n", cfg->ads_cfg.image_name);
+    return pd_client_spawn(&runnable->pd, &runnable->ads, &runnable->cpu, cfg, argc, args);
+}
+
 int sel4gpi_start_pd(sel4gpi_runnable_t *runnable)
 {
     int error = 0;
@@ -572,6 +621,25 @@ err_goto:
     return error;
 }
 
+int sel4gpi_handle_cow_fault(sel4gpi_runnable_t *runnable, seL4_MessageInfo_t fault_tag)
+{
+    int error = 0;
+
+    GOTO_IF_COND(seL4_MessageInfo_get_label(fault_tag) != seL4_Fault_VMFault,
+                 "Not a VM fault (label %lu)\n", seL4_MessageInfo_get_label(fault_tag));
+
+    /* read the fault before the RPC overwrites the message registers */
+    void *fault_addr = (void *)seL4_GetMR(seL4_VMFault_Addr);
+    GOTO_IF_COND(!sel4gpi_is_write_fault(), "Not a write fault at %p\n", fault_addr);
+
+    PD_CREATION_PRINT("Resolving copy-on-write fault at %p\n", fault_addr);
+    error = ads_client_cow_fault(&runnable->ads, fault_addr);
+    GOTO_IF_ERR(error, "failed to resolve copy-on-write fault at %p\n", fault_addr);
+
+err_goto:
+    return error;
+}
+
 void sel4gpi_generate_proc_config(pd_config_t *proc_cfg, const char *image_name, size_t stack_pages, size_t heap_pages)
 {
     proc_cfg->ads_cfg.image_name = image_name;
@@ -711,6 +779,8 @@ char *sel4gpi_share_degree_to_str(gpi_share_degree_t share_deg)
         return "Shared";
     case GPI_DISJOINT:
         return "Disjoint";
+    case GPI_COW:
+        return "Copy-on-write";
     default:
         return "Invalid";
     }
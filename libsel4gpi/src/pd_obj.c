@@ -53,6 +53,135 @@ extern char _cpio_archive_end[];
 static int pd_setup_cspace(pd_t *pd, vka_t *vka);
 static int pd_dump_internal(pd_t *pd, model_state_t *ms);
 
+/* Hold nodes of every PD, indexed by the resource they hold */
+static pd_holder_index_t *holder_index = NULL;
+
+/**
+ * Add a new hold node to the global holder index, and to its PD's space index
+ */
+static int pd_index_hold_node(pd_t *pd, pd_hold_node_t *node)
+{
+    int error = 0;
+    gpi_badge_t res_key = node->gen.object_id;
+
+    pd_holder_index_t *holders;
+    HASH_FIND(hh, holder_index, &res_key, sizeof(gpi_badge_t), holders);
+    if (holders == NULL)
+    {
+        holders = calloc(1, sizeof(pd_holder_index_t));
+        SERVER_GOTO_IF_COND(holders == NULL, "Failed to allocate holder index entry\n");
+        holders->res_key = res_key;
+        HASH_ADD(hh, holder_index, res_key, sizeof(gpi_badge_t), holders);
+    }
+
+    pd_space_index_t *space;
+    HASH_FIND(hh, pd->hold_by_space, &node->res_id.space_id, sizeof(gpi_space_id_t), space);
+    if (space == NULL)
+    {
+        space = calloc(1, sizeof(pd_space_index_t));
+        SERVER_GOTO_IF_COND(space == NULL, "Failed to allocate space index entry\n");
+        space->space_id = node->res_id.space_id;
+        HASH_ADD(hh, pd->hold_by_space, space_id, sizeof(gpi_space_id_t), space);
+    }
+
+    node->pd = pd;
+
+    node->holder_prev = NULL;
+    node->holder_next = holders->head;
+    if (node->holder_next)
+    {
+        node->holder_next->holder_prev = node;
+    }
+    holders->head = node;
+    holders->count++;
+
+    node->space_prev = NULL;
+    node->space_next = space->head;
+    if (node->space_next)
+    {
+        node->space_next->space_prev = node;
+    }
+    space->head = node;
+    space->count++;
+
+    model_journal_record(&get_gpi_server()->model_journal, GPI_JOURNAL_ADD_EDGE, GPI_EDGE_TYPE_HOLD,
+                         get_pd_key(pd->id), get_resource_key(node->res_id), GPICAP_TYPE_NONE);
+
+err_goto:
+    if (error && holders && holders->head == NULL)
+    {
+        HASH_DEL(holder_index, holders);
+        free(holders);
+    }
+    return error;
+}
+
+/**
+ * Remove a hold node from the global holder index and its PD's space index
+ */
+static void pd_unindex_hold_node(pd_t *pd, pd_hold_node_t *node)
+{
+    if (node->pd == NULL)
+    {
+        // The node was never indexed
+        return;
+    }
+
+    gpi_badge_t res_key = node->gen.object_id;
+    pd_holder_index_t *holders;
+    HASH_FIND(hh, holder_index, &res_key, sizeof(gpi_badge_t), holders);
+    assert(holders != NULL);
+
+    if (node->holder_prev)
+    {
+        node->holder_prev->holder_next = node->holder_next;
+    }
+    else
+    {
+        holders->head = node->holder_next;
+    }
+
+    if (node->holder_next)
+    {
+        node->holder_next->holder_prev = node->holder_prev;
+    }
+
+    if (--holders->count == 0)
+    {
+        HASH_DEL(holder_index, holders);
+        free(holders);
+    }
+
+    pd_space_index_t *space;
+    HASH_FIND(hh, pd->hold_by_space, &node->res_id.space_id, sizeof(gpi_space_id_t), space);
+    assert(space != NULL);
+
+    if (node->space_prev)
+    {
+        node->space_prev->space_next = node->space_next;
+    }
+    else
+    {
+        space->head = node->space_next;
+    }
+
+    if (node->space_next)
+    {
+        node->space_next->space_prev = node->space_prev;
+    }
+
+    if (--space->count == 0)
+    {
+        HASH_DEL(pd->hold_by_space, space);
+        free(space);
+    }
+
+    model_journal_record(&get_gpi_server()->model_journal, GPI_JOURNAL_REMOVE_EDGE, GPI_EDGE_TYPE_HOLD,
+                         get_pd_key(pd->id), get_resource_key(node->res_id), GPICAP_TYPE_NONE);
+
+    node->pd = NULL;
+}
+
 int pd_add_resource(pd_t *pd, gpi_res_id_t res_id,
                     seL4_CPtr slot_in_RT, seL4_CPtr slot_in_PD, seL4_CPtr slot_in_serverPD)
 {
@@ -82,6 +211,13 @@ int pd_add_resource(pd_t *pd, gpi_res_id_t res_id,
         node->slot_in_ServerPD_Debug = slot_in_serverPD;
         node->gen.object_id = compact_id;
 
+        error = pd_index_hold_node(pd, node);
+        if (error)
+        {
+            free(node);
+            SERVER_GOTO_IF_ERR(error, "Failed to index hold node for PD\n");
+        }
+
         resource_registry_insert(&pd->hold_registry, (resource_registry_node_t *)node);
     }
 
@@ -156,34 +292,56 @@ int pd_delete_resource(pd_t *pd, gpi_res_id_t res_id)
 
 bool pd_has_resources_in_space(pd_t *pd, gpi_space_id_t space_id)
 {
-    // Search through the held resources, check if any belong to the given space ID
-    resource_registry_node_t *curr, *tmp;
-    HASH_ITER(hh, pd->hold_registry.head, curr, tmp)
-    {
-        if (((pd_hold_node_t *)curr)->res_id.space_id == space_id)
-        {
-            return true;
-        }
-    }
+    // The space index only keeps entries for spaces with held resources
+    pd_space_index_t *space;
+    HASH_FIND(hh, pd->hold_by_space, &space_id, sizeof(gpi_space_id_t), space);
 
-    return false;
+    return space != NULL;
 }
 
 int pd_remove_resources_in_space(pd_t *pd, gpi_space_id_t space_id)
 {
-    // Search through the held resources, delete any belonging to the given space ID
-    resource_registry_node_t *curr, *tmp;
-    HASH_ITER(hh, pd->hold_registry.head, curr, tmp)
+    // Delete the held resources of the given space ID until the index entry is gone
+    // Deleting one resource may cascade to others, so look up the entry again each time
+    pd_space_index_t *space;
+    HASH_FIND(hh, pd->hold_by_space, &space_id, sizeof(gpi_space_id_t), space);
+
+    while (space != NULL)
     {
-        if (((pd_hold_node_t *)curr)->res_id.space_id == space_id)
-        {
-            resource_registry_delete(&pd->hold_registry, curr);
-        }
+        resource_registry_delete(&pd->hold_registry, (resource_registry_node_t *)space->head);
+        HASH_FIND(hh, pd->hold_by_space, &space_id, sizeof(gpi_space_id_t), space);
     }
 
     return 0;
 }
 
+gpi_obj_id_t *pd_get_resource_holders(gpi_res_id_t res_id, size_t *ret_count)
+{
+    *ret_count = 0;
+
+    gpi_badge_t res_key = compact_res_id(res_id.type, res_id.space_id, res_id.object_id);
+    pd_holder_index_t *holders;
+    HASH_FIND(hh, holder_index, &res_key, sizeof(gpi_badge_t), holders);
+
+    if (holders == NULL)
+    {
+        return NULL;
+    }
+
+    gpi_obj_id_t *pd_ids = malloc(holders->count * sizeof(gpi_obj_id_t));
+    if (pd_ids == NULL)
+    {
+        return NULL;
+    }
+
+    for (pd_hold_node_t *node = holders->head; node != NULL; node = node->holder_next)
+    {
+        pd_ids[(*ret_count)++] = node->pd->id;
+    }
+
+    return pd_ids;
+}
+
 static int pd_rde_find_idx(pd_t *pd,
                            gpi_cap_t type,
                            gpi_space_id_t space_id)
@@ -232,6 +390,21 @@ void pd_add_type_name(pd_t *pd,
     strncpy(pd->shared_data->type_names[type.type], type_name, RESOURCE_TYPE_MAX_STRING_SIZE);
 }
 
+/**
+ * Record the request edge of an RDE in the model journal
+ * The edge goes to the PD that manages the RDE's space, as in a full model extraction
+ */
+static void pd_journal_rde(pd_t *pd, gpi_journal_op_t op, gpi_cap_t type, gpi_space_id_t space_id)
+{
+    resspc_component_registry_entry_t *rm = resource_space_get_entry_by_id(space_id);
+
+    if (rm != NULL)
+    {
+        model_journal_record(&get_gpi_server()->model_journal, op, GPI_EDGE_TYPE_REQUEST,
+                             get_pd_key(pd->id), get_pd_key(rm->space.pd_id), type);
+    }
+}
+
 int pd_add_rde(pd_t *pd,
                rde_type_t type,
                char *type_name,
@@ -305,6 +478,8 @@ int pd_add_rde(pd_t *pd,
     OSDB_PRINTF("Added new RDE of type %s to PD %u, in slot %u, with badge %lx\n", cap_type_to_str(type.type), client_id, (int)dest.capPtr, badge_val);
 
     pd->shared_data->rde_count++;
+
+    pd_journal_rde(pd, GPI_JOURNAL_ADD_EDGE, type.type, space_id);
     return 0;
 }
 
@@ -330,6 +505,7 @@ static int pd_remove_rde_by_idx(pd_t *pd, rde_type_t type, int idx)
 
     gpi_space_id_t space_id = pd->shared_data->rde[type.type][idx].space_id;
     OSDB_PRINTF("Removed RDE of type %s, space %u from PD (%u)\n", cap_type_to_str(type.type), space_id, pd->id);
+    pd_journal_rde(pd, GPI_JOURNAL_REMOVE_EDGE, type.type, space_id);
 
     // Clear the entry
     pd->shared_data->rde[type.type][idx].space_id = BADGE_SPACE_ID_NULL;
@@ -493,6 +669,8 @@ pd_held_resource_on_delete(resource_registry_node_t *node_gen, void *pd_v)
     gpi_res_id_t res_id = node->res_id;
     pd_t *pd = (pd_t *)pd_v;
 
+    pd_unindex_hold_node(pd, node);
+
     if (pd->id == get_gpi_server()->rt_pd_id)
     {
         // The root task doesn't keep refcounts, nothing to do here
@@ -567,6 +745,7 @@ pd_held_resource_on_delete(resource_registry_node_t *node_gen, void *pd_v)
             pd_work_entry_t *work_entry = calloc(1, sizeof(pd_work_entry_t));
             SERVER_GOTO_IF_COND(work_entry == NULL, "Failed to allocate work entry node\n");
             work_entry->res_id = res_id;
+            work_entry->client_pd_id = pd->id;
 
             OSDB_PRINTF("Queue work: notify resource server (%u) that resource " RES_ID_PRINTF " is freed from PD (%u).\n",
                         manager_pd_data->pd.id, RES_ID_PRINT_ARGS(res_id), pd->id);
@@ -613,6 +792,7 @@ void pd_initialize_registries(pd_t *pd)
     // Max ID for the hold registry is the BADGE_MAX - 1 because the keys are badges
     resource_registry_initialize(&pd->hold_registry, pd_held_resource_on_delete, (void *)pd, BADGE_MAX - 1);
     resource_registry_initialize(&pd->linked_registry, pd_linkage_on_delete, (void *)pd, BADGE_MAX - 1);
+    pd->hold_by_space = NULL;
 }
 
 int pd_new(pd_t *pd,
@@ -636,6 +816,7 @@ int pd_new(pd_t *pd,
     pd->shared_data->rde_count = 0;
     memset(pd->shared_data->rde, 0, sizeof(osmosis_rde_t) * MAX_PD_OSM_RDE);
     pd->shared_data->pd_conn.id = pd->id;
+    pd->shared_data->n_invalidation_pds = get_gpi_server()->n_invalidation_pds;
 
     // Setup the cspace
     error = pd_setup_cspace(pd, get_pd_component()->server_vka);
@@ -852,6 +1033,71 @@ int pd_free_slot(pd_t *pd,
     return 0;
 }
 
+int pd_lease_slots(pd_t *pd,
+                   uint32_t count,
+                   seL4_CPtr *base,
+                   uint32_t *n_slots)
+{
+    int error = pd_next_slot(pd, base);
+    SERVER_GOTO_IF_ERR(error, "Failed to allocate first slot of lease for PD %u\n", pd->id);
+
+    *n_slots = 1;
+
+    while (*n_slots < count)
+    {
+        seL4_CPtr slot;
+        if (pd_next_slot(pd, &slot) != 0)
+        {
+            break;
+        }
+
+        if (slot != *base + *n_slots)
+        {
+            // The allocator did not continue the range, give the slot back
+            pd_free_slot(pd, slot);
+            break;
+        }
+
+        (*n_slots)++;
+    }
+
+err_goto:
+    return error;
+}
+
+int pd_return_slots(pd_t *pd,
+                    seL4_CPtr base,
+                    uint64_t bitmap)
+{
+    int error = 0;
+
+    for (int i = 0; bitmap != 0; i++, bitmap >>= 1)
+    {
+        if (bitmap & 1)
+        {
+            // Deleting an empty slot succeeds, so a failure means the slot still holds a cap
+            // Keep such a slot allocated rather than handing it out again, and report the first error
+            int clear_err = pd_clear_slot(pd, base + i);
+            if (clear_err)
+            {
+                OSDB_PRINTERR("Failed to clear returned slot 0x%lx of PD %u (%d), not freeing it\n",
+                              base + i, pd->id, clear_err);
+                error = error ? error : clear_err;
+                continue;
+            }
+
+            int free_err = pd_free_slot(pd, base + i);
+            if (free_err)
+            {
+                OSDB_PRINTERR("Failed to free returned slot 0x%lx of PD %u (%d)\n", base + i, pd->id, free_err);
+                error = error ? error : free_err;
+            }
+        }
+    }
+
+    return error;
+}
+
 int pd_bootstrap_allocator(pd_t *pd,
                            seL4_CPtr root,
                            size_t start_slot,
@@ -1203,9 +1449,8 @@ static int res_dump(pd_t *pd, model_state_t *ms, pd_hold_node_t *current_cap, gp
                                 current_cap->res_id.space_id);
 
             /* Add the subset edge */
-            char space_id[CSV_MAX_STRING_SIZE];
-            get_resource_space_id(space_entry->space.resource_type, space_entry->space.id, space_id);
-            add_edge_by_id(ms, GPI_EDGE_TYPE_SUBSET, res_node->id, space_id);
+            add_edge_by_id(ms, GPI_EDGE_TYPE_SUBSET, res_node->id,
+                           get_resource_space_key(space_entry->space.resource_type, space_entry->space.id));
 
             /* Find the resource server */
             pd_component_registry_entry_t *manager_pd_entry =
@@ -1272,9 +1517,7 @@ static int pd_dump_internal(pd_t *pd, model_state_t *ms)
                 SERVER_GOTO_IF_COND(rm == NULL, "Couldn't find resource space (%u)\n", rde.space_id);
 
                 /* Add the resource server PD node */
-                char resource_manager_pd_id[CSV_MAX_STRING_SIZE];
-                get_pd_id(rm->space.pd_id, resource_manager_pd_id);
-                add_request_edge_by_id(ms, pd_node->id, resource_manager_pd_id, rde.type.type);
+                add_request_edge_by_id(ms, pd_node->id, get_pd_key(rm->space.pd_id), rde.type.type);
 
                 /* Request info about the space */
                 if (rm->space.pd_id != get_gpi_server()->rt_pd_id)
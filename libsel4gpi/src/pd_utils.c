@@ -1,12 +1,48 @@
+#include <autoconf.h>
 #include <sel4runtime.h>
 #include <sel4gpi/pd_clientapi.h>
 #include <sel4gpi/vmr_clientapi.h>
 #include <sel4gpi/mo_clientapi.h>
 #include <sel4gpi/error_handle.h>
 #include <sel4gpi/pd_utils.h>
+#include <sel4gpi/gpi_options.h>
 
 static seL4_CPtr reply_cap_slot = seL4_CapNull;
 
+#if PD_SLOT_LEASE_SIZE
+/* The lease state is per PD, so it lives in the PD's OSmosis data rather than in a global */
+static pd_slot_lease_t *slot_lease_find(seL4_CPtr slot)
+{
+    pd_slot_lease_t *slot_leases = sel4gpi_get_shared_data()->slot_leases;
+
+    for (int i = 0; i < PD_SLOT_MAX_LEASES; i++)
+    {
+        pd_slot_lease_t *lease = &slot_leases[i];
+        if (slot >= lease->base && slot < lease->base + PD_SLOT_LEASE_MAX &&
+            (lease->owned & (1ULL << (slot - lease->base))))
+        {
+            return lease;
+        }
+    }
+
+    return NULL;
+}
+
+static int slot_lease_return(pd_slot_lease_t *lease)
+{
+    pd_client_context_t pd_conn = sel4gpi_get_pd_conn();
+
+    int error = pd_client_return_slots(&pd_conn, lease->base, lease->free);
+    WARN_IF_COND(error, "Failed to return leased slots from 0x%lx, they are no longer used\n", lease->base);
+
+    // Some slots may have been freed by the RT even on failure, so none of them can be handed out again
+    lease->owned &= ~lease->free;
+    lease->free = 0;
+
+    return error;
+}
+#endif
+
 osm_pd_shared_data_t *sel4gpi_get_shared_data(void)
 {
     return (osm_pd_shared_data_t *)sel4runtime_get_osm_shared_data();
@@ -172,7 +208,6 @@ seL4_CPtr sel4gpi_get_reply_cap(void)
 void sel4gpi_clear_reply_cap(void)
 {
     int error = 0;
-    pd_client_context_t pd_conn = sel4gpi_get_pd_conn();
 
     // Set the data to null first in case we are killed while the slot is being cleared
     ((osm_pd_shared_data_t *)sel4runtime_get_osm_shared_data())->reply_cap = seL4_CapNull;
@@ -180,13 +215,13 @@ void sel4gpi_clear_reply_cap(void)
     if (reply_cap_slot == seL4_CapNull)
     {
         // Setup the initial cap reply slot
-        error = pd_client_next_slot(&pd_conn, &reply_cap_slot);
+        error = sel4gpi_alloc_slot(&reply_cap_slot);
         GOTO_IF_ERR(error, "Failed to allocate slot for reply cap\n");
     }
     else
     {
         // Clear the cap reply slot
-        error = pd_client_clear_slot(&pd_conn, reply_cap_slot);
+        error = sel4gpi_clear_slot(reply_cap_slot);
         GOTO_IF_ERR(error, "Failed to clear slot for reply cap\n");
     }
 
@@ -194,6 +229,119 @@ err_goto:
     return;
 }
 
+int sel4gpi_alloc_slot(seL4_CPtr *slot)
+{
+    int error = 0;
+    pd_client_context_t pd_conn = sel4gpi_get_pd_conn();
+
+#if PD_SLOT_LEASE_SIZE
+    pd_slot_lease_t *slot_leases = sel4gpi_get_shared_data()->slot_leases;
+    pd_slot_lease_t *unused = NULL;
+
+    for (int i = 0; i < PD_SLOT_MAX_LEASES; i++)
+    {
+        pd_slot_lease_t *lease = &slot_leases[i];
+        if (lease->free != 0)
+        {
+            int idx = __builtin_ctzll(lease->free);
+            lease->free &= ~(1ULL << idx);
+            *slot = lease->base + idx;
+            return 0;
+        }
+
+        if (lease->owned == 0 && unused == NULL)
+        {
+            unused = lease;
+        }
+    }
+
+    if (unused != NULL)
+    {
+        uint32_t n_slots;
+        error = pd_client_lease_slots(&pd_conn, PD_SLOT_LEASE_SIZE, &unused->base, &n_slots);
+        GOTO_IF_ERR(error, "Failed to lease slots\n");
+
+        // The first slot of the new lease is handed out right away
+        unused->owned = n_slots == PD_SLOT_LEASE_MAX ? ~0ULL : (1ULL << n_slots) - 1;
+        unused->free = unused->owned & ~1ULL;
+        *slot = unused->base;
+        return 0;
+    }
+
+    // Every lease is in use, fall back to a single slot
+#endif
+
+    error = pd_client_next_slot(&pd_conn, slot);
+
+err_goto:
+    return error;
+}
+
+int sel4gpi_free_slot(seL4_CPtr slot)
+{
+    pd_client_context_t pd_conn = sel4gpi_get_pd_conn();
+
+#if PD_SLOT_LEASE_SIZE
+    pd_slot_lease_t *slot_leases = sel4gpi_get_shared_data()->slot_leases;
+    pd_slot_lease_t *lease = slot_lease_find(slot);
+    if (lease != NULL)
+    {
+        // Ignore error from clear slot, error occurs if the slot was already empty
+        sel4gpi_clear_slot(slot);
+        lease->free |= 1ULL << (slot - lease->base);
+
+        if (lease->free != lease->owned)
+        {
+            return 0;
+        }
+
+        // Return a fully-free lease in bulk, unless it is the only one with free slots
+        for (int i = 0; i < PD_SLOT_MAX_LEASES; i++)
+        {
+            if (&slot_leases[i] != lease && slot_leases[i].free != 0)
+            {
+                return slot_lease_return(lease);
+            }
+        }
+
+        return 0;
+    }
+#endif
+
+    return pd_client_free_slot(&pd_conn, slot);
+}
+
+int sel4gpi_clear_slot(seL4_CPtr slot)
+{
+#if PD_SLOT_LEASE_SIZE
+    return seL4_CNode_Delete(PD_CAP_ROOT, slot, PD_CAP_DEPTH);
+#else
+    pd_client_context_t pd_conn = sel4gpi_get_pd_conn();
+    return pd_client_clear_slot(&pd_conn, slot);
+#endif
+}
+
+int sel4gpi_return_free_slots(void)
+{
+    int error = 0;
+
+#if PD_SLOT_LEASE_SIZE
+    pd_slot_lease_t *slot_leases = sel4gpi_get_shared_data()->slot_leases;
+
+    for (int i = 0; i < PD_SLOT_MAX_LEASES; i++)
+    {
+        if (slot_leases[i].free != 0)
+        {
+            error = slot_lease_return(&slot_leases[i]);
+            GOTO_IF_ERR(error, "Failed to return leased slots\n");
+        }
+    }
+
+err_goto:
+#endif
+    return error;
+}
+
 static void sel4gpi_exit_cb(int code)
 {
     /* Notify the pd component to destruct this PD */
@@ -331,3 +479,28 @@ int sel4gpi_copy_data_to_mo(void *vaddr, size_t size_bytes, mo_client_context_t
 err_goto:
     return error;
 }
+
+bool sel4gpi_is_write_fault(void)
+{
+    if (seL4_GetMR(seL4_VMFault_PrefetchFault))
+    {
+        return false;
+    }
+
+    seL4_Word fsr = seL4_GetMR(seL4_VMFault_FSR);
+#if defined(CONFIG_ARCH_X86)
+    /* page fault error code, W/R bit */
+    return fsr & BIT(1);
+#elif defined(CONFIG_ARCH_AARCH64)
+    /* ESR data abort ISS, WnR bit */
+    return fsr & BIT(6);
+#elif defined(CONFIG_ARCH_AARCH32)
+    /* DFSR, WnR bit */
+    return fsr & BIT(11);
+#elif defined(CONFIG_ARCH_RISCV)
+    /* scause, store/AMO access fault or store/AMO page fault */
+    return fsr == 7 || fsr == 15;
+#else
+#error "Unsupported architecture for sel4gpi_is_write_fault"
+#endif
+}
@@ -0,0 +1,195 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <sel4gpi/range_tree.h>
+
+static inline int height(range_tree_node_t *node)
+{
+    return node ? node->height : 0;
+}
+
+static inline void update_height(range_tree_node_t *node)
+{
+    int l = height(node->left);
+    int r = height(node->right);
+    node->height = (l > r ? l : r) + 1;
+}
+
+static range_tree_node_t *rotate_right(range_tree_node_t *node)
+{
+    range_tree_node_t *new_root = node->left;
+    node->left = new_root->right;
+    new_root->right = node;
+    update_height(node);
+    update_height(new_root);
+    return new_root;
+}
+
+static range_tree_node_t *rotate_left(range_tree_node_t *node)
+{
+    range_tree_node_t *new_root = node->right;
+    node->right = new_root->left;
+    new_root->left = node;
+    update_height(node);
+    update_height(new_root);
+    return new_root;
+}
+
+/**
+ * Restore the AVL balance of a subtree after one of its children changed height by at most one
+ */
+static range_tree_node_t *rebalance(range_tree_node_t *node)
+{
+    update_height(node);
+    int balance = height(node->left) - height(node->right);
+
+    if (balance > 1)
+    {
+        if (height(node->left->left) < height(node->left->right))
+        {
+            node->left = rotate_left(node->left);
+        }
+        return rotate_right(node);
+    }
+
+    if (balance < -1)
+    {
+        if (height(node->right->right) < height(node->right->left))
+        {
+            node->right = rotate_right(node->right);
+        }
+        return rotate_left(node);
+    }
+
+    return node;
+}
+
+static range_tree_node_t *insert_node(range_tree_node_t *root, range_tree_node_t *node)
+{
+    if (root == NULL)
+    {
+        return node;
+    }
+
+    if (node->start < root->start)
+    {
+        root->left = insert_node(root->left, node);
+    }
+    else
+    {
+        root->right = insert_node(root->right, node);
+    }
+
+    return rebalance(root);
+}
+
+static range_tree_node_t *remove_min(range_tree_node_t *root, range_tree_node_t **ret_min)
+{
+    if (root->left == NULL)
+    {
+        *ret_min = root;
+        return root->right;
+    }
+
+    root->left = remove_min(root->left, ret_min);
+    return rebalance(root);
+}
+
+static range_tree_node_t *remove_node(range_tree_node_t *root, range_tree_node_t *node)
+{
+    if (root == NULL)
+    {
+        return NULL;
+    }
+
+    if (node->start < root->start)
+    {
+        root->left = remove_node(root->left, node);
+    }
+    else if (node->start > root->start)
+    {
+        root->right = remove_node(root->right, node);
+    }
+    else
+    {
+        // Ranges do not overlap, so starts are unique
+        assert(root == node);
+
+        if (root->left == NULL)
+        {
+            return root->right;
+        }
+
+        if (root->right == NULL)
+        {
+            return root->left;
+        }
+
+        // Replace the node with its successor
+        range_tree_node_t *successor;
+        range_tree_node_t *right = remove_min(root->right, &successor);
+        successor->left = root->left;
+        successor->right = right;
+        return rebalance(successor);
+    }
+
+    return rebalance(root);
+}
+
+int range_tree_insert(range_tree_t *tree, range_tree_node_t *node)
+{
+    if (node->start >= node->end || range_tree_find_overlap(tree, node->start, node->end) != NULL)
+    {
+        return 1;
+    }
+
+    node->left = NULL;
+    node->right = NULL;
+    node->height = 1;
+    tree->root = insert_node(tree->root, node);
+    tree->count++;
+
+    return 0;
+}
+
+void range_tree_remove(range_tree_t *tree, range_tree_node_t *node)
+{
+    assert(tree->count > 0);
+
+    tree->root = remove_node(tree->root, node);
+    tree->count--;
+
+    node->left = NULL;
+    node->right = NULL;
+    node->height = 0;
+}
+
+range_tree_node_t *range_tree_find_overlap(range_tree_t *tree, uintptr_t start, uintptr_t end)
+{
+    range_tree_node_t *found = NULL;
+    range_tree_node_t *curr = tree->root;
+
+    while (curr != NULL)
+    {
+        if (curr->end <= start)
+        {
+            curr = curr->right;
+        }
+        else if (curr->start >= end)
+        {
+            curr = curr->left;
+        }
+        else
+        {
+            // Overlaps, but an earlier range may overlap as well
+            found = curr;
+            curr = curr->left;
+        }
+    }
+
+    return found;
+}
+
+range_tree_node_t *range_tree_find(range_tree_t *tree, uintptr_t addr)
+{
+    return range_tree_find_overlap(tree, addr, addr + 1);
+}
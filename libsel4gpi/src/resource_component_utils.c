@@ -62,11 +62,13 @@ void resource_component_handle(resource_component_context_t *component,
     int error = 0;
     bool needs_new_receive_slot = false;
     bool should_reply = true;
+    bool raw;
 
-    char rpc_msg_buf[RPC_MSG_MAX_SIZE] = {0};
+    // Both decoders clear every request field before decoding, so only the reply needs to be zeroed
+    char rpc_msg_buf[RPC_MSG_MAX_SIZE];
     char rpc_reply_buf[RPC_MSG_MAX_SIZE] = {0};
 
-    error = sel4gpi_rpc_recv(&component->rpc_env, (void *)rpc_msg_buf);
+    error = sel4gpi_rpc_recv(&component->rpc_env, tag, (void *)rpc_msg_buf, &raw);
     assert(error == 0);
 
 #if MESSAGE_DEBUG_ENABLED
@@ -75,6 +77,8 @@ void resource_component_handle(resource_component_context_t *component,
 #endif
 
     // Handle the message
+    // Components access each other's registries, so only decoding and replying run outside the lock
+    gpi_server_lock();
     component->request_handler(
         (void *)rpc_msg_buf,
         sender_badge,
@@ -83,20 +87,21 @@ void resource_component_handle(resource_component_context_t *component,
         &needs_new_receive_slot,
         &should_reply);
 
-    // Send the reply
-    if (should_reply)
+    // Allocate a new receive slot if needed
+    if (needs_new_receive_slot)
     {
-        seL4_MessageInfo_t reply_tag;
-        error = sel4gpi_rpc_reply(&component->rpc_env, (void *)rpc_reply_buf, &reply_tag);
+        error = vka_cspace_alloc_path(component->server_vka, received_cap);
         assert(error == 0);
-        resource_component_reply(component, reply_tag);
     }
+    gpi_server_unlock();
 
-    // Allocate a new receive slot if needed
-    if (needs_new_receive_slot)
+    // Send the reply
+    if (should_reply)
     {
-        error = vka_cspace_alloc_path(component->server_vka, received_cap);
+        seL4_MessageInfo_t reply_tag;
+        error = sel4gpi_rpc_reply(&component->rpc_env, (void *)rpc_reply_buf, raw, &reply_tag);
         assert(error == 0);
+        resource_component_reply(component, reply_tag);
     }
 }
 
@@ -130,19 +130,19 @@ static void resource_server_reply(resource_server_context_t *context,
 static int resource_server_next_slot(resource_server_context_t *context,
                                      seL4_CPtr *slot)
 {
-    return pd_client_next_slot(&context->pd_conn, slot);
+    return sel4gpi_alloc_slot(slot);
 }
 
 static int resource_server_free_slot(resource_server_context_t *context,
                                      seL4_CPtr slot)
 {
-    return pd_client_free_slot(&context->pd_conn, slot);
+    return sel4gpi_free_slot(slot);
 }
 
 static int resource_server_clear_slot(resource_server_context_t *context,
                                       seL4_CPtr slot)
 {
-    return pd_client_clear_slot(&context->pd_conn, slot);
+    return sel4gpi_clear_slot(slot);
 }
 
 int resource_server_main(void *context_v)
@@ -261,6 +261,20 @@ int resource_server_main(void *context_v)
 
                 if (work.action != PdWorkAction_NO_WORK)
                 {
+                    // Drop cached MOs of clients that freed their resources, or of all clients
+                    // if a space is destroyed, so their MOs are not kept alive by the server
+                    if (work.action == PdWorkAction_FREE)
+                    {
+                        for (int i = 0; i < work.pd_ids_count; i++)
+                        {
+                            resource_server_release_client_mos(context, work.pd_ids[i]);
+                        }
+                    }
+                    else if (work.action == PdWorkAction_DESTROY)
+                    {
+                        resource_server_release_client_mos(context, BADGE_OBJ_ID_NULL);
+                    }
+
                     context->work_handler(&work);
                 }
                 else
@@ -280,8 +294,9 @@ int resource_server_main(void *context_v)
         /* Decode the message */
         char rpc_msg_buf[RPC_MSG_MAX_SIZE];
         char rpc_reply_buf[RPC_MSG_MAX_SIZE];
+        bool raw;
 
-        error = sel4gpi_rpc_recv(&context->rpc_env, (void *)rpc_msg_buf);
+        error = sel4gpi_rpc_recv(&context->rpc_env, tag, (void *)rpc_msg_buf, &raw);
         assert(error == 0);
 
         if (context->debug_print)
@@ -298,7 +313,7 @@ int resource_server_main(void *context_v)
 
         /* Reply to message */
         seL4_MessageInfo_t reply_tag;
-        error = sel4gpi_rpc_reply(&context->rpc_env, (void *)rpc_reply_buf, &reply_tag);
+        error = sel4gpi_rpc_reply(&context->rpc_env, (void *)rpc_reply_buf, raw, &reply_tag);
         assert(error == 0);
         resource_server_reply(context, reply_tag);
 
@@ -328,7 +343,8 @@ exit_main:
  */
 int resource_server_attach_mo(resource_server_context_t *context,
                               seL4_CPtr mo_cap,
-                              void **vaddr)
+                              void **vaddr,
+                              size_t *size)
 {
     int error = 0;
     mo_client_context_t mo_conn;
@@ -343,6 +359,11 @@ int resource_server_attach_mo(resource_server_context_t *context,
                                          vaddr);
     CHECK_ERROR(error, "failed to attach client's MO to ADS");
 
+    if (size != NULL)
+    {
+        *size = mo_conn.size;
+    }
+
     return error;
 }
 
@@ -364,6 +385,96 @@ int resource_server_unattach(resource_server_context_t *context,
     return error;
 }
 
+int resource_server_attach_client_mo(resource_server_context_t *context,
+                                     gpi_obj_id_t client_id,
+                                     gpi_obj_id_t mo_id,
+                                     seL4_CPtr mo_cap,
+                                     void **vaddr,
+                                     size_t *size)
+{
+    int error = 0;
+    resource_server_mo_cache_entry_t *victim = &context->mo_cache[0];
+
+    context->mo_cache_clock++;
+
+    for (int i = 0; i < RESOURCE_SERVER_MO_CACHE_SIZE; i++)
+    {
+        resource_server_mo_cache_entry_t *entry = &context->mo_cache[i];
+
+        if (entry->valid && entry->client_id == client_id && entry->mo_id == mo_id)
+        {
+            entry->last_used = context->mo_cache_clock;
+            *vaddr = entry->vaddr;
+            if (size != NULL)
+            {
+                *size = entry->size;
+            }
+            return 0;
+        }
+
+        // Prefer an empty entry, otherwise the least recently used one
+        if (victim->valid && (!entry->valid || entry->last_used < victim->last_used))
+        {
+            victim = entry;
+        }
+    }
+
+    RESOURCE_SERVER_PRINTF("MO cache miss for MO (%u) of client (%u)\n", mo_id, client_id);
+    CHECK_ERROR(mo_cap == 0, "client did not attach MO for read/write op");
+
+    if (victim->valid)
+    {
+        error = resource_server_unattach(context, victim->vaddr);
+        CHECK_ERROR(error, "failed to evict cached client MO");
+        victim->valid = false;
+    }
+
+    mo_client_context_t mo_conn = {.ep = mo_cap};
+
+    error = vmr_client_attach_no_reserve(context->vmr_rde,
+                                         NULL,
+                                         &mo_conn,
+                                         SEL4UTILS_RES_TYPE_GENERIC,
+                                         vaddr);
+    CHECK_ERROR(error, "failed to attach client's MO to ADS");
+
+    // Use the real ID of the MO, in case the client gave the wrong one
+    victim->valid = true;
+    victim->client_id = client_id;
+    victim->mo_id = mo_conn.id;
+    victim->vaddr = *vaddr;
+    victim->size = mo_conn.size;
+    victim->last_used = context->mo_cache_clock;
+
+    if (size != NULL)
+    {
+        *size = mo_conn.size;
+    }
+
+    return error;
+}
+
+int resource_server_release_client_mos(resource_server_context_t *context,
+                                       gpi_obj_id_t client_id)
+{
+    int error = 0;
+
+    for (int i = 0; i < RESOURCE_SERVER_MO_CACHE_SIZE; i++)
+    {
+        resource_server_mo_cache_entry_t *entry = &context->mo_cache[i];
+
+        if (entry->valid && (client_id == BADGE_OBJ_ID_NULL || entry->client_id == client_id))
+        {
+            RESOURCE_SERVER_PRINTF("Releasing cached MO (%u) of client (%u)\n", entry->mo_id, entry->client_id);
+
+            entry->valid = false;
+            error |= resource_server_unattach(context, entry->vaddr);
+        }
+    }
+
+    return error;
+}
+
 int resource_server_create_resource(resource_server_context_t *context,
                                     resspc_client_context_t *space_conn,
                                     gpi_obj_id_t resource_id)
@@ -431,22 +542,18 @@ int resource_server_extraction_setup(resource_server_context_t *context,
     int error = 0;
 
     // Allocate an MO for the extraction
-    size_t mem_size = SIZE_BITS_TO_BYTES(MO_PAGE_BITS) * n_pages;
     error = mo_component_client_connect(sel4gpi_get_rde(GPICAP_TYPE_MO), n_pages, MO_PAGE_BITS, mo);
     CHECK_ERROR_GOTO(error, "failed to allocate MO for model extraction", err_goto);
 
-    void *mem_vaddr;
-    error = resource_server_attach_mo(context,
-                                      mo->ep,
-                                      &mem_vaddr);
-    CHECK_ERROR_GOTO(error, "failed to attach MO for model extraction", err_goto);
+    // Build the model state on the heap, it is only serialized to the MO when finished
+    *ms = calloc(1, sizeof(model_state_t));
+    CHECK_ERROR_GOTO(*ms == NULL, "failed to allocate model state", err_disconnect);
+    init_model_state(*ms);
 
-    // Initialize model state
-    *ms = (model_state_t *)mem_vaddr;
-    void *free_mem = mem_vaddr + sizeof(model_state_t);
-    size_t free_size = mem_size - sizeof(model_state_t);
-    init_model_state(*ms, free_mem, free_size);
+    return 0;
 
+err_disconnect:
+    mo_component_client_disconnect(mo);
 err_goto:
     return error;
 }
@@ -455,21 +562,45 @@ int resource_server_extraction_finish(resource_server_context_t *context, mo_cli
                                       model_state_t *ms, int n_requests)
 {
     int error = 0;
+    int cleanup_error = 0;
 
-    clean_model_state(ms);
+    /* Serialize the state to the MO */
+    void *mem_vaddr = NULL;
+    error = resource_server_attach_mo(context,
+                                      mo->ep,
+                                      &mem_vaddr,
+                                      NULL);
+    CHECK_ERROR_GOTO(error, "failed to attach MO for model extraction", err_goto);
+
+    error = serialize_model_state(ms, mem_vaddr, mo->size);
+    CHECK_ERROR_GOTO(error, "Model state does not fit in the MO for model extraction\n", err_goto);
 
     /* Send the state to the RT */
     pd_client_context_t pd_conn = sel4gpi_get_pd_conn();
     error = pd_client_send_subgraph(&pd_conn, mo, true, n_requests);
     CHECK_ERROR_GOTO(error, "Failed to send subgraph\n", err_goto);
 
-    /* Remove & destroy the MO */
-    error = resource_server_unattach(context, (void *)ms);
-    CHECK_ERROR_GOTO(error, "Failed to unattach MO for model extraction\n", err_goto);
-    error = mo_component_client_disconnect(mo);
-    CHECK_ERROR_GOTO(error, "Failed to delete MO for model extraction\n", err_goto);
-
 err_goto:
+    /* Remove & destroy the MO and model state, whether or not the state was sent */
+    if (mem_vaddr != NULL)
+    {
+        cleanup_error = resource_server_unattach(context, mem_vaddr);
+        if (cleanup_error)
+        {
+            ZF_LOGE(SERVER_UTILS ": Failed to unattach MO for model extraction, %d.", cleanup_error);
+            error = error ? error : cleanup_error;
+        }
+    }
+
+    cleanup_error = mo_component_client_disconnect(mo);
+    if (cleanup_error)
+    {
+        ZF_LOGE(SERVER_UTILS ": Failed to delete MO for model extraction, %d.", cleanup_error);
+        error = error ? error : cleanup_error;
+    }
+
+    destroy_model_state(ms);
+
     return error;
 }
 
@@ -507,13 +507,12 @@ gpi_model_node_t *resspc_dump_rr(res_space_t *space, model_state_t *ms, gpi_mode
     {
         // Add any map edges
         res_space_t *maps_to;
-        char maps_to_id[CSV_MAX_STRING_SIZE];
         for (linked_list_node_t *curr = space->map_spaces.head; curr != NULL; curr = curr->next)
         {
             maps_to = (res_space_t *)curr->data;
 
-            get_resource_space_id(maps_to->resource_type, maps_to->id, maps_to_id);
-            add_edge_by_id(ms, GPI_EDGE_TYPE_MAP, space_node->id, maps_to_id);
+            add_edge_by_id(ms, GPI_EDGE_TYPE_MAP, space_node->id,
+                           get_resource_space_key(maps_to->resource_type, maps_to->id));
         }
         space_node->extracted = true;
     }
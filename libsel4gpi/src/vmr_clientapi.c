@@ -82,8 +82,8 @@ int vmr_client_attach(ads_vmr_context_t *reservation,
 
     AdsReturnMessage ret_msg = {0};
 
-    error = sel4gpi_rpc_call(&rpc_env, reservation->ep, (void *)&msg,
-                             1, &mo->ep, (void *)&ret_msg);
+    error = sel4gpi_rpc_call_raw(&rpc_env, reservation->ep, (void *)&msg,
+                                 1, &mo->ep, (void *)&ret_msg);
     error |= ret_msg.errorCode;
 
     return error;
@@ -109,13 +109,15 @@ int vmr_client_attach_no_reserve(seL4_CPtr vmr_rde,
 
     AdsReturnMessage ret_msg = {0};
 
-    error = sel4gpi_rpc_call(&rpc_env, vmr_rde, (void *)&msg,
-                             1, &mo_cap->ep, (void *)&ret_msg);
+    error = sel4gpi_rpc_call_raw(&rpc_env, vmr_rde, (void *)&msg,
+                                 1, &mo_cap->ep, (void *)&ret_msg);
     error |= ret_msg.errorCode;
 
     if (!error)
     {
         *ret_vaddr = (void *)ret_msg.msg.attach_no_reserve.vaddr;
+        mo_cap->id = ret_msg.msg.attach_no_reserve.mo_id;
+        mo_cap->size = ret_msg.msg.attach_no_reserve.size;
     }
 
     return error;